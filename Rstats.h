@@ -1,3 +1,52 @@
+/* Range of cached small integer vectors(Rstats::Vector::shared_integer) */
+#define RSTATS_SMALL_INTEGER_MIN (-128)
+#define RSTATS_SMALL_INTEGER_MAX 1023
+
+/* Byte size of values stored in Rstats::Vector itself(two IV/NV, one complex or one character) */
+#define RSTATS_VECTOR_INLINE_SIZE 16
+
+/* Pool allocator(Rstats::Memory). Size classes are 16, 32, ..., 512 bytes */
+#define RSTATS_MEMORY_CLASS_COUNT 6
+#define RSTATS_MEMORY_MIN_CLASS_SIZE 16
+#define RSTATS_MEMORY_ARENA_SIZE 65536
+#define RSTATS_MEMORY_ALIGNMENT 64
+
+/* Vectors shorter than this are processed in the calling thread(Rstats::ThreadPool) */
+#define RSTATS_PARALLEL_MIN_LENGTH 65536
+
+/* Minimum bytes of a chunk of a file parsed by a thread(Rstats::TableReader) */
+#define RSTATS_READER_MIN_CHUNK_SIZE 1048576
+
+/* Alignment of buffers of binary file(Rstats::BinaryFile) and size of write buffer(Rstats::FileWriter) */
+#define RSTATS_BINARY_ALIGNMENT 64
+#define RSTATS_BINARY_BUFFER_SIZE 4194304
+
+/* Alignment of buffers of Arrow IPC file(Rstats::ArrowFile) */
+#define RSTATS_ARROW_ALIGNMENT 64
+
+/* Bytes of a mapped vector processed at once and memory for sorting before runs spill to a file(Rstats::VectorFunc) */
+#define RSTATS_MAPPED_CHUNK_SIZE 4194304
+#define RSTATS_SORT_MEMORY 268435456
+
+/* Entries of interned strings are in blocks whose sizes are doubled from this(Rstats::StringPool) */
+#define RSTATS_STRING_POOL_FIRST_BLOCK_SIZE 1024
+
+/* Rows formatted by a thread at once(Rstats::TableWriter) */
+#define RSTATS_WRITER_BLOCK_ROWS 8192
+
+/* Bytes of data which are read from a compressed file at once(Rstats::TableReader) */
+#define RSTATS_READER_SEGMENT_SIZE 16777216
+
+/* Decompressed blocks queued ahead of the parser(Rstats::Decompressor) */
+#define RSTATS_DECOMPRESS_BLOCK_SIZE 1048576
+#define RSTATS_DECOMPRESS_QUEUE_SIZE 16
+
+/* Significant digits of double to character conversion(same as R's as.character) */
+#define RSTATS_DOUBLE_DIGITS 15
+
+/* Buffer size which is enough for a formatted number(Rstats::Util::format_double) */
+#define RSTATS_NUMBER_BUFFER_SIZE 64
+
 namespace Rstats {
   
   // Rstats::PerlAPI
@@ -18,6 +67,10 @@ namespace Rstats {
     SV* new_mSVpv_nolen(const char* pv) {
       return sv_2mortal(newSVpvn(pv, strlen(pv)));
     }
+
+    SV* new_mSVpvn(const char* pv, STRLEN len) {
+      return sv_2mortal(newSVpvn(pv, len));
+    }
         
     SV* new_mSViv(IV iv) {
       return sv_2mortal(newSViv(iv));
@@ -175,1267 +228,2191 @@ namespace Rstats {
     };
   }
   
+  // Rstats::Memory
+  namespace Memory {
+    
+    struct FreeBlock {
+      FreeBlock* next;
+    };
+    
+    struct Pool {
+      FreeBlock* free_lists[RSTATS_MEMORY_CLASS_COUNT];
+      char* arena_pos;
+      char* arena_end;
+      IV class_in_use[RSTATS_MEMORY_CLASS_COUNT];
+      IV class_free[RSTATS_MEMORY_CLASS_COUNT];
+      IV arena_count;
+      IV large_in_use;
+      IV large_bytes;
+      std::mutex mutex;
+    };
+    
+    // One pool per process. Blocks can be allocated and freed by any thread(workers of Rstats::ThreadPool
+    // included), so the pool is locked and a block freed by another thread returns to the same free list.
+    // Arenas are never returned to the system.
+    Pool* get_pool() {
+      static Pool pool;
+      return &pool;
+    }
+    
+    IV get_class_index(size_t size) {
+      size_t class_size = RSTATS_MEMORY_MIN_CLASS_SIZE;
+      for (IV i = 0; i < RSTATS_MEMORY_CLASS_COUNT; i++) {
+        if (size <= class_size) {
+          return i;
+        }
+        class_size <<= 1;
+      }
+      return -1;
+    }
+    
+    size_t get_class_size(IV index) {
+      return (size_t)RSTATS_MEMORY_MIN_CLASS_SIZE << index;
+    }
+    
+    void* alloc_aligned(size_t size) {
+      void* ptr;
+      if (posix_memalign(&ptr, RSTATS_MEMORY_ALIGNMENT, size) != 0) {
+        croak("Can't allocate memory(Rstats::Memory::alloc_aligned())");
+      }
+      return ptr;
+    }
+    
+    // Small blocks come from size class free lists or arenas, large blocks are 64 byte aligned
+    void* alloc_block(size_t size) {
+      Pool* pool = get_pool();
+      IV index = get_class_index(size);
+      
+      if (index < 0) {
+        void* ptr = alloc_aligned(size);
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->large_in_use++;
+        pool->large_bytes += size;
+        return ptr;
+      }
+      
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      FreeBlock* block = pool->free_lists[index];
+      if (block != NULL) {
+        pool->free_lists[index] = block->next;
+        pool->class_free[index]--;
+        pool->class_in_use[index]++;
+        return block;
+      }
+      
+      // croak must not leave the pool locked
+      size_t class_size = get_class_size(index);
+      if (pool->arena_pos == NULL || pool->arena_pos + class_size > pool->arena_end) {
+        void* arena;
+        if (posix_memalign(&arena, RSTATS_MEMORY_ALIGNMENT, RSTATS_MEMORY_ARENA_SIZE) != 0) {
+          lock.unlock();
+          croak("Can't allocate memory(Rstats::Memory::alloc_block())");
+        }
+        pool->arena_pos = (char*)arena;
+        pool->arena_end = pool->arena_pos + RSTATS_MEMORY_ARENA_SIZE;
+        pool->arena_count++;
+      }
+      pool->class_in_use[index]++;
+      void* ptr = pool->arena_pos;
+      pool->arena_pos += class_size;
+      
+      return ptr;
+    }
+    
+    // size must be same as the size passed to alloc_block
+    void free_block(void* ptr, size_t size) {
+      if (ptr == NULL) {
+        return;
+      }
+      
+      Pool* pool = get_pool();
+      IV index = get_class_index(size);
+      
+      if (index < 0) {
+        {
+          std::lock_guard<std::mutex> lock(pool->mutex);
+          pool->large_in_use--;
+          pool->large_bytes -= size;
+        }
+        ::free(ptr);
+        return;
+      }
+      
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      FreeBlock* block = (FreeBlock*)ptr;
+      block->next = pool->free_lists[index];
+      pool->free_lists[index] = block;
+      pool->class_in_use[index]--;
+      pool->class_free[index]++;
+    }
+    
+    SV* get_stats() {
+      Pool* pool = get_pool();
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      
+      SV* sv_classes = Rstats::PerlAPI::new_mAVRV();
+      for (IV i = 0; i < RSTATS_MEMORY_CLASS_COUNT; i++) {
+        SV* sv_class = Rstats::PerlAPI::new_mHVRV();
+        Rstats::PerlAPI::hvrv_store_nolen_inc(sv_class, "size", Rstats::PerlAPI::new_mSViv(get_class_size(i)));
+        Rstats::PerlAPI::hvrv_store_nolen_inc(sv_class, "in_use", Rstats::PerlAPI::new_mSViv(pool->class_in_use[i]));
+        Rstats::PerlAPI::hvrv_store_nolen_inc(sv_class, "free", Rstats::PerlAPI::new_mSViv(pool->class_free[i]));
+        Rstats::PerlAPI::avrv_push_inc(sv_classes, sv_class);
+      }
+      
+      SV* sv_stats = Rstats::PerlAPI::new_mHVRV();
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_stats, "classes", sv_classes);
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_stats, "arena_count", Rstats::PerlAPI::new_mSViv(pool->arena_count));
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_stats, "arena_bytes", Rstats::PerlAPI::new_mSViv(pool->arena_count * RSTATS_MEMORY_ARENA_SIZE));
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_stats, "large_in_use", Rstats::PerlAPI::new_mSViv(pool->large_in_use));
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_stats, "large_bytes", Rstats::PerlAPI::new_mSViv(pool->large_bytes));
+      
+      return sv_stats;
+    }
+  }
+  
   // Rstats::Util header
   namespace Util {
+    // Value of a string parsed by parse_scalar. re is set for every number type and iv for logical and integer.
+    struct Scalar {
+      bool na;
+      IV iv;
+      NV re;
+      NV im;
+    };
+    Rstats::VectorType::Enum parse_scalar(const char*, STRLEN, Rstats::Util::Scalar&);
     SV* looks_like_na(SV*);
     SV* looks_like_integer(SV*);
     SV* looks_like_double(SV*);
     SV* looks_like_logical(SV*);
     SV* looks_like_complex(SV*);
+    bool is_ascii(const char*, STRLEN);
+    void latin1_to_utf8(const char*, STRLEN, std::string&);
+    void ascii_case_convert(const char*, STRLEN, char*, bool);
+    STRLEN count_utf8_chars(const char*, STRLEN);
+    STRLEN utf8_char_offset(const char*, STRLEN, STRLEN);
+    void append_code_point(std::string&, UV, bool);
+    STRLEN get_converted_length(const char*, STRLEN, bool);
+    char* write_converted(char*, const char*, STRLEN, bool);
+    char* format_double(char*, NV, IV);
+    char* format_integer(char*, IV);
   }
   
-  // Rstats::Vector
-  class Vector {
-    private:
-    Rstats::VectorType::Enum type;
-    std::map<IV, IV> na_positions;
-    void* values;
-    
-    public:
+  // Rstats::ThreadPool - workers for pure C++ tasks. Tasks must not call Perl API.
+  namespace ThreadPool {
     
-    ~Vector () {
-      IV length = this->get_length();
-      
-      Rstats::VectorType::Enum type = this->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER : {
-          std::vector<SV*>* values = this->get_character_values();
-          for (IV i = 0; i < length; i++) {
-            if ((*values)[i] != NULL) {
-              SvREFCNT_dec((*values)[i]);
+    struct Pool {
+      std::vector<std::thread> workers;
+      std::deque<std::function<void()> > tasks;
+      std::mutex mutex;
+      std::mutex run_mutex;
+      std::condition_variable task_ready;
+      std::condition_variable task_done;
+      IV pending;
+      
+      Pool () : pending(0) {}
+      
+      void work () {
+        while (true) {
+          std::function<void()> task;
+          {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (this->tasks.empty()) {
+              this->task_ready.wait(lock);
             }
+            task = this->tasks.front();
+            this->tasks.pop_front();
           }
-          delete values;
-          break;
-        }
-        case Rstats::VectorType::COMPLEX : {
-          std::vector<std::complex<NV> >* values = this->get_complex_values();
-          delete values;
-          break;
+          task();
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending--;
+          }
+          this->task_done.notify_all();
         }
-        case Rstats::VectorType::DOUBLE : {
-          std::vector<NV>* values = this->get_double_values();
-          delete values;
-          break;
+      }
+      
+      void ensure_workers (IV count) {
+        while ((IV)this->workers.size() < count) {
+          this->workers.push_back(std::thread(&Pool::work, this));
+          this->workers.back().detach();
         }
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL : {
-          std::vector<IV>* values = this->get_integer_values();
-          delete values;
+      }
+    };
+    
+    IV& thread_count_ref() {
+      static IV thread_count = 0;
+      return thread_count;
+    }
+    
+    // RSTATS_NUM_THREADS environment variable or count of CPU cores
+    IV get_thread_count() {
+      IV& thread_count = thread_count_ref();
+      if (thread_count == 0) {
+        const char* env = getenv("RSTATS_NUM_THREADS");
+        thread_count = env ? atoi(env) : (IV)std::thread::hardware_concurrency();
+        if (thread_count < 1) {
+          thread_count = 1;
         }
       }
+      return thread_count;
     }
-
-    SV* get_value(IV pos) {
-
-      SV* sv_value;
+    
+    void set_thread_count(IV thread_count) {
+      thread_count_ref() = thread_count < 1 ? 1 : thread_count;
+    }
+    
+    // The pool is never destructed because detached workers can be alive at exit.
+    // Workers are not copied by fork, so child process creates new pool.
+    Pool* get_pool() {
+      static Pool* pool = NULL;
+      static Pid_t pool_pid = 0;
+      if (pool == NULL || pool_pid != getpid()) {
+        pool = new Pool;
+        pool_pid = getpid();
+      }
+      return pool;
+    }
+    
+    // func(begin, end) is called for chunks of [0, length). The calling thread runs first chunk.
+    void parallel_for(IV length, const std::function<void(IV, IV)>& func, IV min_length = RSTATS_PARALLEL_MIN_LENGTH) {
+      IV thread_count = get_thread_count();
+      if (thread_count > length) {
+        thread_count = length;
+      }
+      if (thread_count <= 1 || length < min_length) {
+        func(0, length);
+        return;
+      }
       
-      Rstats::VectorType::Enum type = this->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          if (this->exists_na_position(pos)) {
-            sv_value = &PL_sv_undef;
-          }
-          else {
-            sv_value = this->get_character_value(pos);
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          if (this->exists_na_position(pos)) {
-            sv_value = &PL_sv_undef;
-          }
-          else {
-            std::complex<NV> z = this->get_complex_value(pos);
-            
-            NV re = z.real();
-            SV* sv_re;
-            if (std::isnan(re)) {
-              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
-            }
-            else if (std::isinf(re) && re > 0) {
-              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
-            }
-            else if (std::isinf(re) && re < 0) {
-              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
-            }
-            else {
-              sv_re = Rstats::PerlAPI::new_mSVnv(re);
-            }
-            
-            NV im = z.imag();
-            SV* sv_im;
-            if (std::isnan(im)) {
-              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
-            }
-            else if (std::isinf(im) && im > 0) {
-              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
-            }
-            else if (std::isinf(im) && im < 0) {
-              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
-            }
-            else {
-              sv_im = Rstats::PerlAPI::new_mSVnv(im);
-            }
-
-            sv_value = Rstats::PerlAPI::new_mHVRV();
-            Rstats::PerlAPI::hvrv_store_nolen_inc(sv_value, "re", sv_re);
-            Rstats::PerlAPI::hvrv_store_nolen_inc(sv_value, "im", sv_im);
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          if (this->exists_na_position(pos)) {
-            sv_value = &PL_sv_undef;
-          }
-          else {
-            NV value = this->get_double_value(pos);
-            if (std::isnan(value)) {
-              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
-            }
-            else if (std::isinf(value) && value > 0) {
-              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
-            }
-            else if (std::isinf(value) && value < 0) {
-              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
-            }
-            else {
-              sv_value = Rstats::PerlAPI::new_mSVnv(value);
-            }
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          if (this->exists_na_position(pos)) {
-            sv_value = &PL_sv_undef;
-          }
-          else {
-            IV value = this->get_integer_value(pos);
-            sv_value = Rstats::PerlAPI::new_mSViv(value);
-          }
-          break;
-        default:
-          sv_value = &PL_sv_undef;
+      Pool* pool = get_pool();
+      std::lock_guard<std::mutex> run_lock(pool->run_mutex);
+      pool->ensure_workers(thread_count - 1);
+      
+      IV chunk_length = (length + thread_count - 1) / thread_count;
+      {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        for (IV begin = chunk_length; begin < length; begin += chunk_length) {
+          IV end = begin + chunk_length < length ? begin + chunk_length : length;
+          pool->tasks.push_back(std::bind(func, begin, end));
+          pool->pending++;
+        }
       }
+      pool->task_ready.notify_all();
       
-      return sv_value;
+      func(0, chunk_length);
+      
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      while (pool->pending > 0) {
+        pool->task_done.wait(lock);
+      }
     }
+  }
+  
+  // Rstats::StringPool - strings shared by interned character vectors. One pool per process.
+  // Entries are in blocks which are never moved or freed, so any thread can read the string of an id
+  // which it holds without lock(workers of Rstats::ThreadPool included). Interning and reference
+  // counts are changed under the lock.
+  namespace StringPool {
     
-    SV* get_values() {
+    struct Entry {
+      std::string str;
+      IV refcnt;
+      bool utf8;
+    };
+    
+    struct Pool {
+      std::atomic<Entry*> blocks[32];
+      U64 entry_count;
+      std::unordered_map<std::string, U32> ids;
+      std::vector<U32> free_ids;
+      std::mutex mutex;
+      
+      // Id 0 is empty string, which is never freed
+      Pool () : entry_count(0) {
+        for (IV i = 0; i < 32; i++) {
+          this->blocks[i].store(NULL, std::memory_order_relaxed);
+        }
+        Entry& entry = this->add_entry();
+        entry.refcnt = 1;
+        entry.utf8 = false;
+        this->ids[std::string()] = 0;
+      }
       
-      IV length = this->get_length();
-      SV* sv_values = Rstats::PerlAPI::new_mAVRV();
-      for (IV i = 0; i < length; i++) {
-        Rstats::PerlAPI::avrv_push_inc(sv_values, this->get_value(i));
+      // Block b has FIRST_BLOCK_SIZE * 2^b entries from id FIRST_BLOCK_SIZE * (2^b - 1)
+      static IV get_block (U64 id) {
+        return 63 - __builtin_clzll(id / RSTATS_STRING_POOL_FIRST_BLOCK_SIZE + 1);
       }
       
-      return sv_values;
-    }
+      static U64 get_block_start (IV block) {
+        return ((U64)RSTATS_STRING_POOL_FIRST_BLOCK_SIZE << block) - RSTATS_STRING_POOL_FIRST_BLOCK_SIZE;
+      }
+      
+      Entry& get_entry (U32 id) {
+        IV block = get_block(id);
+        return this->blocks[block].load(std::memory_order_acquire)[id - get_block_start(block)];
+      }
+      
+      // Called with the lock
+      Entry& add_entry () {
+        U64 id = this->entry_count;
+        IV block = get_block(id);
+        if (id == get_block_start(block)) {
+          this->blocks[block].store(new Entry[(U64)RSTATS_STRING_POOL_FIRST_BLOCK_SIZE << block], std::memory_order_release);
+        }
+        this->entry_count++;
+        return this->get_entry(id);
+      }
+    };
     
-    bool is_character () { return this->get_type() == Rstats::VectorType::CHARACTER; }
-    bool is_complex () { return this->get_type() == Rstats::VectorType::COMPLEX; }
-    bool is_double () { return this->get_type() == Rstats::VectorType::DOUBLE; }
-    bool is_integer () { return this->get_type() == Rstats::VectorType::INTEGER; }
-    bool is_numeric () {
-      return this->get_type() == Rstats::VectorType::DOUBLE || this->get_type() == Rstats::VectorType::INTEGER;
+    // The pool is never destructed because workers can read it at exit
+    Pool* get_pool() {
+      static Pool* pool = new Pool;
+      return pool;
     }
-    bool is_logical () { return this->get_type() == Rstats::VectorType::LOGICAL; }
     
-    std::vector<SV*>* get_character_values() {
-      return (std::vector<SV*>*)this->values;
+    // Strings are kept as ASCII or UTF-8 so that same strings get same id
+    U32 intern(const char* str, STRLEN length, bool utf8) {
+      Pool* pool = get_pool();
+      
+      bool is_ascii = Rstats::Util::is_ascii(str, length);
+      std::string key;
+      if (is_ascii || utf8) {
+        key.assign(str, length);
+      }
+      else {
+        Rstats::Util::latin1_to_utf8(str, length, key);
+      }
+      
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      std::unordered_map<std::string, U32>::iterator it = pool->ids.find(key);
+      if (it != pool->ids.end()) {
+        if (it->second != 0) {
+          pool->get_entry(it->second).refcnt++;
+        }
+        return it->second;
+      }
+      
+      U32 id;
+      if (!pool->free_ids.empty()) {
+        id = pool->free_ids.back();
+        pool->free_ids.pop_back();
+      }
+      else {
+        if (pool->entry_count > 0xFFFFFFFF) {
+          lock.unlock();
+          croak("Too many interned strings(Rstats::StringPool::intern())");
+        }
+        id = pool->entry_count;
+        pool->add_entry();
+      }
+      
+      Entry& entry = pool->get_entry(id);
+      entry.str = key;
+      entry.refcnt = 1;
+      entry.utf8 = !is_ascii;
+      pool->ids[key] = id;
+      
+      return id;
     }
     
-    std::vector<std::complex<NV> >* get_complex_values() {
-      return (std::vector<std::complex<NV> >*)this->values;
+    void retain(U32 id) {
+      if (id != 0) {
+        Pool* pool = get_pool();
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->get_entry(id).refcnt++;
+      }
     }
     
-    std::vector<NV>* get_double_values() {
-      return (std::vector<NV>*)this->values;
+    void release(U32 id) {
+      if (id == 0) {
+        return;
+      }
+      
+      Pool* pool = get_pool();
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      Entry& entry = pool->get_entry(id);
+      entry.refcnt--;
+      if (entry.refcnt == 0) {
+        pool->ids.erase(entry.str);
+        std::string().swap(entry.str);
+        pool->free_ids.push_back(id);
+      }
     }
     
-    std::vector<IV>* get_integer_values() {
-      return (std::vector<IV>*)this->values;
+    const char* get_ptr(U32 id) {
+      return get_pool()->get_entry(id).str.data();
     }
     
-    Rstats::VectorType::Enum get_type() {
-      return this->type;
+    STRLEN get_length(U32 id) {
+      return get_pool()->get_entry(id).str.size();
     }
     
-    void add_na_position (IV position) {
-      this->na_positions[position] = 1;
+    bool is_utf8(U32 id) {
+      return get_pool()->get_entry(id).utf8;
     }
-
-    bool exists_na_position (IV position) {
-      return this->na_positions.count(position);
+    
+    IV get_count() {
+      Pool* pool = get_pool();
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      return pool->entry_count - pool->free_ids.size();
     }
+  }
+  
+  // Rstats::StringRef - place of a character element in the string arena of the vector
+  struct StringRef {
+    STRLEN offset;
+    STRLEN length;
+  };
+  
+  // Rstats::MappedFile - file mapped into memory. Vectors whose values are in the file share it.
+  // Read-only mapping shares pages with the page cache. The other mapping has private pages,
+  // so values can be changed without writing the file.
+  class MappedFile {
+    private:
+    void* map;
+    STRLEN size;
+    IV refcnt;
+    bool read_only;
     
-    void merge_na_positions (Rstats::Vector* elements) {
-      for(std::map<IV, IV>::iterator it = elements->na_positions.begin(); it != elements->na_positions.end(); ++it) {
-        this->add_na_position(it->first);
-      }
+    MappedFile (const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+    
+    public:
+    
+    MappedFile (void* map, STRLEN size, bool read_only) : map(map), size(size), refcnt(1), read_only(read_only) {}
+    
+    ~MappedFile () {
+      munmap(this->map, this->size);
     }
     
-    IV get_length () {
-      if (this->values == NULL) {
-        return 0;
+    // Map the whole file of the descriptor. Return NULL if the file is empty or can't be mapped.
+    static Rstats::MappedFile* map_fd (int fd, bool read_only) {
+      struct stat st;
+      if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return NULL;
+      }
+      void* map = mmap(NULL, st.st_size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, read_only ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        return NULL;
       }
       
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          return this->get_character_values()->size();
-          break;
-        case Rstats::VectorType::COMPLEX :
-          return this->get_complex_values()->size();
-          break;
-        case Rstats::VectorType::DOUBLE :
-          return this->get_double_values()->size();
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          return this->get_integer_values()->size();
-          break;
-      }
+      return new Rstats::MappedFile(map, st.st_size, read_only);
     }
-
-    static Rstats::Vector* new_character(IV length, SV* sv_str) {
-
-      Rstats::Vector* elements = Rstats::Vector::new_character(length);
-      for (IV i = 0; i < length; i++) {
-        elements->set_character_value(i, sv_str);
+    
+    // Map the whole file. Return NULL and set error if the file can't be mapped.
+    static Rstats::MappedFile* open (const char* file, std::string& error, bool read_only = false) {
+      int fd = ::open(file, O_RDONLY);
+      if (fd < 0) {
+        error = std::string("cannot open file '") + file + "': " + strerror(errno);
+        return NULL;
+      }
+      Rstats::MappedFile* mapped_file = map_fd(fd, read_only);
+      ::close(fd);
+      if (mapped_file == NULL) {
+        error = std::string("cannot map file '") + file + "'";
       }
-      elements->type = Rstats::VectorType::CHARACTER;
       
-      return elements;
+      return mapped_file;
     }
-
-    static Rstats::Vector* new_character(IV length) {
-
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<SV*>(length);
-      elements->type = Rstats::VectorType::CHARACTER;
-      
-      return elements;
+    
+    bool is_read_only () {
+      return this->read_only;
     }
-
-    SV* get_character_value(IV pos) {
-      SV* value = (*this->get_character_values())[pos];
-      if (value == NULL) {
-        return NULL;
+    
+    // Hint of access to the range(madvise). The range is expanded to the pages.
+    void advise (const void* ptr, STRLEN size, int advice) {
+      static const STRLEN page_size = sysconf(_SC_PAGESIZE);
+      STRLEN begin = ((const char*)ptr - (const char*)this->map) / page_size * page_size;
+      STRLEN end = (const char*)ptr - (const char*)this->map + size;
+      if (end > this->size) {
+        end = this->size;
       }
-      else {
-        return Rstats::PerlAPI::new_mSVsv(value);
+      if (end > begin) {
+        madvise((char*)this->map + begin, end - begin, advice);
       }
     }
     
-    void set_character_value(IV pos, SV* value) {
-      if (value != NULL) {
-        SvREFCNT_dec((*this->get_character_values())[pos]);
-      }
-      
-      SV* new_value = Rstats::PerlAPI::new_mSVsv(value);
-      (*this->get_character_values())[pos] = SvREFCNT_inc(new_value);
+    char* get_data () {
+      return (char*)this->map;
     }
-
-    static Rstats::Vector* new_complex(IV length) {
-      
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<std::complex<NV> >(length, std::complex<NV>(0, 0));
-      elements->type = Rstats::VectorType::COMPLEX;
-      
-      return elements;
+    
+    STRLEN get_size () {
+      return this->size;
     }
-        
-    static Rstats::Vector* new_complex(IV length, std::complex<NV> z) {
-      
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<std::complex<NV> >(length, z);
-      elements->type = Rstats::VectorType::COMPLEX;
-      
-      return elements;
+    
+    bool contains (const void* ptr) {
+      return ptr >= this->map && (const char*)ptr < (const char*)this->map + this->size;
     }
-
-    std::complex<NV> get_complex_value(IV pos) {
-      return (*this->get_complex_values())[pos];
+    
+    Rstats::MappedFile* inc_refcnt () {
+      this->refcnt++;
+      return this;
     }
     
-    void set_complex_value(IV pos, std::complex<NV> value) {
-      (*this->get_complex_values())[pos] = value;
+    void dec_refcnt () {
+      this->refcnt--;
+      if (this->refcnt <= 0) {
+        delete this;
+      }
     }
+  };
+  
+  // Rstats::FileWriter - buffered sequential writer of a file descriptor
+  struct FileWriter {
+    int fd;
+    U64 offset;
+    std::string buffer;
+    bool ok;
     
-    static Rstats::Vector* new_double(IV length) {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<NV>(length);
-      elements->type = Rstats::VectorType::DOUBLE;
+    FileWriter (int fd) : fd(fd), offset(0), ok(true) {}
+    
+    void flush () {
+      const char* p = this->buffer.data();
+      STRLEN rest = this->buffer.size();
+      while (this->ok && rest > 0) {
+        ssize_t size = ::write(this->fd, p, rest);
+        if (size < 0 && errno == EINTR) {
+          continue;
+        }
+        if (size <= 0) {
+          this->ok = false;
+          break;
+        }
+        p += size;
+        rest -= size;
+      }
+      this->buffer.clear();
+    }
+    
+    // Large data is written directly
+    U64 write (const void* data, STRLEN size) {
+      U64 offset = this->offset;
+      if (this->buffer.size() + size > RSTATS_BINARY_BUFFER_SIZE) {
+        this->flush();
+      }
+      if (size > RSTATS_BINARY_BUFFER_SIZE) {
+        const char* p = (const char*)data;
+        STRLEN rest = size;
+        while (this->ok && rest > 0) {
+          ssize_t written = ::write(this->fd, p, rest);
+          if (written < 0 && errno == EINTR) {
+            continue;
+          }
+          if (written <= 0) {
+            this->ok = false;
+            break;
+          }
+          p += written;
+          rest -= written;
+        }
+      }
+      else {
+        this->buffer.append((const char*)data, size);
+      }
+      this->offset += size;
       
-      return elements;
+      return offset;
+    }
+    
+    void align (STRLEN alignment) {
+      STRLEN padding = (alignment - this->offset % alignment) % alignment;
+      this->buffer.append(padding, '\0');
+      this->offset += padding;
     }
+  };
+  
+  // Rstats::Vector
+  class Vector {
+    private:
+    Rstats::VectorType::Enum type;
+    std::map<IV, IV> na_positions;
+    void* values;
+    IV length;
+    IV refcnt;
+    bool immortal;
+    
+    // Bytes of character elements. Overwritten strings stay until the vector is freed.
+    char* strings;
+    STRLEN strings_size;
+    STRLEN strings_capacity;
+    bool utf8;
+    
+    // Character elements are ids of Rstats::StringPool
+    bool interned;
+    
+    // Values and strings can be views of a mapped file. Views are not freed.
+    Rstats::MappedFile* mapped_file;
+    
+    // Short vectors keep values here instead of heap
+    union {
+      IV iv[RSTATS_VECTOR_INLINE_SIZE / sizeof(IV)];
+      NV nv[RSTATS_VECTOR_INLINE_SIZE / sizeof(NV)];
+      StringRef str[RSTATS_VECTOR_INLINE_SIZE / sizeof(StringRef)];
+      U32 id[RSTATS_VECTOR_INLINE_SIZE / sizeof(U32)];
+      char bytes[RSTATS_VECTOR_INLINE_SIZE];
+    } inline_values;
 
-    static Rstats::Vector* new_double(IV length, NV value) {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<NV>(length, value);
-      elements->type = Rstats::VectorType::DOUBLE;
+    // Vector is not copyable because values can point to inline_values
+    Vector (const Vector&);
+    Vector& operator=(const Vector&);
+
+    // Zero filled
+    void alloc_values (IV length, size_t element_size) {
+      size_t size = (size_t)length * element_size;
       
-      return elements;
+      this->length = length;
+      if (length == 0) {
+        this->values = NULL;
+      }
+      else if (size <= sizeof(this->inline_values)) {
+        memset(&this->inline_values, 0, sizeof(this->inline_values));
+        this->values = &this->inline_values;
+      }
+      else {
+        this->values = Rstats::Memory::alloc_block(size);
+        memset(this->values, 0, size);
+      }
+    }
+
+    bool is_mapped (const void* ptr) {
+      return this->mapped_file != NULL && this->mapped_file->contains(ptr);
     }
     
-    NV get_double_value(IV pos) {
-      return (*this->get_double_values())[pos];
+    void free_strings () {
+      if (this->strings != NULL && !this->is_mapped(this->strings)) {
+        Rstats::Memory::free_block(this->strings, this->strings_capacity);
+      }
     }
     
-    void set_double_value(IV pos, NV value) {
-      (*this->get_double_values())[pos] = value;
+    void free_values () {
+      if (this->values != NULL && !this->is_inline_values() && !this->is_mapped(this->values)) {
+        Rstats::Memory::free_block(this->values, (size_t)this->length * this->get_element_size());
+      }
+      this->values = NULL;
+      this->length = 0;
     }
 
-    static Rstats::Vector* new_integer(IV length) {
+    // Return offset of the copied string in arena
+    STRLEN append_string (const char* str, STRLEN length) {
+      if (this->strings_size + length > this->strings_capacity) {
+        // str can be a string of this vector
+        bool is_own_str = this->strings != NULL && str >= this->strings && str < this->strings + this->strings_size;
+        STRLEN own_offset = is_own_str ? str - this->strings : 0;
+        this->reserve_strings(length);
+        if (is_own_str) {
+          str = this->strings + own_offset;
+        }
+      }
       
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<IV>(length);
-      elements->type = Rstats::VectorType::INTEGER;
+      STRLEN offset = this->strings_size;
+      if (length > 0) {
+        memcpy(this->strings + offset, str, length);
+      }
+      this->strings_size += length;
       
-      return elements;
+      return offset;
     }
-
-    static Rstats::Vector* new_integer(IV length, IV value) {
+    
+    // Latin-1 strings to UTF-8 strings
+    void upgrade_strings () {
+      if (this->utf8) {
+        return;
+      }
+      this->utf8 = true;
       
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<IV>(length, value);
-      elements->type = Rstats::VectorType::INTEGER;
+      if (Rstats::Util::is_ascii(this->strings, this->strings_size)) {
+        return;
+      }
       
-      return elements;
-    }
-
-    IV get_integer_value(IV pos) {
-      return (*this->get_integer_values())[pos];
-    }
-    
-    void set_integer_value(IV pos, IV value) {
-      (*this->get_integer_values())[pos] = value;
+      char* old_strings = this->strings;
+      STRLEN old_capacity = this->strings_capacity;
+      this->strings = NULL;
+      this->strings_size = 0;
+      this->strings_capacity = 0;
+      
+      IV length = this->get_length();
+      StringRef* values = this->get_character_values();
+      std::string upgraded;
+      for (IV i = 0; i < length; i++) {
+        Rstats::Util::latin1_to_utf8(old_strings + values[i].offset, values[i].length, upgraded);
+        values[i].offset = this->append_string(upgraded.data(), upgraded.size());
+        values[i].length = upgraded.size();
+      }
+      if (!this->is_mapped(old_strings)) {
+        Rstats::Memory::free_block(old_strings, old_capacity);
+      }
     }
     
-    static Rstats::Vector* new_logical(IV length) {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<IV>(length);
-      elements->type = Rstats::VectorType::LOGICAL;
+    public:
+
+    // Space for more size bytes of character elements
+    void reserve_strings (STRLEN size) {
+      if (this->strings_size + size <= this->strings_capacity) {
+        return;
+      }
       
-      return elements;
+      STRLEN capacity = this->strings_capacity ? this->strings_capacity * 2 : 64;
+      while (capacity < this->strings_size + size) {
+        capacity *= 2;
+      }
+      
+      char* strings = (char*)Rstats::Memory::alloc_block(capacity);
+      if (this->strings != NULL) {
+        memcpy(strings, this->strings, this->strings_size);
+        this->free_strings();
+      }
+      this->strings = strings;
+      this->strings_capacity = capacity;
     }
 
-    static Rstats::Vector* new_logical(IV length, IV value) {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<IV>(length, value);
-      elements->type = Rstats::VectorType::LOGICAL;
-      
-      return elements;
+    Vector () : values(NULL), length(0), refcnt(1), immortal(false),
+      strings(NULL), strings_size(0), strings_capacity(0), utf8(false), interned(false), mapped_file(NULL) {}
+
+    static void* operator new (size_t size) {
+      return Rstats::Memory::alloc_block(size);
     }
-    
-    static Rstats::Vector* new_true() {
-      return new_logical(1, 1);
+
+    static void operator delete (void* ptr, size_t size) {
+      Rstats::Memory::free_block(ptr, size);
     }
 
-    static Rstats::Vector* new_false() {
-      return new_logical(1, 0);
+    size_t get_element_size () {
+      switch (this->get_type()) {
+        case Rstats::VectorType::CHARACTER :
+          return this->interned ? sizeof(U32) : sizeof(StringRef);
+        case Rstats::VectorType::COMPLEX :
+          return sizeof(std::complex<NV>);
+        case Rstats::VectorType::DOUBLE :
+          return sizeof(NV);
+        default:
+          return sizeof(IV);
+      }
     }
-    
-    static Rstats::Vector* new_nan() {
-      return  Rstats::Vector::new_double(1, NAN);
+
+    bool is_inline_values () {
+      return this->values == (void*)&this->inline_values;
     }
 
-    static Rstats::Vector* new_negative_inf() {
-      return Rstats::Vector::new_double(1, -(INFINITY));
+    Rstats::Vector* inc_refcnt () {
+      if (!this->immortal) {
+        this->refcnt++;
+      }
+      return this;
     }
-    
-    static Rstats::Vector* new_inf() {
-      return Rstats::Vector::new_double(1, INFINITY);
+
+    // Shared constant vectors are never freed
+    void dec_refcnt () {
+      if (this->immortal) {
+        return;
+      }
+
+      this->refcnt--;
+      if (this->refcnt <= 0) {
+        delete this;
+      }
     }
-    
-    static Rstats::Vector* new_na() {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = new std::vector<IV>(1, 0);
-      elements->type = Rstats::VectorType::LOGICAL;
-      elements->add_na_position(0);
-      
-      return elements;
+
+    bool is_immortal () {
+      return this->immortal;
     }
-    
-    static Rstats::Vector* new_null() {
-      Rstats::Vector* elements = new Rstats::Vector;
-      elements->values = NULL;
-      elements->type = Rstats::VectorType::LOGICAL;
-      return elements;
+
+    Rstats::Vector* to_immortal () {
+      this->immortal = true;
+      return this;
     }
 
-    Rstats::Vector* as (SV* sv_type) {
-      Rstats::Vector* e2;
-      if (SvOK(sv_type)) {
-        char* type = SvPV_nolen(sv_type);
-        if (strEQ(type, "character")) {
-          e2 = this->as_character();
-        }
-        else if (strEQ(type, "complex")) {
-          e2 = this->as_complex();
-        }
-        else if (strEQ(type, "double")) {
-          e2 = this->as_double();
-        }
-        else if (strEQ(type, "numeric")) {
-          e2 = this->as_numeric();
-        }
-        else if (strEQ(type, "integer")) {
-          e2 = this->as_integer();
-        }
-        else if (strEQ(type, "logical")) {
-          e2 = this->as_logical();
-        }
-        else {
-          croak("Invalid mode is passed(Rstats::Vector::as())");
+    ~Vector () {
+      if (this->interned) {
+        IV length = this->get_length();
+        U32* ids = this->get_character_ids();
+        for (IV i = 0; i < length; i++) {
+          Rstats::StringPool::release(ids[i]);
         }
       }
-      else {
-        croak("Invalid mode is passed(Rstats::Vector::as())");
+      this->free_strings();
+      this->free_values();
+      if (this->mapped_file != NULL) {
+        this->mapped_file->dec_refcnt();
       }
-      
-      return e2;
     }
-    
-    Rstats::Vector* as_character () {
-      IV length = this->get_length();
-      Rstats::Vector* e2 = new_character(length);
+
+    SV* get_value(IV pos) {
+
+      SV* sv_value;
+      
       Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            SV* sv_value = this->get_character_value(i);
-            e2->set_character_value(i, sv_value);
+          if (this->exists_na_position(pos)) {
+            sv_value = &PL_sv_undef;
+          }
+          else {
+            sv_value = this->get_character_value(pos);
           }
           break;
         case Rstats::VectorType::COMPLEX :
-          for (IV i = 0; i < length; i++) {
-            std::complex<NV> z = this->get_complex_value(i);
-            NV re = z.real();
-            NV im = z.imag();
-            
-            SV* sv_re = Rstats::PerlAPI::new_mSVnv(re);
-            SV* sv_im = Rstats::PerlAPI::new_mSVnv(im);
-            SV* sv_str = Rstats::PerlAPI::new_mSVpv_nolen("");
-            
-            sv_catpv(sv_str, SvPV_nolen(sv_re));
-            if (im >= 0) {
-              sv_catpv(sv_str, "+");
-            }
-            sv_catpv(sv_str, SvPV_nolen(sv_im));
-            sv_catpv(sv_str, "i");
-
-            e2->set_character_value(i, sv_str);
+          if (this->exists_na_position(pos)) {
+            sv_value = &PL_sv_undef;
           }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            NV value = this->get_double_value(i);
-            SV* sv_str = Rstats::PerlAPI::new_mSVpv_nolen("");
-            if (std::isinf(value) && value > 0) {
-              sv_catpv(sv_str, "Inf");
+          else {
+            std::complex<NV> z = this->get_complex_value(pos);
+            
+            NV re = z.real();
+            SV* sv_re;
+            if (std::isnan(re)) {
+              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
             }
-            else if (std::isinf(value) && value < 0) {
-              sv_catpv(sv_str, "-Inf");
+            else if (std::isinf(re) && re > 0) {
+              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
             }
-            else if (std::isnan(value)) {
-              sv_catpv(sv_str, "NaN");
+            else if (std::isinf(re) && re < 0) {
+              sv_re = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
             }
             else {
-              sv_catpv(sv_str, SvPV_nolen(Rstats::PerlAPI::new_mSVnv(value)));
+              sv_re = Rstats::PerlAPI::new_mSVnv(re);
             }
-            e2->set_character_value(i, sv_str);
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-          for (IV i = 0; i < length; i++) {
-            e2->set_character_value(
-              i,
-              Rstats::PerlAPI::new_mSViv(this->get_integer_value(i))
-            );
-          }
-          break;
-        case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            if (this->get_integer_value(i)) {
-              e2->set_character_value(i, Rstats::PerlAPI::new_mSVpv_nolen("TRUE"));
+            
+            NV im = z.imag();
+            SV* sv_im;
+            if (std::isnan(im)) {
+              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
             }
-            else {
-              e2->set_character_value(i, Rstats::PerlAPI::new_mSVpv_nolen("FALSE"));
+            else if (std::isinf(im) && im > 0) {
+              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
             }
-          }
-          break;
-        default:
-          croak("unexpected type");
-      }
-
-      e2->merge_na_positions(this);
-      
-      return e2;
-    }
-    
-    Rstats::Vector* as_double() {
-
-      IV length = this->get_length();
-      Rstats::Vector* e2 = new_double(length);
-      Rstats::VectorType::Enum type = this->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            SV* sv_value = this->get_character_value(i);
-            SV* sv_value_fix = Rstats::Util::looks_like_double(sv_value);
-            if (SvOK(sv_value_fix)) {
-              NV value = SvNV(sv_value_fix);
-              e2->set_double_value(i, value);
+            else if (std::isinf(im) && im < 0) {
+              sv_im = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
             }
             else {
-              warn("NAs introduced by coercion");
-              e2->add_na_position(i);
+              sv_im = Rstats::PerlAPI::new_mSVnv(im);
             }
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          warn("imaginary parts discarded in coercion");
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, this->get_complex_value(i).real());
+
+            sv_value = Rstats::PerlAPI::new_mHVRV();
+            Rstats::PerlAPI::hvrv_store_nolen_inc(sv_value, "re", sv_re);
+            Rstats::PerlAPI::hvrv_store_nolen_inc(sv_value, "im", sv_im);
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, this->get_double_value(i));
+          if (this->exists_na_position(pos)) {
+            sv_value = &PL_sv_undef;
+          }
+          else {
+            NV value = this->get_double_value(pos);
+            if (std::isnan(value)) {
+              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("NaN");
+            }
+            else if (std::isinf(value) && value > 0) {
+              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("Inf");
+            }
+            else if (std::isinf(value) && value < 0) {
+              sv_value = Rstats::PerlAPI::new_mSVpv_nolen("-Inf");
+            }
+            else {
+              sv_value = Rstats::PerlAPI::new_mSVnv(value);
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, this->get_integer_value(i));
+          if (this->exists_na_position(pos)) {
+            sv_value = &PL_sv_undef;
+          }
+          else {
+            IV value = this->get_integer_value(pos);
+            sv_value = Rstats::PerlAPI::new_mSViv(value);
           }
           break;
         default:
-          croak("unexpected type");
+          sv_value = &PL_sv_undef;
       }
-
-      e2->merge_na_positions(this);
       
-      return e2;
+      return sv_value;
     }
+    
+    SV* get_values() {
 
-    Rstats::Vector* as_numeric() {
-      return this->as_double();
+      IV length = this->get_length();
+      SV* sv_values = Rstats::PerlAPI::new_mAVRV();
+      if (length > 0) {
+        av_extend((AV*)SvRV(sv_values), length - 1);
+      }
+      for (IV i = 0; i < length; i++) {
+        Rstats::PerlAPI::avrv_push_inc(sv_values, this->get_value(i));
+      }
+
+      return sv_values;
     }
 
-    Rstats::Vector* as_integer() {
+    // Plain numbers(NaN and Inf stay NV, NA is undef, complex is real part)
+    SV* get_raw_values() {
 
       IV length = this->get_length();
-      Rstats::Vector* e2 = new_integer(length);
+      AV* av_values = Rstats::PerlAPI::new_mAV();
+      SV* sv_values = Rstats::PerlAPI::new_mRV_inc((SV*)av_values);
+      if (length == 0) {
+        return sv_values;
+      }
+      av_extend(av_values, length - 1);
+
       Rstats::VectorType::Enum type = this->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            SV* sv_value = this->get_character_value(i);
-            SV* sv_value_fix = Rstats::Util::looks_like_double(sv_value);
-            if (SvOK(sv_value_fix)) {
-              IV value = SvIV(sv_value_fix);
-              e2->set_integer_value(i, value);
-            }
-            else {
-              warn("NAs introduced by coercion");
-              e2->add_na_position(i);
-            }
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          warn("imaginary parts discarded in coercion");
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, (IV)this->get_complex_value(i).real());
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          NV value;
-          for (IV i = 0; i < length; i++) {
-            value = this->get_double_value(i);
-            if (std::isnan(value) || std::isinf(value)) {
-              e2->add_na_position(i);
-            }
-            else {
-              e2->set_integer_value(i, (IV)value);
-            }
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, this->get_integer_value(i));
+      bool has_na = !this->na_positions.empty();
+      for (IV i = 0; i < length; i++) {
+        SV* sv_value;
+        if (has_na && this->exists_na_position(i)) {
+          sv_value = newSV(0);
+        }
+        else {
+          switch (type) {
+            case Rstats::VectorType::CHARACTER :
+              sv_value = newSVpvn(this->get_character_ptr(i), this->get_character_length(i));
+              if (this->is_character_utf8(i)) {
+                SvUTF8_on(sv_value);
+              }
+              break;
+            case Rstats::VectorType::COMPLEX :
+              sv_value = newSVnv(this->get_complex_values()[i].real());
+              break;
+            case Rstats::VectorType::DOUBLE :
+              sv_value = newSVnv(this->get_double_values()[i]);
+              break;
+            case Rstats::VectorType::INTEGER :
+            case Rstats::VectorType::LOGICAL :
+              sv_value = newSViv(this->get_integer_values()[i]);
+              break;
+            default:
+              sv_value = newSV(0);
           }
-          break;
-        default:
-          croak("unexpected type");
+        }
+        av_store(av_values, i, sv_value);
       }
 
-      e2->merge_na_positions(this);
-      
-      return e2;
+      return sv_values;
     }
 
-    Rstats::Vector* as_complex() {
+    SV* get_complex_part_values(bool is_im) {
+
+      if (this->get_type() != Rstats::VectorType::COMPLEX) {
+        croak("Can't get complex part of not complex vector(Rstats::Vector::get_complex_part_values())");
+      }
 
       IV length = this->get_length();
-      Rstats::Vector* e2 = new_complex(length);
-      Rstats::VectorType::Enum type = this->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            SV* sv_value = this->get_character_value(i);
-            SV* sv_z = Rstats::Util::looks_like_complex(sv_value);
-            
-            if (SvOK(sv_z)) {
-              SV* sv_re = Rstats::PerlAPI::hvrv_fetch_simple(sv_z, "re");
-              SV* sv_im = Rstats::PerlAPI::hvrv_fetch_simple(sv_z, "im");
-              NV re = SvNV(sv_re);
-              NV im = SvNV(sv_im);
-              e2->set_complex_value(i, std::complex<NV>(re, im));
-            }
-            else {
-              warn("NAs introduced by coercion");
-              e2->add_na_position(i);
-            }
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, this->get_complex_value(i));
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            NV value = this->get_double_value(i);
-            if (std::isnan(value)) {
-              e2->add_na_position(i);
-            }
-            else {
-              e2->set_complex_value(i, std::complex<NV>(this->get_double_value(i), 0));
-            }
+      AV* av_values = Rstats::PerlAPI::new_mAV();
+      SV* sv_values = Rstats::PerlAPI::new_mRV_inc((SV*)av_values);
+      if (length == 0) {
+        return sv_values;
+      }
+      av_extend(av_values, length - 1);
+
+      std::complex<NV>* values = this->get_complex_values();
+      bool has_na = !this->na_positions.empty();
+      for (IV i = 0; i < length; i++) {
+        if (has_na && this->exists_na_position(i)) {
+          av_store(av_values, i, newSV(0));
+        }
+        else {
+          std::complex<NV> z = values[i];
+          av_store(av_values, i, newSVnv(is_im ? z.imag() : z.real()));
+        }
+      }
+
+      return sv_values;
+    }
+
+    // Native layout(double is pack "d*", integer and logical is pack "j*",
+    // complex is pack "d*" of real and imaginary pairs, NA of double is NaN)
+    SV* get_packed_values() {
+
+      if (this->get_type() == Rstats::VectorType::CHARACTER) {
+        croak("Can't pack character vector(Rstats::Vector::get_packed_values())");
+      }
+
+      IV length = this->get_length();
+      SV* sv_packed = Rstats::PerlAPI::new_mSVpvn(
+        length ? this->get_buffer() : "",
+        this->get_buffer_size()
+      );
+
+      if (!this->na_positions.empty()) {
+        NV* packed = (NV*)SvPVX(sv_packed);
+        for (std::map<IV, IV>::iterator it = this->na_positions.begin(); it != this->na_positions.end(); ++it) {
+          if (this->is_complex()) {
+            packed[it->first * 2] = NAN;
+            packed[it->first * 2 + 1] = NAN;
           }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::complex<NV>(this->get_integer_value(i), 0));
+          else if (this->is_double()) {
+            packed[it->first] = NAN;
           }
-          break;
-        default:
-          croak("unexpected type");
+        }
       }
 
-      e2->merge_na_positions(this);
-      
-      return e2;
+      return sv_packed;
     }
-    
-    Rstats::Vector* as_logical() {
+
+    char* get_buffer() {
+      if (this->get_type() == Rstats::VectorType::CHARACTER) {
+        croak("Can't get buffer of character vector(Rstats::Vector::get_buffer())");
+      }
+
+      return (char*)this->values;
+    }
+
+    STRLEN get_buffer_size() {
       IV length = this->get_length();
-      Rstats::Vector* e2 = new_logical(length);
+
       Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            SV* sv_value = this->get_character_value(i);
-            SV* sv_logical = Rstats::Util::looks_like_logical(sv_value);
-            if (SvOK(sv_logical)) {
-              if (SvTRUE(sv_logical)) {
-                e2->set_integer_value(i, 1);
-              }
-              else {
-                e2->set_integer_value(i, 0);
-              }
-            }
-            else {
-              warn("NAs introduced by coercion");
-              e2->add_na_position(i);
-            }
-          }
-          break;
         case Rstats::VectorType::COMPLEX :
-          warn("imaginary parts discarded in coercion");
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, this->get_complex_value(i).real() ? 1 : 0);
-          }
-          break;
+          return length * sizeof(std::complex<NV>);
         case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            NV value = this->get_double_value(i);
-            if (std::isnan(value)) {
-              e2->add_na_position(i);
-            }
-            else if (std::isinf(value)) {
-              e2->set_integer_value(i, 1);
-            }
-            else {
-              e2->set_integer_value(i, value ? 1 : 0);
-            }
-          }
-          break;
+          return length * sizeof(NV);
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, this->get_integer_value(i) ? 1 : 0);
-          }
-          break;
+          return length * sizeof(IV);
         default:
-          croak("unexpected type");
+          croak("Can't get buffer of character vector(Rstats::Vector::get_buffer_size())");
       }
-
-      e2->merge_na_positions(this);
-      
-      return e2;
     }
-  };
 
-  // Rstats::VectorFunc
-  namespace VectorFunc {
+    bool is_character () { return this->get_type() == Rstats::VectorType::CHARACTER; }
+    bool is_complex () { return this->get_type() == Rstats::VectorType::COMPLEX; }
+    bool is_double () { return this->get_type() == Rstats::VectorType::DOUBLE; }
+    bool is_integer () { return this->get_type() == Rstats::VectorType::INTEGER; }
+    bool is_numeric () {
+      return this->get_type() == Rstats::VectorType::DOUBLE || this->get_type() == Rstats::VectorType::INTEGER;
+    }
+    bool is_logical () { return this->get_type() == Rstats::VectorType::LOGICAL; }
+    
+    StringRef* get_character_values() {
+      return (StringRef*)this->values;
+    }
+    
+    U32* get_character_ids() {
+      return (U32*)this->values;
+    }
+    
+    std::complex<NV>* get_complex_values() {
+      return (std::complex<NV>*)this->values;
+    }
+    
+    NV* get_double_values() {
+      return (NV*)this->values;
+    }
+    
+    IV* get_integer_values() {
+      return (IV*)this->values;
+    }
+    
+    // File which values are mapped from, or NULL if values are in memory
+    Rstats::MappedFile* get_mapped_file() {
+      return this->is_mapped(this->values) ? this->mapped_file : NULL;
+    }
+    
+    Rstats::VectorType::Enum get_type() {
+      return this->type;
+    }
+    
+    void add_na_position (IV position) {
+      this->na_positions[position] = 1;
+    }
+    
+    void remove_na_position (IV position) {
+      this->na_positions.erase(position);
+    }
+    
+    const std::map<IV, IV>& get_na_positions () {
+      return this->na_positions;
+    }
 
-    Rstats::Vector* negation (Rstats::Vector* e1) {
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("argument is not interpretable as logical(Rstats::VectorFunc::negation())");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            std::complex<NV> value = e1->get_complex_value(i);
-            e2->set_complex_value(i, std::complex<NV>(-value.real(), -value.imag()));
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, -e1->get_double_value(i));
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, -e1->get_integer_value(i));
-          }
-          break;
-        default:
-          croak("unexpected type");
+    bool exists_na_position (IV position) {
+      return this->na_positions.count(position);
+    }
+    
+    void merge_na_positions (Rstats::Vector* elements) {
+      for(std::map<IV, IV>::iterator it = elements->na_positions.begin(); it != elements->na_positions.end(); ++it) {
+        this->add_na_position(it->first);
       }
+    }
+    
+    IV get_length () {
+      return this->length;
+    }
 
-      e2->merge_na_positions(e1);
+    static Rstats::Vector* new_character(IV length, SV* sv_str) {
+
+      Rstats::Vector* elements = Rstats::Vector::new_character(length);
+      if (length > 0) {
+        elements->set_character_value(0, sv_str);
+        StringRef* values = elements->get_character_values();
+        for (IV i = 1; i < length; i++) {
+          values[i] = values[0];
+        }
+      }
       
-      return e2;
+      return elements;
     }
 
-    Rstats::Vector* reminder(Rstats::Vector* e1, Rstats::Vector* e2) {
-      
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't reminder different type(Rstats::VectorFunc::remainder())");
-      }
+    static Rstats::Vector* new_character(IV length) {
+
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(StringRef));
+      elements->type = Rstats::VectorType::CHARACTER;
       
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't reminder different length(Rstats::VectorFunc::remainder())");
+      return elements;
+    }
+
+    // View of values(and strings of character vector) in the mapped file. Character values are StringRef.
+    static Rstats::Vector* new_mapped(Rstats::VectorType::Enum type, IV length, Rstats::MappedFile* mapped_file,
+      STRLEN values_offset, STRLEN strings_offset, STRLEN strings_size, bool utf8)
+    {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->type = type;
+      elements->length = length;
+      elements->mapped_file = mapped_file->inc_refcnt();
+      elements->values = length ? mapped_file->get_data() + values_offset : NULL;
+      if (type == Rstats::VectorType::CHARACTER && strings_size > 0) {
+        elements->strings = mapped_file->get_data() + strings_offset;
+        elements->strings_size = strings_size;
+        elements->strings_capacity = strings_size;
       }
+      elements->utf8 = utf8;
       
-      IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_double(length);
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error : non-numeric argument to binary operator(Rstats::Vector::Func::reminder())");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          croak("unimplemented complex operation(Rstats::Vector::Func::reminder())");
-          break;
-        case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            NV e1_value = e1->get_double_value(i);
-            NV e2_value = e2->get_double_value(i);
-            
-            if (std::isnan(e1_value) || std::isnan(e2_value) || e2_value == 0) {
-              e3->set_double_value(i, std::numeric_limits<NV>::signaling_NaN());
-            }
-            else {
-              NV e3_value = e1_value - std::floor(e1_value / e2_value) * e2_value;
-              e3->set_double_value(i, e3_value);
-            }
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            if (e2->get_integer_value(i) == 0) {
-              e3->set_double_value(i, std::numeric_limits<NV>::signaling_NaN());
-            }
-            else {
-              e3->set_double_value(i, e1->get_integer_value(i) % e2->get_integer_value(i));
-            }
-          }
-          break;
-        default:
-          croak("Invalid type");
+      return elements;
+    }
+    
+    // Character vector whose strings are a view of the mapped file. References are allocated and zero filled.
+    static Rstats::Vector* new_mapped_strings(IV length, Rstats::MappedFile* mapped_file,
+      STRLEN strings_offset, STRLEN strings_size, bool utf8)
+    {
+      Rstats::Vector* elements = Rstats::Vector::new_character(length);
+      elements->mapped_file = mapped_file->inc_refcnt();
+      if (strings_size > 0) {
+        elements->strings = mapped_file->get_data() + strings_offset;
+        elements->strings_size = strings_size;
+        elements->strings_capacity = strings_size;
       }
+      elements->utf8 = utf8;
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      return e3;
+      return elements;
     }
     
-    Rstats::Vector* And(Rstats::Vector* e1, Rstats::Vector* e2) {
+    static Rstats::Vector* new_character_interned(IV length) {
+
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(U32));
+      elements->type = Rstats::VectorType::CHARACTER;
+      elements->interned = true;
       
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::And())");
+      return elements;
+    }
+
+    bool is_interned () {
+      return this->interned;
+    }
+
+    // Interned copy of character vector
+    Rstats::Vector* intern () {
+      if (this->get_type() != Rstats::VectorType::CHARACTER) {
+        croak("Can't intern not character vector(Rstats::Vector::intern())");
       }
       
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::And())");
+      IV length = this->get_length();
+      Rstats::Vector* elements = Rstats::Vector::new_character_interned(length);
+      for (IV i = 0; i < length; i++) {
+        elements->set_character_value(i, this, i);
       }
+      elements->merge_na_positions(this);
       
-      IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
-      
-      Rstats::Vector* e1_fix = NULL;
-      Rstats::Vector* e2_fix = NULL;
-      
-      if (!e1->is_logical()) {
-        e1_fix = e1->as_logical();
-        e1 = e1_fix;
+      return elements;
+    }
+
+    bool is_utf8 () {
+      return this->utf8;
+    }
+
+    const char* get_character_ptr(IV pos) {
+      if (this->interned) {
+        return Rstats::StringPool::get_ptr(this->get_character_ids()[pos]);
       }
-      
-      if (!e2->is_logical()) {
-        e2_fix = e2->as_logical();
-        e2 = e2_fix;
+      return this->strings ? this->strings + this->get_character_values()[pos].offset : "";
+    }
+
+    STRLEN get_character_length(IV pos) {
+      if (this->interned) {
+        return Rstats::StringPool::get_length(this->get_character_ids()[pos]);
       }
-      
-      for (IV i = 0; i < length; i++) {
-        e3->set_integer_value(i, e1->get_integer_value(i) && e2->get_integer_value(i));
+      return this->get_character_values()[pos].length;
+    }
+
+    bool is_character_utf8(IV pos) {
+      if (this->interned) {
+        return Rstats::StringPool::is_utf8(this->get_character_ids()[pos]);
       }
-      
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      if (e1_fix != NULL) {
-        delete e1_fix;
+      return this->utf8;
+    }
+
+    // Same strings have same key(ASCII or UTF-8 bytes)
+    void get_character_key(IV pos, std::string& key) {
+      const char* str = this->get_character_ptr(pos);
+      STRLEN length = this->get_character_length(pos);
+      if (this->is_character_utf8(pos) || Rstats::Util::is_ascii(str, length)) {
+        key.assign(str, length);
       }
-      
-      if (e2_fix != NULL) {
-        delete e2_fix;
+      else {
+        Rstats::Util::latin1_to_utf8(str, length, key);
       }
-      
-      return e3;
+    }
+
+    // SV is created only here
+    SV* get_character_value(IV pos) {
+      SV* sv_value = Rstats::PerlAPI::new_mSVpvn(this->get_character_ptr(pos), this->get_character_length(pos));
+      if (this->is_character_utf8(pos)) {
+        SvUTF8_on(sv_value);
+      }
+      return sv_value;
     }
     
-    Rstats::Vector* Or(Rstats::Vector* e1, Rstats::Vector* e2) {
-      
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::Or())");
+    void set_character_value(IV pos, SV* value) {
+      if (value == NULL) {
+        this->set_character_value(pos, "", 0, false);
+      }
+      else {
+        STRLEN length;
+        const char* str = SvPV(value, length);
+        this->set_character_value(pos, str, length, SvUTF8(value));
+      }
+    }
+
+    void set_character_value(IV pos, const char* str, STRLEN length, bool utf8) {
+      if (this->interned) {
+        U32* ids = this->get_character_ids();
+        U32 id = Rstats::StringPool::intern(str, length, utf8);
+        Rstats::StringPool::release(ids[pos]);
+        ids[pos] = id;
+        return;
       }
       
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::Or())");
+      if (utf8 && !this->utf8) {
+        this->upgrade_strings();
+      }
+      else if (!utf8 && this->utf8) {
+        SV* sv_str = Rstats::PerlAPI::new_mSVpvn(str, length);
+        sv_utf8_upgrade(sv_str);
+        str = SvPV(sv_str, length);
       }
       
-      IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
+      StringRef* values = this->get_character_values();
+      values[pos].offset = this->append_string(str, length);
+      values[pos].length = length;
+    }
+
+    // Space of a character element. Caller writes length bytes(UTF-8 if utf8 is true) to the space.
+    char* alloc_character_value(IV pos, STRLEN length, bool utf8) {
+      if (this->interned) {
+        croak("Can't allocate character value of interned vector(Rstats::Vector::alloc_character_value())");
+      }
+      if (utf8 && !this->utf8) {
+        this->upgrade_strings();
+      }
+      else if (!utf8 && this->utf8) {
+        croak("Can't allocate Latin-1 value of UTF-8 vector(Rstats::Vector::alloc_character_value())");
+      }
       
-      Rstats::Vector* e1_fix = NULL;
-      Rstats::Vector* e2_fix = NULL;
+      this->reserve_strings(length);
+      StringRef* values = this->get_character_values();
+      values[pos].offset = this->strings_size;
+      values[pos].length = length;
+      this->strings_size += length;
       
-      if (!e1->is_logical()) {
-        e1_fix = e1->as_logical();
-        e1 = e1_fix;
+      return this->strings + values[pos].offset;
+    }
+
+    // Copy a character element of other vector
+    void set_character_value(IV pos, Rstats::Vector* elements, IV elements_pos) {
+      if (this->interned && elements->is_interned()) {
+        U32* ids = this->get_character_ids();
+        U32 id = elements->get_character_ids()[elements_pos];
+        Rstats::StringPool::retain(id);
+        Rstats::StringPool::release(ids[pos]);
+        ids[pos] = id;
+        return;
       }
       
-      if (!e2->is_logical()) {
-        e2_fix = e2->as_logical();
-        e2 = e2_fix;
+      this->set_character_value(
+        pos,
+        elements->get_character_ptr(elements_pos),
+        elements->get_character_length(elements_pos),
+        elements->is_character_utf8(elements_pos)
+      );
+    }
+
+    bool equal_character_value(IV pos, Rstats::Vector* elements, IV elements_pos) {
+      if (this->interned && elements->is_interned()) {
+        return this->get_character_ids()[pos] == elements->get_character_ids()[elements_pos];
       }
       
-      for (IV i = 0; i < length; i++) {
-        e3->set_integer_value(i, e1->get_integer_value(i) || e2->get_integer_value(i));
+      if (this->is_character_utf8(pos) == elements->is_character_utf8(elements_pos)
+        && this->get_character_length(pos) != elements->get_character_length(elements_pos))
+      {
+        return false;
       }
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      if (e1_fix != NULL) {
-        delete e1_fix;
+      return this->compare_character_value(pos, elements, elements_pos) == 0;
+    }
+
+    // Same as sv_cmp. Bytes are compared directly when UTF-8 flags are same.
+    IV compare_character_value(IV pos, Rstats::Vector* elements, IV elements_pos) {
+      if (this->interned && elements->is_interned()
+        && this->get_character_ids()[pos] == elements->get_character_ids()[elements_pos])
+      {
+        return 0;
       }
       
-      if (e2_fix != NULL) {
-        delete e2_fix;
+      // Interned strings are always ASCII or UTF-8
+      bool both_interned = this->interned && elements->is_interned();
+      if (!both_interned && this->is_character_utf8(pos) != elements->is_character_utf8(elements_pos)) {
+        return sv_cmp(this->get_character_value(pos), elements->get_character_value(elements_pos));
       }
       
-      return e3;
+      STRLEN length1 = this->get_character_length(pos);
+      STRLEN length2 = elements->get_character_length(elements_pos);
+      int ret = memcmp(
+        this->get_character_ptr(pos),
+        elements->get_character_ptr(elements_pos),
+        length1 < length2 ? length1 : length2
+      );
+      if (ret != 0) {
+        return ret < 0 ? -1 : 1;
+      }
+      else {
+        return length1 < length2 ? -1 : length1 > length2 ? 1 : 0;
+      }
     }
-    
-    Rstats::Vector* Conj (Rstats::Vector* e1) {
-      IV length = e1->get_length();
-      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
-      Rstats::VectorType::Enum type = e1->get_type();
+
+    static Rstats::Vector* new_complex(IV length) {
+      
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(std::complex<NV>));
+      elements->type = Rstats::VectorType::COMPLEX;
+      
+      return elements;
+    }
+        
+    static Rstats::Vector* new_complex(IV length, std::complex<NV> z) {
+      
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(std::complex<NV>));
+      std::complex<NV>* values = elements->get_complex_values();
+      for (IV i = 0; i < length; i++) {
+        values[i] = z;
+      }
+      elements->type = Rstats::VectorType::COMPLEX;
+      
+      return elements;
+    }
+
+    std::complex<NV> get_complex_value(IV pos) {
+      return this->get_complex_values()[pos];
+    }
+    
+    void set_complex_value(IV pos, std::complex<NV> value) {
+      this->get_complex_values()[pos] = value;
+    }
+    
+    static Rstats::Vector* new_double(IV length) {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(NV));
+      elements->type = Rstats::VectorType::DOUBLE;
+      
+      return elements;
+    }
+
+    static Rstats::Vector* new_double(IV length, NV value) {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(NV));
+      NV* values = elements->get_double_values();
+      for (IV i = 0; i < length; i++) {
+        values[i] = value;
+      }
+      elements->type = Rstats::VectorType::DOUBLE;
+      
+      return elements;
+    }
+    
+    NV get_double_value(IV pos) {
+      return this->get_double_values()[pos];
+    }
+    
+    void set_double_value(IV pos, NV value) {
+      this->get_double_values()[pos] = value;
+    }
+
+    static Rstats::Vector* new_integer(IV length) {
+      
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(IV));
+      elements->type = Rstats::VectorType::INTEGER;
+      
+      return elements;
+    }
+
+    static Rstats::Vector* new_integer(IV length, IV value) {
+      
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(IV));
+      IV* values = elements->get_integer_values();
+      for (IV i = 0; i < length; i++) {
+        values[i] = value;
+      }
+      elements->type = Rstats::VectorType::INTEGER;
+      
+      return elements;
+    }
+
+    static Rstats::Vector* new_double_from_buffer(const char* buffer, STRLEN size) {
+
+      if (size % sizeof(NV) != 0) {
+        croak("Buffer size must be multiple of %d(Rstats::Vector::new_double_from_buffer())", (int)sizeof(NV));
+      }
+
+      IV length = size / sizeof(NV);
+      Rstats::Vector* elements = Rstats::Vector::new_double(length);
+      if (length > 0) {
+        memcpy(elements->get_double_values(), buffer, size);
+      }
+
+      return elements;
+    }
+
+    // element_size is 4(pack "l*") or sizeof(IV)(pack "j*")
+    static Rstats::Vector* new_integer_from_buffer(const char* buffer, STRLEN size, IV element_size) {
+
+      if (element_size != 4 && element_size != sizeof(IV)) {
+        croak("Element size must be 4 or %d(Rstats::Vector::new_integer_from_buffer())", (int)sizeof(IV));
+      }
+
+      if (size % element_size != 0) {
+        croak("Buffer size must be multiple of %d(Rstats::Vector::new_integer_from_buffer())", (int)element_size);
+      }
+
+      IV length = size / element_size;
+      Rstats::Vector* elements = Rstats::Vector::new_integer(length);
+      if (length > 0) {
+        IV* values = elements->get_integer_values();
+        if (element_size == sizeof(IV)) {
+          memcpy(values, buffer, size);
+        }
+        else {
+          I32 value32;
+          for (IV i = 0; i < length; i++) {
+            memcpy(&value32, buffer + i * 4, 4);
+            values[i] = value32;
+          }
+        }
+      }
+
+      return elements;
+    }
+
+    IV get_integer_value(IV pos) {
+      return this->get_integer_values()[pos];
+    }
+    
+    void set_integer_value(IV pos, IV value) {
+      this->get_integer_values()[pos] = value;
+    }
+    
+    static Rstats::Vector* new_logical(IV length) {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(IV));
+      elements->type = Rstats::VectorType::LOGICAL;
+      
+      return elements;
+    }
+
+    static Rstats::Vector* new_logical(IV length, IV value) {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(length, sizeof(IV));
+      IV* values = elements->get_integer_values();
+      for (IV i = 0; i < length; i++) {
+        values[i] = value;
+      }
+      elements->type = Rstats::VectorType::LOGICAL;
+      
+      return elements;
+    }
+    
+    static Rstats::Vector* new_true() {
+      return new_logical(1, 1);
+    }
+
+    static Rstats::Vector* new_false() {
+      return new_logical(1, 0);
+    }
+    
+    static Rstats::Vector* new_nan() {
+      return  Rstats::Vector::new_double(1, NAN);
+    }
+
+    static Rstats::Vector* new_negative_inf() {
+      return Rstats::Vector::new_double(1, -(INFINITY));
+    }
+    
+    static Rstats::Vector* new_inf() {
+      return Rstats::Vector::new_double(1, INFINITY);
+    }
+    
+    static Rstats::Vector* new_na() {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->alloc_values(1, sizeof(IV));
+      elements->type = Rstats::VectorType::LOGICAL;
+      elements->add_na_position(0);
+      
+      return elements;
+    }
+    
+    static Rstats::Vector* new_null() {
+      Rstats::Vector* elements = new Rstats::Vector;
+      elements->type = Rstats::VectorType::LOGICAL;
+      return elements;
+    }
+
+    // Shared immutable constants. Callers must not modify them.
+    static Rstats::Vector* shared_true() {
+      static Rstats::Vector* elements = Rstats::Vector::new_true()->to_immortal();
+      return elements;
+    }
+
+    static Rstats::Vector* shared_false() {
+      static Rstats::Vector* elements = Rstats::Vector::new_false()->to_immortal();
+      return elements;
+    }
+
+    static Rstats::Vector* shared_na() {
+      static Rstats::Vector* elements = Rstats::Vector::new_na()->to_immortal();
+      return elements;
+    }
+
+    static Rstats::Vector* shared_nan() {
+      static Rstats::Vector* elements = Rstats::Vector::new_nan()->to_immortal();
+      return elements;
+    }
+
+    static Rstats::Vector* shared_inf() {
+      static Rstats::Vector* elements = Rstats::Vector::new_inf()->to_immortal();
+      return elements;
+    }
+
+    static Rstats::Vector* shared_negative_inf() {
+      static Rstats::Vector* elements = Rstats::Vector::new_negative_inf()->to_immortal();
+      return elements;
+    }
+
+    static bool is_small_integer(IV value) {
+      return value >= RSTATS_SMALL_INTEGER_MIN && value <= RSTATS_SMALL_INTEGER_MAX;
+    }
+
+    // Integer vector of length 1 cached for RSTATS_SMALL_INTEGER_MIN .. RSTATS_SMALL_INTEGER_MAX
+    static Rstats::Vector* shared_integer(IV value) {
+      static Rstats::Vector* cache[RSTATS_SMALL_INTEGER_MAX - RSTATS_SMALL_INTEGER_MIN + 1];
+
+      if (!Rstats::Vector::is_small_integer(value)) {
+        return Rstats::Vector::new_integer(1, value);
+      }
+
+      IV index = value - RSTATS_SMALL_INTEGER_MIN;
+      if (cache[index] == NULL) {
+        cache[index] = Rstats::Vector::new_integer(1, value)->to_immortal();
+      }
+
+      return cache[index];
+    }
+
+    static Rstats::Vector* shared_logical(IV value) {
+      return value ? Rstats::Vector::shared_true() : Rstats::Vector::shared_false();
+    }
+
+    Rstats::Vector* as (SV* sv_type) {
+      Rstats::Vector* e2;
+      if (SvOK(sv_type)) {
+        char* type = SvPV_nolen(sv_type);
+        if (strEQ(type, "character")) {
+          e2 = this->as_character();
+        }
+        else if (strEQ(type, "complex")) {
+          e2 = this->as_complex();
+        }
+        else if (strEQ(type, "double")) {
+          e2 = this->as_double();
+        }
+        else if (strEQ(type, "numeric")) {
+          e2 = this->as_numeric();
+        }
+        else if (strEQ(type, "integer")) {
+          e2 = this->as_integer();
+        }
+        else if (strEQ(type, "logical")) {
+          e2 = this->as_logical();
+        }
+        else {
+          croak("Invalid mode is passed(Rstats::Vector::as())");
+        }
+      }
+      else {
+        croak("Invalid mode is passed(Rstats::Vector::as())");
+      }
+      
+      return e2;
+    }
+    
+    // Character representation. Double is shortest round-trip form rounded to digits.
+    Rstats::Vector* as_character (IV digits = RSTATS_DOUBLE_DIGITS) {
+      IV length = this->get_length();
+      Rstats::Vector* e2 = new_character(length);
+      Rstats::VectorType::Enum type = this->get_type();
+      char buffer[RSTATS_NUMBER_BUFFER_SIZE * 2 + 2];
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Re())");
+          for (IV i = 0; i < length; i++) {
+            e2->set_character_value(i, this, i);
+          }
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            std::complex<NV> e1_value = e1->get_complex_value(i);
-            std::complex<NV> e2_value(e1_value.real(), -e1_value.imag());
-            e2->set_complex_value(i, e2_value);
+            std::complex<NV> z = this->get_complex_value(i);
+            NV re = z.real();
+            NV im = z.imag();
+            
+            char* end = Rstats::Util::format_double(buffer, re, digits);
+            if (im >= 0) {
+              *end++ = '+';
+            }
+            end = Rstats::Util::format_double(end, im, digits);
+            *end++ = 'i';
+            
+            e2->set_character_value(i, buffer, end - buffer, false);
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, e1->get_double_value(i));
+            char* end = Rstats::Util::format_double(buffer, this->get_double_value(i), digits);
+            e2->set_character_value(i, buffer, end - buffer, false);
           }
           break;
         case Rstats::VectorType::INTEGER :
-          e2 = Rstats::Vector::new_integer(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, e1->get_integer_value(i));
+            char* end = Rstats::Util::format_integer(buffer, this->get_integer_value(i));
+            e2->set_character_value(i, buffer, end - buffer, false);
           }
           break;
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, e1->get_integer_value(i));
+            if (this->get_integer_value(i)) {
+              e2->set_character_value(i, "TRUE", 4, false);
+            }
+            else {
+              e2->set_character_value(i, "FALSE", 5, false);
+            }
           }
           break;
         default:
           croak("unexpected type");
       }
 
-      e2->merge_na_positions(e1);
+      e2->merge_na_positions(this);
       
       return e2;
     }
     
-    Rstats::Vector* Re (Rstats::Vector* e1) {
-      IV length = e1->get_length();
-      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
-      Rstats::VectorType::Enum type = e1->get_type();
+    Rstats::Vector* as_double() {
+
+      IV length = this->get_length();
+      Rstats::Vector* e2 = new_double(length);
+      Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Re())");
+          for (IV i = 0; i < length; i++) {
+            if (this->exists_na_position(i)) {
+              continue;
+            }
+            Rstats::Util::Scalar scalar;
+            Rstats::VectorType::Enum value_type = Rstats::Util::parse_scalar(
+              this->get_character_ptr(i), this->get_character_length(i), scalar);
+            if (value_type == Rstats::VectorType::INTEGER || value_type == Rstats::VectorType::DOUBLE) {
+              e2->set_double_value(i, scalar.re);
+            }
+            else {
+              warn("NAs introduced by coercion");
+              e2->add_na_position(i);
+            }
+          }
           break;
         case Rstats::VectorType::COMPLEX :
+          warn("imaginary parts discarded in coercion");
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, e1->get_complex_value(i).real());
+            e2->set_double_value(i, this->get_complex_value(i).real());
           }
           break;
         case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, e1->get_double_value(i));
+            e2->set_double_value(i, this->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, e1->get_integer_value(i));
+            e2->set_double_value(i, this->get_integer_value(i));
           }
           break;
         default:
           croak("unexpected type");
       }
 
-      e2->merge_na_positions(e1);
+      e2->merge_na_positions(this);
       
       return e2;
     }
-    
-    Rstats::Vector* Im (Rstats::Vector* e1) {
-      IV length = e1->get_length();
-      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
-      Rstats::VectorType::Enum type = e1->get_type();
+
+    Rstats::Vector* as_numeric() {
+      return this->as_double();
+    }
+
+    Rstats::Vector* as_integer() {
+
+      IV length = this->get_length();
+      Rstats::Vector* e2 = new_integer(length);
+      Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Im())");
+          for (IV i = 0; i < length; i++) {
+            if (this->exists_na_position(i)) {
+              continue;
+            }
+            Rstats::Util::Scalar scalar;
+            Rstats::VectorType::Enum value_type = Rstats::Util::parse_scalar(
+              this->get_character_ptr(i), this->get_character_length(i), scalar);
+            if (value_type == Rstats::VectorType::INTEGER) {
+              e2->set_integer_value(i, scalar.iv);
+            }
+            else if (value_type == Rstats::VectorType::DOUBLE && scalar.re >= (NV)IV_MIN && scalar.re < -(NV)IV_MIN) {
+              e2->set_integer_value(i, (IV)scalar.re);
+            }
+            else {
+              warn("NAs introduced by coercion");
+              e2->add_na_position(i);
+            }
+          }
           break;
         case Rstats::VectorType::COMPLEX :
+          warn("imaginary parts discarded in coercion");
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, e1->get_complex_value(i).imag());
+            e2->set_integer_value(i, (IV)this->get_complex_value(i).real());
           }
           break;
         case Rstats::VectorType::DOUBLE :
+          NV value;
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, 0);
+            value = this->get_double_value(i);
+            if (std::isnan(value) || std::isinf(value)) {
+              e2->add_na_position(i);
+            }
+            else {
+              e2->set_integer_value(i, (IV)value);
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, 0);
+            e2->set_integer_value(i, this->get_integer_value(i));
           }
           break;
         default:
           croak("unexpected type");
       }
 
-      e2->merge_na_positions(e1);
+      e2->merge_na_positions(this);
       
       return e2;
     }
-    
-    Rstats::Vector* less_than_or_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
-      
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::less_than_or_equal())");
-      }
-      
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::less_than_or_equal())");
-      }
-      
-      IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
-      Rstats::VectorType::Enum type = e1->get_type();
+
+    Rstats::Vector* as_complex() {
+
+      IV length = this->get_length();
+      Rstats::Vector* e2 = new_complex(length);
+      Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) <= 0) {
-              e3->set_integer_value(i, 1);
+            if (this->exists_na_position(i)) {
+              continue;
+            }
+            Rstats::Util::Scalar scalar;
+            Rstats::VectorType::Enum value_type = Rstats::Util::parse_scalar(
+              this->get_character_ptr(i), this->get_character_length(i), scalar);
+            if (value_type == Rstats::VectorType::INTEGER || value_type == Rstats::VectorType::DOUBLE || value_type == Rstats::VectorType::COMPLEX) {
+              e2->set_complex_value(i, std::complex<NV>(scalar.re, scalar.im));
             }
             else {
-              e3->set_integer_value(i, 0);
+              warn("NAs introduced by coercion");
+              e2->add_na_position(i);
             }
           }
           break;
         case Rstats::VectorType::COMPLEX :
-          croak("invalid comparison with complex values(Rstats::VectorFunc::less_than_or_equal())");
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, this->get_complex_value(i));
+          }
           break;
         case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
+            NV value = this->get_double_value(i);
+            if (std::isnan(value)) {
+              e2->add_na_position(i);
             }
             else {
-              if (e1->get_double_value(i) <= e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
+              e2->set_complex_value(i, std::complex<NV>(this->get_double_value(i), 0));
             }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) <= e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
+            e2->set_complex_value(i, std::complex<NV>(this->get_integer_value(i), 0));
           }
           break;
         default:
-          croak("Invalid type");
+          croak("unexpected type");
       }
+
+      e2->merge_na_positions(this);
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      return e3;
+      return e2;
     }
     
-    Rstats::Vector* more_than_or_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
-      
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::more_than_or_equal())");
-      }
-      
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::more_than_or_equal())");
-      }
-      
-      IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
-      Rstats::VectorType::Enum type = e1->get_type();
+    Rstats::Vector* as_logical() {
+      IV length = this->get_length();
+      Rstats::Vector* e2 = new_logical(length);
+      Rstats::VectorType::Enum type = this->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) >= 0) {
-              e3->set_integer_value(i, 1);
+            if (this->exists_na_position(i)) {
+              continue;
+            }
+            Rstats::Util::Scalar scalar;
+            Rstats::VectorType::Enum value_type = Rstats::Util::parse_scalar(
+              this->get_character_ptr(i), this->get_character_length(i), scalar);
+            if (value_type == Rstats::VectorType::LOGICAL && !scalar.na) {
+              e2->set_integer_value(i, scalar.iv);
             }
             else {
-              e3->set_integer_value(i, 0);
+              warn("NAs introduced by coercion");
+              e2->add_na_position(i);
             }
           }
           break;
         case Rstats::VectorType::COMPLEX :
-          croak("invalid comparison with complex values(Rstats::VectorFunc::more_than_or_equal())");
+          warn("imaginary parts discarded in coercion");
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, this->get_complex_value(i).real() ? 1 : 0);
+          }
           break;
         case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
+            NV value = this->get_double_value(i);
+            if (std::isnan(value)) {
+              e2->add_na_position(i);
+            }
+            else if (std::isinf(value)) {
+              e2->set_integer_value(i, 1);
             }
             else {
-              if (e1->get_double_value(i) >= e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
+              e2->set_integer_value(i, value ? 1 : 0);
             }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) >= e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
+            e2->set_integer_value(i, this->get_integer_value(i) ? 1 : 0);
           }
           break;
         default:
-          croak("Invalid type");
+          croak("unexpected type");
+      }
+
+      e2->merge_na_positions(this);
+      
+      return e2;
+    }
+  };
 
+  // Rstats::StringView - character element which can be read from worker threads
+  struct StringView {
+    const char* ptr;
+    STRLEN length;
+    bool utf8;
+    bool na;
+  };
+  
+  // Rstats::Matcher - pattern which is compiled once and used for all elements
+  class Matcher {
+    private:
+    bool fixed;
+    REGEXP* re;
+    std::string pattern;
+    bool pattern_utf8;
+    SV* sv_str;
+    std::string upgraded_str;
+    const char* str;
+    STRLEN length;
+    bool utf8;
+    
+    Matcher (const Matcher&);
+    Matcher& operator=(const Matcher&);
+    
+    public:
+    
+    // Regex is Perl regex. fixed pattern is literal string.
+    Matcher (Rstats::Vector* e_pattern, bool ignore_case, bool fixed)
+      : fixed(fixed), re(NULL), sv_str(NULL), str(""), length(0), utf8(false)
+    {
+      if (!e_pattern->is_character() || e_pattern->get_length() < 1 || e_pattern->exists_na_position(0)) {
+        croak("pattern must be a character string(Rstats::Matcher)");
       }
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
+      e_pattern->get_character_key(0, this->pattern);
+      this->pattern_utf8 = !Rstats::Util::is_ascii(this->pattern.data(), this->pattern.size());
       
-      return e3;
+      if (fixed) {
+        if (ignore_case) {
+          warn("argument 'ignore.case = TRUE' will be ignored");
+        }
+      }
+      else {
+        this->re = Rstats::PerlAPI::mpregcomp(e_pattern->get_character_value(0), ignore_case ? PMf_FOLD : 0);
+        this->sv_str = Rstats::PerlAPI::new_mSVpvn("", 0);
+      }
     }
     
-    Rstats::Vector* less_than(Rstats::Vector* e1, Rstats::Vector* e2) {
+    bool is_fixed () {
+      return this->fixed;
+    }
+    
+    const std::string& get_pattern () {
+      return this->pattern;
+    }
+    
+    bool is_pattern_utf8 () {
+      return this->pattern_utf8;
+    }
+    
+    // Latin-1 string is upgraded when pattern is UTF-8
+    void set_string (const char* str, STRLEN length, bool utf8) {
+      if (this->fixed) {
+        if (!utf8 && this->pattern_utf8 && !Rstats::Util::is_ascii(str, length)) {
+          Rstats::Util::latin1_to_utf8(str, length, this->upgraded_str);
+          str = this->upgraded_str.data();
+          length = this->upgraded_str.size();
+          utf8 = true;
+        }
+      }
+      else {
+        sv_setpvn(this->sv_str, str, length);
+        if (utf8) {
+          SvUTF8_on(this->sv_str);
+        }
+        else {
+          SvUTF8_off(this->sv_str);
+          if (RX_UTF8(this->re)) {
+            sv_utf8_upgrade(this->sv_str);
+            utf8 = true;
+          }
+        }
+        str = SvPV(this->sv_str, length);
+      }
       
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::less_than())");
+      this->str = str;
+      this->length = length;
+      this->utf8 = utf8;
+    }
+    
+    const char* get_str () {
+      return this->str;
+    }
+    
+    STRLEN get_length () {
+      return this->length;
+    }
+    
+    bool is_utf8 () {
+      return this->utf8;
+    }
+    
+    // Byte offsets of first match at or after offset
+    bool find (STRLEN offset, STRLEN* start, STRLEN* end) {
+      if (offset > this->length) {
+        return false;
       }
       
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::less_than())");
+      if (this->fixed) {
+        return Rstats::Matcher::find_fixed(this->str, this->length, this->pattern, offset, start, end);
+      }
+      
+      char* begin = SvPVX(this->sv_str);
+      IV ret = pregexec(this->re, begin + offset, begin + this->length, begin, 0, this->sv_str, 1);
+      if (!ret) {
+        return false;
+      }
+      *start = RX_OFFS(this->re)[0].start;
+      *end = RX_OFFS(this->re)[0].end;
+      
+      return true;
+    }
+    
+    // Capture group of last match(0 is whole match)
+    bool get_capture (IV index, STRLEN* start, STRLEN* end) {
+      if (this->fixed || index > (IV)RX_NPARENS(this->re) || RX_OFFS(this->re)[index].start == -1) {
+        return false;
+      }
+      *start = RX_OFFS(this->re)[index].start;
+      *end = RX_OFFS(this->re)[index].end;
+      
+      return true;
+    }
+    
+    static bool find_fixed (const char* str, STRLEN length, const std::string& pattern, STRLEN offset, STRLEN* start, STRLEN* end) {
+      if (pattern.empty()) {
+        *start = *end = offset;
+        return true;
+      }
+      
+      const char* found = (const char*)memmem(str + offset, length - offset, pattern.data(), pattern.size());
+      if (found == NULL) {
+        return false;
+      }
+      *start = found - str;
+      *end = *start + pattern.size();
+      
+      return true;
+    }
+    
+    // Same as find_fixed for worker threads. buffer is used to upgrade Latin-1 string.
+    static bool find_fixed (const StringView& view, const std::string& pattern, bool pattern_utf8, std::string& buffer, STRLEN* start, STRLEN* end) {
+      if (!view.utf8 && pattern_utf8 && !Rstats::Util::is_ascii(view.ptr, view.length)) {
+        Rstats::Util::latin1_to_utf8(view.ptr, view.length, buffer);
+        bool found = Rstats::Matcher::find_fixed(buffer.data(), buffer.size(), pattern, 0, start, end);
+        if (found) {
+          // Offsets of Latin-1 string
+          *start = Rstats::Util::count_utf8_chars(buffer.data(), *start);
+          *end = Rstats::Util::count_utf8_chars(buffer.data(), *end);
+        }
+        return found;
       }
       
+      return Rstats::Matcher::find_fixed(view.ptr, view.length, pattern, 0, start, end);
+    }
+    
+    // Strings are collected in the interpreter thread, so workers read only the views
+    static void get_string_views (Rstats::Vector* e1, std::vector<StringView>& views) {
       IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
+      views.resize(length);
+      for (IV i = 0; i < length; i++) {
+        views[i].ptr = e1->get_character_ptr(i);
+        views[i].length = e1->get_character_length(i);
+        views[i].utf8 = e1->is_character_utf8(i);
+        views[i].na = e1->exists_na_position(i);
+      }
+    }
+  };
+  
+  // Rstats::VectorFunc
+  namespace VectorFunc {
+
+    Rstats::Vector* negation (Rstats::Vector* e1) {
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) < 0) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
+          croak("argument is not interpretable as logical(Rstats::VectorFunc::negation())");
           break;
         case Rstats::VectorType::COMPLEX :
-          croak("invalid comparison with complex values(Rstats::VectorFunc::less_than())");
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            std::complex<NV> value = e1->get_complex_value(i);
+            e2->set_complex_value(i, std::complex<NV>(-value.real(), -value.imag()));
+          }
           break;
         case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
-            }
-            else {
-              if (e1->get_double_value(i) < e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
-            }
+            e2->set_double_value(i, -e1->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_integer(length);
           for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) < e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
+            e2->set_integer_value(i, -e1->get_integer_value(i));
           }
           break;
         default:
-          croak("Invalid type");
-
+          croak("unexpected type");
       }
+
+      e2->merge_na_positions(e1);
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      return e3;
+      return e2;
     }
-    
-    Rstats::Vector* more_than(Rstats::Vector* e1, Rstats::Vector* e2) {
+
+    Rstats::Vector* reminder(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::more_than())");
+        croak("Can't reminder different type(Rstats::VectorFunc::remainder())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::more_than())");
+        croak("Can't reminder different length(Rstats::VectorFunc::remainder())");
       }
       
       IV length = e1->get_length();
-      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
+      Rstats::Vector* e3 = Rstats::Vector::new_double(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) > 0) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
+          croak("Error : non-numeric argument to binary operator(Rstats::Vector::Func::reminder())");
           break;
         case Rstats::VectorType::COMPLEX :
-          croak("invalid comparison with complex values(Rstats::VectorFunc::more_than())");
+          croak("unimplemented complex operation(Rstats::Vector::Func::reminder())");
           break;
         case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
+            NV e1_value = e1->get_double_value(i);
+            NV e2_value = e2->get_double_value(i);
+            
+            if (std::isnan(e1_value) || std::isnan(e2_value) || e2_value == 0) {
+              e3->set_double_value(i, std::numeric_limits<NV>::signaling_NaN());
             }
             else {
-              if (e1->get_double_value(i) > e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
+              NV e3_value = e1_value - std::floor(e1_value / e2_value) * e2_value;
+              e3->set_double_value(i, e3_value);
             }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) > e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
+            if (e2->get_integer_value(i) == 0) {
+              e3->set_double_value(i, std::numeric_limits<NV>::signaling_NaN());
             }
             else {
-              e3->set_integer_value(i, 0);
+              e3->set_double_value(i, e1->get_integer_value(i) % e2->get_integer_value(i));
             }
           }
           break;
         default:
           croak("Invalid type");
-
       }
       
       e3->merge_na_positions(e1);
@@ -1444,300 +2421,260 @@ namespace Rstats {
       return e3;
     }
     
-    Rstats::Vector* not_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
+    Rstats::Vector* And(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::not_equal())");
+        croak("Can't compare different type(Rstats::VectorFunc::And())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::not_equal())");
+        croak("Can't compare different length(Rstats::VectorFunc::And())");
       }
       
       IV length = e1->get_length();
       Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) != 0) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          for (IV i = 0; i < length; i++) {
-            if (e1->get_complex_value(i) != e2->get_complex_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
-            }
-            else {
-              if (e1->get_double_value(i) != e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
-            }
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) != e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
-          break;
-        default:
-          croak("Invalid type");
-
+      
+      Rstats::Vector* e1_fix = NULL;
+      Rstats::Vector* e2_fix = NULL;
+      
+      if (!e1->is_logical()) {
+        e1_fix = e1->as_logical();
+        e1 = e1_fix;
+      }
+      
+      if (!e2->is_logical()) {
+        e2_fix = e2->as_logical();
+        e2 = e2_fix;
+      }
+      
+      for (IV i = 0; i < length; i++) {
+        e3->set_integer_value(i, e1->get_integer_value(i) && e2->get_integer_value(i));
       }
       
       e3->merge_na_positions(e1);
       e3->merge_na_positions(e2);
       
+      if (e1_fix != NULL) {
+        delete e1_fix;
+      }
+      
+      if (e2_fix != NULL) {
+        delete e2_fix;
+      }
+      
       return e3;
     }
     
-    Rstats::Vector* equal(Rstats::Vector* e1, Rstats::Vector* e2) {
+    Rstats::Vector* Or(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't compare different type(Rstats::VectorFunc::equal())");
+        croak("Can't compare different type(Rstats::VectorFunc::Or())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't compare different length(Rstats::VectorFunc::equal())");
+        croak("Can't compare different length(Rstats::VectorFunc::Or())");
       }
       
       IV length = e1->get_length();
       Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
+      
+      Rstats::Vector* e1_fix = NULL;
+      Rstats::Vector* e2_fix = NULL;
+      
+      if (!e1->is_logical()) {
+        e1_fix = e1->as_logical();
+        e1 = e1_fix;
+      }
+      
+      if (!e2->is_logical()) {
+        e2_fix = e2->as_logical();
+        e2 = e2_fix;
+      }
+      
+      for (IV i = 0; i < length; i++) {
+        e3->set_integer_value(i, e1->get_integer_value(i) || e2->get_integer_value(i));
+      }
+      
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
+      
+      if (e1_fix != NULL) {
+        delete e1_fix;
+      }
+      
+      if (e2_fix != NULL) {
+        delete e2_fix;
+      }
+      
+      return e3;
+    }
+    
+    Rstats::Vector* Conj (Rstats::Vector* e1) {
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          for (IV i = 0; i < length; i++) {
-            if (sv_cmp(e1->get_character_value(i), e2->get_character_value(i)) == 0) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
-          }
+          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Re())");
           break;
         case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            if (e1->get_complex_value(i) == e2->get_complex_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
+            std::complex<NV> e1_value = e1->get_complex_value(i);
+            std::complex<NV> e2_value(e1_value.real(), -e1_value.imag());
+            e2->set_complex_value(i, e2_value);
           }
           break;
         case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            NV value1 = e1->get_double_value(i);
-            NV value2 = e2->get_double_value(i);
-            if (std::isnan(value1) || std::isnan(value2)) {
-              e3->add_na_position(i);
-            }
-            else {
-              if (e1->get_double_value(i) == e2->get_double_value(i)) {
-                e3->set_integer_value(i, 1);
-              }
-              else {
-                e3->set_integer_value(i, 0);
-              }
-            }
+            e2->set_double_value(i, e1->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
+          e2 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, e1->get_integer_value(i));
+          }
+          break;
         case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            if (e1->get_integer_value(i) == e2->get_integer_value(i)) {
-              e3->set_integer_value(i, 1);
-            }
-            else {
-              e3->set_integer_value(i, 0);
-            }
+            e2->set_integer_value(i, e1->get_integer_value(i));
           }
           break;
         default:
-          croak("Invalid type");
-
+          croak("unexpected type");
       }
+
+      e2->merge_na_positions(e1);
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      return e3;
+      return e2;
     }
     
-    Rstats::Vector* sum(Rstats::Vector* e1) {
-      
+    Rstats::Vector* Re (Rstats::Vector* e1) {
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
+          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Re())");
           break;
-        case Rstats::VectorType::COMPLEX : {
-          e2 = Rstats::Vector::new_complex(1);
-          std::complex<NV> e2_total(0, 0);
+        case Rstats::VectorType::COMPLEX :
           for (IV i = 0; i < length; i++) {
-            e2_total += e1->get_complex_value(i);
+            e2->set_double_value(i, e1->get_complex_value(i).real());
           }
-          e2->set_complex_value(0, e2_total);
           break;
-        }
-        case Rstats::VectorType::DOUBLE : {
-          e2 = Rstats::Vector::new_double(1);
-          NV e2_total(0);
+        case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            e2_total += e1->get_double_value(i);
+            e2->set_double_value(i, e1->get_double_value(i));
           }
-          e2->set_double_value(0, e2_total);
           break;
-        }
         case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL : {
-          e2 = Rstats::Vector::new_integer(1);
-          IV e2_total(0);
+        case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            e2_total += e1->get_integer_value(i);
+            e2->set_integer_value(i, e1->get_integer_value(i));
           }
-          e2->set_integer_value(0, e2_total);
           break;
-        }
         default:
-          croak("Invalid type");
-
-      }
-      
-      for (IV i = 0; i < length; i++) {
-        if (e1->exists_na_position(i)) {
-          e2->add_na_position(0);
-          break;
-        }
+          croak("unexpected type");
       }
+
+      e2->merge_na_positions(e1);
       
       return e2;
     }
     
-    Rstats::Vector* add(Rstats::Vector* e1, Rstats::Vector* e2) {
-      
-      if (e1->get_type() != e2->get_type()) {
-        croak("Can't add different type(Rstats::VectorFunc::add())");
-      }
-      
-      if (e1->get_length() != e2->get_length()) {
-        croak("Can't add different length(Rstats::VectorFunc::add())");
-      }
-      
+    Rstats::Vector* Im (Rstats::Vector* e1) {
       IV length = e1->get_length();
-      Rstats::Vector* e3;
+      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
       Rstats::VectorType::Enum type = e1->get_type();
-      
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a + b : non-numeric argument to binary operator");
+          croak("Error : non-numeric argument to function(Rstats::VectorFunc::Im())");
           break;
         case Rstats::VectorType::COMPLEX :
-          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_complex_value(i, e1->get_complex_value(i) + e2->get_complex_value(i));
+            e2->set_double_value(i, e1->get_complex_value(i).imag());
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, e1->get_double_value(i) + e2->get_double_value(i));
+            e2->set_double_value(i, 0);
           }
           break;
         case Rstats::VectorType::INTEGER :
-          e3 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) + e2->get_integer_value(i));
-          }
-          break;
         case Rstats::VectorType::LOGICAL :
-          e3 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) + e2->get_integer_value(i));
+            e2->set_integer_value(i, 0);
           }
           break;
         default:
-          croak("Invalid type");
+          croak("unexpected type");
       }
+
+      e2->merge_na_positions(e1);
       
-      e3->merge_na_positions(e1);
-      e3->merge_na_positions(e2);
-      
-      return e3;
+      return e2;
     }
-
-    Rstats::Vector* subtract(Rstats::Vector* e1, Rstats::Vector* e2) {
+    
+    Rstats::Vector* less_than_or_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't subtract different type(Rstats::VectorFunc::subtract())");
+        croak("Can't compare different type(Rstats::VectorFunc::less_than_or_equal())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't subtract different length(Rstats::VectorFunc::subtract())");
+        croak("Can't compare different length(Rstats::VectorFunc::less_than_or_equal())");
       }
       
       IV length = e1->get_length();
-      Rstats::Vector* e3;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_complex_value(i, e1->get_complex_value(i) - e2->get_complex_value(i));
+            if (e1->compare_character_value(i, e2, i) <= 0) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
+        case Rstats::VectorType::COMPLEX :
+          croak("invalid comparison with complex values(Rstats::VectorFunc::less_than_or_equal())");
+          break;
         case Rstats::VectorType::DOUBLE :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, e1->get_double_value(i) - e2->get_double_value(i));
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) <= e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
-          e3 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) - e2->get_integer_value(i));
-          }
-          break;
         case Rstats::VectorType::LOGICAL :
-          e3 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) - e2->get_integer_value(i));
+            if (e1->get_integer_value(i) <= e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         default:
           croak("Invalid type");
-
       }
       
       e3->merge_na_positions(e1);
@@ -1745,46 +2682,60 @@ namespace Rstats {
       
       return e3;
     }
-
-    Rstats::Vector* multiply(Rstats::Vector* e1, Rstats::Vector* e2) {
+    
+    Rstats::Vector* more_than_or_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't multiply different type(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different type(Rstats::VectorFunc::more_than_or_equal())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't multiply different length(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different length(Rstats::VectorFunc::more_than_or_equal())");
       }
       
       IV length = e1->get_length();
-      Rstats::Vector* e3;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_complex_value(i, e1->get_complex_value(i) * e2->get_complex_value(i));
+            if (e1->compare_character_value(i, e2, i) >= 0) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
+        case Rstats::VectorType::COMPLEX :
+          croak("invalid comparison with complex values(Rstats::VectorFunc::more_than_or_equal())");
+          break;
         case Rstats::VectorType::DOUBLE :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, e1->get_double_value(i) * e2->get_double_value(i));
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) >= e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
-          e3 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) * e2->get_integer_value(i));
-          }
-          break;
         case Rstats::VectorType::LOGICAL :
-          e3 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_integer_value(i, e1->get_integer_value(i) * e2->get_integer_value(i));
+            if (e1->get_integer_value(i) >= e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         default:
@@ -1797,41 +2748,60 @@ namespace Rstats {
       
       return e3;
     }
-
-    Rstats::Vector* divide(Rstats::Vector* e1, Rstats::Vector* e2) {
+    
+    Rstats::Vector* less_than(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't divide different type(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different type(Rstats::VectorFunc::less_than())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't divide different length(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different length(Rstats::VectorFunc::less_than())");
       }
       
       IV length = e1->get_length();
-      Rstats::Vector* e3;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_complex_value(i, e1->get_complex_value(i) / e2->get_complex_value(i));
+            if (e1->compare_character_value(i, e2, i) < 0) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
+        case Rstats::VectorType::COMPLEX :
+          croak("invalid comparison with complex values(Rstats::VectorFunc::less_than())");
+          break;
         case Rstats::VectorType::DOUBLE :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, e1->get_double_value(i) / e2->get_double_value(i));
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) < e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, e1->get_integer_value(i) / e2->get_integer_value(i));
+            if (e1->get_integer_value(i) < e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         default:
@@ -1844,41 +2814,60 @@ namespace Rstats {
       
       return e3;
     }
-
-    Rstats::Vector* pow(Rstats::Vector* e1, Rstats::Vector* e2) {
+    
+    Rstats::Vector* more_than(Rstats::Vector* e1, Rstats::Vector* e2) {
       
       if (e1->get_type() != e2->get_type()) {
-        croak("Can't pow different type(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different type(Rstats::VectorFunc::more_than())");
       }
       
       if (e1->get_length() != e2->get_length()) {
-        croak("Can't pow different length(Rstats::VectorFunc::multiply())");
+        croak("Can't compare different length(Rstats::VectorFunc::more_than())");
       }
       
       IV length = e1->get_length();
-      Rstats::Vector* e3;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_complex_value(i, std::pow(e1->get_complex_value(i), e2->get_complex_value(i)));
+            if (e1->compare_character_value(i, e2, i) > 0) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
+        case Rstats::VectorType::COMPLEX :
+          croak("invalid comparison with complex values(Rstats::VectorFunc::more_than())");
+          break;
         case Rstats::VectorType::DOUBLE :
-          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, ::pow(e1->get_double_value(i), e2->get_double_value(i)));
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e3 = Rstats::Vector::new_double(length);
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) > e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            e3->set_double_value(i, ::pow(e1->get_integer_value(i), e2->get_integer_value(i)));
+            if (e1->get_integer_value(i) > e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         default:
@@ -1891,89 +2880,140 @@ namespace Rstats {
       
       return e3;
     }
-
-    Rstats::Vector* sqrt(Rstats::Vector* e1) {
+    
+    Rstats::Vector* not_equal(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't compare different type(Rstats::VectorFunc::not_equal())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't compare different length(Rstats::VectorFunc::not_equal())");
+      }
       
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
+          for (IV i = 0; i < length; i++) {
+            if (!e1->equal_character_value(i, e2, i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
+          }
           break;
-        case Rstats::VectorType::COMPLEX : {
-          e2 = Rstats::Vector::new_complex(length);
-          std::complex<NV> value;
+        case Rstats::VectorType::COMPLEX :
           for (IV i = 0; i < length; i++) {
-            value = e1->get_complex_value(i);
-            
-            // Fix bug that clang sqrt can't right value of perfect squeres
-            if (value.imag() == 0 && value.real() < 0) {
-              e2->set_complex_value(
-                i,
-                std::complex<NV>(
-                  0,
-                  std::sqrt(-(value.real()))
-                )
-              );
+            if (e1->get_complex_value(i) != e2->get_complex_value(i)) {
+              e3->set_integer_value(i, 1);
             }
             else {
-              e2->set_complex_value(i, std::sqrt(value));
+              e3->set_integer_value(i, 0);
             }
           }
           break;
-        }
-        case Rstats::VectorType::DOUBLE : {
-          e2 = Rstats::Vector::new_double(length);
+        case Rstats::VectorType::DOUBLE :
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sqrt(e1->get_double_value(i)));
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) != e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
           }
           break;
-        }
         case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL : {
-          e2 = Rstats::Vector::new_double(length);
+        case Rstats::VectorType::LOGICAL :
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sqrt(e1->get_integer_value(i)));
+            if (e1->get_integer_value(i) != e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
-        }
         default:
           croak("Invalid type");
 
       }
       
-      e2->merge_na_positions(e1);
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
       
-      return e2;
+      return e3;
     }
-
-    Rstats::Vector* sin(Rstats::Vector* e1) {
+    
+    Rstats::Vector* equal(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't compare different type(Rstats::VectorFunc::equal())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't compare different length(Rstats::VectorFunc::equal())");
+      }
       
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e3 = Rstats::Vector::new_logical(length);
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
+          for (IV i = 0; i < length; i++) {
+            if (e1->equal_character_value(i, e2, i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
+          }
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::sin(e1->get_complex_value(i)));
+            if (e1->get_complex_value(i) == e2->get_complex_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sin(e1->get_double_value(i)));
+            NV value1 = e1->get_double_value(i);
+            NV value2 = e2->get_double_value(i);
+            if (std::isnan(value1) || std::isnan(value2)) {
+              e3->add_na_position(i);
+            }
+            else {
+              if (e1->get_double_value(i) == e2->get_double_value(i)) {
+                e3->set_integer_value(i, 1);
+              }
+              else {
+                e3->set_integer_value(i, 0);
+              }
+            }
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sin(e1->get_integer_value(i)));
+            if (e1->get_integer_value(i) == e2->get_integer_value(i)) {
+              e3->set_integer_value(i, 1);
+            }
+            else {
+              e3->set_integer_value(i, 0);
+            }
           }
           break;
         default:
@@ -1981,12 +3021,41 @@ namespace Rstats {
 
       }
       
-      e2->merge_na_positions(e1);
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
       
-      return e2;
+      return e3;
     }
     
-    Rstats::Vector* cos(Rstats::Vector* e1) {
+    // Call func(begin, end) for ranges of elements. Values of a mapped vector are processed in chunks.
+    // The next chunk is read ahead, and pages of a read-only mapping are released after use.
+    template <class Func>
+    void for_each_chunk(Rstats::Vector* e1, Func func) {
+      IV length = e1->get_length();
+      Rstats::VectorType::Enum type = e1->get_type();
+      Rstats::MappedFile* mapped_file = e1->get_mapped_file();
+      if (mapped_file == NULL || type == Rstats::VectorType::CHARACTER || type == Rstats::VectorType::COMPLEX) {
+        func(0, length);
+        return;
+      }
+      
+      STRLEN element_size = type == Rstats::VectorType::DOUBLE ? sizeof(NV) : sizeof(IV);
+      const char* values = (const char*)e1->get_integer_values();
+      IV chunk_length = RSTATS_MAPPED_CHUNK_SIZE / element_size;
+      for (IV begin = 0; begin < length; begin += chunk_length) {
+        IV end = begin + chunk_length < length ? begin + chunk_length : length;
+        if (end < length) {
+          IV next_end = end + chunk_length < length ? end + chunk_length : length;
+          mapped_file->advise(values + end * element_size, (next_end - end) * element_size, MADV_WILLNEED);
+        }
+        func(begin, end);
+        if (mapped_file->is_read_only()) {
+          mapped_file->advise(values + begin * element_size, (end - begin) * element_size, MADV_DONTNEED);
+        }
+      }
+    }
+    
+    Rstats::Vector* sum(Rstats::Vector* e1) {
       
       IV length = e1->get_length();
       Rstats::Vector* e2;
@@ -1995,99 +3064,364 @@ namespace Rstats {
         case Rstats::VectorType::CHARACTER :
           croak("Error in a - b : non-numeric argument to binary operator");
           break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
+        case Rstats::VectorType::COMPLEX : {
+          e2 = Rstats::Vector::new_complex(1);
+          std::complex<NV> e2_total(0, 0);
           for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::cos(e1->get_complex_value(i)));
+            e2_total += e1->get_complex_value(i);
           }
+          e2->set_complex_value(0, e2_total);
           break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::cos(e1->get_double_value(i)));
-          }
+        }
+        case Rstats::VectorType::DOUBLE : {
+          e2 = Rstats::Vector::new_double(1);
+          NV* e1_values = e1->get_double_values();
+          NV e2_total(0);
+          for_each_chunk(e1, [&](IV begin, IV end) {
+            for (IV i = begin; i < end; i++) {
+              e2_total += e1_values[i];
+            }
+          });
+          e2->set_double_value(0, e2_total);
           break;
+        }
         case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::cos(e1->get_integer_value(i)));
-          }
+        case Rstats::VectorType::LOGICAL : {
+          e2 = Rstats::Vector::new_integer(1);
+          IV* e1_values = e1->get_integer_values();
+          IV e2_total(0);
+          for_each_chunk(e1, [&](IV begin, IV end) {
+            for (IV i = begin; i < end; i++) {
+              e2_total += e1_values[i];
+            }
+          });
+          e2->set_integer_value(0, e2_total);
           break;
+        }
         default:
           croak("Invalid type");
 
       }
       
-      e2->merge_na_positions(e1);
+      if (!e1->get_na_positions().empty()) {
+        e2->add_na_position(0);
+      }
       
       return e2;
     }
-
-    Rstats::Vector* tan(Rstats::Vector* e1) {
+    
+    IV& sort_memory_ref() {
+      static IV sort_memory = RSTATS_SORT_MEMORY;
+      return sort_memory;
+    }
+    
+    // Bytes of values sorted in memory. Larger mapped vectors are sorted by external merge sort.
+    IV get_sort_memory() {
+      return sort_memory_ref();
+    }
+    
+    void set_sort_memory(IV sort_memory) {
+      sort_memory_ref() = sort_memory < 1 ? 1 : sort_memory;
+    }
+    
+    // Temporary file in TMPDIR, which is removed when it is closed. Return -1 if it can't be created.
+    int create_temp_file() {
+      const char* dir = getenv("TMPDIR");
+      std::string path = std::string(dir && *dir ? dir : "/tmp") + "/rstats-XXXXXX";
+      std::vector<char> name(path.begin(), path.end());
+      name.push_back('\0');
+      int fd = mkstemp(name.data());
+      if (fd >= 0) {
+        unlink(name.data());
+      }
       
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
+      return fd;
+    }
+    
+    // Empty vector of the type of sorted values
+    Rstats::Vector* new_sorted(Rstats::VectorType::Enum type, IV length) {
       switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::tan(e1->get_complex_value(i)));
-          }
-          break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::tan(e1->get_double_value(i)));
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
+          return Rstats::Vector::new_double(length);
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::tan(e1->get_integer_value(i)));
-          }
-          break;
+          return Rstats::Vector::new_logical(length);
         default:
-          croak("Invalid type");
-
+          return Rstats::Vector::new_integer(length);
+      }
+    }
+    
+    template <class T>
+    Rstats::Vector* sort_in_memory(Rstats::Vector* e1, T* e1_values, bool decreasing) {
+      const std::map<IV, IV>& na_positions = e1->get_na_positions();
+      bool has_na = !na_positions.empty();
+      std::vector<T> sorted;
+      sorted.reserve(e1->get_length() - na_positions.size());
+      for_each_chunk(e1, [&](IV begin, IV end) {
+        for (IV i = begin; i < end; i++) {
+          if (e1_values[i] == e1_values[i] && !(has_na && na_positions.count(i))) {
+            sorted.push_back(e1_values[i]);
+          }
+        }
+      });
+      if (decreasing) {
+        std::sort(sorted.begin(), sorted.end(), std::greater<T>());
+      }
+      else {
+        std::sort(sorted.begin(), sorted.end());
       }
       
-      e2->merge_na_positions(e1);
+      Rstats::Vector* e2 = new_sorted(e1->get_type(), sorted.size());
+      if (!sorted.empty()) {
+        memcpy(e2->get_integer_values(), sorted.data(), sorted.size() * sizeof(T));
+      }
       
       return e2;
     }
-
-    Rstats::Vector* sinh(Rstats::Vector* e1) {
+    
+    // Values are sorted in runs of sort memory, which are written to a temporary file and merged
+    // into another temporary file. The result is a view of the merged file.
+    template <class T>
+    Rstats::Vector* sort_external(Rstats::Vector* e1, T* e1_values, bool decreasing) {
+      const std::map<IV, IV>& na_positions = e1->get_na_positions();
+      bool has_na = !na_positions.empty();
+      IV run_length = get_sort_memory() / (IV)sizeof(T);
+      if (run_length < 1) {
+        run_length = 1;
+      }
       
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
+      int runs_fd = create_temp_file();
+      if (runs_fd < 0) {
+        croak("Can't create temporary file: %s(Rstats::VectorFunc::sort())", strerror(errno));
+      }
+      Rstats::FileWriter runs_writer(runs_fd);
+      std::vector<std::pair<IV, IV> > runs;
+      std::vector<T> run;
+      run.reserve(run_length);
+      IV total = 0;
+      auto write_run = [&]() {
+        if (decreasing) {
+          std::sort(run.begin(), run.end(), std::greater<T>());
+        }
+        else {
+          std::sort(run.begin(), run.end());
+        }
+        runs.push_back(std::pair<IV, IV>(total, run.size()));
+        runs_writer.write(run.data(), run.size() * sizeof(T));
+        total += run.size();
+        run.clear();
+      };
+      for_each_chunk(e1, [&](IV begin, IV end) {
+        for (IV i = begin; i < end; i++) {
+          if (e1_values[i] == e1_values[i] && !(has_na && na_positions.count(i))) {
+            run.push_back(e1_values[i]);
+            if ((IV)run.size() == run_length) {
+              write_run();
+            }
+          }
+        }
+      });
+      if (!run.empty()) {
+        write_run();
+      }
+      std::vector<T>().swap(run);
+      runs_writer.flush();
+      
+      Rstats::MappedFile* runs_file = runs_writer.ok && total > 0 ? Rstats::MappedFile::map_fd(runs_fd, true) : NULL;
+      ::close(runs_fd);
+      if (total == 0) {
+        return new_sorted(e1->get_type(), 0);
+      }
+      if (runs_file == NULL) {
+        croak("Can't write temporary file(Rstats::VectorFunc::sort())");
+      }
+      runs_file->advise(runs_file->get_data(), runs_file->get_size(), MADV_SEQUENTIAL);
+      
+      int merged_fd = create_temp_file();
+      if (merged_fd < 0) {
+        runs_file->dec_refcnt();
+        croak("Can't create temporary file: %s(Rstats::VectorFunc::sort())", strerror(errno));
+      }
+      Rstats::FileWriter merged_writer(merged_fd);
+      const T* run_values = (const T*)runs_file->get_data();
+      
+      // Heap of the head of each run. The top is the next value of the result.
+      std::vector<IV> positions(runs.size());
+      auto later = [&](IV a, IV b) {
+        T a_value = run_values[positions[a]];
+        T b_value = run_values[positions[b]];
+        return decreasing ? a_value < b_value : a_value > b_value;
+      };
+      std::priority_queue<IV, std::vector<IV>, decltype(later)> heads(later);
+      for (size_t r = 0; r < runs.size(); r++) {
+        positions[r] = runs[r].first;
+        heads.push(r);
+      }
+      while (!heads.empty()) {
+        IV r = heads.top();
+        heads.pop();
+        merged_writer.write(&run_values[positions[r]], sizeof(T));
+        positions[r]++;
+        if (positions[r] < runs[r].first + runs[r].second) {
+          heads.push(r);
+        }
+      }
+      merged_writer.flush();
+      runs_file->dec_refcnt();
+      
+      Rstats::MappedFile* merged_file = merged_writer.ok ? Rstats::MappedFile::map_fd(merged_fd, false) : NULL;
+      ::close(merged_fd);
+      if (merged_file == NULL) {
+        croak("Can't write temporary file(Rstats::VectorFunc::sort())");
+      }
+      Rstats::Vector* e2 = Rstats::Vector::new_mapped(e1->get_type(), total, merged_file, 0, 0, 0, false);
+      merged_file->dec_refcnt();
+      
+      return e2;
+    }
+    
+    // Sorted values except NA and NaN. Type is kept. A mapped vector larger than sort memory
+    // is sorted by external merge sort.
+    Rstats::Vector* sort(Rstats::Vector* e1, bool decreasing) {
+      Rstats::VectorType::Enum type = e1->get_type();
+      bool external = e1->get_mapped_file() != NULL && e1->get_length() > get_sort_memory() / (IV)sizeof(NV);
+      
+      Rstats::Vector* e2;
+      switch (type) {
+        case Rstats::VectorType::DOUBLE :
+          if (external) {
+            e2 = sort_external(e1, e1->get_double_values(), decreasing);
+          }
+          else {
+            e2 = sort_in_memory(e1, e1->get_double_values(), decreasing);
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          if (external) {
+            e2 = sort_external(e1, e1->get_integer_values(), decreasing);
+          }
+          else {
+            e2 = sort_in_memory(e1, e1->get_integer_values(), decreasing);
+          }
+          break;
+        default:
+          croak("Error in sort : only double, integer and logical vectors are sorted natively(Rstats::VectorFunc::sort())");
+      }
+      
+      return e2;
+    }
+    
+    // Vector of native doubles or integers in the file. Values are read from the file when they are used.
+    Rstats::Vector* new_mapped_file(const char* file, Rstats::VectorType::Enum type, bool read_only) {
+      std::string error;
+      Rstats::MappedFile* mapped_file = Rstats::MappedFile::open(file, error, read_only);
+      if (mapped_file == NULL) {
+        croak("%s(Rstats::VectorFunc::new_mapped_file())", error.c_str());
+      }
+      STRLEN element_size = type == Rstats::VectorType::DOUBLE ? sizeof(NV) : sizeof(IV);
+      STRLEN size = mapped_file->get_size();
+      if (size % element_size != 0) {
+        mapped_file->dec_refcnt();
+        croak("size of file '%s' is not a multiple of %d(Rstats::VectorFunc::new_mapped_file())", file, (int)element_size);
+      }
+      mapped_file->advise(mapped_file->get_data(), size, MADV_SEQUENTIAL);
+      Rstats::Vector* e1 = Rstats::Vector::new_mapped(type, size / element_size, mapped_file, 0, 0, 0, false);
+      mapped_file->dec_refcnt();
+      
+      return e1;
+    }
+    
+    Rstats::Vector* add(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't add different type(Rstats::VectorFunc::add())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't add different length(Rstats::VectorFunc::add())");
+      }
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e3;
+      Rstats::VectorType::Enum type = e1->get_type();
+      
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a + b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e3 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_complex_value(i, e1->get_complex_value(i) + e2->get_complex_value(i));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e3 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_double_value(i, e1->get_double_value(i) + e2->get_double_value(i));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+          e3 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_integer_value(i, e1->get_integer_value(i) + e2->get_integer_value(i));
+          }
+          break;
+        case Rstats::VectorType::LOGICAL :
+          e3 = Rstats::Vector::new_logical(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_integer_value(i, e1->get_integer_value(i) + e2->get_integer_value(i));
+          }
+          break;
+        default:
+          croak("Invalid type");
+      }
+      
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
+      
+      return e3;
+    }
+
+    Rstats::Vector* subtract(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't subtract different type(Rstats::VectorFunc::subtract())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't subtract different length(Rstats::VectorFunc::subtract())");
+      }
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e3;
+      Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           croak("Error in a - b : non-numeric argument to binary operator");
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
+          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::sinh(e1->get_complex_value(i)));
+            e3->set_complex_value(i, e1->get_complex_value(i) - e2->get_complex_value(i));
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sinh(e1->get_double_value(i)));
+            e3->set_double_value(i, e1->get_double_value(i) - e2->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
+          e3 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_integer_value(i, e1->get_integer_value(i) - e2->get_integer_value(i));
+          }
+          break;
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::sinh(e1->get_integer_value(i)));
+            e3->set_integer_value(i, e1->get_integer_value(i) - e2->get_integer_value(i));
           }
           break;
         default:
@@ -2095,37 +3429,51 @@ namespace Rstats {
 
       }
       
-      e2->merge_na_positions(e1);
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
       
-      return e2;
+      return e3;
     }
-    
-    Rstats::Vector* cosh(Rstats::Vector* e1) {
+
+    Rstats::Vector* multiply(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't multiply different type(Rstats::VectorFunc::multiply())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't multiply different length(Rstats::VectorFunc::multiply())");
+      }
       
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e3;
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           croak("Error in a - b : non-numeric argument to binary operator");
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
+          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::cosh(e1->get_complex_value(i)));
+            e3->set_complex_value(i, e1->get_complex_value(i) * e2->get_complex_value(i));
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::cosh(e1->get_double_value(i)));
+            e3->set_double_value(i, e1->get_double_value(i) * e2->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
+          e3 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_integer_value(i, e1->get_integer_value(i) * e2->get_integer_value(i));
+          }
+          break;
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_logical(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::cosh(e1->get_integer_value(i)));
+            e3->set_integer_value(i, e1->get_integer_value(i) * e2->get_integer_value(i));
           }
           break;
         default:
@@ -2133,47 +3481,46 @@ namespace Rstats {
 
       }
       
-      e2->merge_na_positions(e1);
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
       
-      return e2;
+      return e3;
     }
 
-    Rstats::Vector* tanh(Rstats::Vector* e1) {
+    Rstats::Vector* divide(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't divide different type(Rstats::VectorFunc::multiply())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't divide different length(Rstats::VectorFunc::multiply())");
+      }
       
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e3;
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           croak("Error in a - b : non-numeric argument to binary operator");
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          NV e1_value_re;
+          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e1_value_re = e1->get_complex_value(i).real();
-            
-            // For fix FreeBSD bug
-            // FreeBAD return (NaN + NaNi) when real value is negative infinite
-            if (std::isinf(e1_value_re) && e1_value_re < 0) {
-              e2->set_complex_value(i, std::complex<NV>(-1, 0));
-            }
-            else {
-              e2->set_complex_value(i, std::tanh(e1->get_complex_value(i)));
-            }
+            e3->set_complex_value(i, e1->get_complex_value(i) / e2->get_complex_value(i));
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::tanh(e1->get_double_value(i)));
+            e3->set_double_value(i, e1->get_double_value(i) / e2->get_double_value(i));
           }
           break;
         case Rstats::VectorType::INTEGER :
         case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::tanh(e1->get_integer_value(i)));
+            e3->set_double_value(i, e1->get_integer_value(i) / e2->get_integer_value(i));
           }
           break;
         default:
@@ -2181,441 +3528,6099 @@ namespace Rstats {
 
       }
       
-      e2->merge_na_positions(e1);
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
       
-      return e2;
+      return e3;
     }
 
-    Rstats::Vector* abs(Rstats::Vector* e1) {
+    Rstats::Vector* pow(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (e1->get_type() != e2->get_type()) {
+        croak("Can't pow different type(Rstats::VectorFunc::multiply())");
+      }
+      
+      if (e1->get_length() != e2->get_length()) {
+        croak("Can't pow different length(Rstats::VectorFunc::multiply())");
+      }
       
       IV length = e1->get_length();
-      Rstats::Vector* e2;
+      Rstats::Vector* e3;
       Rstats::VectorType::Enum type = e1->get_type();
       switch (type) {
         case Rstats::VectorType::CHARACTER :
           croak("Error in a - b : non-numeric argument to binary operator");
           break;
         case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_complex(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::abs(e1->get_complex_value(i)));
+            e3->set_complex_value(i, std::pow(e1->get_complex_value(i), e2->get_complex_value(i)));
           }
           break;
         case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
+          e3 = Rstats::Vector::new_double(length);
           for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::abs(e1->get_double_value(i)));
+            e3->set_double_value(i, ::pow(e1->get_double_value(i), e2->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e3 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e3->set_double_value(i, ::pow(e1->get_integer_value(i), e2->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e3->merge_na_positions(e1);
+      e3->merge_na_positions(e2);
+      
+      return e3;
+    }
+
+    Rstats::Vector* sqrt(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX : {
+          e2 = Rstats::Vector::new_complex(length);
+          std::complex<NV> value;
+          for (IV i = 0; i < length; i++) {
+            value = e1->get_complex_value(i);
+            
+            // Fix bug that clang sqrt can't right value of perfect squeres
+            if (value.imag() == 0 && value.real() < 0) {
+              e2->set_complex_value(
+                i,
+                std::complex<NV>(
+                  0,
+                  std::sqrt(-(value.real()))
+                )
+              );
+            }
+            else {
+              e2->set_complex_value(i, std::sqrt(value));
+            }
+          }
+          break;
+        }
+        case Rstats::VectorType::DOUBLE : {
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sqrt(e1->get_double_value(i)));
+          }
+          break;
+        }
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL : {
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sqrt(e1->get_integer_value(i)));
+          }
+          break;
+        }
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* sin(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::sin(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sin(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sin(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+    
+    Rstats::Vector* cos(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::cos(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::cos(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::cos(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* tan(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::tan(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::tan(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::tan(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* sinh(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::sinh(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sinh(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::sinh(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+    
+    Rstats::Vector* cosh(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::cosh(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::cosh(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::cosh(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* tanh(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          NV e1_value_re;
+          for (IV i = 0; i < length; i++) {
+            e1_value_re = e1->get_complex_value(i).real();
+            
+            // For fix FreeBSD bug
+            // FreeBAD return (NaN + NaNi) when real value is negative infinite
+            if (std::isinf(e1_value_re) && e1_value_re < 0) {
+              e2->set_complex_value(i, std::complex<NV>(-1, 0));
+            }
+            else {
+              e2->set_complex_value(i, std::tanh(e1->get_complex_value(i)));
+            }
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::tanh(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::tanh(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* abs(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::abs(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::abs(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+          e2 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, (IV)std::abs((NV)e1->get_integer_value(i)));
+          }
+          break;
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_logical(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, (IV)std::abs((NV)e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* clone(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          e2 = e1->is_interned()
+            ? Rstats::Vector::new_character_interned(length)
+            : Rstats::Vector::new_character(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_character_value(i, e1, i);
+          }
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, e1->get_complex_value(i));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, e1->get_double_value(i));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+          e2 = Rstats::Vector::new_integer(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, e1->get_integer_value(i));
+          }
+          break;
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_logical(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_integer_value(i, e1->get_integer_value(i));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    // Position(1 based) of first element of e2 which equals to each element of e1. NA never matches.
+    Rstats::Vector* match(Rstats::Vector* e1, Rstats::Vector* e2) {
+      
+      if (!e1->is_character() || !e2->is_character()) {
+        croak("Can't match not character vector(Rstats::VectorFunc::match())");
+      }
+      
+      IV length1 = e1->get_length();
+      IV length2 = e2->get_length();
+      Rstats::Vector* e3 = Rstats::Vector::new_double(length1);
+      
+      if (e1->is_interned() && e2->is_interned()) {
+        U32* ids1 = e1->get_character_ids();
+        U32* ids2 = e2->get_character_ids();
+        std::unordered_map<U32, IV> positions;
+        for (IV i = length2 - 1; i >= 0; i--) {
+          if (!e2->exists_na_position(i)) {
+            positions[ids2[i]] = i + 1;
+          }
+        }
+        for (IV i = 0; i < length1; i++) {
+          std::unordered_map<U32, IV>::iterator it = positions.find(ids1[i]);
+          if (e1->exists_na_position(i) || it == positions.end()) {
+            e3->add_na_position(i);
+          }
+          else {
+            e3->set_double_value(i, it->second);
+          }
+        }
+      }
+      else {
+        std::string key;
+        std::unordered_map<std::string, IV> positions;
+        for (IV i = length2 - 1; i >= 0; i--) {
+          if (!e2->exists_na_position(i)) {
+            e2->get_character_key(i, key);
+            positions[key] = i + 1;
+          }
+        }
+        for (IV i = 0; i < length1; i++) {
+          if (e1->exists_na_position(i)) {
+            e3->add_na_position(i);
+            continue;
+          }
+          e1->get_character_key(i, key);
+          std::unordered_map<std::string, IV>::iterator it = positions.find(key);
+          if (it == positions.end()) {
+            e3->add_na_position(i);
+          }
+          else {
+            e3->set_double_value(i, it->second);
+          }
+        }
+      }
+      
+      return e3;
+    }
+    
+    // Convert character vector to the lowest type which can represent all elements
+    // (logical, integer, double, complex, character). Each element is parsed once.
+    Rstats::Vector* type_convert(Rstats::Vector* e1) {
+      
+      if (!e1->is_character()) {
+        croak("Can't convert not character vector(Rstats::VectorFunc::type_convert())");
+      }
+      
+      IV length = e1->get_length();
+      std::vector<Rstats::Util::Scalar> scalars(length);
+      Rstats::VectorType::Enum type = Rstats::VectorType::LOGICAL;
+      for (IV i = 0; i < length; i++) {
+        if (e1->exists_na_position(i)) {
+          scalars[i].na = true;
+          continue;
+        }
+        Rstats::VectorType::Enum value_type = Rstats::Util::parse_scalar(
+          e1->get_character_ptr(i), e1->get_character_length(i), scalars[i]);
+        if (value_type == Rstats::VectorType::CHARACTER) {
+          return Rstats::VectorFunc::clone(e1);
+        }
+        if (value_type > type) {
+          type = value_type;
+        }
+      }
+      
+      Rstats::Vector* e2;
+      switch (type) {
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          break;
+        case Rstats::VectorType::INTEGER :
+          e2 = Rstats::Vector::new_integer(length);
+          break;
+        default :
+          e2 = Rstats::Vector::new_logical(length);
+      }
+      
+      for (IV i = 0; i < length; i++) {
+        Rstats::Util::Scalar& scalar = scalars[i];
+        if (scalar.na) {
+          e2->add_na_position(i);
+          continue;
+        }
+        switch (type) {
+          case Rstats::VectorType::COMPLEX :
+            e2->set_complex_value(i, std::complex<NV>(scalar.re, scalar.im));
+            break;
+          case Rstats::VectorType::DOUBLE :
+            e2->set_double_value(i, scalar.re);
+            break;
+          default :
+            e2->set_integer_value(i, scalar.iv);
+        }
+      }
+      
+      return e2;
+    }
+    
+    // First occurrences of character elements. First NA is kept.
+    Rstats::Vector* unique(Rstats::Vector* e1) {
+      
+      if (!e1->is_character()) {
+        croak("Can't get unique elements of not character vector(Rstats::VectorFunc::unique())");
+      }
+      
+      IV length = e1->get_length();
+      std::vector<IV> positions;
+      bool has_na = false;
+      if (e1->is_interned()) {
+        U32* ids = e1->get_character_ids();
+        std::unordered_set<U32> seen;
+        for (IV i = 0; i < length; i++) {
+          if (e1->exists_na_position(i)) {
+            if (!has_na) {
+              positions.push_back(i);
+              has_na = true;
+            }
+          }
+          else if (seen.insert(ids[i]).second) {
+            positions.push_back(i);
+          }
+        }
+      }
+      else {
+        std::string key;
+        std::unordered_set<std::string> seen;
+        for (IV i = 0; i < length; i++) {
+          if (e1->exists_na_position(i)) {
+            if (!has_na) {
+              positions.push_back(i);
+              has_na = true;
+            }
+          }
+          else {
+            e1->get_character_key(i, key);
+            if (seen.insert(key).second) {
+              positions.push_back(i);
+            }
+          }
+        }
+      }
+      
+      IV unique_length = positions.size();
+      Rstats::Vector* e2 = e1->is_interned()
+        ? Rstats::Vector::new_character_interned(unique_length)
+        : Rstats::Vector::new_character(unique_length);
+      for (IV i = 0; i < unique_length; i++) {
+        if (e1->exists_na_position(positions[i])) {
+          e2->add_na_position(i);
+        }
+        else {
+          e2->set_character_value(i, e1, positions[i]);
+        }
+      }
+      
+      return e2;
+    }
+
+    // Count of characters(code points of UTF-8 string) or bytes
+    Rstats::Vector* nchar(Rstats::Vector* e1, bool bytes) {
+      
+      if (!e1->is_character()) {
+        croak("Can't get nchar of not character vector(Rstats::VectorFunc::nchar())");
+      }
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_double(length);
+      for (IV i = 0; i < length; i++) {
+        STRLEN str_length = e1->get_character_length(i);
+        if (!bytes && e1->is_character_utf8(i)) {
+          str_length = Rstats::Util::count_utf8_chars(e1->get_character_ptr(i), str_length);
+        }
+        e2->set_double_value(i, str_length);
+      }
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+    
+    // toupper and tolower. Non ASCII characters of UTF-8 string use Perl case mapping.
+    Rstats::Vector* case_convert(Rstats::Vector* e1, bool upper) {
+      
+      if (!e1->is_character()) {
+        croak("Can't convert case of not character vector(Rstats::VectorFunc::case_convert())");
+      }
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      std::string ret;
+      for (IV i = 0; i < length; i++) {
+        if (e1->exists_na_position(i)) {
+          continue;
+        }
+        
+        const char* str = e1->get_character_ptr(i);
+        STRLEN str_length = e1->get_character_length(i);
+        bool utf8 = e1->is_character_utf8(i);
+        if (!utf8 || Rstats::Util::is_ascii(str, str_length)) {
+          ret.resize(str_length);
+          if (str_length > 0) {
+            Rstats::Util::ascii_case_convert(str, str_length, &ret[0], upper);
+          }
+        }
+        else {
+          ret.clear();
+          const U8* p = (const U8*)str;
+          const U8* end = p + str_length;
+          U8 buffer[UTF8_MAXBYTES_CASE + 1];
+          STRLEN buffer_length;
+          while (p < end) {
+            if (*p < 0x80) {
+              char c = *p;
+              Rstats::Util::ascii_case_convert(&c, 1, &c, upper);
+              ret += c;
+              p++;
+            }
+            else {
+#ifdef toUPPER_utf8_safe
+              if (upper) {
+                toUPPER_utf8_safe(p, end, buffer, &buffer_length);
+              }
+              else {
+                toLOWER_utf8_safe(p, end, buffer, &buffer_length);
+              }
+#else
+              if (upper) {
+                to_utf8_upper(p, buffer, &buffer_length);
+              }
+              else {
+                to_utf8_lower(p, buffer, &buffer_length);
+              }
+#endif
+              ret.append((char*)buffer, buffer_length);
+              p += UTF8SKIP(p);
+            }
+          }
+        }
+        e2->set_character_value(i, ret.data(), ret.size(), utf8);
+      }
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+    
+    // chartr("a-c", "A-C", x). Ranges are expanded and short new is padded with its last character.
+    Rstats::Vector* chartr(Rstats::Vector* e_old, Rstats::Vector* e_new, Rstats::Vector* e1) {
+      
+      if (!e_old->is_character() || !e_new->is_character() || !e1->is_character()) {
+        croak("Can't translate not character vector(Rstats::VectorFunc::chartr())");
+      }
+      if (e_old->get_length() == 0 || e_new->get_length() == 0) {
+        croak("old and new must have a element(Rstats::VectorFunc::chartr())");
+      }
+      
+      std::vector<UV> old_chars;
+      std::vector<UV> new_chars;
+      Rstats::Vector* specs[2] = {e_old, e_new};
+      std::vector<UV>* chars_list[2] = {&old_chars, &new_chars};
+      for (IV k = 0; k < 2; k++) {
+        const U8* p = (const U8*)specs[k]->get_character_ptr(0);
+        const U8* end = p + specs[k]->get_character_length(0);
+        bool utf8 = specs[k]->is_character_utf8(0);
+        std::vector<UV> chars;
+        while (p < end) {
+          if (utf8 && *p >= 0x80) {
+            STRLEN char_length;
+            chars.push_back(utf8_to_uvchr_buf(p, end, &char_length));
+            p += char_length ? char_length : 1;
+          }
+          else {
+            chars.push_back(*p++);
+          }
+        }
+        for (size_t c = 0; c < chars.size(); c++) {
+          if (c + 2 < chars.size() && chars[c + 1] == '-' && chars[c] <= chars[c + 2]) {
+            for (UV cp = chars[c]; cp <= chars[c + 2]; cp++) {
+              chars_list[k]->push_back(cp);
+            }
+            c += 2;
+          }
+          else {
+            chars_list[k]->push_back(chars[c]);
+          }
+        }
+      }
+      if (new_chars.empty()) {
+        new_chars = old_chars;
+      }
+      while (new_chars.size() < old_chars.size()) {
+        new_chars.push_back(new_chars.back());
+      }
+      
+      // Table of bytes for ASCII only translation, map of code points for others
+      bool ascii_only = true;
+      U8 table[256];
+      for (IV c = 0; c < 256; c++) {
+        table[c] = (U8)c;
+      }
+      std::unordered_map<UV, UV> code_points;
+      for (size_t c = old_chars.size(); c > 0; c--) {
+        UV old_char = old_chars[c - 1];
+        UV new_char = new_chars[c - 1];
+        if (old_char >= 0x80 || new_char >= 0x80) {
+          ascii_only = false;
+        }
+        else {
+          table[old_char] = (U8)new_char;
+        }
+        code_points[old_char] = new_char;
+      }
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      std::string ret;
+      for (IV i = 0; i < length; i++) {
+        if (e1->exists_na_position(i)) {
+          continue;
+        }
+        
+        const U8* p = (const U8*)e1->get_character_ptr(i);
+        STRLEN str_length = e1->get_character_length(i);
+        bool utf8 = e1->is_character_utf8(i);
+        if (ascii_only) {
+          ret.resize(str_length);
+          for (STRLEN k = 0; k < str_length; k++) {
+            ret[k] = (char)table[p[k]];
+          }
+        }
+        else {
+          ret.clear();
+          const U8* end = p + str_length;
+          std::vector<UV> chars;
+          bool ret_utf8 = utf8;
+          while (p < end) {
+            UV cp;
+            if (utf8 && *p >= 0x80) {
+              STRLEN char_length;
+              cp = utf8_to_uvchr_buf(p, end, &char_length);
+              p += char_length ? char_length : 1;
+            }
+            else {
+              cp = *p++;
+            }
+            std::unordered_map<UV, UV>::iterator it = code_points.find(cp);
+            if (it != code_points.end()) {
+              cp = it->second;
+            }
+            if (cp > 0xFF) {
+              ret_utf8 = true;
+            }
+            chars.push_back(cp);
+          }
+          for (size_t k = 0; k < chars.size(); k++) {
+            Rstats::Util::append_code_point(ret, chars[k], ret_utf8);
+          }
+          utf8 = ret_utf8;
+        }
+        e2->set_character_value(i, ret.data(), ret.size(), utf8);
+      }
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+    
+    // substr(x, start, stop) with 1 based positions in characters or bytes. start and stop are recycled.
+    Rstats::Vector* substr(Rstats::Vector* e1, Rstats::Vector* e_start, Rstats::Vector* e_stop, bool bytes) {
+      
+      if (!e1->is_character()) {
+        croak("Can't get substring of not character vector(Rstats::VectorFunc::substr())");
+      }
+      if (!e_start->is_integer() || !e_stop->is_integer()) {
+        croak("start and stop must be integer vectors(Rstats::VectorFunc::substr())");
+      }
+      
+      IV length = e1->get_length();
+      IV start_length = e_start->get_length();
+      IV stop_length = e_stop->get_length();
+      if (length > 0 && (start_length == 0 || stop_length == 0)) {
+        croak("invalid substring arguments(Rstats::VectorFunc::substr())");
+      }
+      
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      for (IV i = 0; i < length; i++) {
+        IV start_pos = i % start_length;
+        IV stop_pos = i % stop_length;
+        if (e1->exists_na_position(i) || e_start->exists_na_position(start_pos) || e_stop->exists_na_position(stop_pos)) {
+          e2->add_na_position(i);
+          continue;
+        }
+        
+        const char* str = e1->get_character_ptr(i);
+        STRLEN str_length = e1->get_character_length(i);
+        bool utf8 = e1->is_character_utf8(i);
+        bool by_char = !bytes && utf8;
+        STRLEN char_length = by_char ? Rstats::Util::count_utf8_chars(str, str_length) : str_length;
+        
+        IV start = e_start->get_integer_value(start_pos);
+        IV stop = e_stop->get_integer_value(stop_pos);
+        if (start < 1) {
+          start = 1;
+        }
+        if (stop > (IV)char_length) {
+          stop = char_length;
+        }
+        if (start > stop) {
+          e2->set_character_value(i, "", 0, utf8);
+          continue;
+        }
+        
+        STRLEN begin = start - 1;
+        STRLEN end = stop;
+        if (by_char) {
+          begin = Rstats::Util::utf8_char_offset(str, str_length, begin);
+          end = Rstats::Util::utf8_char_offset(str, str_length, end);
+        }
+        else if (utf8) {
+          // Bytes which split a character are not UTF-8 string
+          bool begin_boundary = begin == str_length || ((U8)str[begin] & 0xC0) != 0x80;
+          bool end_boundary = end == str_length || ((U8)str[end] & 0xC0) != 0x80;
+          utf8 = begin_boundary && end_boundary;
+        }
+        e2->set_character_value(i, str + begin, end - begin, utf8);
+      }
+      
+      return e2;
+    }
+
+    // Byte offsets of first match of each element. start is -1 if element doesn't match.
+    void find_first_matches(Rstats::Vector* e_pattern, Rstats::Vector* e1, bool ignore_case, bool fixed,
+      std::vector<IV>& starts, std::vector<IV>& ends)
+    {
+      if (!e1->is_character()) {
+        croak("Can't match not character vector(Rstats::VectorFunc::find_first_matches())");
+      }
+      
+      Rstats::Matcher matcher(e_pattern, ignore_case, fixed);
+      IV length = e1->get_length();
+      starts.assign(length, -1);
+      ends.assign(length, -1);
+      
+      // Literal search is done in worker threads
+      if (fixed) {
+        std::vector<StringView> views;
+        Rstats::Matcher::get_string_views(e1, views);
+        const std::string& pattern = matcher.get_pattern();
+        bool pattern_utf8 = matcher.is_pattern_utf8();
+        Rstats::ThreadPool::parallel_for(length, [&](IV begin, IV end) {
+          std::string buffer;
+          for (IV i = begin; i < end; i++) {
+            STRLEN match_start;
+            STRLEN match_end;
+            if (!views[i].na && Rstats::Matcher::find_fixed(views[i], pattern, pattern_utf8, buffer, &match_start, &match_end)) {
+              starts[i] = match_start;
+              ends[i] = match_end;
+            }
+          }
+        });
+      }
+      else {
+        for (IV i = 0; i < length; i++) {
+          if (e1->exists_na_position(i)) {
+            continue;
+          }
+          
+          matcher.set_string(e1->get_character_ptr(i), e1->get_character_length(i), e1->is_character_utf8(i));
+          STRLEN match_start;
+          STRLEN match_end;
+          if (matcher.find(0, &match_start, &match_end)) {
+            // Offsets of original string when Latin-1 string is upgraded
+            if (matcher.is_utf8() && !e1->is_character_utf8(i)) {
+              match_start = Rstats::Util::count_utf8_chars(matcher.get_str(), match_start);
+              match_end = Rstats::Util::count_utf8_chars(matcher.get_str(), match_end);
+            }
+            starts[i] = match_start;
+            ends[i] = match_end;
+          }
+        }
+      }
+    }
+    
+    // TRUE if element matches pattern. NA is FALSE.
+    Rstats::Vector* grepl(Rstats::Vector* e_pattern, Rstats::Vector* e1, bool ignore_case, bool fixed) {
+      
+      std::vector<IV> starts;
+      std::vector<IV> ends;
+      Rstats::VectorFunc::find_first_matches(e_pattern, e1, ignore_case, fixed, starts, ends);
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_logical(length);
+      IV* values = e2->get_integer_values();
+      for (IV i = 0; i < length; i++) {
+        values[i] = starts[i] >= 0;
+      }
+      
+      return e2;
+    }
+    
+    // Positions(1 based) of elements which match pattern
+    Rstats::Vector* grep(Rstats::Vector* e_pattern, Rstats::Vector* e1, bool ignore_case, bool fixed) {
+      
+      std::vector<IV> starts;
+      std::vector<IV> ends;
+      Rstats::VectorFunc::find_first_matches(e_pattern, e1, ignore_case, fixed, starts, ends);
+      
+      IV length = e1->get_length();
+      std::vector<IV> positions;
+      for (IV i = 0; i < length; i++) {
+        if (starts[i] >= 0) {
+          positions.push_back(i + 1);
+        }
+      }
+      
+      Rstats::Vector* e2 = Rstats::Vector::new_double(positions.size());
+      for (size_t i = 0; i < positions.size(); i++) {
+        e2->set_double_value(i, positions[i]);
+      }
+      
+      return e2;
+    }
+    
+    // Character position(1 based) of first match and length of the match. -1 if element doesn't match.
+    Rstats::Vector* regexpr(Rstats::Vector* e_pattern, Rstats::Vector* e1, bool ignore_case, bool fixed, Rstats::Vector** e_match_length) {
+      
+      std::vector<IV> starts;
+      std::vector<IV> ends;
+      Rstats::VectorFunc::find_first_matches(e_pattern, e1, ignore_case, fixed, starts, ends);
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_integer(length);
+      *e_match_length = Rstats::Vector::new_integer(length);
+      for (IV i = 0; i < length; i++) {
+        if (e1->exists_na_position(i)) {
+          e2->add_na_position(i);
+          (*e_match_length)->add_na_position(i);
+        }
+        else if (starts[i] < 0) {
+          e2->set_integer_value(i, -1);
+          (*e_match_length)->set_integer_value(i, -1);
+        }
+        else {
+          IV start = starts[i];
+          IV end = ends[i];
+          if (e1->is_character_utf8(i)) {
+            const char* str = e1->get_character_ptr(i);
+            start = Rstats::Util::count_utf8_chars(str, start);
+            end = start + Rstats::Util::count_utf8_chars(str + starts[i], ends[i] - starts[i]);
+          }
+          e2->set_integer_value(i, start + 1);
+          (*e_match_length)->set_integer_value(i, end - start);
+        }
+      }
+      
+      return e2;
+    }
+    
+    // sub and gsub. "\\1" to "\\9" in replacement are capture groups of regex, "\\0" is the whole match
+    // and "\\\\" is a backslash.
+    Rstats::Vector* sub(Rstats::Vector* e_pattern, Rstats::Vector* e_replacement, Rstats::Vector* e1, bool ignore_case, bool fixed, bool global) {
+      
+      if (!e1->is_character()) {
+        croak("Can't replace not character vector(Rstats::VectorFunc::sub())");
+      }
+      if (!e_replacement->is_character() || e_replacement->get_length() < 1) {
+        croak("replacement must be a character string(Rstats::VectorFunc::sub())");
+      }
+      
+      Rstats::Matcher matcher(e_pattern, ignore_case, fixed);
+      
+      // Literal parts and capture group numbers(-1 is literal)
+      std::string replacement;
+      e_replacement->get_character_key(0, replacement);
+      bool replacement_utf8 = !Rstats::Util::is_ascii(replacement.data(), replacement.size());
+      std::vector<std::string> literals;
+      std::vector<IV> groups;
+      std::string literal;
+      for (STRLEN k = 0; k < replacement.size(); k++) {
+        if (!fixed && replacement[k] == '\\' && k + 1 < replacement.size() && replacement[k + 1] >= '0' && replacement[k + 1] <= '9') {
+          literals.push_back(literal);
+          groups.push_back(-1);
+          literals.push_back(std::string());
+          groups.push_back(replacement[k + 1] - '0');
+          literal.clear();
+          k++;
+        }
+        else if (!fixed && replacement[k] == '\\' && k + 1 < replacement.size() && replacement[k + 1] == '\\') {
+          literal += '\\';
+          k++;
+        }
+        else {
+          literal += replacement[k];
+        }
+      }
+      literals.push_back(literal);
+      groups.push_back(-1);
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      std::string ret;
+      std::string upgraded;
+      for (IV i = 0; i < length; i++) {
+        if (e1->exists_na_position(i)) {
+          continue;
+        }
+        
+        const char* original = e1->get_character_ptr(i);
+        STRLEN original_length = e1->get_character_length(i);
+        bool original_utf8 = e1->is_character_utf8(i);
+        
+        // UTF-8 replacement needs UTF-8 subject
+        if (replacement_utf8 && !original_utf8 && !Rstats::Util::is_ascii(original, original_length)) {
+          Rstats::Util::latin1_to_utf8(original, original_length, upgraded);
+          original = upgraded.data();
+          original_length = upgraded.size();
+          original_utf8 = true;
+        }
+        matcher.set_string(original, original_length, original_utf8);
+        
+        const char* str = matcher.get_str();
+        STRLEN str_length = matcher.get_length();
+        bool utf8 = matcher.is_utf8() || replacement_utf8;
+        
+        ret.clear();
+        STRLEN pos = 0;
+        STRLEN search_pos = 0;
+        STRLEN match_start;
+        STRLEN match_end;
+        while (matcher.find(search_pos, &match_start, &match_end)) {
+          ret.append(str + pos, match_start - pos);
+          for (size_t k = 0; k < literals.size(); k++) {
+            if (groups[k] < 0) {
+              ret += literals[k];
+            }
+            else {
+              STRLEN capture_start;
+              STRLEN capture_end;
+              if (matcher.get_capture(groups[k], &capture_start, &capture_end)) {
+                ret.append(str + capture_start, capture_end - capture_start);
+              }
+            }
+          }
+          pos = match_end;
+          search_pos = match_end;
+          
+          // Empty match copies one character
+          if (match_start == match_end) {
+            if (match_end >= str_length) {
+              break;
+            }
+            STRLEN skip = matcher.is_utf8() ? UTF8SKIP(str + match_end) : 1;
+            ret.append(str + match_end, skip);
+            pos = match_end + skip;
+            search_pos = pos;
+          }
+          
+          if (!global) {
+            break;
+          }
+        }
+        if (pos < str_length) {
+          ret.append(str + pos, str_length - pos);
+        }
+        
+        e2->set_character_value(i, ret.data(), ret.size(), utf8);
+      }
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    // paste(..., sep, collapse). Arguments are character vectors and recycled. NA is "NA".
+    // Output size is computed first and elements are written into one buffer.
+    Rstats::Vector* paste(std::vector<Rstats::Vector*>& elements_list, SV* sv_sep, SV* sv_collapse) {
+      
+      IV count = elements_list.size();
+      IV length = 0;
+      bool utf8 = SvUTF8(sv_sep);
+      for (IV k = 0; k < count; k++) {
+        Rstats::Vector* elements = elements_list[k];
+        if (!elements->is_character()) {
+          croak("Can't paste not character vector(Rstats::VectorFunc::paste())");
+        }
+        IV elements_length = elements->get_length();
+        if (elements_length > length) {
+          length = elements_length;
+        }
+        for (IV i = 0; i < elements_length && !utf8; i++) {
+          utf8 = elements->is_character_utf8(i);
+        }
+      }
+      
+      STRLEN sep_length;
+      const char* sep = SvPV(sv_sep, sep_length);
+      bool convert_sep = utf8 && !SvUTF8(sv_sep);
+      STRLEN converted_sep_length = Rstats::Util::get_converted_length(sep, sep_length, convert_sep);
+      
+      // Byte length of each output element
+      std::vector<STRLEN> sizes(length, count > 0 ? converted_sep_length * (count - 1) : 0);
+      STRLEN total_size = 0;
+      for (IV k = 0; k < count; k++) {
+        Rstats::Vector* elements = elements_list[k];
+        IV elements_length = elements->get_length();
+        if (elements_length == 0) {
+          continue;
+        }
+        for (IV i = 0; i < length; i++) {
+          IV pos = i % elements_length;
+          if (elements->exists_na_position(pos)) {
+            sizes[i] += 2;
+          }
+          else {
+            sizes[i] += Rstats::Util::get_converted_length(
+              elements->get_character_ptr(pos),
+              elements->get_character_length(pos),
+              utf8 && !elements->is_character_utf8(pos)
+            );
+          }
+        }
+      }
+      for (IV i = 0; i < length; i++) {
+        total_size += sizes[i];
+      }
+      
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      e2->reserve_strings(total_size);
+      for (IV i = 0; i < length; i++) {
+        char* out = e2->alloc_character_value(i, sizes[i], utf8);
+        for (IV k = 0; k < count; k++) {
+          if (k > 0) {
+            out = Rstats::Util::write_converted(out, sep, sep_length, convert_sep);
+          }
+          Rstats::Vector* elements = elements_list[k];
+          IV elements_length = elements->get_length();
+          if (elements_length == 0) {
+            continue;
+          }
+          IV pos = i % elements_length;
+          if (elements->exists_na_position(pos)) {
+            memcpy(out, "NA", 2);
+            out += 2;
+          }
+          else {
+            out = Rstats::Util::write_converted(
+              out,
+              elements->get_character_ptr(pos),
+              elements->get_character_length(pos),
+              utf8 && !elements->is_character_utf8(pos)
+            );
+          }
+        }
+      }
+      
+      if (sv_collapse == NULL || !SvOK(sv_collapse)) {
+        return e2;
+      }
+      
+      // Collapse to one element
+      STRLEN collapse_length;
+      const char* collapse = SvPV(sv_collapse, collapse_length);
+      bool collapse_utf8 = utf8 || SvUTF8(sv_collapse);
+      bool convert_collapse = collapse_utf8 && !SvUTF8(sv_collapse);
+      bool convert_elements = collapse_utf8 && !utf8;
+      STRLEN converted_collapse_length = Rstats::Util::get_converted_length(collapse, collapse_length, convert_collapse);
+      STRLEN collapsed_size = length > 0 ? converted_collapse_length * (length - 1) : 0;
+      for (IV i = 0; i < length; i++) {
+        collapsed_size += Rstats::Util::get_converted_length(e2->get_character_ptr(i), sizes[i], convert_elements);
+      }
+      
+      Rstats::Vector* e3 = Rstats::Vector::new_character(1);
+      char* out = e3->alloc_character_value(0, collapsed_size, collapse_utf8);
+      for (IV i = 0; i < length; i++) {
+        if (i > 0) {
+          out = Rstats::Util::write_converted(out, collapse, collapse_length, convert_collapse);
+        }
+        out = Rstats::Util::write_converted(out, e2->get_character_ptr(i), sizes[i], convert_elements);
+      }
+      delete e2;
+      
+      return e3;
+    }
+    
+    // sprintf(fmt, ...). Conversions are %d %i %o %x %X %f %e %E %g %G %s %%. Arguments are recycled.
+    Rstats::Vector* sprintf(Rstats::Vector* e_fmt, std::vector<Rstats::Vector*>& elements_list) {
+      
+      if (!e_fmt->is_character()) {
+        croak("fmt must be character vector(Rstats::VectorFunc::sprintf())");
+      }
+      
+      IV count = elements_list.size();
+      IV length = e_fmt->get_length();
+      for (IV k = 0; k < count; k++) {
+        IV elements_length = elements_list[k]->get_length();
+        if (elements_length == 0) {
+          return Rstats::Vector::new_character(0);
+        }
+        if (elements_length > length) {
+          length = elements_length;
+        }
+      }
+      if (e_fmt->get_length() == 0) {
+        return Rstats::Vector::new_character(0);
+      }
+      
+      // Character arguments of %s
+      std::vector<Rstats::Vector*> character_list(count, (Rstats::Vector*)NULL);
+      
+      Rstats::Vector* e2 = Rstats::Vector::new_character(length);
+      std::string ret;
+      std::string spec;
+      std::string piece;
+      char buffer[512];
+      for (IV i = 0; i < length; i++) {
+        IV fmt_pos = i % e_fmt->get_length();
+        if (e_fmt->exists_na_position(fmt_pos)) {
+          e2->add_na_position(i);
+          continue;
+        }
+        
+        const char* fmt = e_fmt->get_character_ptr(fmt_pos);
+        STRLEN fmt_length = e_fmt->get_character_length(fmt_pos);
+        bool fmt_utf8 = e_fmt->is_character_utf8(fmt_pos);
+        
+        ret.clear();
+        bool utf8 = fmt_utf8;
+        IV arg_index = 0;
+        for (STRLEN p = 0; p < fmt_length; p++) {
+          if (fmt[p] != '%') {
+            ret += fmt[p];
+            continue;
+          }
+          if (p + 1 < fmt_length && fmt[p + 1] == '%') {
+            ret += '%';
+            p++;
+            continue;
+          }
+          
+          // %[flags][width][.precision]conversion
+          STRLEN spec_start = p;
+          p++;
+          while (p < fmt_length && strchr("-+ #0", fmt[p])) {
+            p++;
+          }
+          while (p < fmt_length && isDIGIT(fmt[p])) {
+            p++;
+          }
+          if (p < fmt_length && fmt[p] == '.') {
+            p++;
+            while (p < fmt_length && isDIGIT(fmt[p])) {
+              p++;
+            }
+          }
+          if (p >= fmt_length || !strchr("dioxXfeEgGs", fmt[p])) {
+            croak("unrecognised format specification '%s'(Rstats::VectorFunc::sprintf())", std::string(fmt + spec_start, fmt_length - spec_start).c_str());
+          }
+          char conversion = fmt[p];
+          std::string flags(fmt + spec_start, p - spec_start);
+          
+          if (arg_index >= count) {
+            croak("too few arguments(Rstats::VectorFunc::sprintf())");
+          }
+          Rstats::Vector* elements = elements_list[arg_index];
+          IV pos = i % elements->get_length();
+          
+          // NA and not finite numbers are formatted as string
+          const char* special = NULL;
+          if (elements->exists_na_position(pos)) {
+            special = "NA";
+          }
+          else if (elements->is_double() && conversion != 's') {
+            NV value = elements->get_double_value(pos);
+            if (std::isnan(value)) {
+              special = "NaN";
+            }
+            else if (std::isinf(value)) {
+              special = value > 0 ? "Inf" : "-Inf";
+            }
+          }
+          
+          if (special != NULL) {
+            spec = flags + "s";
+            snprintf(buffer, sizeof(buffer), spec.c_str(), special);
+            ret += buffer;
+          }
+          else if (conversion == 's') {
+            if (!elements->is_character()) {
+              if (character_list[arg_index] == NULL) {
+                character_list[arg_index] = elements->as_character();
+              }
+              elements = character_list[arg_index];
+            }
+            piece.assign(elements->get_character_ptr(pos), elements->get_character_length(pos));
+            bool piece_utf8 = elements->is_character_utf8(pos);
+            if (piece_utf8 && !utf8) {
+              std::string upgraded;
+              Rstats::Util::latin1_to_utf8(ret.data(), ret.size(), upgraded);
+              ret = upgraded;
+              utf8 = true;
+            }
+            else if (!piece_utf8 && utf8) {
+              std::string upgraded;
+              Rstats::Util::latin1_to_utf8(piece.data(), piece.size(), upgraded);
+              piece = upgraded;
+            }
+            if (flags == "%") {
+              ret += piece;
+            }
+            else {
+              spec = flags + "s";
+              IV size = snprintf(NULL, 0, spec.c_str(), piece.c_str());
+              std::vector<char> formatted(size + 1);
+              snprintf(&formatted[0], size + 1, spec.c_str(), piece.c_str());
+              ret.append(&formatted[0], size);
+            }
+          }
+          else if (conversion == 'd' || conversion == 'i' || conversion == 'o' || conversion == 'x' || conversion == 'X') {
+            long long value;
+            if (elements->is_integer() || elements->is_logical()) {
+              value = elements->get_integer_value(pos);
+            }
+            else if (elements->is_double() && elements->get_double_value(pos) == (NV)(long long)elements->get_double_value(pos)) {
+              value = (long long)elements->get_double_value(pos);
+            }
+            else {
+              croak("invalid format '%s'; use format %%f, %%e, %%g or %%s for this object(Rstats::VectorFunc::sprintf())", (flags + conversion).c_str());
+            }
+            spec = flags + "ll" + conversion;
+            snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+            ret += buffer;
+          }
+          else {
+            NV value;
+            if (elements->is_double()) {
+              value = elements->get_double_value(pos);
+            }
+            else if (elements->is_integer() || elements->is_logical()) {
+              value = elements->get_integer_value(pos);
+            }
+            else {
+              croak("invalid format '%s'; use format %%s for this object(Rstats::VectorFunc::sprintf())", (flags + conversion).c_str());
+            }
+            spec = flags + conversion;
+            IV size = snprintf(buffer, sizeof(buffer), spec.c_str(), (double)value);
+            if (size >= (IV)sizeof(buffer)) {
+              std::vector<char> formatted(size + 1);
+              snprintf(&formatted[0], size + 1, spec.c_str(), (double)value);
+              ret.append(&formatted[0], size);
+            }
+            else {
+              ret += buffer;
+            }
+          }
+          arg_index++;
+        }
+        
+        e2->set_character_value(i, ret.data(), ret.size(), utf8);
+      }
+      
+      for (IV k = 0; k < count; k++) {
+        if (character_list[k] != NULL) {
+          delete character_list[k];
+        }
+      }
+      
+      return e2;
+    }
+        
+    Rstats::Vector* log(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::log(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::log(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::log(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* logb(Rstats::Vector* e1) {
+      return log(e1);
+    }
+    
+    Rstats::Vector* log10(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::log10(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::log10(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::log10(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* log2(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = divide(log(e1), log(Rstats::Vector::new_complex(length, std::complex<NV>(2, 0))));
+          break;
+        case Rstats::VectorType::DOUBLE :
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = divide(log(e1), log(Rstats::Vector::new_double(length, 2)));
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* exp(Rstats::Vector* e1) {
+      
+      IV length = e1->get_length();
+      Rstats::Vector* e2;
+      Rstats::VectorType::Enum type = e1->get_type();
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          croak("Error in a - b : non-numeric argument to binary operator");
+          break;
+        case Rstats::VectorType::COMPLEX :
+          e2 = Rstats::Vector::new_complex(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_complex_value(i, std::exp(e1->get_complex_value(i)));
+          }
+          break;
+        case Rstats::VectorType::DOUBLE :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::exp(e1->get_double_value(i)));
+          }
+          break;
+        case Rstats::VectorType::INTEGER :
+        case Rstats::VectorType::LOGICAL :
+          e2 = Rstats::Vector::new_double(length);
+          for (IV i = 0; i < length; i++) {
+            e2->set_double_value(i, std::exp(e1->get_integer_value(i)));
+          }
+          break;
+        default:
+          croak("Invalid type");
+
+      }
+      
+      e2->merge_na_positions(e1);
+      
+      return e2;
+    }
+
+    Rstats::Vector* is_infinite(Rstats::Vector* elements) {
+      
+      IV length = elements->get_length();
+      Rstats::Vector* rets;
+      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
+        rets = Rstats::Vector::new_logical(length);
+        NV* values = elements->get_double_values();
+        IV* rets_values = rets->get_integer_values();
+        for (IV i = 0; i < length; i++) {
+          if(std::isinf(values[i])) {
+            rets_values[i] = 1;
+          }
+          else {
+            rets_values[i] = 0;
+          }
+        }
+      }
+      else {
+        rets = Rstats::Vector::new_logical(length, 0);
+      }
+      
+      return rets;
+    }
+
+    Rstats::Vector* is_positive_infinite(Rstats::Vector* elements) {
+      
+      IV length = elements->get_length();
+      Rstats::Vector* rets;
+      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
+        rets = Rstats::Vector::new_logical(length);
+        NV* values = elements->get_double_values();
+        IV* rets_values = rets->get_integer_values();
+        for (IV i = 0; i < length; i++) {
+          if(std::isinf(values[i]) && values[i] > 0) {
+            rets_values[i] = 1;
+          }
+          else {
+            rets_values[i] = 0;
+          }
+        }
+      }
+      else {
+        rets = Rstats::Vector::new_logical(length, 0);
+      }
+      
+      return rets;
+    }
+
+    Rstats::Vector* is_negative_infinite(Rstats::Vector* elements) {
+      
+      IV length = elements->get_length();
+      Rstats::Vector* rets;
+      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
+        rets = Rstats::Vector::new_logical(length);
+        NV* values = elements->get_double_values();
+        IV* rets_values = rets->get_integer_values();
+        for (IV i = 0; i < length; i++) {
+          if(std::isinf(values[i]) && values[i] < 0) {
+            rets_values[i] = 1;
+          }
+          else {
+            rets_values[i] = 0;
+          }
+        }
+      }
+      else {
+        rets = Rstats::Vector::new_logical(length, 0);
+      }
+      
+      return rets;
+    }
+    
+    Rstats::Vector* is_nan(Rstats::Vector* elements) {
+      IV length = elements->get_length();
+      Rstats::Vector* rets = Rstats::Vector::new_logical(length);
+      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
+        NV* values = elements->get_double_values();
+        IV* rets_values = rets->get_integer_values();
+        for (IV i = 0; i < length; i++) {
+          if(std::isnan(values[i])) {
+            rets_values[i] = 1;
+          }
+          else {
+            rets_values[i] = 0;
+          }
+        }
+      }
+      else {
+        rets = Rstats::Vector::new_logical(length, 0);
+      }
+      
+      return rets;
+    }
+
+    Rstats::Vector* is_finite(Rstats::Vector* elements) {
+      
+      IV length = elements->get_length();
+      Rstats::Vector* rets;
+      if (elements->is_integer()) {
+        rets = Rstats::Vector::new_logical(length, 1);
+      }
+      else if (elements->is_double()) {
+        NV* values = elements->get_double_values();
+        rets = Rstats::Vector::new_logical(length);
+        IV* rets_values = rets->get_integer_values();
+        for (IV i = 0; i < length; i++) {
+          if (std::isfinite(values[i])) {
+            rets_values[i] = 1;
+          }
+          else {
+            rets_values[i] = 0;
+          }
+        }
+      }
+      else {
+        rets = Rstats::Vector::new_logical(length, 0);
+      }
+      
+      return rets;
+    }
+    
+    // 0-based rows selected by a logical, positive or negative index of a data frame. -1 is an out of range row,
+    // which is NA in every column. NA of a logical index doesn't select the row.
+    Rstats::Vector* row_positions(Rstats::Vector* index, IV row_count) {
+      IV length = index->get_length();
+      const std::map<IV, IV>& na_positions = index->get_na_positions();
+      std::vector<IV> positions;
+      switch (index->get_type()) {
+        case Rstats::VectorType::LOGICAL : {
+          IV* values = index->get_integer_values();
+          for (IV i = 0; i < length; i++) {
+            if (values[i] && !na_positions.count(i)) {
+              positions.push_back(i < row_count ? i : -1);
+            }
+          }
+          break;
+        }
+        case Rstats::VectorType::DOUBLE :
+        case Rstats::VectorType::INTEGER : {
+          std::vector<IV> rows(length);
+          IV minus_count = 0;
+          for (IV i = 0; i < length; i++) {
+            rows[i] = index->is_double() ? (IV)index->get_double_value(i) : index->get_integer_value(i);
+            if (rows[i] == 0 || na_positions.count(i)) {
+              croak("0 is invalid index(Rstats::VectorFunc::row_positions())");
+            }
+            if (rows[i] < 0) {
+              minus_count++;
+            }
+          }
+          if (minus_count > 0 && minus_count != length) {
+            croak("Can't min minus sign and plus sign(Rstats::VectorFunc::row_positions())");
+          }
+          if (minus_count > 0) {
+            std::vector<bool> excluded(row_count, false);
+            for (IV i = 0; i < length; i++) {
+              if (-rows[i] <= row_count) {
+                excluded[-rows[i] - 1] = true;
+              }
+            }
+            for (IV row = 0; row < row_count; row++) {
+              if (!excluded[row]) {
+                positions.push_back(row);
+              }
+            }
+          }
+          else {
+            for (IV i = 0; i < length; i++) {
+              positions.push_back(rows[i] <= row_count ? rows[i] - 1 : -1);
+            }
+          }
+          break;
+        }
+        default:
+          croak("Invalid row index(Rstats::VectorFunc::row_positions())");
+      }
+      
+      Rstats::Vector* e2 = Rstats::Vector::new_integer(positions.size());
+      if (!positions.empty()) {
+        memcpy(e2->get_integer_values(), positions.data(), positions.size() * sizeof(IV));
+      }
+      
+      return e2;
+    }
+    
+    template <class T>
+    void gather_values(Rstats::Vector* e1, const T* e1_values, Rstats::Vector* e2, T* e2_values, const IV* positions, IV length) {
+      bool has_na = !e1->get_na_positions().empty();
+      for (IV i = 0; i < length; i++) {
+        IV pos = positions[i];
+        if (pos < 0) {
+          e2->add_na_position(i);
+        }
+        else {
+          e2_values[i] = e1_values[pos];
+          if (has_na && e1->exists_na_position(pos)) {
+            e2->add_na_position(i);
+          }
+        }
+      }
+    }
+    
+    // Rows of columns at the positions(Rstats::VectorFunc::row_positions). Numeric columns are gathered
+    // in parallel, and character columns in this thread because strings are appended to the result one by one.
+    void gather_columns(std::vector<Rstats::Vector*>& columns, Rstats::Vector* positions, std::vector<Rstats::Vector*>& results) {
+      IV column_count = columns.size();
+      IV length = positions->get_length();
+      const IV* position_values = positions->get_integer_values();
+      
+      results.resize(column_count);
+      for (IV k = 0; k < column_count; k++) {
+        Rstats::Vector* column = columns[k];
+        switch (column->get_type()) {
+          case Rstats::VectorType::CHARACTER :
+            results[k] = column->is_interned() ? Rstats::Vector::new_character_interned(length) : Rstats::Vector::new_character(length);
+            break;
+          case Rstats::VectorType::COMPLEX :
+            results[k] = Rstats::Vector::new_complex(length);
+            break;
+          case Rstats::VectorType::DOUBLE :
+            results[k] = Rstats::Vector::new_double(length);
+            break;
+          case Rstats::VectorType::INTEGER :
+            results[k] = Rstats::Vector::new_integer(length);
+            break;
+          case Rstats::VectorType::LOGICAL :
+            results[k] = Rstats::Vector::new_logical(length);
+            break;
+          default:
+            croak("Invalid type");
+        }
+      }
+      
+      IV min_columns = length >= RSTATS_PARALLEL_MIN_LENGTH ? 2 : column_count + 1;
+      Rstats::ThreadPool::parallel_for(column_count, [&](IV begin, IV end) {
+        for (IV k = begin; k < end; k++) {
+          Rstats::Vector* column = columns[k];
+          Rstats::Vector* result = results[k];
+          switch (column->get_type()) {
+            case Rstats::VectorType::COMPLEX :
+              gather_values(column, column->get_complex_values(), result, result->get_complex_values(), position_values, length);
+              break;
+            case Rstats::VectorType::DOUBLE :
+              gather_values(column, column->get_double_values(), result, result->get_double_values(), position_values, length);
+              break;
+            case Rstats::VectorType::INTEGER :
+            case Rstats::VectorType::LOGICAL :
+              gather_values(column, column->get_integer_values(), result, result->get_integer_values(), position_values, length);
+              break;
+            default:
+              break;
+          }
+        }
+      }, min_columns);
+      
+      for (IV k = 0; k < column_count; k++) {
+        Rstats::Vector* column = columns[k];
+        if (column->get_type() != Rstats::VectorType::CHARACTER) {
+          continue;
+        }
+        Rstats::Vector* result = results[k];
+        bool has_na = !column->get_na_positions().empty();
+        for (IV i = 0; i < length; i++) {
+          IV pos = position_values[i];
+          if (pos < 0) {
+            result->add_na_position(i);
+          }
+          else {
+            result->set_character_value(i, column, pos);
+            if (has_na && column->exists_na_position(pos)) {
+              result->add_na_position(i);
+            }
+          }
+        }
+      }
+    }
+    
+    // Rows which have no NA(or NaN) in the columns
+    Rstats::Vector* complete_rows(std::vector<Rstats::Vector*>& columns, IV row_count) {
+      Rstats::Vector* e2 = Rstats::Vector::new_logical(row_count, 1);
+      IV* e2_values = e2->get_integer_values();
+      for (size_t k = 0; k < columns.size(); k++) {
+        Rstats::Vector* column = columns[k];
+        const std::map<IV, IV>& na_positions = column->get_na_positions();
+        for (std::map<IV, IV>::const_iterator it = na_positions.begin(); it != na_positions.end(); ++it) {
+          if (it->first < row_count) {
+            e2_values[it->first] = 0;
+          }
+        }
+        if (column->get_type() == Rstats::VectorType::DOUBLE) {
+          NV* values = column->get_double_values();
+          IV length = column->get_length() < row_count ? column->get_length() : row_count;
+          for (IV i = 0; i < length; i++) {
+            if (std::isnan(values[i])) {
+              e2_values[i] = 0;
+            }
+          }
+        }
+      }
+      
+      return e2;
+    }
+  }
+  
+  // Rstats::Decompressor - decompress gzip(or zstd) file in a background thread.
+  // Blocks are queued, so decompression runs ahead of the parser. No Perl API is called in the thread.
+  class Decompressor {
+    public:
+    
+    enum Format { NONE, GZIP, ZSTD };
+    
+    // Format from the magic number of the file head
+    static Format detect_format (const unsigned char* head, STRLEN length) {
+      if (length >= 2 && head[0] == 0x1f && head[1] == 0x8b) {
+        return GZIP;
+      }
+      else if (length >= 4 && head[0] == 0x28 && head[1] == 0xb5 && head[2] == 0x2f && head[3] == 0xfd) {
+        return ZSTD;
+      }
+      return NONE;
+    }
+    
+    private:
+    
+    int fd;
+    Format format;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable block_ready;
+    std::condition_variable block_taken;
+    std::deque<std::string> blocks;
+    bool finished;
+    bool stopped;
+    std::string error;
+    
+    // Queue a block. Wait while the queue is full. Return false if the reader is destroyed.
+    bool push_block (std::string& block) {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (!this->stopped && this->blocks.size() >= RSTATS_DECOMPRESS_QUEUE_SIZE) {
+          this->block_taken.wait(lock);
+        }
+        if (this->stopped) {
+          return false;
+        }
+        this->blocks.push_back(std::string());
+        this->blocks.back().swap(block);
+      }
+      this->block_ready.notify_one();
+      block.reserve(RSTATS_DECOMPRESS_BLOCK_SIZE);
+      
+      return true;
+    }
+    
+#ifdef RSTATS_HAVE_ZLIB
+    // Concatenated gzip members are decompressed in order
+    void inflate_gzip (std::string& error) {
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        error = "can't initialize zlib";
+        return;
+      }
+      
+      std::vector<unsigned char> input(RSTATS_DECOMPRESS_BLOCK_SIZE);
+      std::string block(RSTATS_DECOMPRESS_BLOCK_SIZE, '\0');
+      STRLEN block_length = 0;
+      bool stream_end = false;
+      while (true) {
+        if (stream.avail_in == 0) {
+          ssize_t size = ::read(this->fd, input.data(), input.size());
+          if (size < 0) {
+            error = std::string("can't read compressed file: ") + strerror(errno);
+            break;
+          }
+          if (size == 0) {
+            if (!stream_end) {
+              error = "unexpected end of compressed file";
+            }
+            break;
+          }
+          stream.next_in = input.data();
+          stream.avail_in = size;
+        }
+        if (stream_end) {
+          inflateReset(&stream);
+          stream_end = false;
+        }
+        
+        stream.next_out = (Bytef*)&block[block_length];
+        stream.avail_out = block.size() - block_length;
+        int status = inflate(&stream, Z_NO_FLUSH);
+        block_length = block.size() - stream.avail_out;
+        if (status == Z_STREAM_END) {
+          stream_end = true;
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR) {
+          error = std::string("invalid compressed data: ") + (stream.msg ? stream.msg : "unknown error");
+          break;
+        }
+        
+        if (block_length == block.size()) {
+          if (!this->push_block(block)) {
+            break;
+          }
+          block.assign(RSTATS_DECOMPRESS_BLOCK_SIZE, '\0');
+          block_length = 0;
+        }
+      }
+      
+      if (error.empty() && block_length > 0) {
+        block.resize(block_length);
+        this->push_block(block);
+      }
+      inflateEnd(&stream);
+    }
+#endif
+    
+#ifdef RSTATS_HAVE_ZSTD
+    void decompress_zstd (std::string& error) {
+      ZSTD_DStream* stream = ZSTD_createDStream();
+      if (stream == NULL || ZSTD_isError(ZSTD_initDStream(stream))) {
+        error = "can't initialize zstd";
+        ZSTD_freeDStream(stream);
+        return;
+      }
+      
+      std::vector<char> input(ZSTD_DStreamInSize());
+      std::string block(RSTATS_DECOMPRESS_BLOCK_SIZE, '\0');
+      ZSTD_inBuffer in = {input.data(), 0, 0};
+      ZSTD_outBuffer out = {&block[0], block.size(), 0};
+      size_t hint = 1;
+      while (true) {
+        if (in.pos == in.size) {
+          ssize_t size = ::read(this->fd, input.data(), input.size());
+          if (size < 0) {
+            error = std::string("can't read compressed file: ") + strerror(errno);
+            break;
+          }
+          if (size == 0) {
+            if (hint != 0) {
+              error = "unexpected end of compressed file";
+            }
+            break;
+          }
+          in.size = size;
+          in.pos = 0;
+        }
+        
+        hint = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(hint)) {
+          error = std::string("invalid compressed data: ") + ZSTD_getErrorName(hint);
+          break;
+        }
+        
+        if (out.pos == out.size) {
+          if (!this->push_block(block)) {
+            break;
+          }
+          block.assign(RSTATS_DECOMPRESS_BLOCK_SIZE, '\0');
+          out.dst = &block[0];
+          out.pos = 0;
+        }
+      }
+      
+      if (error.empty() && out.pos > 0) {
+        block.resize(out.pos);
+        this->push_block(block);
+      }
+      ZSTD_freeDStream(stream);
+    }
+#endif
+    
+    void run () {
+      std::string error;
+      if (this->format == GZIP) {
+#ifdef RSTATS_HAVE_ZLIB
+        this->inflate_gzip(error);
+#else
+        error = "gzip compressed file is not supported. Rstats is built without zlib library";
+#endif
+      }
+      else {
+#ifdef RSTATS_HAVE_ZSTD
+        this->decompress_zstd(error);
+#else
+        error = "zstd compressed file is not supported. Rstats is built without zstd library";
+#endif
+      }
+      
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->error = error;
+        this->finished = true;
+      }
+      this->block_ready.notify_one();
+    }
+    
+    public:
+    
+    // fd is owned by the decompressor
+    Decompressor (int fd, Format format) : fd(fd), format(format), finished(false), stopped(false) {
+      this->worker = std::thread(&Decompressor::run, this);
+    }
+    
+    ~Decompressor () {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+      }
+      this->block_taken.notify_one();
+      this->worker.join();
+      ::close(this->fd);
+    }
+    
+    // Take the next block. Return false at the end of the file.
+    bool take_block (std::string& block) {
+      std::string error;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (this->blocks.empty() && !this->finished) {
+          this->block_ready.wait(lock);
+        }
+        if (this->blocks.empty()) {
+          if (this->error.empty()) {
+            return false;
+          }
+          error = this->error;
+        }
+        else {
+          block.swap(this->blocks.front());
+          this->blocks.pop_front();
+        }
+      }
+      if (!error.empty()) {
+        croak("%s(Rstats::Decompressor::take_block())", error.c_str());
+      }
+      this->block_taken.notify_one();
+      
+      return true;
+    }
+  };
+  
+  // Rstats::TableReader - reader of delimited text files. Records are parsed without Perl API.
+  class TableReader {
+    public:
+    
+    // Columns specified by numbers(1 origin) or names
+    struct ColumnSpec {
+      std::vector<IV> numbers;
+      std::vector<std::string> names;
+      
+      bool empty () {
+        return this->numbers.empty() && this->names.empty();
+      }
+    };
+    
+    // Options of read_table
+    struct Options {
+      char sep;
+      std::string quote;
+      char comment_char;
+      IV skip;
+      bool header;
+      bool utf8;
+      std::vector<std::string> col_classes;
+      std::map<std::string, std::string> col_classes_by_name;
+      ColumnSpec select;
+      ColumnSpec drop;
+      IV sample_rows;
+      
+      Options () : sep('\0'), quote("\"'"), comment_char('#'), skip(0), header(false), utf8(true), sample_rows(0) {}
+    };
+    
+    private:
+    
+    // Field in the buffer. Doubled quotes in quoted field are unescaped when the text is read.
+    struct Field {
+      const char* ptr;
+      STRLEN length;
+      char quote;
+      bool escaped;
+    };
+    
+    // Values of a column in a chunk. Character values are filled after the type of the column is decided.
+    struct Column {
+      Rstats::VectorType::Enum type;
+      std::vector<IV> integer_values;
+      std::vector<NV> double_values;
+      std::vector<std::complex<NV> > complex_values;
+      std::vector<IV> na_rows;
+      std::string strings;
+      std::vector<Rstats::StringRef> string_refs;
+      bool utf8;
+      
+      Column () : type(Rstats::VectorType::LOGICAL), utf8(false) {}
+    };
+    
+    // Records starting between begin and end of the buffer. Last record can continue to limit.
+    // After parsing, end is the end of last record and line_count is count of lines.
+    struct Chunk {
+      const char* begin;
+      const char* end;
+      const char* limit;
+      IV line_count;
+      IV row_count;
+      std::vector<Column> columns;
+      std::string error;
+      IV error_line;
+      bool partial;
+    };
+    
+    Options options;
+    void* map;
+    STRLEN map_size;
+    std::string buffer;
+    
+    // Data of a compressed file is decompressed into segments. eof is false while the rest of the file
+    // is not in the current segment.
+    Rstats::Decompressor* decompressor;
+    std::deque<std::string> segments;
+    bool eof;
+    
+    const char* data;
+    const char* data_end;
+    const char* pos;
+    IV line;
+    IV column_count;
+    std::vector<std::string> names;
+    
+    // Columns which are read, types given by colClasses and the classes
+    std::vector<bool> selected;
+    std::vector<bool> fixed;
+    std::vector<Rstats::VectorType::Enum> fixed_types;
+    std::vector<std::string> classes;
+    std::vector<std::string> selected_names;
+    std::vector<std::string> selected_classes;
+    
+    // Types of columns decided so far. Types are only widened by later rows, and the changes are
+    // reported in upgrades once the types have been decided by the sample or by the first read.
+    std::vector<Rstats::VectorType::Enum> column_types;
+    bool types_decided;
+    std::vector<std::string> upgrades;
+    
+    static const char* get_type_name (Rstats::VectorType::Enum type) {
+      switch (type) {
+        case Rstats::VectorType::CHARACTER :
+          return "character";
+        case Rstats::VectorType::COMPLEX :
+          return "complex";
+        case Rstats::VectorType::DOUBLE :
+          return "double";
+        case Rstats::VectorType::INTEGER :
+          return "integer";
+        default :
+          return "logical";
+      }
+    }
+    
+    // Length of a white space character at p, or 0. Line breaks are not white spaces.
+    STRLEN get_white_space_length (const char* p, const char* end) {
+      U8 c = (U8)*p;
+      if (c == ' ' || c == '\t' || c == '\f' || c == '\v') {
+        return 1;
+      }
+      else if (c < 0x80) {
+        return 0;
+      }
+      
+      if (!this->options.utf8) {
+        return c == 0xA0 || c == 0x85 ? 1 : 0;
+      }
+      else if (c == 0xC2 && p + 1 < end) {
+        U8 c1 = (U8)p[1];
+        return c1 == 0xA0 || c1 == 0x85 ? 2 : 0;
+      }
+      else if ((c == 0xE1 || c == 0xE2 || c == 0xE3) && p + 2 < end) {
+        U8 c1 = (U8)p[1];
+        U8 c2 = (U8)p[2];
+        if (c == 0xE1) {
+          // U+1680
+          return c1 == 0x9A && c2 == 0x80 ? 3 : 0;
+        }
+        else if (c == 0xE2) {
+          // U+2000 - U+200A, U+2028, U+2029, U+202F, U+205F
+          if (c1 == 0x80 && (c2 <= 0x8A || c2 == 0xA8 || c2 == 0xA9 || c2 == 0xAF)) {
+            return 3;
+          }
+          return c1 == 0x81 && c2 == 0x9F ? 3 : 0;
+        }
+        else {
+          // U+3000
+          return c1 == 0x80 && c2 == 0x80 ? 3 : 0;
+        }
+      }
+      
+      return 0;
+    }
+    
+    bool is_end_of_record (const char* p, const char* end) {
+      return p >= end || *p == '\n' || (*p == '\r' && (p + 1 >= end || p[1] == '\n'))
+        || (this->options.comment_char != '\0' && *p == this->options.comment_char);
+    }
+    
+    bool is_end_of_field (const char* p, const char* end) {
+      if (this->is_end_of_record(p, end)) {
+        return true;
+      }
+      else if (this->options.sep == '\0') {
+        return this->get_white_space_length(p, end) > 0;
+      }
+      else {
+        return *p == this->options.sep;
+      }
+    }
+    
+    const char* parse_field (const char* p, const char* end, Field& field, IV& line, std::string& error) {
+      field.quote = '\0';
+      field.escaped = false;
+      
+      if (!this->options.quote.empty() && memchr(this->options.quote.data(), *p, this->options.quote.size())) {
+        char quote = *p++;
+        field.ptr = p;
+        field.quote = quote;
+        while (true) {
+          const char* found = (const char*)memchr(p, quote, end - p);
+          if (found == NULL) {
+            error = "had EOF within quoted string";
+            field.length = end - field.ptr;
+            return end;
+          }
+          for (const char* q = p; q < found; q++) {
+            if (*q == '\n') {
+              line++;
+            }
+          }
+          if (found + 1 < end && found[1] == quote) {
+            field.escaped = true;
+            p = found + 2;
+          }
+          else {
+            field.length = found - field.ptr;
+            p = found + 1;
+            break;
+          }
+        }
+        
+        // Characters after closing quote are ignored
+        while (!this->is_end_of_field(p, end)) {
+          p++;
+        }
+        return p;
+      }
+      
+      field.ptr = p;
+      while (!this->is_end_of_field(p, end)) {
+        p++;
+      }
+      field.length = p - field.ptr;
+      
+      return p;
+    }
+    
+    // Parse a record and move to the next line. Blank or comment line has no fields.
+    const char* parse_record (const char* p, const char* end, std::vector<Field>& fields, IV& line, std::string& error) {
+      fields.clear();
+      bool white_space_sep = this->options.sep == '\0';
+      while (true) {
+        if (white_space_sep) {
+          STRLEN white_space_length;
+          while (p < end && (white_space_length = this->get_white_space_length(p, end)) > 0) {
+            p += white_space_length;
+          }
+        }
+        
+        if (this->is_end_of_record(p, end)) {
+          // Separator at the end of the line is followed by an empty field
+          if (!white_space_sep && !fields.empty()) {
+            Field field = {p, 0, '\0', false};
+            fields.push_back(field);
+          }
+          break;
+        }
+        
+        Field field;
+        p = this->parse_field(p, end, field, line, error);
+        fields.push_back(field);
+        if (!error.empty()) {
+          return end;
+        }
+        
+        if (!white_space_sep) {
+          if (p < end && *p == this->options.sep) {
+            p++;
+          }
+          else {
+            break;
+          }
+        }
+      }
+      
+      // Comment and line break
+      const char* line_end = (const char*)memchr(p, '\n', end - p);
+      line++;
+      
+      return line_end == NULL ? end : line_end + 1;
+    }
+    
+    void get_field_text (Field& field, std::string& text, const char*& str, STRLEN& length) {
+      if (!field.escaped) {
+        str = field.ptr;
+        length = field.length;
+        return;
+      }
+      
+      text.clear();
+      for (STRLEN i = 0; i < field.length; i++) {
+        text += field.ptr[i];
+        if (field.ptr[i] == field.quote) {
+          i++;
+        }
+      }
+      str = text.data();
+      length = text.size();
+    }
+    
+    void upgrade_column (Column& column, Rstats::VectorType::Enum type) {
+      if (type == Rstats::VectorType::DOUBLE && column.type <= Rstats::VectorType::INTEGER) {
+        column.double_values.assign(column.integer_values.begin(), column.integer_values.end());
+        std::vector<IV>().swap(column.integer_values);
+      }
+      else if (type == Rstats::VectorType::COMPLEX) {
+        if (column.type == Rstats::VectorType::DOUBLE) {
+          column.complex_values.assign(column.double_values.begin(), column.double_values.end());
+          std::vector<NV>().swap(column.double_values);
+        }
+        else {
+          column.complex_values.assign(column.integer_values.begin(), column.integer_values.end());
+          std::vector<IV>().swap(column.integer_values);
+        }
+      }
+      column.type = type;
+    }
+    
+    // Parse a field into the column. A column which has type of colClasses is not upgraded.
+    bool add_value (Column& column, Field& field, IV row, std::string& text, bool fixed, std::string& error) {
+      if (column.type == Rstats::VectorType::CHARACTER) {
+        return true;
+      }
+      
+      const char* str;
+      STRLEN length;
+      this->get_field_text(field, text, str, length);
+      
+      // Empty field is NA except in character column
+      Rstats::Util::Scalar scalar;
+      Rstats::VectorType::Enum type;
+      if (length == 0) {
+        scalar.na = true;
+        scalar.iv = 0;
+        scalar.re = 0;
+        scalar.im = 0;
+        type = Rstats::VectorType::LOGICAL;
+      }
+      else {
+        type = Rstats::Util::parse_scalar(str, length, scalar);
+      }
+      
+      if (fixed && type > column.type) {
+        error = std::string("expected '") + get_type_name(column.type) + "', got '" + std::string(str, length) + "'";
+        return false;
+      }
+      else if (type == Rstats::VectorType::CHARACTER) {
+        column = Column();
+        column.type = Rstats::VectorType::CHARACTER;
+        return true;
+      }
+      else if (type > column.type) {
+        this->upgrade_column(column, type);
+      }
+      
+      if (scalar.na) {
+        column.na_rows.push_back(row);
+      }
+      switch (column.type) {
+        case Rstats::VectorType::COMPLEX :
+          column.complex_values.push_back(std::complex<NV>(scalar.re, scalar.im));
+          break;
+        case Rstats::VectorType::DOUBLE :
+          column.double_values.push_back(scalar.re);
+          break;
+        default :
+          column.integer_values.push_back(scalar.iv);
+      }
+      
+      return true;
+    }
+    
+    // Parse records of the chunk and infer types of columns
+    void parse_chunk (Chunk& chunk, IV max_rows) {
+      chunk.columns.assign(this->column_count, Column());
+      for (IV k = 0; k < this->column_count; k++) {
+        chunk.columns[k].type = this->column_types[k];
+      }
+      chunk.row_count = 0;
+      chunk.error.clear();
+      
+      std::vector<Field> fields;
+      std::string text;
+      IV line = 0;
+      const char* p = chunk.begin;
+      while (p < chunk.end && (max_rows < 0 || chunk.row_count < max_rows)) {
+        const char* record_begin = p;
+        IV record_line = line;
+        chunk.error_line = line + 1;
+        p = this->parse_record(p, chunk.limit, fields, line, chunk.error);
+        
+        // A record reaching the limit of a partial chunk is parsed again with the next segment
+        if (chunk.partial && (!chunk.error.empty() || (p == chunk.limit && p[-1] != '\n'))) {
+          chunk.error.clear();
+          p = record_begin;
+          line = record_line;
+          break;
+        }
+        if (!chunk.error.empty()) {
+          break;
+        }
+        if (fields.empty()) {
+          continue;
+        }
+        if ((IV)fields.size() != this->column_count) {
+          chunk.error = "did not have " + std::to_string(this->column_count) + " elements";
+          break;
+        }
+        
+        // Fields of columns which are not selected are skipped
+        bool ok = true;
+        for (IV k = 0; k < this->column_count && ok; k++) {
+          if (this->selected[k]) {
+            ok = this->add_value(chunk.columns[k], fields[k], chunk.row_count, text, this->fixed[k], chunk.error);
+          }
+        }
+        if (!ok) {
+          break;
+        }
+        chunk.row_count++;
+      }
+      chunk.end = p;
+      chunk.line_count = line;
+    }
+    
+    // Split data from begin to end into chunks, parse them in threads and append them to chunks.
+    // Chunks start at line heads. A chunk is parsed again if the previous chunk doesn't end at its head
+    // (e.g. quoted line break).
+    void parse_chunks (const char* begin, const char* end, std::vector<Chunk>& chunks) {
+      IV thread_count = Rstats::ThreadPool::get_thread_count();
+      IV chunk_count = (end - begin) / RSTATS_READER_MIN_CHUNK_SIZE;
+      if (chunk_count > thread_count) {
+        chunk_count = thread_count;
+      }
+      if (chunk_count < 1) {
+        chunk_count = 1;
+      }
+      
+      size_t offset = chunks.size();
+      chunks.resize(offset + chunk_count);
+      STRLEN chunk_size = (end - begin) / chunk_count;
+      const char* chunk_begin = begin;
+      for (IV c = 0; c < chunk_count; c++) {
+        const char* chunk_end = end;
+        if (c < chunk_count - 1) {
+          const char* nominal_end = begin + chunk_size * (c + 1);
+          if (nominal_end < chunk_begin) {
+            nominal_end = chunk_begin;
+          }
+          const char* line_end = (const char*)memchr(nominal_end, '\n', end - nominal_end);
+          chunk_end = line_end == NULL ? end : line_end + 1;
+        }
+        Chunk& chunk = chunks[offset + c];
+        chunk.begin = chunk_begin;
+        chunk.end = chunk_end;
+        chunk.limit = this->data_end;
+        chunk.partial = !this->eof;
+        chunk_begin = chunk_end;
+      }
+      
+      Rstats::ThreadPool::parallel_for(
+        chunk_count,
+        [this, &chunks, offset] (IV begin, IV end) {
+          for (IV c = begin; c < end; c++) {
+            this->parse_chunk(chunks[offset + c], -1);
+          }
+        },
+        1
+      );
+      
+      for (size_t c = offset + 1; c < chunks.size(); c++) {
+        if (!chunks[c - 1].error.empty()) {
+          chunks.resize(c);
+          break;
+        }
+        if (chunks[c].begin != chunks[c - 1].end) {
+          const char* chunk_end = chunks[c].end;
+          chunks[c].begin = chunks[c - 1].end;
+          chunks[c].end = chunks[c].begin > chunk_end ? chunks[c].begin : chunk_end;
+          this->parse_chunk(chunks[c], -1);
+        }
+      }
+    }
+    
+    // Move the unread data and the next decompressed blocks into a new segment,
+    // until the segment has min_size bytes and min_lines line breaks. Previous segments are kept
+    // because parsed chunks refer to them.
+    void fill_segment (STRLEN min_size, IV min_lines) {
+      this->segments.push_back(std::string());
+      std::string& segment = this->segments.back();
+      segment.reserve(min_size + (this->data_end - this->pos));
+      segment.append(this->pos, this->data_end - this->pos);
+      
+      IV line_count = 0;
+      for (size_t i = 0; i < segment.size(); i++) {
+        if (segment[i] == '\n') {
+          line_count++;
+        }
+      }
+      
+      std::string block;
+      while (!this->eof && (segment.size() < min_size || line_count < min_lines)) {
+        if (!this->decompressor->take_block(block)) {
+          this->eof = true;
+          break;
+        }
+        for (size_t i = 0; i < block.size() && line_count < min_lines; i++) {
+          if (block[i] == '\n') {
+            line_count++;
+          }
+        }
+        segment.append(block);
+      }
+      
+      this->data = segment.data();
+      this->data_end = this->data + segment.size();
+      this->pos = this->data;
+    }
+    
+    // Segments before the current segment are released after the chunks are built
+    void release_segments () {
+      while (this->segments.size() > 1) {
+        this->segments.pop_front();
+      }
+    }
+    
+    // Store text of fields into character columns. Records are parsed again.
+    void fill_characters (Chunk& chunk, const std::vector<bool>& targets) {
+      for (IV k = 0; k < this->column_count; k++) {
+        if (targets[k]) {
+          Column& column = chunk.columns[k];
+          column = Column();
+          column.type = Rstats::VectorType::CHARACTER;
+          column.string_refs.reserve(chunk.row_count);
+        }
+      }
+      
+      std::vector<Field> fields;
+      std::string text;
+      std::string error;
+      IV line = 0;
+      const char* p = chunk.begin;
+      IV row = 0;
+      while (p < chunk.end && row < chunk.row_count) {
+        p = this->parse_record(p, chunk.limit, fields, line, error);
+        if (fields.empty()) {
+          continue;
+        }
+        for (IV k = 0; k < this->column_count; k++) {
+          if (!targets[k]) {
+            continue;
+          }
+          Column& column = chunk.columns[k];
+          const char* str;
+          STRLEN length;
+          this->get_field_text(fields[k], text, str, length);
+          Rstats::StringRef string_ref = {column.strings.size(), length};
+          column.strings.append(str, length);
+          column.string_refs.push_back(string_ref);
+          if (!column.utf8 && this->options.utf8 && !Rstats::Util::is_ascii(str, length)) {
+            column.utf8 = true;
+          }
+        }
+        row++;
+      }
+    }
+    
+    // Merge columns of chunks into vectors. Type of a column is the highest type in the chunks.
+    void build (std::vector<Chunk>& chunks, std::vector<Rstats::Vector*>& vectors) {
+      IV row_count = 0;
+      for (size_t c = 0; c < chunks.size(); c++) {
+        row_count += chunks[c].row_count;
+      }
+      
+      std::vector<Rstats::VectorType::Enum>& types = this->column_types;
+      
+      Rstats::ThreadPool::parallel_for(
+        chunks.size(),
+        [this, &chunks, &types] (IV begin, IV end) {
+          for (IV c = begin; c < end; c++) {
+            std::vector<bool> targets(this->column_count, false);
+            bool has_target = false;
+            for (IV k = 0; k < this->column_count; k++) {
+              if (this->selected[k] && types[k] == Rstats::VectorType::CHARACTER
+                && (IV)chunks[c].columns[k].string_refs.size() != chunks[c].row_count)
+              {
+                targets[k] = true;
+                has_target = true;
+              }
+            }
+            if (has_target) {
+              this->fill_characters(chunks[c], targets);
+            }
+          }
+        },
+        1
+      );
+      
+      vectors.clear();
+      for (IV k = 0; k < this->column_count; k++) {
+        if (!this->selected[k]) {
+          continue;
+        }
+        
+        Rstats::Vector* vector;
+        switch (types[k]) {
+          case Rstats::VectorType::CHARACTER :
+            vector = Rstats::Vector::new_character(row_count);
+            break;
+          case Rstats::VectorType::COMPLEX :
+            vector = Rstats::Vector::new_complex(row_count);
+            break;
+          case Rstats::VectorType::DOUBLE :
+            vector = Rstats::Vector::new_double(row_count);
+            break;
+          case Rstats::VectorType::INTEGER :
+            vector = Rstats::Vector::new_integer(row_count);
+            break;
+          default :
+            vector = Rstats::Vector::new_logical(row_count);
+        }
+        
+        IV offset = 0;
+        for (size_t c = 0; c < chunks.size(); c++) {
+          Column& column = chunks[c].columns[k];
+          IV count = chunks[c].row_count;
+          switch (types[k]) {
+            case Rstats::VectorType::CHARACTER : {
+              if (c == 0) {
+                STRLEN strings_size = 0;
+                for (size_t d = 0; d < chunks.size(); d++) {
+                  strings_size += chunks[d].columns[k].strings.size();
+                }
+                vector->reserve_strings(strings_size);
+              }
+              const char* strings = column.strings.data();
+              for (IV i = 0; i < count; i++) {
+                Rstats::StringRef& string_ref = column.string_refs[i];
+                vector->set_character_value(offset + i, strings + string_ref.offset, string_ref.length, column.utf8);
+              }
+              break;
+            }
+            case Rstats::VectorType::COMPLEX : {
+              std::complex<NV>* values = vector->get_complex_values() + offset;
+              if (column.type == Rstats::VectorType::COMPLEX) {
+                std::copy(column.complex_values.begin(), column.complex_values.end(), values);
+              }
+              else if (column.type == Rstats::VectorType::DOUBLE) {
+                std::copy(column.double_values.begin(), column.double_values.end(), values);
+              }
+              else {
+                std::copy(column.integer_values.begin(), column.integer_values.end(), values);
+              }
+              break;
+            }
+            case Rstats::VectorType::DOUBLE : {
+              NV* values = vector->get_double_values() + offset;
+              if (column.type == Rstats::VectorType::DOUBLE) {
+                std::copy(column.double_values.begin(), column.double_values.end(), values);
+              }
+              else {
+                std::copy(column.integer_values.begin(), column.integer_values.end(), values);
+              }
+              break;
+            }
+            default : {
+              std::copy(column.integer_values.begin(), column.integer_values.end(), vector->get_integer_values() + offset);
+            }
+          }
+          
+          if (types[k] != Rstats::VectorType::CHARACTER) {
+            for (size_t i = 0; i < column.na_rows.size(); i++) {
+              vector->add_na_position(offset + column.na_rows[i]);
+            }
+          }
+          offset += count;
+          
+          // Release memory of the chunk early
+          column = Column();
+        }
+        vectors.push_back(vector);
+      }
+    }
+    
+    // Skip lines and read header. Count of columns is decided by the first record.
+    void start () {
+      this->pos = this->data;
+      this->line = 0;
+      for (IV i = 0; i < this->options.skip && this->pos < this->data_end; i++) {
+        const char* line_end = (const char*)memchr(this->pos, '\n', this->data_end - this->pos);
+        this->pos = line_end == NULL ? this->data_end : line_end + 1;
+        this->line++;
+      }
+      
+      std::vector<Field> fields;
+      std::string text;
+      std::string error;
+      std::vector<std::string> header_names;
+      bool header_read = !this->options.header;
+      this->column_count = 0;
+      const char* p = this->pos;
+      IV line = this->line;
+      while (p < this->data_end) {
+        IV record_line = line + 1;
+        p = this->parse_record(p, this->data_end, fields, line, error);
+        if (!error.empty()) {
+          croak("line %" IVdf " %s(Rstats::TableReader::start())", record_line, error.c_str());
+        }
+        if (fields.empty()) {
+          continue;
+        }
+        
+        if (!header_read) {
+          for (size_t k = 0; k < fields.size(); k++) {
+            const char* str;
+            STRLEN length;
+            this->get_field_text(fields[k], text, str, length);
+            header_names.push_back(std::string(str, length));
+          }
+          header_read = true;
+          this->pos = p;
+          this->line = line;
+          continue;
+        }
+        
+        this->column_count = fields.size();
+        break;
+      }
+      if (this->column_count == 0) {
+        this->column_count = header_names.size();
+      }
+      
+      for (IV k = 0; k < this->column_count; k++) {
+        if (k < (IV)header_names.size()) {
+          this->names.push_back(header_names[k]);
+        }
+        else {
+          this->names.push_back("V" + std::to_string(k + 1));
+        }
+      }
+      
+      this->resolve_columns();
+      
+      // Types are inferred from the first rows without consuming them
+      this->column_types = this->fixed_types;
+      this->types_decided = false;
+      if (this->options.sample_rows > 0) {
+        Chunk chunk;
+        chunk.begin = this->pos;
+        chunk.end = this->data_end;
+        chunk.limit = this->data_end;
+        chunk.partial = !this->eof;
+        this->parse_chunk(chunk, this->options.sample_rows);
+        for (IV k = 0; k < this->column_count; k++) {
+          if (chunk.columns[k].type > this->column_types[k]) {
+            this->column_types[k] = chunk.columns[k].type;
+          }
+        }
+        this->types_decided = true;
+      }
+    }
+    
+    // Index of the column specified by number or name
+    IV find_column (IV number, const std::string* name) {
+      if (name == NULL) {
+        if (number < 1 || number > this->column_count) {
+          croak("column number %" IVdf " is out of range(Rstats::TableReader::open())", number);
+        }
+        return number - 1;
+      }
+      
+      for (IV k = 0; k < this->column_count; k++) {
+        if (this->names[k] == *name) {
+          return k;
+        }
+      }
+      croak("column '%s' is not found(Rstats::TableReader::open())", name->c_str());
+      
+      return -1;
+    }
+    
+    // Decide columns which are read and their types from select, drop and colClasses
+    void resolve_columns () {
+      ColumnSpec& select = this->options.select;
+      ColumnSpec& drop = this->options.drop;
+      if (!select.empty() && !drop.empty()) {
+        croak("select and drop can't be specified at the same time(Rstats::TableReader::open())");
+      }
+      
+      this->selected.assign(this->column_count, select.empty());
+      for (size_t i = 0; i < select.numbers.size(); i++) {
+        this->selected[this->find_column(select.numbers[i], NULL)] = true;
+      }
+      for (size_t i = 0; i < select.names.size(); i++) {
+        this->selected[this->find_column(0, &select.names[i])] = true;
+      }
+      for (size_t i = 0; i < drop.numbers.size(); i++) {
+        this->selected[this->find_column(drop.numbers[i], NULL)] = false;
+      }
+      for (size_t i = 0; i < drop.names.size(); i++) {
+        this->selected[this->find_column(0, &drop.names[i])] = false;
+      }
+      
+      // colClasses are recycled if they are not named
+      this->classes.assign(this->column_count, std::string());
+      std::vector<std::string>& col_classes = this->options.col_classes;
+      for (IV k = 0; k < this->column_count && !col_classes.empty(); k++) {
+        this->classes[k] = col_classes[k % col_classes.size()];
+      }
+      std::map<std::string, std::string>& col_classes_by_name = this->options.col_classes_by_name;
+      for (std::map<std::string, std::string>::iterator it = col_classes_by_name.begin(); it != col_classes_by_name.end(); ++it) {
+        this->classes[this->find_column(0, &it->first)] = it->second;
+      }
+      
+      this->fixed.assign(this->column_count, true);
+      this->fixed_types.assign(this->column_count, Rstats::VectorType::LOGICAL);
+      for (IV k = 0; k < this->column_count; k++) {
+        std::string& col_class = this->classes[k];
+        if (col_class.empty()) {
+          this->fixed[k] = false;
+        }
+        else if (col_class == "NULL") {
+          this->selected[k] = false;
+        }
+        else if (col_class == "character" || col_class == "factor") {
+          this->fixed_types[k] = Rstats::VectorType::CHARACTER;
+        }
+        else if (col_class == "complex") {
+          this->fixed_types[k] = Rstats::VectorType::COMPLEX;
+        }
+        else if (col_class == "numeric" || col_class == "double") {
+          this->fixed_types[k] = Rstats::VectorType::DOUBLE;
+        }
+        else if (col_class == "integer") {
+          this->fixed_types[k] = Rstats::VectorType::INTEGER;
+        }
+        else if (col_class != "logical") {
+          croak("invalid colClasses '%s'(Rstats::TableReader::open())", col_class.c_str());
+        }
+      }
+      
+      for (IV k = 0; k < this->column_count; k++) {
+        if (this->selected[k]) {
+          this->selected_names.push_back(this->names[k]);
+          this->selected_classes.push_back(this->classes[k]);
+        }
+      }
+    }
+    
+    public:
+    
+    // Column numbers and names of array reference
+    static void parse_column_spec (SV* sv_spec, ColumnSpec& spec) {
+      if (!SvOK(sv_spec)) {
+        return;
+      }
+      IV length = Rstats::PerlAPI::avrv_len_fix(sv_spec);
+      for (IV i = 0; i < length; i++) {
+        SV* sv_column = Rstats::PerlAPI::avrv_fetch_simple(sv_spec, i);
+        if (looks_like_number(sv_column)) {
+          spec.numbers.push_back(SvIV(sv_column));
+        }
+        else {
+          spec.names.push_back(SvPV_nolen(sv_column));
+        }
+      }
+    }
+    
+    TableReader () : map(NULL), map_size(0), decompressor(NULL), eof(true), data(NULL), data_end(NULL), pos(NULL) {}
+    
+    // Open the file and read the header. options is a hash reference which has sep, quote, comment.char,
+    // skip, header, encoding, colClasses(array reference or hash reference of column names), select and drop.
+    // This can croak, so the reader must be owned by a Perl object before calling this. Then the mapping
+    // and the decompressor are released by the destructor.
+    void open (SV* sv_file, SV* sv_options) {
+      
+      if (SvOK(sv_options)) {
+        SV* sv_sep = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "sep");
+        if (SvOK(sv_sep)) {
+          STRLEN sep_length;
+          const char* sep = SvPV(sv_sep, sep_length);
+          if (sep_length == 1) {
+            this->options.sep = sep[0] == ' ' ? '\0' : sep[0];
+          }
+          else if (!(sep_length == 0 || (sep_length == 3 && memcmp(sep, "\\s+", 3) == 0))) {
+            croak("invalid 'sep' value: must be one byte(Rstats::TableReader::open())");
+          }
+        }
+        SV* sv_quote = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "quote");
+        if (SvOK(sv_quote)) {
+          this->options.quote = SvPV_nolen(sv_quote);
+        }
+        SV* sv_comment_char = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "comment.char");
+        if (SvOK(sv_comment_char)) {
+          STRLEN comment_char_length;
+          const char* comment_char = SvPV(sv_comment_char, comment_char_length);
+          if (comment_char_length > 1) {
+            croak("invalid 'comment.char' argument(Rstats::TableReader::open())");
+          }
+          this->options.comment_char = comment_char_length ? comment_char[0] : '\0';
+        }
+        SV* sv_skip = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "skip");
+        if (SvOK(sv_skip)) {
+          this->options.skip = SvIV(sv_skip);
+        }
+        SV* sv_header = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "header");
+        this->options.header = SvTRUE(sv_header);
+        SV* sv_sample = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "sample");
+        if (SvOK(sv_sample)) {
+          this->options.sample_rows = SvIV(sv_sample);
+        }
+        SV* sv_col_classes = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "colClasses");
+        if (SvROK(sv_col_classes) && SvTYPE(SvRV(sv_col_classes)) == SVt_PVHV) {
+          HV* hv_col_classes = (HV*)SvRV(sv_col_classes);
+          hv_iterinit(hv_col_classes);
+          HE* entry;
+          while ((entry = hv_iternext(hv_col_classes)) != NULL) {
+            SV* sv_col_class = hv_iterval(hv_col_classes, entry);
+            if (SvOK(sv_col_class)) {
+              this->options.col_classes_by_name[SvPV_nolen(hv_iterkeysv(entry))] = SvPV_nolen(sv_col_class);
+            }
+          }
+        }
+        else if (SvOK(sv_col_classes)) {
+          IV length = Rstats::PerlAPI::avrv_len_fix(sv_col_classes);
+          for (IV i = 0; i < length; i++) {
+            SV* sv_col_class = Rstats::PerlAPI::avrv_fetch_simple(sv_col_classes, i);
+            this->options.col_classes.push_back(SvOK(sv_col_class) ? SvPV_nolen(sv_col_class) : "");
+          }
+        }
+        parse_column_spec(Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "select"), this->options.select);
+        parse_column_spec(Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "drop"), this->options.drop);
+        SV* sv_encoding = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "encoding");
+        if (SvOK(sv_encoding)) {
+          std::string encoding = SvPV_nolen(sv_encoding);
+          for (size_t i = 0; i < encoding.size(); i++) {
+            encoding[i] = toLOWER(encoding[i]);
+          }
+          if (encoding == "latin1" || encoding == "latin-1" || encoding == "iso-8859-1") {
+            this->options.utf8 = false;
+          }
+          else if (!(encoding == "utf-8" || encoding == "utf8")) {
+            croak("unsupported encoding '%s'(Rstats::TableReader::open())", SvPV_nolen(sv_encoding));
+          }
+        }
+      }
+      
+      const char* file = SvPV_nolen(sv_file);
+      int fd = ::open(file, O_RDONLY);
+      if (fd < 0) {
+        croak("cannot open file '%s': %s", file, strerror(errno));
+      }
+      struct stat st;
+      bool regular_file = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+      
+      // Compressed file is decompressed in a background thread while records are parsed
+      unsigned char head[4];
+      ssize_t head_length = regular_file ? pread(fd, head, sizeof(head), 0) : 0;
+      Rstats::Decompressor::Format format
+        = Rstats::Decompressor::detect_format(head, head_length > 0 ? head_length : 0);
+      if (format != Rstats::Decompressor::NONE) {
+        this->decompressor = new Rstats::Decompressor(fd, format);
+        this->eof = false;
+        this->fill_segment(RSTATS_READER_SEGMENT_SIZE, this->options.skip + 2 + this->options.sample_rows);
+        this->start();
+        return;
+      }
+      
+      if (regular_file) {
+        this->map_size = st.st_size;
+        this->map = mmap(NULL, this->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (this->map == MAP_FAILED) {
+          this->map = NULL;
+        }
+        else {
+          madvise(this->map, this->map_size, MADV_SEQUENTIAL);
+        }
+      }
+      
+      // Files which can't be mapped are read into the buffer
+      if (this->map == NULL) {
+        char block[65536];
+        ssize_t size;
+        while ((size = ::read(fd, block, sizeof(block))) > 0) {
+          this->buffer.append(block, size);
+        }
+        this->data = this->buffer.data();
+        this->data_end = this->data + this->buffer.size();
+      }
+      else {
+        this->data = (const char*)this->map;
+        this->data_end = this->data + this->map_size;
+      }
+      ::close(fd);
+      
+      this->start();
+    }
+    
+    ~TableReader () {
+      if (this->map != NULL) {
+        munmap(this->map, this->map_size);
+      }
+      delete this->decompressor;
+    }
+    
+    // Names of selected columns
+    std::vector<std::string>& get_names () {
+      return this->selected_names;
+    }
+    
+    // Messages of column types changed by the last read
+    std::vector<std::string>& get_upgrades () {
+      return this->upgrades;
+    }
+    
+    // colClasses of selected columns. Empty string if the type is inferred.
+    std::vector<std::string>& get_classes () {
+      return this->selected_classes;
+    }
+    
+    bool is_utf8 () {
+      return this->options.utf8;
+    }
+    
+    // Read at most max_rows rows(all rows if max_rows is negative) into column vectors.
+    // All rows are parsed by threads. Return false if there are no more rows.
+    bool read (IV max_rows, std::vector<Rstats::Vector*>& vectors) {
+      
+      std::vector<Chunk> chunks;
+      IV first_line = this->line + 1;
+      IV row_count = 0;
+      while (true) {
+        // Data after the last line head may be continued in the next segment
+        const char* end = this->data_end;
+        if (!this->eof) {
+          while (end > this->pos && end[-1] != '\n') {
+            end--;
+          }
+        }
+        
+        size_t offset = chunks.size();
+        if (max_rows < 0) {
+          this->parse_chunks(this->pos, end, chunks);
+        }
+        else {
+          chunks.resize(offset + 1);
+          Chunk& chunk = chunks.back();
+          chunk.begin = this->pos;
+          chunk.end = end;
+          chunk.limit = this->data_end;
+          chunk.partial = !this->eof;
+          this->parse_chunk(chunk, max_rows - row_count);
+        }
+        
+        for (size_t c = offset; c < chunks.size(); c++) {
+          if (!chunks[c].error.empty()) {
+            croak(
+              "line %" IVdf " %s(Rstats::TableReader::read())",
+              this->line + chunks[c].error_line,
+              chunks[c].error.c_str()
+            );
+          }
+          this->line += chunks[c].line_count;
+          row_count += chunks[c].row_count;
+        }
+        this->pos = chunks.back().end;
+        
+        if (this->eof || (max_rows >= 0 && row_count >= max_rows)) {
+          break;
+        }
+        this->fill_segment(RSTATS_READER_SEGMENT_SIZE, 0);
+      }
+      
+      this->upgrades.clear();
+      if (row_count == 0 && max_rows != 0) {
+        vectors.clear();
+        this->release_segments();
+        return false;
+      }
+      
+      // Column types are widened to hold the values of all chunks
+      for (size_t c = 0; c < chunks.size(); c++) {
+        for (IV k = 0; k < this->column_count && chunks[c].row_count > 0; k++) {
+          Rstats::VectorType::Enum type = chunks[c].columns[k].type;
+          if (type > this->column_types[k]) {
+            if (this->types_decided && this->selected[k]) {
+              this->upgrades.push_back(
+                "type of column '" + this->names[k] + "' is changed from " + get_type_name(this->column_types[k])
+                + " to " + get_type_name(type) + " in the rows from line " + std::to_string(first_line)
+              );
+            }
+            this->column_types[k] = type;
+          }
+        }
+      }
+      this->types_decided = true;
+      
+      this->build(chunks, vectors);
+      this->release_segments();
+      
+      return true;
+    }
+  };
+  
+  // Rstats::TableWriter - writer of delimited text files. Blocks of rows are formatted
+  // (and compressed) in threads without Perl API, and written in order. Character cells
+  // of each batch of blocks are collected as StringView in the interpreter thread first.
+  class TableWriter {
+    public:
+    
+    // Options of write_table
+    struct Options {
+      std::string sep;
+      std::string eol;
+      std::string na;
+      bool quote;
+      bool double_quote;
+      bool gzip;
+      
+      Options () : sep(" "), eol("\n"), na("NA"), quote(true), double_quote(false), gzip(false) {}
+    };
+    
+    private:
+    
+    // Column is a vector(data frame) or a part of a vector from offset(matrix).
+    // views are character cells of the current batch.
+    struct Column {
+      Rstats::Vector* vector;
+      IV offset;
+      std::vector<StringView> views;
+    };
+    
+    Options options;
+    std::vector<Column> columns;
+    IV row_count;
+    Rstats::Vector* row_names;
+    bool row_numbers;
+    Rstats::Vector* col_names;
+    bool col_names_blank;
+    std::vector<StringView> row_name_views;
+    
+    void append_string (std::string& out, const char* str, STRLEN length, bool quote) {
+      if (!quote) {
+        out.append(str, length);
+        return;
+      }
+      
+      out += '"';
+      const char* end = str + length;
+      const char* p = str;
+      while (p < end) {
+        const char* found = (const char*)memchr(p, '"', end - p);
+        if (found == NULL) {
+          out.append(p, end - p);
+          break;
+        }
+        out.append(p, found - p);
+        out += this->options.double_quote ? '"' : '\\';
+        out += '"';
+        p = found + 1;
+      }
+      out += '"';
+    }
+    
+    // Strings are quoted. NA is not quoted.
+    void append_view (std::string& out, const StringView& view) {
+      if (view.na) {
+        out += this->options.na;
+      }
+      else {
+        this->append_string(out, view.ptr, view.length, this->options.quote);
+      }
+    }
+    
+    // Character cells of rows from begin to end
+    static void collect_views (Rstats::Vector* vector, IV begin, IV end, std::vector<StringView>& views) {
+      views.resize(end - begin);
+      for (IV i = begin; i < end; i++) {
+        StringView& view = views[i - begin];
+        view.ptr = vector->get_character_ptr(i);
+        view.length = vector->get_character_length(i);
+        view.utf8 = vector->is_character_utf8(i);
+        view.na = vector->exists_na_position(i);
+      }
+    }
+    
+    // Values except character
+    void append_value (std::string& out, Rstats::Vector* vector, IV pos) {
+      if (vector->exists_na_position(pos)) {
+        out += this->options.na;
+        return;
+      }
+      
+      char buffer[RSTATS_NUMBER_BUFFER_SIZE * 2 + 2];
+      char* end = buffer;
+      switch (vector->get_type()) {
+        case Rstats::VectorType::COMPLEX : {
+          std::complex<NV> z = vector->get_complex_value(pos);
+          end = Rstats::Util::format_double(buffer, z.real(), RSTATS_DOUBLE_DIGITS);
+          if (z.imag() >= 0) {
+            *end++ = '+';
+          }
+          end = Rstats::Util::format_double(end, z.imag(), RSTATS_DOUBLE_DIGITS);
+          *end++ = 'i';
+          break;
+        }
+        case Rstats::VectorType::DOUBLE :
+          end = Rstats::Util::format_double(buffer, vector->get_double_value(pos), RSTATS_DOUBLE_DIGITS);
+          break;
+        case Rstats::VectorType::INTEGER :
+          end = Rstats::Util::format_integer(buffer, vector->get_integer_value(pos));
+          break;
+        default :
+          out += vector->get_integer_value(pos) ? "TRUE" : "FALSE";
+          return;
+      }
+      out.append(buffer, end - buffer);
+    }
+    
+    void format_header (std::string& out) {
+      if (this->col_names == NULL) {
+        return;
+      }
+      
+      bool first = true;
+      if (this->col_names_blank) {
+        this->append_string(out, "", 0, this->options.quote);
+        first = false;
+      }
+      for (IV k = 0; k < this->col_names->get_length(); k++) {
+        if (!first) {
+          out += this->options.sep;
+        }
+        StringView view = {
+          this->col_names->get_character_ptr(k),
+          this->col_names->get_character_length(k),
+          this->col_names->is_character_utf8(k),
+          this->col_names->exists_na_position(k)
+        };
+        this->append_view(out, view);
+        first = false;
+      }
+      out += this->options.eol;
+    }
+    
+    // Rows from begin to end in the batch from batch_begin. Perl API is not used.
+    void format_rows (std::string& out, IV batch_begin, IV begin, IV end) {
+      for (IV i = begin; i < end; i++) {
+        bool first = true;
+        if (this->row_names != NULL) {
+          this->append_view(out, this->row_name_views[i - batch_begin]);
+          first = false;
+        }
+        else if (this->row_numbers) {
+          char buffer[RSTATS_NUMBER_BUFFER_SIZE];
+          char* end = Rstats::Util::format_integer(buffer, i + 1);
+          this->append_string(out, buffer, end - buffer, this->options.quote);
+          first = false;
+        }
+        for (size_t k = 0; k < this->columns.size(); k++) {
+          if (!first) {
+            out += this->options.sep;
+          }
+          const Column& column = this->columns[k];
+          if (column.vector->get_type() == Rstats::VectorType::CHARACTER) {
+            this->append_view(out, column.views[i - batch_begin]);
+          }
+          else {
+            this->append_value(out, column.vector, column.offset + i);
+          }
+          first = false;
+        }
+        out += this->options.eol;
+      }
+    }
+    
+    // Compress text into a gzip member. Concatenated members are a valid gzip file.
+    static bool deflate_gzip (const std::string& text, std::string& out) {
+#ifndef RSTATS_HAVE_ZLIB
+      return false;
+#else
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+      }
+      out.resize(deflateBound(&stream, text.size()));
+      stream.next_in = (Bytef*)text.data();
+      stream.avail_in = text.size();
+      stream.next_out = (Bytef*)&out[0];
+      stream.avail_out = out.size();
+      int status = deflate(&stream, Z_FINISH);
+      out.resize(out.size() - stream.avail_out);
+      deflateEnd(&stream);
+      
+      return status == Z_STREAM_END;
+#endif
+    }
+    
+    static bool write_all (int fd, const std::string& out) {
+      const char* p = out.data();
+      STRLEN rest = out.size();
+      while (rest > 0) {
+        ssize_t size = ::write(fd, p, rest);
+        if (size < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return false;
+        }
+        p += size;
+        rest -= size;
+      }
+      return true;
+    }
+    
+    public:
+    
+    // columns is an array reference of Rstats::Vector. A matrix is given as a vector with ncol.
+    // row_names and col_names are Rstats::Vector of character or undef.
+    // options is a hash reference which has sep, eol, na, quote, qmethod, compress,
+    // row_numbers(row names are 1, 2, ...) and col_names_blank(header has a blank for row names).
+    TableWriter (SV* sv_columns, SV* sv_ncol, SV* sv_row_names, SV* sv_col_names, SV* sv_options)
+      : row_count(0), row_names(NULL), row_numbers(false), col_names(NULL), col_names_blank(false)
+    {
+      IV length = Rstats::PerlAPI::avrv_len_fix(sv_columns);
+      if (SvOK(sv_ncol)) {
+        Rstats::Vector* matrix = Rstats::PerlAPI::to_c_obj<Rstats::Vector*>(Rstats::PerlAPI::avrv_fetch_simple(sv_columns, 0));
+        IV ncol = SvIV(sv_ncol);
+        this->row_count = ncol > 0 ? matrix->get_length() / ncol : 0;
+        for (IV k = 0; k < ncol; k++) {
+          Column column = {matrix, k * this->row_count};
+          this->columns.push_back(column);
+        }
+      }
+      else {
+        for (IV k = 0; k < length; k++) {
+          Column column = {Rstats::PerlAPI::to_c_obj<Rstats::Vector*>(Rstats::PerlAPI::avrv_fetch_simple(sv_columns, k)), 0};
+          if (k == 0) {
+            this->row_count = column.vector->get_length();
+          }
+          else if (column.vector->get_length() != this->row_count) {
+            croak("columns must have the same length(Rstats::TableWriter::new())");
+          }
+          this->columns.push_back(column);
+        }
+      }
+      
+      if (SvOK(sv_row_names)) {
+        this->row_names = Rstats::PerlAPI::to_c_obj<Rstats::Vector*>(sv_row_names);
+        if (this->row_names->get_type() != Rstats::VectorType::CHARACTER || this->row_names->get_length() != this->row_count) {
+          croak("invalid 'row.names' argument(Rstats::TableWriter::new())");
+        }
+      }
+      if (SvOK(sv_col_names)) {
+        this->col_names = Rstats::PerlAPI::to_c_obj<Rstats::Vector*>(sv_col_names);
+        if (this->col_names->get_type() != Rstats::VectorType::CHARACTER
+          || this->col_names->get_length() != (IV)this->columns.size())
+        {
+          croak("invalid 'col.names' argument(Rstats::TableWriter::new())");
+        }
+      }
+      
+      if (SvOK(sv_options)) {
+        SV* sv_sep = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "sep");
+        if (SvOK(sv_sep)) {
+          this->options.sep = SvPV_nolen(sv_sep);
+        }
+        SV* sv_eol = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "eol");
+        if (SvOK(sv_eol)) {
+          this->options.eol = SvPV_nolen(sv_eol);
+        }
+        SV* sv_na = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "na");
+        if (SvOK(sv_na)) {
+          this->options.na = SvPV_nolen(sv_na);
+        }
+        SV* sv_quote = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "quote");
+        if (SvOK(sv_quote)) {
+          this->options.quote = SvTRUE(sv_quote);
+        }
+        SV* sv_qmethod = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "qmethod");
+        if (SvOK(sv_qmethod)) {
+          std::string qmethod = SvPV_nolen(sv_qmethod);
+          if (qmethod == "double") {
+            this->options.double_quote = true;
+          }
+          else if (qmethod != "escape") {
+            croak("invalid 'qmethod' argument(Rstats::TableWriter::new())");
+          }
+        }
+        SV* sv_compress = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "compress");
+        this->options.gzip = SvTRUE(sv_compress);
+#ifndef RSTATS_HAVE_ZLIB
+        if (this->options.gzip) {
+          croak("gzip compression is not supported. Rstats is built without zlib library(Rstats::TableWriter::new())");
+        }
+#endif
+        SV* sv_row_numbers = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "row_numbers");
+        this->row_numbers = SvTRUE(sv_row_numbers) && this->row_names == NULL;
+        SV* sv_col_names_blank = Rstats::PerlAPI::hvrv_fetch_simple(sv_options, "col_names_blank");
+        this->col_names_blank = SvTRUE(sv_col_names_blank) && (this->row_names != NULL || this->row_numbers);
+      }
+    }
+    
+    // Write the table into file. Return false and set error if the file can't be written.
+    bool write (const char* file, std::string& error) {
+      int fd = ::open(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0) {
+        error = std::string("cannot open file '") + file + "': " + strerror(errno);
+        return false;
+      }
+      
+      // The header is a gzip member by itself, so an empty table is also a valid gzip file
+      std::string header;
+      this->format_header(header);
+      bool ok = true;
+      if (this->options.gzip) {
+        std::string out;
+        ok = deflate_gzip(header, out);
+        if (!ok) {
+          error = "can't compress data";
+        }
+        header.swap(out);
+      }
+      if (ok && !write_all(fd, header)) {
+        error = std::string("cannot write file '") + file + "': " + strerror(errno);
+        ok = false;
+      }
+      
+      IV block_count = Rstats::ThreadPool::get_thread_count() * 4;
+      std::vector<std::string> texts(block_count);
+      std::vector<std::string> outs(block_count);
+      // Not vector<bool>, whose elements share words, because blocks are compressed in threads
+      std::vector<char> compressed(block_count, 1);
+      for (IV batch_begin = 0; ok && batch_begin < this->row_count; batch_begin += block_count * RSTATS_WRITER_BLOCK_ROWS) {
+        IV batch_end = batch_begin + block_count * RSTATS_WRITER_BLOCK_ROWS;
+        if (batch_end > this->row_count) {
+          batch_end = this->row_count;
+        }
+        IV batch_block_count = (batch_end - batch_begin + RSTATS_WRITER_BLOCK_ROWS - 1) / RSTATS_WRITER_BLOCK_ROWS;
+        
+        if (this->row_names != NULL) {
+          collect_views(this->row_names, batch_begin, batch_end, this->row_name_views);
+        }
+        for (size_t k = 0; k < this->columns.size(); k++) {
+          Column& column = this->columns[k];
+          if (column.vector->get_type() == Rstats::VectorType::CHARACTER) {
+            collect_views(column.vector, column.offset + batch_begin, column.offset + batch_end, column.views);
+          }
+        }
+        
+        Rstats::ThreadPool::parallel_for(
+          batch_block_count,
+          [this, &texts, &outs, &compressed, batch_begin, batch_end] (IV begin, IV end) {
+            for (IV b = begin; b < end; b++) {
+              IV row_begin = batch_begin + b * RSTATS_WRITER_BLOCK_ROWS;
+              IV row_end = row_begin + RSTATS_WRITER_BLOCK_ROWS < batch_end ? row_begin + RSTATS_WRITER_BLOCK_ROWS : batch_end;
+              texts[b].clear();
+              this->format_rows(texts[b], batch_begin, row_begin, row_end);
+              if (this->options.gzip) {
+                compressed[b] = deflate_gzip(texts[b], outs[b]);
+              }
+            }
+          },
+          1
+        );
+        
+        for (IV b = 0; b < batch_block_count; b++) {
+          if (this->options.gzip && !compressed[b]) {
+            error = "can't compress data";
+            ok = false;
+            break;
+          }
+          if (!write_all(fd, this->options.gzip ? outs[b] : texts[b])) {
+            error = std::string("cannot write file '") + file + "': " + strerror(errno);
+            ok = false;
+            break;
+          }
+        }
+      }
+      
+      if (::close(fd) != 0 && ok) {
+        error = std::string("cannot write file '") + file + "': " + strerror(errno);
+        ok = false;
+      }
+      
+      return ok;
+    }
+  };
+  
+  // Rstats::BinaryFile - binary file of vectors. Values, strings and NA bitmaps are stored
+  // in native layout and aligned to 64 bytes, so vectors are loaded as views of the mapped file.
+  class BinaryFile {
+    private:
+    
+    struct Header {
+      char magic[8];
+      U32 version;
+      U32 byte_order;
+      U32 iv_size;
+      U32 nv_size;
+      U64 vector_count;
+      U64 table_offset;
+      U64 meta_offset;
+      U64 meta_size;
+      char reserved[8];
+    };
+    
+    // Offsets of buffers of a vector. NA bitmap has a bit for each element.
+    struct Entry {
+      U32 type;
+      U32 utf8;
+      U64 length;
+      U64 values_offset;
+      U64 strings_offset;
+      U64 strings_size;
+      U64 na_offset;
+      U64 na_count;
+      char reserved[8];
+    };
+    
+    static void write_vector (Rstats::FileWriter& writer, Rstats::Vector* vector, Entry& entry) {
+      memset(&entry, 0, sizeof(entry));
+      IV length = vector->get_length();
+      entry.type = vector->get_type();
+      entry.length = length;
+      
+      if (vector->get_type() == Rstats::VectorType::CHARACTER) {
+        // Strings are stored in an arena with references. Latin-1 strings are upgraded if UTF-8 strings are mixed.
+        bool utf8 = false;
+        for (IV i = 0; i < length && !utf8; i++) {
+          utf8 = !vector->exists_na_position(i) && vector->is_character_utf8(i);
+        }
+        std::vector<StringRef> refs(length);
+        std::string strings;
+        std::string upgraded;
+        for (IV i = 0; i < length; i++) {
+          const char* str = vector->get_character_ptr(i);
+          STRLEN str_length = vector->get_character_length(i);
+          if (utf8 && !vector->is_character_utf8(i) && !Rstats::Util::is_ascii(str, str_length)) {
+            Rstats::Util::latin1_to_utf8(str, str_length, upgraded);
+            str = upgraded.data();
+            str_length = upgraded.size();
+          }
+          refs[i].offset = strings.size();
+          refs[i].length = str_length;
+          strings.append(str, str_length);
+        }
+        entry.utf8 = utf8;
+        
+        writer.align(RSTATS_BINARY_ALIGNMENT);
+        entry.values_offset = writer.write(refs.data(), length * sizeof(StringRef));
+        writer.align(RSTATS_BINARY_ALIGNMENT);
+        entry.strings_offset = writer.write(strings.data(), strings.size());
+        entry.strings_size = strings.size();
+      }
+      else {
+        writer.align(RSTATS_BINARY_ALIGNMENT);
+        entry.values_offset = writer.write(length ? vector->get_buffer() : "", vector->get_buffer_size());
+      }
+      
+      const std::map<IV, IV>& na_positions = vector->get_na_positions();
+      if (!na_positions.empty()) {
+        std::vector<U64> bitmap((length + 63) / 64, 0);
+        for (std::map<IV, IV>::const_iterator it = na_positions.begin(); it != na_positions.end(); ++it) {
+          bitmap[it->first / 64] |= (U64)1 << (it->first % 64);
+        }
+        writer.align(RSTATS_BINARY_ALIGNMENT);
+        entry.na_offset = writer.write(bitmap.data(), bitmap.size() * sizeof(U64));
+        entry.na_count = na_positions.size();
+      }
+    }
+    
+    static void init_header (Header& header) {
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, "RSTATSB", 8);
+      header.version = 2;
+      header.byte_order = 0x01020304;
+      header.iv_size = sizeof(IV);
+      header.nv_size = sizeof(NV);
+    }
+    
+    public:
+    
+    // Save vectors and meta data(attributes serialized by Perl) into file.
+    // Return false and set error if the file can't be written.
+    static bool save (const char* file, std::vector<Rstats::Vector*>& vectors, const char* meta, STRLEN meta_size, std::string& error) {
+      int fd = ::open(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0) {
+        error = std::string("cannot open file '") + file + "': " + strerror(errno);
+        return false;
+      }
+      
+      Header header;
+      init_header(header);
+      Rstats::FileWriter writer(fd);
+      writer.write(&header, sizeof(header));
+      
+      std::vector<Entry> entries(vectors.size());
+      for (size_t i = 0; i < vectors.size(); i++) {
+        write_vector(writer, vectors[i], entries[i]);
+      }
+      writer.align(RSTATS_BINARY_ALIGNMENT);
+      header.vector_count = entries.size();
+      header.table_offset = writer.write(entries.data(), entries.size() * sizeof(Entry));
+      header.meta_offset = writer.write(meta, meta_size);
+      header.meta_size = meta_size;
+      writer.flush();
+      
+      bool ok = writer.ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+      if (::close(fd) != 0) {
+        ok = false;
+      }
+      if (!ok) {
+        error = std::string("cannot write file '") + file + "': " + strerror(errno);
+      }
+      
+      return ok;
+    }
+    
+    // Load vectors as views of the mapped file. Return false and set error if the file is broken.
+    static bool load (const char* file, std::vector<Rstats::Vector*>& vectors, std::string& meta, std::string& error) {
+      Rstats::MappedFile* mapped_file = Rstats::MappedFile::open(file, error);
+      if (mapped_file == NULL) {
+        return false;
+      }
+      
+      const char* data = mapped_file->get_data();
+      U64 size = mapped_file->get_size();
+      Header expected;
+      init_header(expected);
+      const Header* header = (const Header*)data;
+      bool ok = size >= sizeof(Header)
+        && memcmp(header->magic, expected.magic, sizeof(expected.magic)) == 0
+        && header->version == expected.version
+        && header->byte_order == expected.byte_order
+        && header->iv_size == expected.iv_size
+        && header->nv_size == expected.nv_size
+        && header->table_offset % RSTATS_BINARY_ALIGNMENT == 0
+        && header->vector_count <= size / sizeof(Entry)
+        && header->table_offset <= size - header->vector_count * sizeof(Entry)
+        && header->meta_offset <= size
+        && header->meta_size <= size - header->meta_offset;
+      
+      const Entry* entries = ok ? (const Entry*)(data + header->table_offset) : NULL;
+      for (U64 i = 0; ok && i < header->vector_count; i++) {
+        const Entry& entry = entries[i];
+        Rstats::VectorType::Enum type = (Rstats::VectorType::Enum)entry.type;
+        STRLEN element_size;
+        switch (type) {
+          case Rstats::VectorType::CHARACTER :
+            element_size = sizeof(StringRef);
+            break;
+          case Rstats::VectorType::COMPLEX :
+            element_size = sizeof(std::complex<NV>);
+            break;
+          case Rstats::VectorType::DOUBLE :
+            element_size = sizeof(NV);
+            break;
+          case Rstats::VectorType::INTEGER :
+          case Rstats::VectorType::LOGICAL :
+            element_size = sizeof(IV);
+            break;
+          default :
+            ok = false;
+            continue;
+        }
+        U64 na_size = (entry.length + 63) / 64 * sizeof(U64);
+        ok = entry.length <= size / element_size
+          && entry.values_offset % RSTATS_BINARY_ALIGNMENT == 0
+          && entry.values_offset <= size - entry.length * element_size
+          && entry.strings_offset <= size
+          && entry.strings_size <= size - entry.strings_offset
+          && (entry.na_count == 0 || (entry.na_offset % RSTATS_BINARY_ALIGNMENT == 0 && entry.na_offset <= size - na_size));
+        if (!ok) {
+          break;
+        }
+        
+        // References of strings must be in the arena
+        if (type == Rstats::VectorType::CHARACTER) {
+          const StringRef* refs = (const StringRef*)(data + entry.values_offset);
+          for (U64 k = 0; k < entry.length && ok; k++) {
+            ok = refs[k].offset <= entry.strings_size && refs[k].length <= entry.strings_size - refs[k].offset;
+          }
+          if (!ok) {
+            break;
+          }
+        }
+        
+        Rstats::Vector* vector = Rstats::Vector::new_mapped(
+          type, entry.length, mapped_file, entry.values_offset, entry.strings_offset, entry.strings_size, entry.utf8
+        );
+        if (entry.na_count > 0) {
+          const U64* bitmap = (const U64*)(data + entry.na_offset);
+          for (U64 w = 0; w < (entry.length + 63) / 64; w++) {
+            U64 word = bitmap[w];
+            while (word) {
+              IV bit = __builtin_ctzll(word);
+              if ((IV)(w * 64 + bit) < (IV)entry.length) {
+                vector->add_na_position(w * 64 + bit);
+              }
+              word &= word - 1;
+            }
+          }
+        }
+        vectors.push_back(vector);
+      }
+      
+      if (ok) {
+        meta.assign(data + header->meta_offset, header->meta_size);
+      }
+      else {
+        for (size_t i = 0; i < vectors.size(); i++) {
+          vectors[i]->dec_refcnt();
+        }
+        vectors.clear();
+        error = std::string("broken binary file '") + file + "'";
+      }
+      mapped_file->dec_refcnt();
+      
+      return ok;
+    }
+  };
+  
+  // Rstats::ArrowFile - Apache Arrow IPC file of data frame columns. Flatbuffers metadata is read and built
+  // here without the Arrow library. 64 bit integer and double buffers(and strings) of a single record batch
+  // are loaded as views of the mapped file.
+  class ArrowFile {
+    public:
+    
+    // Column of data frame. Factor has levels, which are written as a dictionary.
+    struct Column {
+      std::string name;
+      Rstats::Vector* vector;
+      Rstats::Vector* levels;
+      bool ordered;
+      
+      Column () : vector(NULL), levels(NULL), ordered(false) {}
+    };
+    
+    private:
+    
+    // Ids of Type union, MessageHeader union and MetadataVersion(V5)
+    enum {
+      TYPE_INT = 2,
+      TYPE_FLOATING_POINT = 3,
+      TYPE_UTF8 = 5,
+      TYPE_BOOL = 6,
+      TYPE_LARGE_UTF8 = 20
+    };
+    enum {
+      HEADER_SCHEMA = 1,
+      HEADER_DICTIONARY_BATCH = 2,
+      HEADER_RECORD_BATCH = 3
+    };
+    enum {
+      METADATA_VERSION = 4
+    };
+    
+    // Field of schema. Dictionary encoded field has the type of values and the bit width of indices.
+    struct Field {
+      std::string name;
+      U8 type;
+      IV bit_width;
+      bool is_signed;
+      I64 dictionary_id;
+      IV index_bit_width;
+      bool index_signed;
+      bool ordered;
+      
+      Field () : type(0), bit_width(0), is_signed(false), dictionary_id(-1), index_bit_width(0), index_signed(false), ordered(false) {}
+    };
+    
+    struct Node {
+      I64 length;
+      I64 null_count;
+    };
+    
+    // Offsets are absolute in read files, and relative to the body in written files
+    struct Buffer {
+      U64 offset;
+      U64 length;
+    };
+    
+    // Block struct of footer
+    struct Block {
+      I64 offset;
+      I32 metadata_length;
+      I32 padding;
+      I64 body_length;
+    };
+    
+    // Record batch, or data of dictionary batch
+    struct Batch {
+      I64 length;
+      std::vector<Node> nodes;
+      std::vector<Buffer> buffers;
+      I64 dictionary_id;
+      bool delta;
+      
+      Batch () : length(0), dictionary_id(-1), delta(false) {}
+    };
+    
+    // Node and buffers of a column in a record batch
+    struct Part {
+      Node node;
+      Buffer buffers[3];
+    };
+    
+    // Buffers of a written record batch. Data of buffers must live until the body is written.
+    struct Body {
+      std::vector<Node> nodes;
+      std::vector<Buffer> buffers;
+      std::vector<const char*> pieces;
+      std::deque<std::string> storage;
+      U64 size;
+      
+      Body () : size(0) {}
+      
+      void add_node (I64 length, I64 null_count) {
+        Node node = {length, null_count};
+        this->nodes.push_back(node);
+      }
+      
+      // Buffers are padded in the body
+      void add_buffer (const char* data, U64 length) {
+        Buffer buffer = {this->size, length};
+        this->buffers.push_back(buffer);
+        this->pieces.push_back(length ? data : "");
+        this->size += (length + RSTATS_ARROW_ALIGNMENT - 1) / RSTATS_ARROW_ALIGNMENT * RSTATS_ARROW_ALIGNMENT;
+      }
+      
+      // Data is moved into the body
+      void add_buffer (std::string& data) {
+        this->storage.push_back(std::string());
+        this->storage.back().swap(data);
+        this->add_buffer(this->storage.back().data(), this->storage.back().size());
+      }
+    };
+    
+    // Reader of flatbuffers. Reads out of the buffer return 0 and make ok false.
+    // Position 0 is the root offset, so 0 is used as the position of absent tables.
+    class FlatReader {
+      private:
+      const char* data;
+      U64 size;
+      
+      public:
+      bool ok;
+      
+      FlatReader (const char* data, U64 size) : data(data), size(size), ok(true) {}
+      
+      template <class T> T get (U64 pos) {
+        T value;
+        if (pos <= this->size && sizeof(T) <= this->size - pos) {
+          memcpy(&value, this->data + pos, sizeof(T));
+        }
+        else {
+          memset(&value, 0, sizeof(T));
+          this->ok = false;
+        }
+        return value;
+      }
+      
+      // Target of the offset at pos
+      U64 deref (U64 pos) {
+        U32 offset = this->get<U32>(pos);
+        return this->ok ? pos + offset : 0;
+      }
+      
+      U64 root () {
+        return this->deref(0);
+      }
+      
+      // Position of the field of the table, or 0 if the field is absent
+      U64 field (U64 table, IV index) {
+        if (table == 0) {
+          return 0;
+        }
+        U64 vtable = table - (U64)(I64)this->get<I32>(table);
+        U16 vtable_size = this->get<U16>(vtable);
+        if (!this->ok || 4 + 2 * (U64)index + 2 > vtable_size) {
+          return 0;
+        }
+        U16 offset = this->get<U16>(vtable + 4 + 2 * index);
+        return offset ? table + offset : 0;
+      }
+      
+      template <class T> T scalar (U64 table, IV index, T default_value) {
+        U64 pos = this->field(table, index);
+        return pos ? this->get<T>(pos) : default_value;
+      }
+      
+      U64 table (U64 table, IV index) {
+        U64 pos = this->field(table, index);
+        return pos ? this->deref(pos) : 0;
+      }
+      
+      // Position of the first element of the vector. length is set to the element count.
+      U64 vector (U64 table, IV index, U64 element_size, U64& length) {
+        U64 pos = this->table(table, index);
+        length = pos ? this->get<U32>(pos) : 0;
+        if (length > 0 && (pos + 4 > this->size || length > (this->size - pos - 4) / element_size)) {
+          this->ok = false;
+          length = 0;
+        }
+        return pos + 4;
+      }
+      
+      std::string string (U64 table, IV index) {
+        U64 length;
+        U64 pos = this->vector(table, index, 1, length);
+        return std::string(length ? this->data + pos : "", length);
+      }
+    };
+    
+    // Builder of flatbuffers from front to back. Children are put after their parents and linked by offsets.
+    struct FlatBuilder {
+      std::string data;
+      
+      void pad (STRLEN alignment) {
+        this->data.append((alignment - this->data.size() % alignment) % alignment, '\0');
+      }
+      
+      template <class T> STRLEN put (T value) {
+        STRLEN pos = this->data.size();
+        this->data.append((const char*)&value, sizeof(T));
+        return pos;
+      }
+      
+      template <class T> void set (STRLEN pos, T value) {
+        memcpy(&this->data[pos], &value, sizeof(T));
+      }
+      
+      void link (STRLEN pos, STRLEN target) {
+        this->set<U32>(pos, target - pos);
+      }
+      
+      // Table with fields of the sizes(0 is absent). Positions of fields are set to fields.
+      // Fields are zero filled and placed from the largest, so they are aligned.
+      STRLEN table (const std::vector<STRLEN>& sizes, std::vector<STRLEN>& fields) {
+        this->pad(2);
+        STRLEN vtable = this->put<U16>(4 + 2 * sizes.size());
+        this->put<U16>(0);
+        for (size_t i = 0; i < sizes.size(); i++) {
+          this->put<U16>(0);
+        }
+        this->pad(8);
+        STRLEN table = this->put<I32>(0);
+        this->set<I32>(table, table - vtable);
+        
+        fields.assign(sizes.size(), 0);
+        for (STRLEN size = 8; size >= 1; size /= 2) {
+          for (size_t i = 0; i < sizes.size(); i++) {
+            if (sizes[i] == size) {
+              this->pad(size);
+              fields[i] = this->data.size();
+              this->data.append(size, '\0');
+              this->set<U16>(vtable + 4 + 2 * i, fields[i] - table);
+            }
+          }
+        }
+        this->set<U16>(vtable + 2, this->data.size() - table);
+        
+        return table;
+      }
+      
+      // Vector of zero filled elements. Elements follow the length and are aligned up to 8 bytes.
+      STRLEN vector (STRLEN count, STRLEN element_size) {
+        STRLEN alignment = element_size >= 8 ? 8 : 4;
+        while ((this->data.size() + 4) % alignment != 0) {
+          this->data.push_back('\0');
+        }
+        STRLEN vector = this->put<U32>(count);
+        this->data.append(count * element_size, '\0');
+        
+        return vector;
+      }
+      
+      STRLEN string (const std::string& str) {
+        this->pad(4);
+        STRLEN string = this->put<U32>(str.size());
+        this->data.append(str);
+        this->data.push_back('\0');
+        
+        return string;
+      }
+    };
+    
+    static const char* get_type_name (U8 type) {
+      static const char* const names[] = {
+        "NONE", "Null", "Int", "FloatingPoint", "Binary", "Utf8", "Bool", "Decimal", "Date", "Time",
+        "Timestamp", "Interval", "List", "Struct_", "Union", "FixedSizeBinary", "FixedSizeList", "Map",
+        "Duration", "LargeBinary", "LargeUtf8", "LargeList", "RunEndEncoded", "BinaryView", "Utf8View",
+        "ListView", "LargeListView"
+      };
+      return type < sizeof(names) / sizeof(names[0]) ? names[type] : "unknown";
+    }
+    
+    static bool is_integer_bit_width (IV bit_width) {
+      return bit_width == 8 || bit_width == 16 || bit_width == 32 || bit_width == 64;
+    }
+    
+    // Return false and set error if the type of the field is not supported
+    static bool read_field (FlatReader& reader, U64 table, Field& field, std::string& error) {
+      field.name = reader.string(table, 0);
+      field.type = reader.scalar<U8>(table, 2, 0);
+      U64 type = reader.table(table, 3);
+      bool ok;
+      switch (field.type) {
+        case TYPE_INT :
+          field.bit_width = reader.scalar<I32>(type, 0, 0);
+          field.is_signed = reader.scalar<U8>(type, 1, 0);
+          ok = is_integer_bit_width(field.bit_width);
+          break;
+        case TYPE_FLOATING_POINT : {
+          // HALF, SINGLE, DOUBLE
+          I16 precision = reader.scalar<I16>(type, 0, 0);
+          field.bit_width = precision == 1 ? 32 : precision == 2 ? 64 : 16;
+          ok = field.bit_width != 16;
+          break;
+        }
+        case TYPE_UTF8 :
+        case TYPE_LARGE_UTF8 :
+        case TYPE_BOOL :
+          ok = true;
+          break;
+        default :
+          ok = false;
+      }
+      U64 child_count;
+      reader.vector(table, 5, 4, child_count);
+      if (!ok || child_count > 0) {
+        error = std::string("arrow type '") + get_type_name(field.type) + "' of column '" + field.name + "' is not supported";
+        return false;
+      }
+      
+      // Indices are int32 if the type is absent
+      U64 dictionary = reader.table(table, 4);
+      if (dictionary) {
+        field.dictionary_id = reader.scalar<I64>(dictionary, 0, 0);
+        U64 index_type = reader.table(dictionary, 1);
+        field.index_bit_width = index_type ? reader.scalar<I32>(index_type, 0, 0) : 32;
+        field.index_signed = index_type ? reader.scalar<U8>(index_type, 1, 0) : true;
+        field.ordered = reader.scalar<U8>(dictionary, 2, 0);
+        if (!(field.type == TYPE_UTF8 || field.type == TYPE_LARGE_UTF8) || !is_integer_bit_width(field.index_bit_width)) {
+          error = std::string("arrow dictionary of type '") + get_type_name(field.type) + "' of column '" + field.name + "' is not supported";
+          return false;
+        }
+      }
+      
+      return true;
+    }
+    
+    // Read the message of the block in footer. Buffers are checked to be in the body, and made absolute.
+    // Return false(and set error if the message is not supported) if the message is broken.
+    static bool read_message (const char* data, U64 size, FlatReader& footer, U64 block, U8 header_type, Batch& batch, std::string& error) {
+      I64 offset = footer.get<I64>(block);
+      I32 metadata_length = footer.get<I32>(block + 8);
+      I64 body_length = footer.get<I64>(block + 16);
+      if (!footer.ok || offset < 0 || metadata_length < 8 || body_length < 0
+        || (U64)offset > size || (U64)metadata_length > size - offset || (U64)body_length > size - offset - metadata_length)
+      {
+        return false;
+      }
+      
+      // Metadata follows the continuation marker and the size(or only the size in old files)
+      FlatReader prefix(data + offset, metadata_length);
+      U64 flat_offset = 8;
+      U64 flat_size = prefix.get<U32>(4);
+      if (prefix.get<U32>(0) != 0xFFFFFFFF) {
+        flat_offset = 4;
+        flat_size = prefix.get<U32>(0);
+      }
+      if (flat_size > (U64)metadata_length - flat_offset) {
+        return false;
+      }
+      
+      FlatReader reader(data + offset + flat_offset, flat_size);
+      U64 message = reader.root();
+      if (reader.scalar<I16>(message, 0, 0) < 3 || reader.scalar<U8>(message, 1, 0) != header_type) {
+        return false;
+      }
+      U64 header = reader.table(message, 2);
+      U64 record_batch = header;
+      if (header_type == HEADER_DICTIONARY_BATCH) {
+        batch.dictionary_id = reader.scalar<I64>(header, 0, 0);
+        record_batch = reader.table(header, 1);
+        batch.delta = reader.scalar<U8>(header, 2, 0);
+      }
+      if (reader.table(record_batch, 3)) {
+        error = "compressed arrow record batch is not supported";
+        return false;
+      }
+      
+      batch.length = reader.scalar<I64>(record_batch, 0, 0);
+      U64 node_count;
+      U64 nodes = reader.vector(record_batch, 1, sizeof(Node), node_count);
+      for (U64 i = 0; i < node_count; i++) {
+        Node node;
+        node.length = reader.get<I64>(nodes + i * sizeof(Node));
+        node.null_count = reader.get<I64>(nodes + i * sizeof(Node) + 8);
+        batch.nodes.push_back(node);
+      }
+      U64 buffer_count;
+      U64 buffers = reader.vector(record_batch, 2, sizeof(Buffer), buffer_count);
+      for (U64 i = 0; i < buffer_count; i++) {
+        Buffer buffer;
+        buffer.offset = reader.get<I64>(buffers + i * sizeof(Buffer));
+        buffer.length = reader.get<I64>(buffers + i * sizeof(Buffer) + 8);
+        if (buffer.offset > (U64)body_length || buffer.length > (U64)body_length - buffer.offset) {
+          return false;
+        }
+        buffer.offset += offset + metadata_length;
+        batch.buffers.push_back(buffer);
+      }
+      
+      return reader.ok && record_batch != 0 && batch.length >= 0;
+    }
+    
+    template <class T> static T load (const char* values, I64 pos) {
+      T value;
+      memcpy(&value, values + pos * sizeof(T), sizeof(T));
+      return value;
+    }
+    
+    template <class T, class R> static void convert (const char* values, I64 length, R* out) {
+      for (I64 i = 0; i < length; i++) {
+        out[i] = (R)load<T>(values, i);
+      }
+    }
+    
+    static void convert_integers (const char* values, IV bit_width, bool is_signed, I64 length, IV* out) {
+      switch (bit_width) {
+        case 8 :
+          is_signed ? convert<I8>(values, length, out) : convert<U8>(values, length, out);
+          break;
+        case 16 :
+          is_signed ? convert<I16>(values, length, out) : convert<U16>(values, length, out);
+          break;
+        case 32 :
+          is_signed ? convert<I32>(values, length, out) : convert<U32>(values, length, out);
+          break;
+        default :
+          convert<I64>(values, length, out);
+      }
+    }
+    
+    // Buffers of the part must be long enough for the type
+    static bool check_part (const char* data, const Field& field, const Part& part) {
+      U64 length = part.node.length;
+      if (part.node.length < 0 || part.node.null_count < 0
+        || (part.node.null_count > 0 && part.buffers[0].length < (length + 7) / 8))
+      {
+        return false;
+      }
+      if (field.dictionary_id >= 0) {
+        return part.buffers[1].length / (field.index_bit_width / 8) >= length;
+      }
+      
+      switch (field.type) {
+        case TYPE_INT :
+        case TYPE_FLOATING_POINT :
+          return part.buffers[1].length / (field.bit_width / 8) >= length;
+        case TYPE_BOOL :
+          return part.buffers[1].length >= (length + 7) / 8;
+        default : {
+          // Offsets must be ascending in the data
+          bool large = field.type == TYPE_LARGE_UTF8;
+          STRLEN offset_size = large ? 8 : 4;
+          if (part.buffers[1].length / offset_size < length + 1) {
+            return false;
+          }
+          const char* offsets = data + part.buffers[1].offset;
+          I64 previous = 0;
+          for (U64 i = 0; i <= length; i++) {
+            I64 offset = large ? load<I64>(offsets, i) : load<I32>(offsets, i);
+            if (offset < previous || (U64)offset > part.buffers[2].length) {
+              return false;
+            }
+            previous = offset;
+          }
+          return true;
+        }
+      }
+    }
+    
+    // Validity bitmap to NA positions
+    static void read_validity (const char* data, const Part& part, Rstats::Vector* vector, IV start) {
+      if (part.node.null_count == 0) {
+        return;
+      }
+      const U8* bits = (const U8*)(data + part.buffers[0].offset);
+      for (I64 b = 0; b < (part.node.length + 7) / 8; b++) {
+        if (bits[b] == 0xFF) {
+          continue;
+        }
+        for (IV bit = 0; bit < 8 && b * 8 + bit < part.node.length; bit++) {
+          if (!((bits[b] >> bit) & 1)) {
+            vector->add_na_position(start + b * 8 + bit);
+          }
+        }
+      }
+    }
+    
+    // Vector of the field in the parts of record batches. Integer and double values of a single part,
+    // and strings of a single part are views of the mapped file. Dictionary indices become factor codes.
+    // Return NULL if the buffers are broken.
+    static Rstats::Vector* read_column (Rstats::MappedFile* mapped_file, const Field& field, std::vector<Part>& parts, IV level_count) {
+      const char* data = mapped_file->get_data();
+      IV length = 0;
+      for (size_t p = 0; p < parts.size(); p++) {
+        if (!check_part(data, field, parts[p])) {
+          return NULL;
+        }
+        length += parts[p].node.length;
+      }
+      bool single = parts.size() == 1;
+      U64 values_offset = single ? parts[0].buffers[1].offset : 0;
+      
+      Rstats::Vector* vector;
+      if (field.dictionary_id >= 0) {
+        vector = Rstats::Vector::new_integer(length);
+      }
+      else if (field.type == TYPE_INT && field.bit_width == 64 && !field.is_signed) {
+        vector = Rstats::Vector::new_double(length);
+      }
+      else if (field.type == TYPE_INT || field.type == TYPE_FLOATING_POINT) {
+        Rstats::VectorType::Enum type = field.type == TYPE_INT ? Rstats::VectorType::INTEGER : Rstats::VectorType::DOUBLE;
+        if (single && field.bit_width == 64 && sizeof(IV) == 8 && values_offset % 8 == 0) {
+          vector = Rstats::Vector::new_mapped(type, length, mapped_file, values_offset, 0, 0, false);
+        }
+        else {
+          vector = type == Rstats::VectorType::INTEGER ? Rstats::Vector::new_integer(length) : Rstats::Vector::new_double(length);
+        }
+      }
+      else if (field.type == TYPE_BOOL) {
+        vector = Rstats::Vector::new_logical(length);
+      }
+      else if (single) {
+        Buffer& strings = parts[0].buffers[2];
+        bool utf8 = !Rstats::Util::is_ascii(data + strings.offset, strings.length);
+        vector = Rstats::Vector::new_mapped_strings(length, mapped_file, strings.offset, strings.length, utf8);
+      }
+      else {
+        vector = Rstats::Vector::new_character(length);
+      }
+      
+      IV start = 0;
+      bool ok = true;
+      for (size_t p = 0; p < parts.size(); p++) {
+        Part& part = parts[p];
+        const char* values = data + part.buffers[1].offset;
+        I64 part_length = part.node.length;
+        if (field.dictionary_id >= 0) {
+          // Indices of null elements can be any value
+          IV* codes = vector->get_integer_values() + start;
+          convert_integers(values, field.index_bit_width, field.index_signed, part_length, codes);
+          read_validity(data, part, vector, start);
+          for (I64 i = 0; i < part_length; i++) {
+            if (codes[i] >= 0 && codes[i] < level_count) {
+              codes[i]++;
+            }
+            else if (vector->exists_na_position(start + i)) {
+              codes[i] = 0;
+            }
+            else {
+              ok = false;
+            }
+          }
+        }
+        else if (field.type == TYPE_INT) {
+          if (vector->get_type() == Rstats::VectorType::DOUBLE) {
+            convert<U64>(values, part_length, vector->get_double_values() + start);
+          }
+          else if (!(single && field.bit_width == 64 && vector->get_integer_values() == (IV*)values)) {
+            convert_integers(values, field.bit_width, field.is_signed, part_length, vector->get_integer_values() + start);
+          }
+        }
+        else if (field.type == TYPE_FLOATING_POINT) {
+          if (field.bit_width == 32) {
+            convert<float>(values, part_length, vector->get_double_values() + start);
+          }
+          else if (vector->get_double_values() != (NV*)values) {
+            convert<double>(values, part_length, vector->get_double_values() + start);
+          }
+        }
+        else if (field.type == TYPE_BOOL) {
+          IV* logicals = vector->get_integer_values() + start;
+          for (I64 i = 0; i < part_length; i++) {
+            logicals[i] = (values[i / 8] >> (i % 8)) & 1;
+          }
+        }
+        else {
+          bool large = field.type == TYPE_LARGE_UTF8;
+          const char* strings = data + part.buffers[2].offset;
+          if (single) {
+            StringRef* refs = vector->get_character_values();
+            for (I64 i = 0; i < part_length; i++) {
+              I64 begin = large ? load<I64>(values, i) : load<I32>(values, i);
+              I64 end = large ? load<I64>(values, i + 1) : load<I32>(values, i + 1);
+              refs[i].offset = begin;
+              refs[i].length = end - begin;
+            }
+          }
+          else {
+            for (I64 i = 0; i < part_length; i++) {
+              I64 begin = large ? load<I64>(values, i) : load<I32>(values, i);
+              I64 end = large ? load<I64>(values, i + 1) : load<I32>(values, i + 1);
+              vector->set_character_value(start + i, strings + begin, end - begin, true);
+            }
+          }
+        }
+        if (field.dictionary_id < 0) {
+          read_validity(data, part, vector, start);
+        }
+        start += part_length;
+      }
+      
+      if (!ok) {
+        vector->dec_refcnt();
+        return NULL;
+      }
+      
+      return vector;
+    }
+    
+    // NA positions to validity bitmap. Bitmap is omitted if there is no NA.
+    static void add_validity (Body& body, Rstats::Vector* vector) {
+      IV length = vector->get_length();
+      const std::map<IV, IV>& na_positions = vector->get_na_positions();
+      body.add_node(length, na_positions.size());
+      if (na_positions.empty()) {
+        body.add_buffer(NULL, 0);
+        return;
+      }
+      
+      std::string validity((length + 7) / 8, (char)0xFF);
+      for (std::map<IV, IV>::const_iterator it = na_positions.begin(); it != na_positions.end(); ++it) {
+        validity[it->first / 8] &= ~(1 << (it->first % 8));
+      }
+      body.add_buffer(validity);
+    }
+    
+    // Offsets and UTF-8 bytes of character vector. Offsets are 64 bit(LargeUtf8) if bytes are over 32 bit offsets.
+    static U8 add_strings (Body& body, Rstats::Vector* vector) {
+      IV length = vector->get_length();
+      std::vector<I64> offsets(length + 1, 0);
+      std::string bytes;
+      std::string upgraded;
+      for (IV i = 0; i < length; i++) {
+        if (!vector->exists_na_position(i)) {
+          const char* str = vector->get_character_ptr(i);
+          STRLEN str_length = vector->get_character_length(i);
+          if (!vector->is_character_utf8(i) && !Rstats::Util::is_ascii(str, str_length)) {
+            Rstats::Util::latin1_to_utf8(str, str_length, upgraded);
+            str = upgraded.data();
+            str_length = upgraded.size();
+          }
+          bytes.append(str, str_length);
+        }
+        offsets[i + 1] = bytes.size();
+      }
+      
+      U8 type;
+      std::string offsets_buffer;
+      if (bytes.size() <= (STRLEN)I32_MAX) {
+        type = TYPE_UTF8;
+        offsets_buffer.resize((length + 1) * sizeof(I32));
+        for (IV i = 0; i <= length; i++) {
+          I32 offset = offsets[i];
+          memcpy(&offsets_buffer[i * sizeof(I32)], &offset, sizeof(I32));
+        }
+      }
+      else {
+        type = TYPE_LARGE_UTF8;
+        offsets_buffer.assign((const char*)offsets.data(), (length + 1) * sizeof(I64));
+      }
+      body.add_buffer(offsets_buffer);
+      body.add_buffer(bytes);
+      
+      return type;
+    }
+    
+    // Add buffers of the column to the body and set the type to the field
+    static bool add_column (Body& body, Field& field, Column& column, std::string& error) {
+      Rstats::Vector* vector = column.vector;
+      IV length = vector->get_length();
+      add_validity(body, vector);
+      
+      // Factor codes are int32 indices of the dictionary
+      if (column.levels != NULL) {
+        field.type = TYPE_UTF8;
+        field.index_bit_width = 32;
+        field.index_signed = true;
+        field.ordered = column.ordered;
+        IV level_count = column.levels->get_length();
+        std::string indices(length * sizeof(I32), '\0');
+        for (IV i = 0; i < length; i++) {
+          if (vector->exists_na_position(i)) {
+            continue;
+          }
+          IV code = vector->get_integer_value(i);
+          if (code < 1 || code > level_count) {
+            error = "invalid factor code of column '" + field.name + "'";
+            return false;
+          }
+          I32 index = code - 1;
+          memcpy(&indices[i * sizeof(I32)], &index, sizeof(I32));
+        }
+        body.add_buffer(indices);
+        return true;
+      }
+      
+      switch (vector->get_type()) {
+        case Rstats::VectorType::DOUBLE :
+          field.type = TYPE_FLOATING_POINT;
+          field.bit_width = 64;
+          body.add_buffer((const char*)vector->get_double_values(), length * sizeof(NV));
+          break;
+        case Rstats::VectorType::INTEGER :
+          field.type = TYPE_INT;
+          field.bit_width = 64;
+          field.is_signed = true;
+          if (sizeof(IV) == sizeof(I64)) {
+            body.add_buffer((const char*)vector->get_integer_values(), length * sizeof(IV));
+          }
+          else {
+            std::string values(length * sizeof(I64), '\0');
+            for (IV i = 0; i < length; i++) {
+              I64 value = vector->get_integer_value(i);
+              memcpy(&values[i * sizeof(I64)], &value, sizeof(I64));
+            }
+            body.add_buffer(values);
+          }
+          break;
+        case Rstats::VectorType::LOGICAL : {
+          field.type = TYPE_BOOL;
+          std::string bits((length + 7) / 8, '\0');
+          for (IV i = 0; i < length; i++) {
+            if (vector->get_integer_value(i)) {
+              bits[i / 8] |= 1 << (i % 8);
+            }
+          }
+          body.add_buffer(bits);
+          break;
+        }
+        case Rstats::VectorType::CHARACTER :
+          field.type = add_strings(body, vector);
+          break;
+        default :
+          error = "complex column '" + field.name + "' can't be written to arrow file";
+          return false;
+      }
+      
+      return true;
+    }
+    
+    static STRLEN build_type (FlatBuilder& builder, U8 type, IV bit_width, bool is_signed) {
+      std::vector<STRLEN> slots;
+      STRLEN table;
+      if (type == TYPE_INT) {
+        table = builder.table({4, 1}, slots);
+        builder.set<I32>(slots[0], bit_width);
+        builder.set<U8>(slots[1], is_signed);
+      }
+      else if (type == TYPE_FLOATING_POINT) {
+        table = builder.table({2}, slots);
+        builder.set<I16>(slots[0], bit_width == 32 ? 1 : 2);
+      }
+      else {
+        table = builder.table({}, slots);
+      }
+      
+      return table;
+    }
+    
+    static STRLEN build_schema (FlatBuilder& builder, const std::vector<Field>& fields) {
+      // Endianness is omitted(little endian)
+      std::vector<STRLEN> slots;
+      STRLEN schema = builder.table({0, 4}, slots);
+      STRLEN field_tables = builder.vector(fields.size(), 4);
+      builder.link(slots[1], field_tables);
+      
+      for (size_t i = 0; i < fields.size(); i++) {
+        const Field& field = fields[i];
+        bool dictionary = field.dictionary_id >= 0;
+        std::vector<STRLEN> field_slots;
+        STRLEN table = builder.table({4, 1, 1, 4, (STRLEN)(dictionary ? 4 : 0), 4}, field_slots);
+        builder.link(field_tables + 4 + 4 * i, table);
+        builder.link(field_slots[0], builder.string(field.name));
+        builder.set<U8>(field_slots[1], 1);
+        builder.set<U8>(field_slots[2], field.type);
+        builder.link(field_slots[3], build_type(builder, field.type, field.bit_width, field.is_signed));
+        if (dictionary) {
+          std::vector<STRLEN> dictionary_slots;
+          STRLEN dictionary_table = builder.table({8, 4, 1}, dictionary_slots);
+          builder.link(field_slots[4], dictionary_table);
+          builder.set<I64>(dictionary_slots[0], field.dictionary_id);
+          builder.link(dictionary_slots[1], build_type(builder, TYPE_INT, field.index_bit_width, field.index_signed));
+          builder.set<U8>(dictionary_slots[2], field.ordered);
+        }
+        builder.link(field_slots[5], builder.vector(0, 4));
+      }
+      
+      return schema;
+    }
+    
+    // Message table. Position of the header field is returned to link the header.
+    static STRLEN build_message (FlatBuilder& builder, U8 header_type, U64 body_length) {
+      STRLEN root = builder.put<U32>(0);
+      std::vector<STRLEN> slots;
+      STRLEN message = builder.table({2, 1, 4, 8}, slots);
+      builder.link(root, message);
+      builder.set<I16>(slots[0], METADATA_VERSION);
+      builder.set<U8>(slots[1], header_type);
+      builder.set<I64>(slots[3], body_length);
+      
+      return slots[2];
+    }
+    
+    static STRLEN build_record_batch (FlatBuilder& builder, I64 length, const Body& body) {
+      std::vector<STRLEN> slots;
+      STRLEN table = builder.table({8, 4, 4}, slots);
+      builder.set<I64>(slots[0], length);
+      STRLEN nodes = builder.vector(body.nodes.size(), sizeof(Node));
+      builder.link(slots[1], nodes);
+      for (size_t i = 0; i < body.nodes.size(); i++) {
+        builder.set<Node>(nodes + 4 + i * sizeof(Node), body.nodes[i]);
+      }
+      STRLEN buffers = builder.vector(body.buffers.size(), sizeof(Buffer));
+      builder.link(slots[2], buffers);
+      for (size_t i = 0; i < body.buffers.size(); i++) {
+        builder.set<Buffer>(buffers + 4 + i * sizeof(Buffer), body.buffers[i]);
+      }
+      
+      return table;
+    }
+    
+    // Encapsulated message. Metadata is padded so that the body starts at aligned offset of the file.
+    static void write_message (Rstats::FileWriter& writer, const std::string& metadata, const Body& body, Block& block) {
+      block.offset = writer.offset;
+      U64 body_offset = writer.offset + 8 + metadata.size();
+      U32 continuation = 0xFFFFFFFF;
+      U32 metadata_size = metadata.size() + (RSTATS_ARROW_ALIGNMENT - body_offset % RSTATS_ARROW_ALIGNMENT) % RSTATS_ARROW_ALIGNMENT;
+      writer.write(&continuation, sizeof(continuation));
+      writer.write(&metadata_size, sizeof(metadata_size));
+      writer.write(metadata.data(), metadata.size());
+      writer.align(RSTATS_ARROW_ALIGNMENT);
+      block.metadata_length = 8 + metadata_size;
+      block.padding = 0;
+      
+      for (size_t i = 0; i < body.buffers.size(); i++) {
+        writer.write(body.pieces[i], body.buffers[i].length);
+        writer.align(RSTATS_ARROW_ALIGNMENT);
+      }
+      block.body_length = body.size;
+    }
+    
+    static STRLEN build_blocks (FlatBuilder& builder, const std::vector<Block>& blocks) {
+      STRLEN vector = builder.vector(blocks.size(), sizeof(Block));
+      for (size_t i = 0; i < blocks.size(); i++) {
+        builder.set<Block>(vector + 4 + i * sizeof(Block), blocks[i]);
+      }
+      
+      return vector;
+    }
+    
+    public:
+    
+    // Write columns as a schema, dictionaries of factors and a record batch.
+    // Return false and set error if a column or the file can't be written.
+    static bool write (const char* file, std::vector<Column>& columns, std::string& error) {
+      IV row_count = columns.empty() ? 0 : columns[0].vector->get_length();
+      std::vector<Field> fields(columns.size());
+      Body body;
+      std::deque<Body> dictionaries;
+      for (size_t i = 0; i < columns.size(); i++) {
+        fields[i].name = columns[i].name;
+        if (columns[i].vector->get_length() != row_count) {
+          error = "columns must have the same length";
+          return false;
+        }
+        if (!add_column(body, fields[i], columns[i], error)) {
+          return false;
+        }
+        
+        // Dictionary id is the column number
+        if (columns[i].levels != NULL) {
+          fields[i].dictionary_id = i;
+          dictionaries.push_back(Body());
+          Rstats::Vector* levels = columns[i].levels;
+          add_validity(dictionaries.back(), levels);
+          if (levels->get_type() != Rstats::VectorType::CHARACTER) {
+            error = "levels of column '" + fields[i].name + "' must be character";
+            return false;
+          }
+          add_strings(dictionaries.back(), levels);
+        }
+      }
+      
+      int fd = ::open(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0) {
+        error = std::string("cannot open file '") + file + "': " + strerror(errno);
+        return false;
+      }
+      Rstats::FileWriter writer(fd);
+      writer.write("ARROW1\0\0", 8);
+      
+      Block schema_block;
+      FlatBuilder schema_builder;
+      STRLEN schema_header = build_message(schema_builder, HEADER_SCHEMA, 0);
+      schema_builder.link(schema_header, build_schema(schema_builder, fields));
+      write_message(writer, schema_builder.data, Body(), schema_block);
+      
+      std::vector<Block> dictionary_blocks;
+      size_t d = 0;
+      for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].levels == NULL) {
+          continue;
+        }
+        FlatBuilder builder;
+        STRLEN header = build_message(builder, HEADER_DICTIONARY_BATCH, dictionaries[d].size);
+        std::vector<STRLEN> slots;
+        STRLEN dictionary_batch = builder.table({8, 4}, slots);
+        builder.link(header, dictionary_batch);
+        builder.set<I64>(slots[0], fields[i].dictionary_id);
+        builder.link(slots[1], build_record_batch(builder, columns[i].levels->get_length(), dictionaries[d]));
+        dictionary_blocks.push_back(Block());
+        write_message(writer, builder.data, dictionaries[d], dictionary_blocks.back());
+        d++;
+      }
+      
+      std::vector<Block> record_batch_blocks(1);
+      FlatBuilder record_batch_builder;
+      STRLEN header = build_message(record_batch_builder, HEADER_RECORD_BATCH, body.size);
+      record_batch_builder.link(header, build_record_batch(record_batch_builder, row_count, body));
+      write_message(writer, record_batch_builder.data, body, record_batch_blocks[0]);
+      
+      // End of stream, footer, size of footer and magic
+      U32 end_of_stream[2] = {0xFFFFFFFF, 0};
+      writer.write(end_of_stream, sizeof(end_of_stream));
+      FlatBuilder footer_builder;
+      STRLEN root = footer_builder.put<U32>(0);
+      std::vector<STRLEN> slots;
+      STRLEN footer = footer_builder.table({2, 4, 4, 4}, slots);
+      footer_builder.link(root, footer);
+      footer_builder.set<I16>(slots[0], METADATA_VERSION);
+      footer_builder.link(slots[1], build_schema(footer_builder, fields));
+      footer_builder.link(slots[2], build_blocks(footer_builder, dictionary_blocks));
+      footer_builder.link(slots[3], build_blocks(footer_builder, record_batch_blocks));
+      I32 footer_size = footer_builder.data.size();
+      writer.write(footer_builder.data.data(), footer_size);
+      writer.write(&footer_size, sizeof(footer_size));
+      writer.write("ARROW1", 6);
+      writer.flush();
+      
+      bool ok = writer.ok;
+      if (::close(fd) != 0) {
+        ok = false;
+      }
+      if (!ok) {
+        error = std::string("cannot write file '") + file + "': " + strerror(errno);
+      }
+      
+      return ok;
+    }
+    
+    // Read columns of the file. Return false and set error if the file is broken or not supported.
+    static bool read (const char* file, std::vector<Column>& columns, std::string& error) {
+      Rstats::MappedFile* mapped_file = Rstats::MappedFile::open(file, error);
+      if (mapped_file == NULL) {
+        return false;
+      }
+      
+      // Magic, stream, footer, size of footer and magic
+      const char* data = mapped_file->get_data();
+      U64 size = mapped_file->get_size();
+      bool ok = size >= 18 && memcmp(data, "ARROW1", 6) == 0 && memcmp(data + size - 6, "ARROW1", 6) == 0;
+      I32 footer_size = 0;
+      if (ok) {
+        memcpy(&footer_size, data + size - 10, sizeof(footer_size));
+        ok = footer_size > 0 && (U64)footer_size <= size - 18;
+      }
+      FlatReader footer(ok ? data + size - 10 - footer_size : data, ok ? footer_size : 0);
+      U64 root = footer.root();
+      U64 schema = footer.table(root, 1);
+      U64 field_count;
+      U64 field_tables = footer.vector(schema, 1, 4, field_count);
+      std::vector<Field> fields(field_count);
+      for (U64 i = 0; ok && i < field_count; i++) {
+        ok = read_field(footer, footer.deref(field_tables + 4 * i), fields[i], error);
+      }
+      ok = ok && footer.ok && schema != 0;
+      
+      // Levels of dictionaries. Values have the type of the field.
+      std::map<I64, Rstats::Vector*> dictionaries;
+      U64 dictionary_count;
+      U64 dictionary_blocks = footer.vector(root, 2, sizeof(Block), dictionary_count);
+      for (U64 i = 0; ok && i < dictionary_count; i++) {
+        Batch batch;
+        ok = read_message(data, size, footer, dictionary_blocks + i * sizeof(Block), HEADER_DICTIONARY_BATCH, batch, error)
+          && batch.nodes.size() == 1 && batch.buffers.size() == 3 && batch.nodes[0].length == batch.length;
+        if (ok && batch.delta) {
+          error = "delta dictionary batch is not supported";
+          ok = false;
+        }
+        Field value_field;
+        for (size_t k = 0; k < fields.size(); k++) {
+          if (fields[k].dictionary_id == batch.dictionary_id) {
+            value_field.type = fields[k].type;
+          }
+        }
+        if (!ok || value_field.type == 0 || dictionaries.count(batch.dictionary_id)) {
+          ok = false;
+          break;
+        }
+        std::vector<Part> parts(1);
+        parts[0].node = batch.nodes[0];
+        std::copy(batch.buffers.begin(), batch.buffers.end(), parts[0].buffers);
+        Rstats::Vector* levels = read_column(mapped_file, value_field, parts, 0);
+        ok = levels != NULL;
+        if (ok) {
+          dictionaries[batch.dictionary_id] = levels;
+        }
+      }
+      
+      // Buffers of a column are validity and values(and data of strings)
+      std::vector<Batch> batches;
+      U64 batch_count;
+      U64 batch_blocks = footer.vector(root, 3, sizeof(Block), batch_count);
+      for (U64 i = 0; ok && i < batch_count; i++) {
+        batches.push_back(Batch());
+        ok = read_message(data, size, footer, batch_blocks + i * sizeof(Block), HEADER_RECORD_BATCH, batches.back(), error)
+          && batches.back().nodes.size() == fields.size();
+      }
+      std::vector<std::vector<Part> > column_parts(fields.size(), std::vector<Part>(batches.size()));
+      for (size_t b = 0; ok && b < batches.size(); b++) {
+        size_t buffer_index = 0;
+        for (size_t i = 0; ok && i < fields.size(); i++) {
+          Part& part = column_parts[i][b];
+          part.node = batches[b].nodes[i];
+          size_t buffer_count = fields[i].dictionary_id < 0 && (fields[i].type == TYPE_UTF8 || fields[i].type == TYPE_LARGE_UTF8) ? 3 : 2;
+          ok = part.node.length == batches[b].length && buffer_index + buffer_count <= batches[b].buffers.size();
+          for (size_t k = 0; ok && k < buffer_count; k++) {
+            part.buffers[k] = batches[b].buffers[buffer_index++];
+          }
+        }
+      }
+      
+      for (size_t i = 0; ok && i < fields.size(); i++) {
+        Column column;
+        column.name = fields[i].name;
+        IV level_count = 0;
+        if (fields[i].dictionary_id >= 0) {
+          ok = dictionaries.count(fields[i].dictionary_id);
+          if (!ok) {
+            break;
+          }
+          column.levels = dictionaries[fields[i].dictionary_id]->inc_refcnt();
+          column.ordered = fields[i].ordered;
+          level_count = column.levels->get_length();
+        }
+        column.vector = read_column(mapped_file, fields[i], column_parts[i], level_count);
+        ok = column.vector != NULL;
+        if (ok) {
+          columns.push_back(column);
+        }
+        else if (column.levels != NULL) {
+          column.levels->dec_refcnt();
+        }
+      }
+      
+      for (std::map<I64, Rstats::Vector*>::iterator it = dictionaries.begin(); it != dictionaries.end(); ++it) {
+        it->second->dec_refcnt();
+      }
+      if (!ok) {
+        for (size_t i = 0; i < columns.size(); i++) {
+          columns[i].vector->dec_refcnt();
+          if (columns[i].levels != NULL) {
+            columns[i].levels->dec_refcnt();
+          }
+        }
+        columns.clear();
+        if (error.empty()) {
+          error = std::string("broken arrow file '") + file + "'";
+        }
+      }
+      mapped_file->dec_refcnt();
+      
+      return ok;
+    }
+  };
+  
+  // Rstats::RowKeys - composite keys of rows of key columns. A factor column is keyed by the labels
+  // of its codes. Keys are hashed, compared and ordered without Perl API. Strings of interned columns
+  // are read from the process-wide Rstats::StringPool without lock, so worker threads can use them.
+  // NA equals NA(and NaN equals NaN) as in match. NA and NaN are ordered last.
+  class RowKeys {
+    private:
+    
+    struct Column {
+      Rstats::Vector* values;
+      Rstats::Vector* codes;
+      Rstats::VectorType::Enum type;
+      bool has_na;
+    };
+    
+    std::vector<Column> columns;
+    IV length;
+    
+    static U64 mix (U64 h, U64 value) {
+      h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      return h;
+    }
+    
+    static U64 hash_double (NV value) {
+      if (std::isnan(value)) {
+        return 0x7ff8000000000000ULL;
+      }
+      if (value == 0) {
+        return 0;
+      }
+      U64 bits;
+      memcpy(&bits, &value, sizeof(bits));
+      return bits;
+    }
+    
+    static bool equal_double (NV value1, NV value2) {
+      return value1 == value2 || (std::isnan(value1) && std::isnan(value2));
+    }
+    
+    // NaN is after numbers
+    static int compare_double (NV value1, NV value2) {
+      bool nan1 = std::isnan(value1);
+      bool nan2 = std::isnan(value2);
+      if (nan1 || nan2) {
+        return nan1 == nan2 ? 0 : nan1 ? 1 : -1;
+      }
+      return value1 < value2 ? -1 : value1 > value2 ? 1 : 0;
+    }
+    
+    // Position of the value of the row, or -1 if the key is NA
+    static IV get_pos (const Column& column, IV row) {
+      if (column.codes == NULL) {
+        return column.has_na && column.values->exists_na_position(row) ? -1 : row;
+      }
+      if (column.has_na && column.codes->exists_na_position(row)) {
+        return -1;
+      }
+      IV code = column.codes->get_integer_values()[row];
+      return code >= 1 && code <= column.values->get_length() ? code - 1 : -1;
+    }
+    
+    // Strings are compared as bytes when their encodings are same or they are ASCII.
+    // Otherwise UTF-8 keys are compared.
+    static int compare_string (Rstats::Vector* e1, IV pos1, Rstats::Vector* e2, IV pos2) {
+      const char* str1 = e1->get_character_ptr(pos1);
+      STRLEN length1 = e1->get_character_length(pos1);
+      const char* str2 = e2->get_character_ptr(pos2);
+      STRLEN length2 = e2->get_character_length(pos2);
+      if (e1->is_character_utf8(pos1) != e2->is_character_utf8(pos2)
+        && !(Rstats::Util::is_ascii(str1, length1) && Rstats::Util::is_ascii(str2, length2)))
+      {
+        std::string key1;
+        std::string key2;
+        e1->get_character_key(pos1, key1);
+        e2->get_character_key(pos2, key2);
+        int ret = key1.compare(key2);
+        return ret < 0 ? -1 : ret > 0 ? 1 : 0;
+      }
+      int ret = memcmp(str1, str2, length1 < length2 ? length1 : length2);
+      if (ret != 0) {
+        return ret < 0 ? -1 : 1;
+      }
+      return length1 < length2 ? -1 : length1 > length2 ? 1 : 0;
+    }
+    
+    static U64 hash_string (Rstats::Vector* e1, IV pos) {
+      const char* str = e1->get_character_ptr(pos);
+      STRLEN length = e1->get_character_length(pos);
+      if (e1->is_character_utf8(pos) || Rstats::Util::is_ascii(str, length)) {
+        return std::hash<std::string_view>()(std::string_view(str, length));
+      }
+      std::string key;
+      e1->get_character_key(pos, key);
+      return std::hash<std::string>()(key);
+    }
+    
+    public:
+    
+    RowKeys () : length(0) {}
+    
+    // Key column. levels is the levels of a factor column, or NULL.
+    void add (Rstats::Vector* vector, Rstats::Vector* levels) {
+      Column column;
+      if (levels != NULL) {
+        column.values = levels;
+        column.codes = vector;
+        column.type = Rstats::VectorType::CHARACTER;
+        column.has_na = !vector->get_na_positions().empty();
+      }
+      else {
+        column.values = vector;
+        column.codes = NULL;
+        column.type = vector->get_type();
+        column.has_na = !vector->get_na_positions().empty();
+      }
+      this->columns.push_back(column);
+      this->length = vector->get_length();
+    }
+    
+    IV get_length () {
+      return this->length;
+    }
+    
+    U64 hash (IV row) {
+      U64 h = 0;
+      for (size_t k = 0; k < this->columns.size(); k++) {
+        const Column& column = this->columns[k];
+        IV pos = get_pos(column, row);
+        U64 value;
+        if (pos < 0) {
+          value = 0x5bd1e9955bd1e995ULL;
+        }
+        else {
+          switch (column.type) {
+            case Rstats::VectorType::CHARACTER :
+              value = hash_string(column.values, pos);
+              break;
+            case Rstats::VectorType::COMPLEX : {
+              std::complex<NV> z = column.values->get_complex_values()[pos];
+              value = mix(hash_double(z.real()), hash_double(z.imag()));
+              break;
+            }
+            case Rstats::VectorType::DOUBLE :
+              value = hash_double(column.values->get_double_values()[pos]);
+              break;
+            default:
+              value = (U64)column.values->get_integer_values()[pos];
+          }
+        }
+        h = mix(h, value * 0xff51afd7ed558ccdULL);
+      }
+      
+      // Finalize so that low bits used as bucket index depend on all bits (integral doubles have zero low bits)
+      h ^= h >> 30;
+      h *= 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 27;
+      h *= 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+      return h;
+    }
+    
+    // Key column k of the row compared with the same column of other keys. Types of the columns are same.
+    int compare_column (size_t k, IV row, Rstats::RowKeys& other, IV other_row, bool equality) {
+      const Column& column1 = this->columns[k];
+      const Column& column2 = other.columns[k];
+      IV pos1 = get_pos(column1, row);
+      IV pos2 = get_pos(column2, other_row);
+      if (pos1 < 0 || pos2 < 0) {
+        return pos1 < 0 && pos2 < 0 ? 0 : pos1 < 0 ? 1 : -1;
+      }
+      switch (column1.type) {
+        case Rstats::VectorType::CHARACTER :
+          return compare_string(column1.values, pos1, column2.values, pos2);
+        case Rstats::VectorType::COMPLEX : {
+          std::complex<NV> z1 = column1.values->get_complex_values()[pos1];
+          std::complex<NV> z2 = column2.values->get_complex_values()[pos2];
+          if (equality) {
+            return equal_double(z1.real(), z2.real()) && equal_double(z1.imag(), z2.imag()) ? 0 : 1;
+          }
+          int ret = compare_double(z1.real(), z2.real());
+          return ret != 0 ? ret : compare_double(z1.imag(), z2.imag());
+        }
+        case Rstats::VectorType::DOUBLE : {
+          NV value1 = column1.values->get_double_values()[pos1];
+          NV value2 = column2.values->get_double_values()[pos2];
+          if (equality) {
+            return equal_double(value1, value2) ? 0 : 1;
+          }
+          return compare_double(value1, value2);
+        }
+        default: {
+          IV value1 = column1.values->get_integer_values()[pos1];
+          IV value2 = column2.values->get_integer_values()[pos2];
+          return value1 < value2 ? -1 : value1 > value2 ? 1 : 0;
+        }
+      }
+    }
+    
+    bool equal (IV row, Rstats::RowKeys& other, IV other_row) {
+      for (size_t k = 0; k < this->columns.size(); k++) {
+        if (this->compare_column(k, row, other, other_row, true) != 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    
+    int compare (IV row, Rstats::RowKeys& other, IV other_row) {
+      for (size_t k = 0; k < this->columns.size(); k++) {
+        int ret = this->compare_column(k, row, other, other_row, false);
+        if (ret != 0) {
+          return ret;
+        }
+      }
+      return 0;
+    }
+    
+    size_t get_column_count () {
+      return this->columns.size();
+    }
+    
+    bool is_na (size_t k, IV row) {
+      return get_pos(this->columns[k], row) < 0;
+    }
+    
+    // Rows are in ascending order of keys(NA last). Chunks are checked in parallel.
+    bool is_sorted () {
+      bool sorted = true;
+      std::mutex sorted_mutex;
+      Rstats::ThreadPool::parallel_for(this->length, [&](IV begin, IV end) {
+        bool chunk_sorted = true;
+        for (IV i = begin > 0 ? begin : 1; i < end; i++) {
+          if (this->compare(i - 1, *this, i) > 0) {
+            chunk_sorted = false;
+            break;
+          }
+        }
+        if (!chunk_sorted) {
+          std::lock_guard<std::mutex> lock(sorted_mutex);
+          sorted = false;
+        }
+      });
+      return sorted;
+    }
+  };
+  
+  // Rstats::Join - joins of data frames on key columns. A join results in row positions of x and y
+  // for each joined row, and -1 is a row which doesn't match(NA in every column of the side).
+  class Join {
+    private:
+    
+    // Order of joined rows by keys. Ties keep the order of x rows and then y rows.
+    static void sort_rows (Rstats::RowKeys& x_keys, Rstats::RowKeys& y_keys, std::vector<IV>& x_rows, std::vector<IV>& y_rows) {
+      IV length = x_rows.size();
+      std::vector<IV> order(length);
+      for (IV i = 0; i < length; i++) {
+        order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(), [&](IV a, IV b) {
+        Rstats::RowKeys& keys_a = x_rows[a] >= 0 ? x_keys : y_keys;
+        Rstats::RowKeys& keys_b = x_rows[b] >= 0 ? x_keys : y_keys;
+        return keys_a.compare(x_rows[a] >= 0 ? x_rows[a] : y_rows[a], keys_b, x_rows[b] >= 0 ? x_rows[b] : y_rows[b]) < 0;
+      });
+      
+      std::vector<IV> sorted_x_rows(length);
+      std::vector<IV> sorted_y_rows(length);
+      for (IV i = 0; i < length; i++) {
+        sorted_x_rows[i] = x_rows[order[i]];
+        sorted_y_rows[i] = y_rows[order[i]];
+      }
+      x_rows.swap(sorted_x_rows);
+      y_rows.swap(sorted_y_rows);
+    }
+    
+    // Rows of keys in ascending order. order is empty if the rows are already sorted.
+    static void order_rows (Rstats::RowKeys& keys, std::vector<IV>& order) {
+      order.clear();
+      if (keys.is_sorted()) {
+        return;
+      }
+      IV length = keys.get_length();
+      order.resize(length);
+      for (IV i = 0; i < length; i++) {
+        order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(), [&](IV a, IV b) {
+        return keys.compare(a, keys, b) < 0;
+      });
+    }
+    
+    public:
+    
+    // Sort-merge join. Both sides are scanned once in order of keys, so sorted keys need no extra memory
+    // except joined rows. Unsorted sides are ordered first. Joined rows are in order of keys, and rows of
+    // same keys are in the order of x rows and then y rows, which is same as hash join with sort.
+    static void merge_join (Rstats::RowKeys& x_keys, Rstats::RowKeys& y_keys, bool all_x, bool all_y,
+      std::vector<IV>& x_rows, std::vector<IV>& y_rows)
+    {
+      std::vector<IV> x_order;
+      std::vector<IV> y_order;
+      order_rows(x_keys, x_order);
+      order_rows(y_keys, y_order);
+      IV x_length = x_keys.get_length();
+      IV y_length = y_keys.get_length();
+      auto x_row = [&](IV i) { return x_order.empty() ? i : x_order[i]; };
+      auto y_row = [&](IV j) { return y_order.empty() ? j : y_order[j]; };
+      
+      x_rows.clear();
+      y_rows.clear();
+      IV i = 0;
+      IV j = 0;
+      while (i < x_length || j < y_length) {
+        int ret = i >= x_length ? 1 : j >= y_length ? -1 : x_keys.compare(x_row(i), y_keys, y_row(j));
+        if (ret < 0) {
+          if (all_x) {
+            x_rows.push_back(x_row(i));
+            y_rows.push_back(-1);
+          }
+          i++;
+        }
+        else if (ret > 0) {
+          if (all_y) {
+            x_rows.push_back(-1);
+            y_rows.push_back(y_row(j));
           }
-          break;
-        case Rstats::VectorType::INTEGER :
-          e2 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, (IV)std::abs((NV)e1->get_integer_value(i)));
+          j++;
+        }
+        else {
+          // Runs of same keys are joined each other
+          IV i_end = i + 1;
+          while (i_end < x_length && x_keys.compare(x_row(i), x_keys, x_row(i_end)) == 0) {
+            i_end++;
+          }
+          IV j_end = j + 1;
+          while (j_end < y_length && y_keys.compare(y_row(j), y_keys, y_row(j_end)) == 0) {
+            j_end++;
+          }
+          for (IV i_run = i; i_run < i_end; i_run++) {
+            for (IV j_run = j; j_run < j_end; j_run++) {
+              x_rows.push_back(x_row(i_run));
+              y_rows.push_back(y_row(j_run));
+            }
           }
-          break;
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_logical(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, (IV)std::abs((NV)e1->get_integer_value(i)));
+          i = i_end;
+          j = j_end;
+        }
+      }
+    }
+    
+    // As-of join. Each x row is joined with the y row which has same keys except the last one and the
+    // nearest previous(or same) value of the last key. x rows keep their order, and -1 is a row which
+    // has no previous y row. Last keys which are NA don't match.
+    static void asof_join (Rstats::RowKeys& x_keys, Rstats::RowKeys& y_keys, std::vector<IV>& x_rows, std::vector<IV>& y_rows) {
+      std::vector<IV> x_order;
+      std::vector<IV> y_order;
+      order_rows(x_keys, x_order);
+      order_rows(y_keys, y_order);
+      IV x_length = x_keys.get_length();
+      IV y_length = y_keys.get_length();
+      auto x_row = [&](IV i) { return x_order.empty() ? i : x_order[i]; };
+      auto y_row = [&](IV j) { return y_order.empty() ? j : y_order[j]; };
+      size_t last = x_keys.get_column_count() - 1;
+      
+      x_rows.resize(x_length);
+      y_rows.resize(x_length);
+      IV j = 0;
+      for (IV i = 0; i < x_length; i++) {
+        IV row = x_row(i);
+        x_rows[row] = row;
+        
+        // y rows before j are not greater than the x row
+        while (j < y_length && y_keys.compare(y_row(j), x_keys, row) <= 0) {
+          j++;
+        }
+        IV match = -1;
+        if (j > 0 && !x_keys.is_na(last, row) && !y_keys.is_na(last, y_row(j - 1))) {
+          match = y_row(j - 1);
+          for (size_t k = 0; k < last; k++) {
+            if (x_keys.compare_column(k, row, y_keys, match, true) != 0) {
+              match = -1;
+              break;
+            }
           }
-          break;
-        default:
-          croak("Invalid type");
-
+        }
+        y_rows[row] = match;
       }
-      
-      e2->merge_na_positions(e1);
-      
-      return e2;
     }
-
-    Rstats::Vector* clone(Rstats::Vector* e1) {
+    
+    // Hash join. The hash table is built on the smaller side, and the other side is probed in parallel.
+    // all_x and all_y keep rows of the side which don't match. Without sort, joined rows are in the order
+    // of the probed side, and unmatched rows of the built side follow.
+    static void hash_join (Rstats::RowKeys& x_keys, Rstats::RowKeys& y_keys, bool all_x, bool all_y, bool sort,
+      std::vector<IV>& x_rows, std::vector<IV>& y_rows)
+    {
+      bool build_x = x_keys.get_length() < y_keys.get_length();
+      Rstats::RowKeys& build = build_x ? x_keys : y_keys;
+      Rstats::RowKeys& probe = build_x ? y_keys : x_keys;
+      bool all_build = build_x ? all_x : all_y;
+      bool all_probe = build_x ? all_y : all_x;
+      IV build_length = build.get_length();
+      IV probe_length = probe.get_length();
+      
+      // Chains of rows in buckets. Rows of a chain are in ascending order.
+      std::vector<U64> hashes(build_length);
+      Rstats::ThreadPool::parallel_for(build_length, [&](IV begin, IV end) {
+        for (IV i = begin; i < end; i++) {
+          hashes[i] = build.hash(i);
+        }
+      });
+      U64 bucket_count = 16;
+      while (bucket_count < (U64)build_length * 2) {
+        bucket_count <<= 1;
+      }
+      U64 mask = bucket_count - 1;
+      std::vector<IV> heads(bucket_count, -1);
+      std::vector<IV> nexts(build_length);
+      for (IV i = build_length - 1; i >= 0; i--) {
+        U64 bucket = hashes[i] & mask;
+        nexts[i] = heads[bucket];
+        heads[bucket] = i;
+      }
       
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          e2 = Rstats::Vector::new_character(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_character_value(i, e1->get_character_value(i));
-          }
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, e1->get_complex_value(i));
+      // Matches of probed chunks, which are concatenated in order of the chunks
+      std::map<IV, std::pair<std::vector<IV>, std::vector<IV> > > chunks;
+      std::mutex chunks_mutex;
+      Rstats::ThreadPool::parallel_for(probe_length, [&](IV begin, IV end) {
+        std::vector<IV> probe_rows;
+        std::vector<IV> build_rows;
+        for (IV i = begin; i < end; i++) {
+          U64 hash = probe.hash(i);
+          bool matched = false;
+          for (IV b = heads[hash & mask]; b >= 0; b = nexts[b]) {
+            if (hashes[b] == hash && probe.equal(i, build, b)) {
+              probe_rows.push_back(i);
+              build_rows.push_back(b);
+              matched = true;
+            }
           }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, e1->get_double_value(i));
+          if (!matched && all_probe) {
+            probe_rows.push_back(i);
+            build_rows.push_back(-1);
           }
-          break;
-        case Rstats::VectorType::INTEGER :
-          e2 = Rstats::Vector::new_integer(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, e1->get_integer_value(i));
+        }
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        chunks[begin].first.swap(probe_rows);
+        chunks[begin].second.swap(build_rows);
+      });
+      
+      std::vector<IV>& probe_result = build_x ? y_rows : x_rows;
+      std::vector<IV>& build_result = build_x ? x_rows : y_rows;
+      probe_result.clear();
+      build_result.clear();
+      for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        probe_result.insert(probe_result.end(), it->second.first.begin(), it->second.first.end());
+        build_result.insert(build_result.end(), it->second.second.begin(), it->second.second.end());
+        std::vector<IV>().swap(it->second.first);
+        std::vector<IV>().swap(it->second.second);
+      }
+      
+      if (all_build) {
+        std::vector<bool> matched(build_length, false);
+        for (size_t i = 0; i < build_result.size(); i++) {
+          if (build_result[i] >= 0) {
+            matched[build_result[i]] = true;
           }
-          break;
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_logical(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_integer_value(i, e1->get_integer_value(i));
+        }
+        for (IV b = 0; b < build_length; b++) {
+          if (!matched[b]) {
+            build_result.push_back(b);
+            probe_result.push_back(-1);
           }
-          break;
-        default:
-          croak("Invalid type");
-
+        }
       }
       
-      e2->merge_na_positions(e1);
+      if (sort) {
+        sort_rows(x_keys, y_keys, x_rows, y_rows);
+      }
+    }
+    
+    // Key column of joined rows. A row which has no x row takes the key of the y row. Codes of y factor
+    // are converted by y_codes, which has the code of the result for each y level.
+    static Rstats::Vector* gather_key (Rstats::Vector* x_key, Rstats::Vector* x_rows, Rstats::Vector* y_key, Rstats::Vector* y_rows,
+      Rstats::Vector* y_codes)
+    {
+      std::vector<Rstats::Vector*> columns(1, x_key);
+      std::vector<Rstats::Vector*> results;
+      Rstats::VectorFunc::gather_columns(columns, x_rows, results);
+      Rstats::Vector* key = results[0];
+      
+      IV length = x_rows->get_length();
+      const IV* x_row_values = x_rows->get_integer_values();
+      const IV* y_row_values = y_rows->get_integer_values();
+      bool y_has_na = !y_key->get_na_positions().empty();
+      for (IV i = 0; i < length; i++) {
+        IV y_row = y_row_values[i];
+        if (x_row_values[i] >= 0 || y_row < 0 || (y_has_na && y_key->exists_na_position(y_row))) {
+          continue;
+        }
+        switch (key->get_type()) {
+          case Rstats::VectorType::CHARACTER :
+            key->set_character_value(i, y_key, y_row);
+            break;
+          case Rstats::VectorType::COMPLEX :
+            key->get_complex_values()[i] = y_key->get_complex_values()[y_row];
+            break;
+          case Rstats::VectorType::DOUBLE :
+            key->get_double_values()[i] = y_key->get_double_values()[y_row];
+            break;
+          default: {
+            IV value = y_key->get_integer_values()[y_row];
+            if (y_codes != NULL) {
+              if (value < 1 || value > y_codes->get_length()) {
+                continue;
+              }
+              value = y_codes->get_integer_values()[value - 1];
+            }
+            key->get_integer_values()[i] = value;
+          }
+        }
+        key->remove_na_position(i);
+      }
       
-      return e2;
+      return key;
     }
-        
-    Rstats::Vector* log(Rstats::Vector* e1) {
+  };
+  
+  // Rstats::Group - groups of rows by key columns and aggregations of the groups. Groups are
+  // numbered in order of keys(NA last).
+  class Group {
+    private:
+    
+    // Open addressing table of groups. A group is kept as its first row.
+    struct Table {
+      std::vector<IV> slots;
+      std::vector<IV> rows;
+      std::vector<U64> hashes;
+      U64 mask;
+      
+      Table () : slots(16, -1), mask(15) {}
+      
+      IV find_or_add (Rstats::RowKeys& keys, IV row, U64 hash) {
+        U64 slot = hash & this->mask;
+        while (this->slots[slot] >= 0) {
+          IV group = this->slots[slot];
+          if (this->hashes[group] == hash && keys.equal(this->rows[group], keys, row)) {
+            return group;
+          }
+          slot = (slot + 1) & this->mask;
+        }
+        IV group = this->rows.size();
+        this->rows.push_back(row);
+        this->hashes.push_back(hash);
+        this->slots[slot] = group;
+        if (this->rows.size() * 2 > this->slots.size()) {
+          this->grow();
+        }
+        return group;
+      }
       
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::log(e1->get_complex_value(i)));
+      void grow () {
+        std::vector<IV>(this->slots.size() * 2, -1).swap(this->slots);
+        this->mask = this->slots.size() - 1;
+        for (size_t group = 0; group < this->rows.size(); group++) {
+          U64 slot = this->hashes[group] & this->mask;
+          while (this->slots[slot] >= 0) {
+            slot = (slot + 1) & this->mask;
           }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::log(e1->get_double_value(i)));
+          this->slots[slot] = group;
+        }
+      }
+    };
+    
+    // Partial aggregation of a group
+    struct State {
+      IV count;
+      IV integer_value;
+      NV value;
+      NV m2;
+      bool na;
+    };
+    
+    enum Func { SUM, MEAN, MIN, MAX, SD };
+    
+    static void init_state (State& state) {
+      state.count = 0;
+      state.integer_value = 0;
+      state.value = 0;
+      state.m2 = 0;
+      state.na = false;
+    }
+    
+    // Partial aggregations of two chunks are combined. Variance is combined by Chan's formula.
+    static void combine_state (Func func, bool is_double, State& state, const State& other) {
+      state.na = state.na || other.na;
+      if (other.count == 0) {
+        return;
+      }
+      if (state.count == 0) {
+        state = other;
+        return;
+      }
+      switch (func) {
+        case SUM :
+        case MEAN :
+          state.value += other.value;
+          state.integer_value += other.integer_value;
+          break;
+        case MIN :
+          if (is_double) {
+            if (std::isnan(other.value) || other.value < state.value) {
+              state.value = other.value;
+            }
+          }
+          else if (other.integer_value < state.integer_value) {
+            state.integer_value = other.integer_value;
           }
           break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::log(e1->get_integer_value(i)));
+        case MAX :
+          if (is_double) {
+            if (std::isnan(other.value) || other.value > state.value) {
+              state.value = other.value;
+            }
+          }
+          else if (other.integer_value > state.integer_value) {
+            state.integer_value = other.integer_value;
           }
           break;
-        default:
-          croak("Invalid type");
-
+        case SD : {
+          NV count = state.count + other.count;
+          NV delta = other.value - state.value;
+          state.m2 += other.m2 + delta * delta * state.count * other.count / count;
+          state.value += delta * other.count / count;
+          break;
+        }
       }
-
-      e2->merge_na_positions(e1);
-      
-      return e2;
-    }
-
-    Rstats::Vector* logb(Rstats::Vector* e1) {
-      return log(e1);
+      state.count += other.count;
     }
     
-    Rstats::Vector* log10(Rstats::Vector* e1) {
-      
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
+    static void add_value (Func func, State& state, NV value, IV integer_value) {
+      switch (func) {
+        case SUM :
+        case MEAN :
+          state.value += value;
+          state.integer_value += integer_value;
           break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::log10(e1->get_complex_value(i)));
+        case MIN :
+          if (state.count == 0 || std::isnan(value) || value < state.value) {
+            state.value = value;
           }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::log10(e1->get_double_value(i)));
+          if (state.count == 0 || integer_value < state.integer_value) {
+            state.integer_value = integer_value;
           }
           break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::log10(e1->get_integer_value(i)));
+        case MAX :
+          if (state.count == 0 || std::isnan(value) || value > state.value) {
+            state.value = value;
+          }
+          if (state.count == 0 || integer_value > state.integer_value) {
+            state.integer_value = integer_value;
           }
           break;
-        default:
-          croak("Invalid type");
-
+        case SD : {
+          NV delta = value - state.value;
+          state.value += delta / (state.count + 1);
+          state.m2 += delta * (value - state.value);
+          break;
+        }
       }
-      
-      e2->merge_na_positions(e1);
-      
-      return e2;
+      state.count++;
     }
-
-    Rstats::Vector* log2(Rstats::Vector* e1) {
-      
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = divide(log(e1), log(Rstats::Vector::new_complex(length, std::complex<NV>(2, 0))));
-          break;
-        case Rstats::VectorType::DOUBLE :
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = divide(log(e1), log(Rstats::Vector::new_double(length, 2)));
-          break;
-        default:
-          croak("Invalid type");
-
+    
+    // Rows of each group. Rows of group g are rows[offsets[g]] to rows[offsets[g + 1] - 1] in ascending order.
+    static void rows_by_group (const IV* groups, IV length, IV group_count, std::vector<IV>& offsets, std::vector<IV>& rows) {
+      offsets.assign(group_count + 1, 0);
+      for (IV i = 0; i < length; i++) {
+        offsets[groups[i] + 1]++;
+      }
+      for (IV g = 0; g < group_count; g++) {
+        offsets[g + 1] += offsets[g];
+      }
+      std::vector<IV> positions(offsets.begin(), offsets.end() - 1);
+      rows.resize(length);
+      for (IV i = 0; i < length; i++) {
+        rows[positions[groups[i]]++] = i;
       }
-      
-      e2->merge_na_positions(e1);
-      
-      return e2;
     }
-
-    Rstats::Vector* exp(Rstats::Vector* e1) {
-      
-      IV length = e1->get_length();
-      Rstats::Vector* e2;
-      Rstats::VectorType::Enum type = e1->get_type();
-      switch (type) {
-        case Rstats::VectorType::CHARACTER :
-          croak("Error in a - b : non-numeric argument to binary operator");
-          break;
-        case Rstats::VectorType::COMPLEX :
-          e2 = Rstats::Vector::new_complex(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_complex_value(i, std::exp(e1->get_complex_value(i)));
-          }
-          break;
-        case Rstats::VectorType::DOUBLE :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::exp(e1->get_double_value(i)));
-          }
-          break;
-        case Rstats::VectorType::INTEGER :
-        case Rstats::VectorType::LOGICAL :
-          e2 = Rstats::Vector::new_double(length);
-          for (IV i = 0; i < length; i++) {
-            e2->set_double_value(i, std::exp(e1->get_integer_value(i)));
+    
+    static std::vector<char> na_mask (Rstats::Vector* values) {
+      std::vector<char> na;
+      const std::map<IV, IV>& na_positions = values->get_na_positions();
+      if (!na_positions.empty()) {
+        na.resize(values->get_length(), 0);
+        for (auto it = na_positions.begin(); it != na_positions.end(); ++it) {
+          na[it->first] = 1;
+        }
+      }
+      return na;
+    }
+    
+    public:
+    
+    // Group of each row and first row of each group. Sorted keys are grouped by runs of same keys.
+    // Otherwise each chunk of rows is grouped by its own hash table in parallel, and groups of chunks are merged.
+    static void group_rows (Rstats::RowKeys& keys, std::vector<IV>& groups, std::vector<IV>& first_rows) {
+      IV length = keys.get_length();
+      groups.resize(length);
+      first_rows.clear();
+      
+      // Starts of runs are marked while sortedness is checked
+      bool sorted = true;
+      std::mutex sorted_mutex;
+      Rstats::ThreadPool::parallel_for(length, [&](IV begin, IV end) {
+        for (IV i = begin; i < end; i++) {
+          int ret = i == 0 ? -1 : keys.compare(i - 1, keys, i);
+          if (ret > 0) {
+            std::lock_guard<std::mutex> lock(sorted_mutex);
+            sorted = false;
+            break;
+          }
+          groups[i] = ret != 0;
+        }
+      });
+      if (sorted) {
+        IV group = -1;
+        for (IV i = 0; i < length; i++) {
+          if (groups[i]) {
+            group++;
+            first_rows.push_back(i);
           }
-          break;
-        default:
-          croak("Invalid type");
-
+          groups[i] = group;
+        }
+        return;
+      }
+      
+      // Local groups of chunks
+      std::map<IV, std::pair<IV, Table> > chunks;
+      std::mutex chunks_mutex;
+      Rstats::ThreadPool::parallel_for(length, [&](IV begin, IV end) {
+        Table table;
+        for (IV i = begin; i < end; i++) {
+          groups[i] = table.find_or_add(keys, i, keys.hash(i));
+        }
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        chunks[begin].first = end;
+        std::swap(chunks[begin].second, table);
+      });
+      
+      // Local groups are merged in order of chunks, so the first row of a group is the first in all rows
+      Table table;
+      std::map<IV, std::pair<IV, std::vector<IV> > > local_to_global;
+      for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        Table& local = it->second.second;
+        local_to_global[it->first].first = it->second.first;
+        std::vector<IV>& global = local_to_global[it->first].second;
+        global.resize(local.rows.size());
+        for (size_t group = 0; group < local.rows.size(); group++) {
+          global[group] = table.find_or_add(keys, local.rows[group], local.hashes[group]);
+        }
+      }
+      
+      // Groups in order of keys
+      IV group_count = table.rows.size();
+      std::vector<IV> order(group_count);
+      for (IV g = 0; g < group_count; g++) {
+        order[g] = g;
+      }
+      std::sort(order.begin(), order.end(), [&](IV a, IV b) {
+        return keys.compare(table.rows[a], keys, table.rows[b]) < 0;
+      });
+      std::vector<IV> ranks(group_count);
+      first_rows.resize(group_count);
+      for (IV g = 0; g < group_count; g++) {
+        ranks[order[g]] = g;
+        first_rows[g] = table.rows[order[g]];
+      }
+      for (auto it = local_to_global.begin(); it != local_to_global.end(); ++it) {
+        std::vector<IV>& global = it->second.second;
+        for (size_t group = 0; group < global.size(); group++) {
+          global[group] = ranks[global[group]];
+        }
       }
       
-      e2->merge_na_positions(e1);
-      
-      return e2;
+      Rstats::ThreadPool::parallel_for(length, [&](IV begin, IV end) {
+        auto it = local_to_global.upper_bound(begin);
+        --it;
+        for (IV i = begin; i < end; i++) {
+          while (i >= it->second.first) {
+            ++it;
+          }
+          groups[i] = it->second.second[groups[i]];
+        }
+      });
     }
-
-    Rstats::Vector* is_infinite(Rstats::Vector* elements) {
-      
-      IV length = elements->get_length();
-      Rstats::Vector* rets;
-      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
-        rets = Rstats::Vector::new_logical(length);
-        std::vector<NV>* values = elements->get_double_values();
-        std::vector<IV>* rets_values = rets->get_integer_values();
+    
+    // Aggregation of values by groups. func is n, sum, mean, min, max, sd, median or n_distinct.
+    // NA(and NaN) results NA unless na_rm. n counts rows, and n_distinct counts NA as a value.
+    static Rstats::Vector* aggregate (const std::string& func_name, Rstats::Vector* values, const IV* groups, IV group_count, bool na_rm) {
+      IV length = values->get_length();
+      Rstats::VectorType::Enum type = values->get_type();
+      
+      if (func_name == "n") {
+        Rstats::Vector* result = Rstats::Vector::new_integer(group_count, 0);
+        IV* result_values = result->get_integer_values();
         for (IV i = 0; i < length; i++) {
-          if(std::isinf((*values)[i])) {
-            (*rets_values)[i] = 1;
+          result_values[groups[i]]++;
+        }
+        return result;
+      }
+      
+      if (func_name == "n_distinct") {
+        std::vector<IV> offsets;
+        std::vector<IV> rows;
+        rows_by_group(groups, length, group_count, offsets, rows);
+        Rstats::RowKeys keys;
+        keys.add(values, NULL);
+        Rstats::Vector* result = Rstats::Vector::new_integer(group_count);
+        IV* result_values = result->get_integer_values();
+        Rstats::ThreadPool::parallel_for(group_count, [&](IV begin, IV end) {
+          for (IV g = begin; g < end; g++) {
+            std::vector<IV> group_rows;
+            for (IV k = offsets[g]; k < offsets[g + 1]; k++) {
+              if (!(na_rm && keys.is_na(0, rows[k]))) {
+                group_rows.push_back(rows[k]);
+              }
+            }
+            std::sort(group_rows.begin(), group_rows.end(), [&](IV a, IV b) {
+              return keys.compare(a, keys, b) < 0;
+            });
+            IV count = 0;
+            for (size_t k = 0; k < group_rows.size(); k++) {
+              if (k == 0 || !keys.equal(group_rows[k - 1], keys, group_rows[k])) {
+                count++;
+              }
+            }
+            result_values[g] = count;
           }
-          else {
-            (*rets_values)[i] = 0;
+        }, 2);
+        return result;
+      }
+      
+      if (type != Rstats::VectorType::DOUBLE && type != Rstats::VectorType::INTEGER && type != Rstats::VectorType::LOGICAL) {
+        croak("Error in %s: invalid 'type' of argument", func_name.c_str());
+      }
+      bool is_double = type == Rstats::VectorType::DOUBLE;
+      const NV* double_values = is_double ? values->get_double_values() : NULL;
+      const IV* integer_values = is_double ? NULL : values->get_integer_values();
+      std::vector<char> na = na_mask(values);
+      
+      if (func_name == "median") {
+        std::vector<IV> offsets;
+        std::vector<IV> rows;
+        rows_by_group(groups, length, group_count, offsets, rows);
+        Rstats::Vector* result = Rstats::Vector::new_double(group_count);
+        NV* result_values = result->get_double_values();
+        std::vector<char> result_na(group_count, 0);
+        Rstats::ThreadPool::parallel_for(group_count, [&](IV begin, IV end) {
+          std::vector<NV> group_values;
+          for (IV g = begin; g < end; g++) {
+            group_values.clear();
+            for (IV k = offsets[g]; k < offsets[g + 1]; k++) {
+              IV row = rows[k];
+              NV value = is_double ? double_values[row] : (NV)integer_values[row];
+              if ((!na.empty() && na[row]) || std::isnan(value)) {
+                if (na_rm) {
+                  continue;
+                }
+                result_na[g] = 1;
+                break;
+              }
+              group_values.push_back(value);
+            }
+            if (result_na[g] || group_values.empty()) {
+              result_na[g] = 1;
+              continue;
+            }
+            size_t half = group_values.size() / 2;
+            std::nth_element(group_values.begin(), group_values.begin() + half, group_values.end());
+            NV median = group_values[half];
+            if (group_values.size() % 2 == 0) {
+              median = (median + *std::max_element(group_values.begin(), group_values.begin() + half)) / 2;
+            }
+            result_values[g] = median;
+          }
+        }, 2);
+        for (IV g = 0; g < group_count; g++) {
+          if (result_na[g]) {
+            result->add_na_position(g);
           }
         }
+        return result;
+      }
+      
+      Func func;
+      if (func_name == "sum") {
+        func = SUM;
+      }
+      else if (func_name == "mean") {
+        func = MEAN;
+      }
+      else if (func_name == "min") {
+        func = MIN;
+      }
+      else if (func_name == "max") {
+        func = MAX;
+      }
+      else if (func_name == "sd") {
+        func = SD;
       }
       else {
-        rets = Rstats::Vector::new_logical(length, 0);
+        croak("Error in summarise: unknown function \"%s\"", func_name.c_str());
       }
       
-      return rets;
-    }
-
-    Rstats::Vector* is_positive_infinite(Rstats::Vector* elements) {
-      
-      IV length = elements->get_length();
-      Rstats::Vector* rets;
-      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
-        rets = Rstats::Vector::new_logical(length);
-        std::vector<NV>* values = elements->get_double_values();
-        std::vector<IV>* rets_values = rets->get_integer_values();
-        for (IV i = 0; i < length; i++) {
-          if(std::isinf((*values)[i]) && (*values)[i] > 0) {
-            (*rets_values)[i] = 1;
+      // Each chunk aggregates its rows to partial states, and the states are combined in order of chunks
+      std::map<IV, std::vector<State> > chunks;
+      std::mutex chunks_mutex;
+      Rstats::ThreadPool::parallel_for(length, [&](IV begin, IV end) {
+        std::vector<State> states(group_count);
+        for (IV g = 0; g < group_count; g++) {
+          init_state(states[g]);
+        }
+        for (IV i = begin; i < end; i++) {
+          State& state = states[groups[i]];
+          NV value = is_double ? double_values[i] : (NV)integer_values[i];
+          IV integer_value = is_double ? 0 : integer_values[i];
+          if (!na.empty() && na[i]) {
+            if (!na_rm) {
+              state.na = true;
+            }
+            continue;
           }
-          else {
-            (*rets_values)[i] = 0;
+          if (na_rm && std::isnan(value)) {
+            continue;
           }
+          add_value(func, state, value, integer_value);
+        }
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        chunks[begin].swap(states);
+      });
+      std::vector<State> states;
+      for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if (states.empty()) {
+          states.swap(it->second);
+          continue;
+        }
+        for (IV g = 0; g < group_count; g++) {
+          combine_state(func, is_double, states[g], it->second[g]);
         }
       }
-      else {
-        rets = Rstats::Vector::new_logical(length, 0);
+      if (states.empty()) {
+        states.resize(group_count);
+        for (IV g = 0; g < group_count; g++) {
+          init_state(states[g]);
+        }
       }
       
-      return rets;
+      // Results are same as R. Sum, min and max of integers are integers.
+      bool integer_result = !is_double && (func == SUM || func == MIN || func == MAX);
+      Rstats::Vector* result = integer_result ? Rstats::Vector::new_integer(group_count) : Rstats::Vector::new_double(group_count);
+      for (IV g = 0; g < group_count; g++) {
+        State& state = states[g];
+        bool result_na = state.na;
+        NV value = NAN;
+        IV integer_value = 0;
+        switch (func) {
+          case SUM :
+            value = state.value;
+            integer_value = state.integer_value;
+            break;
+          case MEAN :
+            value = state.count > 0 ? state.value / state.count : NAN;
+            break;
+          case MIN :
+          case MAX :
+            if (state.count > 0) {
+              value = is_double ? state.value : (NV)state.integer_value;
+              integer_value = state.integer_value;
+            }
+            else if (integer_result) {
+              result_na = true;
+            }
+            else {
+              value = func == MIN ? INFINITY : -INFINITY;
+            }
+            break;
+          case SD :
+            if (state.count > 1) {
+              value = std::sqrt(state.m2 / (state.count - 1));
+            }
+            else {
+              result_na = true;
+            }
+            break;
+        }
+        if (result_na) {
+          result->add_na_position(g);
+        }
+        else if (integer_result) {
+          result->get_integer_values()[g] = integer_value;
+        }
+        else {
+          result->get_double_values()[g] = value;
+        }
+      }
+      
+      return result;
     }
-
-    Rstats::Vector* is_negative_infinite(Rstats::Vector* elements) {
+  };
+  
+  // Rstats::Util body
+  namespace Util {
+    // End of number("[+-]digits[.digits][e[+-]digits]") starting at str, or NULL if not number.
+    // integral is set to true if the number has neither fraction nor exponent.
+    static const char* scan_number (const char* str, const char* end, bool& integral) {
+      const char* p = str;
+      if (p < end && (*p == '+' || *p == '-')) {
+        p++;
+      }
       
-      IV length = elements->get_length();
-      Rstats::Vector* rets;
-      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
-        rets = Rstats::Vector::new_logical(length);
-        std::vector<NV>* values = elements->get_double_values();
-        std::vector<IV>* rets_values = rets->get_integer_values();
-        for (IV i = 0; i < length; i++) {
-          if(std::isinf((*values)[i]) && (*values)[i] < 0) {
-            (*rets_values)[i] = 1;
-          }
-          else {
-            (*rets_values)[i] = 0;
-          }
+      const char* digits_start = p;
+      while (p < end && isDIGIT(*p)) {
+        p++;
+      }
+      IV digit_count = p - digits_start;
+      integral = true;
+      
+      if (p < end && *p == '.') {
+        integral = false;
+        p++;
+        const char* fraction_start = p;
+        while (p < end && isDIGIT(*p)) {
+          p++;
         }
+        digit_count += p - fraction_start;
       }
-      else {
-        rets = Rstats::Vector::new_logical(length, 0);
+      if (digit_count == 0) {
+        return NULL;
       }
       
-      return rets;
-    }
-    
-    Rstats::Vector* is_nan(Rstats::Vector* elements) {
-      IV length = elements->get_length();
-      Rstats::Vector* rets = Rstats::Vector::new_logical(length);
-      if (elements->get_type() == Rstats::VectorType::DOUBLE) {
-        std::vector<NV>* values = elements->get_double_values();
-        std::vector<IV>* rets_values = rets->get_integer_values();
-        for (IV i = 0; i < length; i++) {
-          if(std::isnan((*values)[i])) {
-            (*rets_values)[i] = 1;
-          }
-          else {
-            (*rets_values)[i] = 0;
+      if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponent = p + 1;
+        if (exponent < end && (*exponent == '+' || *exponent == '-')) {
+          exponent++;
+        }
+        if (exponent < end && isDIGIT(*exponent)) {
+          integral = false;
+          p = exponent;
+          while (p < end && isDIGIT(*p)) {
+            p++;
           }
         }
       }
-      else {
-        rets = Rstats::Vector::new_logical(length, 0);
-      }
       
-      return rets;
+      return p;
     }
-
-    Rstats::Vector* is_finite(Rstats::Vector* elements) {
+    
+    // Double value of a string returned by scan_number. Overflow is Inf(or -Inf) and underflow is 0.
+    // Return false if the string can't be parsed.
+    static bool read_number (const char* str, const char* end, NV& value) {
+      if (*str == '+') {
+        str++;
+      }
+#ifdef RSTATS_HAVE_FLOAT_CHARCONV
+      double result = 0;
+      std::from_chars_result ret = std::from_chars(str, end, result);
+      if (ret.ec == std::errc::result_out_of_range) {
+        // strtod returns HUGE_VAL or 0
+        std::string buffer(str, end);
+        result = strtod(buffer.c_str(), NULL);
+      }
+      else if (ret.ec != std::errc() || ret.ptr != end) {
+        return false;
+      }
+      value = result;
+      return true;
+#else
+      std::string buffer(str, end);
+      char* parsed_end;
+      value = strtod(buffer.c_str(), &parsed_end);
+      return parsed_end == buffer.c_str() + buffer.size();
+#endif
+    }
+    
+    // Classify a string and parse its value in one pass.
+    // "NA" is logical NA. Surrounding spaces are ignored. Not a value is character.
+    Rstats::VectorType::Enum parse_scalar (const char* str, STRLEN length, Rstats::Util::Scalar& scalar) {
+      scalar.na = false;
+      scalar.iv = 0;
+      scalar.re = 0;
+      scalar.im = 0;
+      
+      if (length == 2 && str[0] == 'N' && str[1] == 'A') {
+        scalar.na = true;
+        return Rstats::VectorType::LOGICAL;
+      }
       
-      IV length = elements->get_length();
-      Rstats::Vector* rets;
-      if (elements->is_integer()) {
-        rets = Rstats::Vector::new_logical(length, 1);
+      const char* p = str;
+      const char* end = str + length;
+      while (p < end && *p == ' ') {
+        p++;
       }
-      else if (elements->is_double()) {
-        std::vector<NV>* values = elements->get_double_values();
-        rets = Rstats::Vector::new_logical(length);
-        std::vector<IV>* rets_values = rets->get_integer_values();
-        for (IV i = 0; i < length; i++) {
-          if (std::isfinite((*values)[i])) {
-            (*rets_values)[i] = 1;
-          }
-          else {
-            (*rets_values)[i] = 0;
+      while (end > p && end[-1] == ' ') {
+        end--;
+      }
+      STRLEN span = end - p;
+      if (span == 0) {
+        return Rstats::VectorType::CHARACTER;
+      }
+      
+      // Logical
+      if (*p == 'T' || *p == 'F') {
+        if (span == 1 || (span == 4 && memcmp(p, "TRUE", 4) == 0) || (span == 5 && memcmp(p, "FALSE", 5) == 0)) {
+          scalar.iv = *p == 'T' ? 1 : 0;
+          scalar.re = (NV)scalar.iv;
+          return Rstats::VectorType::LOGICAL;
+        }
+        return Rstats::VectorType::CHARACTER;
+      }
+      
+      // Not finite double
+      const char* name = (*p == '+' || *p == '-') ? p + 1 : p;
+      if (end - name == 3 && (memcmp(name, "Inf", 3) == 0 || (name == p && memcmp(name, "NaN", 3) == 0))) {
+        scalar.re = *name == 'N' ? std::numeric_limits<NV>::quiet_NaN()
+          : (*p == '-' ? -std::numeric_limits<NV>::infinity() : std::numeric_limits<NV>::infinity());
+        return Rstats::VectorType::DOUBLE;
+      }
+      
+      bool integral;
+      const char* number_end = scan_number(p, end, integral);
+      if (number_end == NULL) {
+        return Rstats::VectorType::CHARACTER;
+      }
+      
+      // Integer or double
+      if (number_end == end) {
+        if (integral) {
+          const char* start = *p == '+' ? p + 1 : p;
+          std::from_chars_result result = std::from_chars(start, end, scalar.iv);
+          if (result.ec == std::errc()) {
+            scalar.re = (NV)scalar.iv;
+            return Rstats::VectorType::INTEGER;
           }
         }
+        return read_number(p, end, scalar.re) ? Rstats::VectorType::DOUBLE : Rstats::VectorType::CHARACTER;
       }
-      else {
-        rets = Rstats::Vector::new_logical(length, 0);
+      
+      // Imaginary number only
+      if (number_end + 1 == end && *number_end == 'i') {
+        return read_number(p, number_end, scalar.im) ? Rstats::VectorType::COMPLEX : Rstats::VectorType::CHARACTER;
       }
       
-      return rets;
+      // Complex number
+      if (*number_end == '+' || *number_end == '-') {
+        bool im_integral;
+        const char* im_end = scan_number(number_end, end, im_integral);
+        if (im_end != NULL && im_end + 1 == end && *im_end == 'i') {
+          if (read_number(p, number_end, scalar.re) && read_number(number_end, im_end, scalar.im)) {
+            return Rstats::VectorType::COMPLEX;
+          }
+        }
+      }
+      
+      return Rstats::VectorType::CHARACTER;
     }
-  }
-  
-  // Rstats::Util body
-  namespace Util {
-    REGEXP* LOGICAL_RE = pregcomp(newSVpv("^ *(T|TRUE|F|FALSE) *$", 0), 0);
-    REGEXP* LOGICAL_TRUE_RE = pregcomp(newSVpv("T", 0), 0);
-    REGEXP* INTEGER_RE = pregcomp(newSVpv("^ *([\\-\\+]?[0-9]+) *$", 0), 0);
-    REGEXP* DOUBLE_RE = pregcomp(newSVpv("^ *([\\-\\+]?[0-9]+(?:\\.[0-9]+)?) *$", 0), 0);
-    REGEXP* COMPLEX_IMAGE_ONLY_RE = pregcomp(newSVpv("^ *([\\+\\-]?[0-9]+(?:\\.[0-9]+)?)i *$", 0), 0);
-    REGEXP* COMPLEX_RE = pregcomp(newSVpv("^ *([\\+\\-]?[0-9]+(?:\\.[0-9]+)?)(?:([\\+\\-][0-9]+(?:\\.[0-9]+)?)i)? *$", 0), 0);
     
     SV* looks_like_complex (SV* sv_value) {
       
-      SV* sv_ret;
       if (!SvOK(sv_value) || sv_len(sv_value) == 0) {
-        sv_ret = &PL_sv_undef;
+        return &PL_sv_undef;
       }
-      else {
-        SV* sv_re;
-        SV* sv_im;
-        if (Rstats::PerlAPI::pregexec_simple(sv_value, COMPLEX_IMAGE_ONLY_RE)) {
-          sv_re = Rstats::PerlAPI::new_mSVnv(0);
-          SV* sv_im_str = Rstats::PerlAPI::new_mSVpv_nolen("");
-          Perl_reg_numbered_buff_fetch(aTHX_ COMPLEX_IMAGE_ONLY_RE, 1, sv_im_str);
-          sv_im = Rstats::PerlAPI::new_mSVnv(SvNV(sv_im_str));
-          
-          sv_ret = Rstats::PerlAPI::new_mHVRV();
-          Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "re", sv_re);
-          Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "im", sv_im);
-        }
-        else if(Rstats::PerlAPI::pregexec_simple(sv_value, COMPLEX_RE)) {
-          SV* sv_re_str = Rstats::PerlAPI::new_mSVpv_nolen("");
-          Perl_reg_numbered_buff_fetch(aTHX_ COMPLEX_RE, 1, sv_re_str);
-          sv_re = Rstats::PerlAPI::new_mSVnv(SvNV(sv_re_str));
-
-          SV* sv_im_str = Rstats::PerlAPI::new_mSVpv_nolen("");
-          Perl_reg_numbered_buff_fetch(aTHX_ COMPLEX_RE, 2, sv_im_str);
-          if (SvOK(sv_im_str)) {
-            sv_im = Rstats::PerlAPI::new_mSVnv(SvNV(sv_im_str));
-          }
-          else {
-            sv_im = Rstats::PerlAPI::new_mSVnv(0);
-          }
-
-          sv_ret = Rstats::PerlAPI::new_mHVRV();
-          Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "re", sv_re);
-          Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "im", sv_im);
-        }
-        else {
-          sv_ret = &PL_sv_undef;
-        }
+      
+      STRLEN length;
+      const char* str = SvPV(sv_value, length);
+      Rstats::Util::Scalar scalar;
+      Rstats::VectorType::Enum type = Rstats::Util::parse_scalar(str, length, scalar);
+      if (scalar.na) {
+        return &PL_sv_undef;
+      }
+      
+      if (type == Rstats::VectorType::LOGICAL || type == Rstats::VectorType::CHARACTER) {
+        return &PL_sv_undef;
       }
       
+      SV* sv_ret = Rstats::PerlAPI::new_mHVRV();
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "re", Rstats::PerlAPI::new_mSVnv(scalar.re));
+      Rstats::PerlAPI::hvrv_store_nolen_inc(sv_ret, "im", Rstats::PerlAPI::new_mSVnv(scalar.im));
+      
       return sv_ret;
     }
     
     SV* looks_like_logical (SV* sv_value) {
       
-      SV* sv_ret;
       if (!SvOK(sv_value) || sv_len(sv_value) == 0) {
-        sv_ret = &PL_sv_undef;
+        return &PL_sv_undef;
       }
-      else {
-        if (Rstats::PerlAPI::pregexec_simple(sv_value, LOGICAL_RE)) {
-          if (Rstats::PerlAPI::pregexec_simple(sv_value, LOGICAL_TRUE_RE)) {
-            sv_ret = Rstats::PerlAPI::new_mSViv(1);
-          }
-          else {
-            sv_ret = Rstats::PerlAPI::new_mSViv(0);
-          }
-        }
-        else {
-          sv_ret = &PL_sv_undef;
-        }
+      
+      STRLEN length;
+      const char* str = SvPV(sv_value, length);
+      Rstats::Util::Scalar scalar;
+      Rstats::VectorType::Enum type = Rstats::Util::parse_scalar(str, length, scalar);
+      if (type == Rstats::VectorType::LOGICAL && !scalar.na) {
+        return Rstats::PerlAPI::new_mSViv(scalar.iv);
       }
-      return sv_ret;
+      
+      return &PL_sv_undef;
     }
 
     SV* looks_like_na (SV* sv_value) {
@@ -2625,9 +9630,10 @@ namespace Rstats {
         sv_ret = &PL_sv_undef;
       }
       else {
-        SV* sv_na = Rstats::PerlAPI::new_mSVpv_nolen("NA");
-        if (sv_cmp(sv_value, sv_na) == 0) {
-          sv_ret = Rstats::PerlAPI::to_perl_obj(Rstats::Vector::new_na(), "Rstats::Vector");
+        STRLEN length;
+        const char* str = SvPV(sv_value, length);
+        if (length == 2 && str[0] == 'N' && str[1] == 'A') {
+          sv_ret = Rstats::PerlAPI::to_perl_obj(Rstats::Vector::shared_na(), "Rstats::Vector");
         }
         else {
           sv_ret = &PL_sv_undef;
@@ -2639,44 +9645,266 @@ namespace Rstats {
     
     SV* looks_like_integer(SV* sv_str) {
       
-      SV* sv_ret;
       if (!SvOK(sv_str) || sv_len(sv_str) == 0) {
-        sv_ret = &PL_sv_undef;
+        return &PL_sv_undef;
       }
-      else {
-        IV ret = Rstats::PerlAPI::pregexec_simple(sv_str, INTEGER_RE);
-        if (ret) {
-          SV* match1 = Rstats::PerlAPI::new_mSVpv_nolen("");
-          Perl_reg_numbered_buff_fetch(aTHX_ INTEGER_RE, 1, match1);
-          sv_ret = Rstats::PerlAPI::new_mSViv(SvIV(match1));
-        }
-        else {
-          sv_ret = &PL_sv_undef;
-        }
+      
+      STRLEN length;
+      const char* str = SvPV(sv_str, length);
+      Rstats::Util::Scalar scalar;
+      Rstats::VectorType::Enum type = Rstats::Util::parse_scalar(str, length, scalar);
+      if (type == Rstats::VectorType::INTEGER) {
+        return Rstats::PerlAPI::new_mSViv(scalar.iv);
       }
       
-      return sv_ret;
+      return &PL_sv_undef;
     }
 
     SV* looks_like_double (SV* sv_value) {
       
-      SV* sv_ret;
       if (!SvOK(sv_value) || sv_len(sv_value) == 0) {
-        sv_ret =  &PL_sv_undef;
+        return &PL_sv_undef;
       }
-      else {
-        IV ret = Rstats::PerlAPI::pregexec_simple(sv_value, DOUBLE_RE);
-        if (ret) {
-          SV* match1 = Rstats::PerlAPI::new_mSVpv_nolen("");
-          Perl_reg_numbered_buff_fetch(aTHX_ DOUBLE_RE, 1, match1);
-          sv_ret = Rstats::PerlAPI::new_mSVnv(SvNV(match1));
+      
+      STRLEN length;
+      const char* str = SvPV(sv_value, length);
+      Rstats::Util::Scalar scalar;
+      Rstats::VectorType::Enum type = Rstats::Util::parse_scalar(str, length, scalar);
+      if (type == Rstats::VectorType::INTEGER || type == Rstats::VectorType::DOUBLE) {
+        return Rstats::PerlAPI::new_mSVnv(scalar.re);
+      }
+      
+      return &PL_sv_undef;
+    }
+
+    bool is_ascii (const char* str, STRLEN length) {
+      for (STRLEN i = 0; i < length; i++) {
+        if ((U8)str[i] >= 0x80) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // ASCII letters are converted and other bytes are copied. str and ret can be same.
+    void ascii_case_convert (const char* str, STRLEN length, char* ret, bool upper) {
+      const char from = upper ? 'a' : 'A';
+      STRLEN i = 0;
+#ifdef __SSE2__
+      const __m128i lower_bound = _mm_set1_epi8(from - 1);
+      const __m128i upper_bound = _mm_set1_epi8(from + 26);
+      const __m128i flip = _mm_set1_epi8(0x20);
+      for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i is_letter = _mm_and_si128(
+          _mm_cmpgt_epi8(chunk, lower_bound),
+          _mm_cmplt_epi8(chunk, upper_bound)
+        );
+        _mm_storeu_si128((__m128i*)(ret + i), _mm_xor_si128(chunk, _mm_and_si128(is_letter, flip)));
+      }
+#endif
+      for (; i < length; i++) {
+        char c = str[i];
+        ret[i] = (c >= from && c < from + 26) ? (char)(c ^ 0x20) : c;
+      }
+    }
+
+    // Count of code points(bytes except continuation bytes)
+    STRLEN count_utf8_chars (const char* str, STRLEN length) {
+      STRLEN count = 0;
+      for (STRLEN i = 0; i < length; i++) {
+        count += ((U8)str[i] & 0xC0) != 0x80;
+      }
+      return count;
+    }
+
+    // Byte offset of the char_pos-th code point
+    STRLEN utf8_char_offset (const char* str, STRLEN length, STRLEN char_pos) {
+      STRLEN count = 0;
+      for (STRLEN i = 0; i < length; i++) {
+        if (((U8)str[i] & 0xC0) != 0x80) {
+          if (count == char_pos) {
+            return i;
+          }
+          count++;
+        }
+      }
+      return length;
+    }
+
+    // Byte length after Latin-1 to UTF-8 conversion if convert is true
+    STRLEN get_converted_length (const char* str, STRLEN length, bool convert) {
+      if (!convert) {
+        return length;
+      }
+      STRLEN converted_length = length;
+      for (STRLEN i = 0; i < length; i++) {
+        converted_length += (U8)str[i] >> 7;
+      }
+      return converted_length;
+    }
+
+    // Write str converting Latin-1 to UTF-8 if convert is true. Return end of written bytes.
+    char* write_converted (char* out, const char* str, STRLEN length, bool convert) {
+      if (!convert) {
+        memcpy(out, str, length);
+        return out + length;
+      }
+      for (STRLEN i = 0; i < length; i++) {
+        U8 c = (U8)str[i];
+        if (c < 0x80) {
+          *out++ = (char)c;
         }
         else {
-          sv_ret = &PL_sv_undef;
+          *out++ = (char)(0xC0 | (c >> 6));
+          *out++ = (char)(0x80 | (c & 0x3F));
+        }
+      }
+      return out;
+    }
+
+    // Scientific form "-d.ddde+xx" with precision digits after the point.
+    // precision -1 is the shortest form which reads back to the same double.
+    static char* format_scientific (char* out, double value, int precision) {
+#ifdef RSTATS_HAVE_FLOAT_CHARCONV
+      if (precision < 0) {
+        return std::to_chars(out, out + RSTATS_NUMBER_BUFFER_SIZE, value, std::chars_format::scientific).ptr;
+      }
+      return std::to_chars(out, out + RSTATS_NUMBER_BUFFER_SIZE, value, std::chars_format::scientific, precision).ptr;
+#else
+      // Precision is increased until the value reads back
+      int length = 0;
+      for (int p = precision < 0 ? 0 : precision; ; p++) {
+        length = snprintf(out, RSTATS_NUMBER_BUFFER_SIZE, "%.*e", p, value);
+        if (precision >= 0 || p >= 16 || strtod(out, NULL) == value) {
+          break;
+        }
+      }
+      return out + length;
+#endif
+    }
+
+    // Shortest representation which reads back to the same double. If it needs more than
+    // digits significant digits, value is rounded to digits. Layout is same as printf's %g.
+    // out needs RSTATS_NUMBER_BUFFER_SIZE bytes. Return end of written bytes.
+    char* format_double (char* out, NV value, IV digits) {
+      if (std::isnan(value)) {
+        memcpy(out, "NaN", 3);
+        return out + 3;
+      }
+      else if (std::isinf(value)) {
+        if (value < 0) {
+          memcpy(out, "-Inf", 4);
+          return out + 4;
+        }
+        memcpy(out, "Inf", 3);
+        return out + 3;
+      }
+      else if (value == 0) {
+        *out = '0';
+        return out + 1;
+      }
+      
+      if (digits < 1) {
+        digits = 1;
+      }
+      else if (digits > 22) {
+        digits = 22;
+      }
+      
+      // Scientific form "-d.ddde+xx"
+      char scientific[RSTATS_NUMBER_BUFFER_SIZE];
+      char* end = format_scientific(scientific, (double)value, -1);
+      char* exponent_mark = (char*)memchr(scientific, 'e', end - scientific);
+      IV mantissa_length = (exponent_mark - scientific) - (value < 0) - (exponent_mark - scientific > 1 + (value < 0));
+      if (mantissa_length > digits) {
+        end = format_scientific(scientific, (double)value, (int)(digits - 1));
+        exponent_mark = (char*)memchr(scientific, 'e', end - scientific);
+      }
+      
+      // Significant digits without trailing zeros
+      char mantissa[RSTATS_NUMBER_BUFFER_SIZE];
+      IV mantissa_count = 0;
+      for (char* p = scientific + (value < 0); p < exponent_mark; p++) {
+        if (*p != '.') {
+          mantissa[mantissa_count++] = *p;
         }
       }
+      while (mantissa_count > 1 && mantissa[mantissa_count - 1] == '0') {
+        mantissa_count--;
+      }
+      IV exponent = 0;
+      std::from_chars(exponent_mark + 1 + (exponent_mark[1] == '+'), end, exponent);
       
-      return sv_ret;
+      if (value < 0) {
+        *out++ = '-';
+      }
+      if (exponent < -4 || exponent >= digits) {
+        *out++ = mantissa[0];
+        if (mantissa_count > 1) {
+          *out++ = '.';
+          memcpy(out, mantissa + 1, mantissa_count - 1);
+          out += mantissa_count - 1;
+        }
+        *out++ = 'e';
+        *out++ = exponent < 0 ? '-' : '+';
+        IV exponent_abs = exponent < 0 ? -exponent : exponent;
+        if (exponent_abs < 10) {
+          *out++ = '0';
+        }
+        out = std::to_chars(out, out + 4, exponent_abs).ptr;
+      }
+      else if (exponent < 0) {
+        *out++ = '0';
+        *out++ = '.';
+        for (IV i = 0; i < -exponent - 1; i++) {
+          *out++ = '0';
+        }
+        memcpy(out, mantissa, mantissa_count);
+        out += mantissa_count;
+      }
+      else {
+        for (IV i = 0; i <= exponent; i++) {
+          *out++ = i < mantissa_count ? mantissa[i] : '0';
+        }
+        if (mantissa_count > exponent + 1) {
+          *out++ = '.';
+          memcpy(out, mantissa + exponent + 1, mantissa_count - exponent - 1);
+          out += mantissa_count - exponent - 1;
+        }
+      }
+      
+      return out;
+    }
+
+    // Decimal representation of integer. Return end of written bytes.
+    char* format_integer (char* out, IV value) {
+      return std::to_chars(out, out + RSTATS_NUMBER_BUFFER_SIZE, value).ptr;
+    }
+
+    void append_code_point (std::string& str, UV code_point, bool utf8) {
+      if (!utf8) {
+        str += (char)code_point;
+        return;
+      }
+      U8 buffer[UTF8_MAXBYTES + 1];
+      U8* end = uvchr_to_utf8(buffer, code_point);
+      str.append((char*)buffer, end - buffer);
+    }
+
+    void latin1_to_utf8 (const char* str, STRLEN length, std::string& utf8_str) {
+      utf8_str.clear();
+      utf8_str.reserve(length * 2);
+      for (STRLEN i = 0; i < length; i++) {
+        U8 c = (U8)str[i];
+        if (c < 0x80) {
+          utf8_str += (char)c;
+        }
+        else {
+          utf8_str += (char)(0xC0 | (c >> 6));
+          utf8_str += (char)(0x80 | (c & 0x3F));
+        }
+      }
     }
   }
 }
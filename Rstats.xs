@@ -30,6 +30,27 @@
 
 namespace my = Rstats::PerlAPI;
 
+/* Key columns(array of hashes of vector and levels) */
+static void to_row_keys (SV* sv_keys, Rstats::RowKeys& keys) {
+  IV length = my::avrv_len_fix(sv_keys);
+  for (IV i = 0; i < length; i++) {
+    SV* sv_key = my::avrv_fetch_simple(sv_keys, i);
+    Rstats::Vector* vector = my::to_c_obj<Rstats::Vector*>(my::hvrv_fetch_simple(sv_key, "vector"));
+    SV* sv_levels = my::hvrv_fetch_simple(sv_key, "levels");
+    Rstats::Vector* levels = SvOK(sv_levels) ? my::to_c_obj<Rstats::Vector*>(sv_levels) : NULL;
+    keys.add(vector, levels);
+  }
+}
+
+/* Integer vector of positions */
+static SV* to_positions (std::vector<IV>& positions) {
+  Rstats::Vector* vector = Rstats::Vector::new_integer(positions.size());
+  if (!positions.empty()) {
+    memcpy(vector->get_integer_values(), positions.data(), positions.size() * sizeof(IV));
+  }
+  return my::to_perl_obj(vector, "Rstats::Vector");
+}
+
 MODULE = Rstats::Vector PACKAGE = Rstats::Vector
 
 SV* values(...)
@@ -40,6 +61,87 @@ SV* values(...)
   return_sv(sv_values);
 }
 
+SV* raw_values(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  SV* sv_values = self->get_raw_values();
+  return_sv(sv_values);
+}
+
+SV* packed_values(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  SV* sv_packed = self->get_packed_values();
+  return_sv(sv_packed);
+}
+
+SV* buffer(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+
+  char* buffer = self->get_buffer();
+  STRLEN size = self->get_buffer_size();
+
+  // Read-only string which aliases the vector storage and keeps the vector alive
+  SV* sv_buffer = sv_2mortal(newSV_type(SVt_PVMG));
+  SvPV_set(sv_buffer, buffer ? buffer : (char*)"");
+  SvCUR_set(sv_buffer, size);
+  SvLEN_set(sv_buffer, 0);
+  SvPOK_only(sv_buffer);
+  sv_magicext(sv_buffer, SvRV(ST(0)), PERL_MAGIC_ext, NULL, NULL, 0);
+  SvREADONLY_on(sv_buffer);
+
+  return_sv(sv_buffer);
+}
+
+SV* new_double_from_buffer(...)
+  PPCODE:
+{
+  STRLEN size;
+  char* buffer = SvPV(ST(0), size);
+  Rstats::Vector* elements = Rstats::Vector::new_double_from_buffer(buffer, size);
+  SV* sv_elements = my::to_perl_obj(elements, "Rstats::Vector");
+  return_sv(sv_elements);
+}
+
+SV* new_integer_from_buffer(...)
+  PPCODE:
+{
+  STRLEN size;
+  char* buffer = SvPV(ST(0), size);
+  IV element_size = items > 1 ? SvIV(ST(1)) : sizeof(IV);
+  Rstats::Vector* elements = Rstats::Vector::new_integer_from_buffer(buffer, size, element_size);
+  SV* sv_elements = my::to_perl_obj(elements, "Rstats::Vector");
+  return_sv(sv_elements);
+}
+
+SV* is_inline_values(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  SV* sv_is = my::new_mSViv(self->is_inline_values() ? 1 : 0);
+  return_sv(sv_is);
+}
+
+SV* re_values(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  SV* sv_values = self->get_complex_part_values(false);
+  return_sv(sv_values);
+}
+
+SV* im_values(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  SV* sv_values = self->get_complex_part_values(true);
+  return_sv(sv_values);
+}
+
 SV* value(...)
   PPCODE:
 {
@@ -132,7 +234,8 @@ SV* as_character(...)
   PPCODE:
 {
   Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
-  Rstats::Vector* e2 = self->as_character();
+  IV digits = items > 1 && SvOK(ST(1)) ? SvIV(ST(1)) : RSTATS_DOUBLE_DIGITS;
+  Rstats::Vector* e2 = self->as_character(digits);
   SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
   return_sv(sv_e2);
 }
@@ -251,13 +354,13 @@ compose(...)
         element = my::to_c_obj<Rstats::Vector*>(sv_element);
       }
       else {
-        element = Rstats::Vector::new_na();
+        element = Rstats::Vector::shared_na();
       }
       if (element->exists_na_position(0)) {
         na_positions.push_back(i);
       }
       else {
-        compose_elements->set_character_value(i, element->get_character_value(0));
+        compose_elements->set_character_value(i, element, 0);
       }
     }
   }
@@ -270,7 +373,7 @@ compose(...)
         element = my::to_c_obj<Rstats::Vector*>(sv_element);
       }
       else {
-        element = Rstats::Vector::new_na();
+        element = Rstats::Vector::shared_na();
       }
       if (element->exists_na_position(0)) {
         na_positions.push_back(i);
@@ -289,7 +392,7 @@ compose(...)
         element = my::to_c_obj<Rstats::Vector*>(sv_element);
       }
       else {
-        element = Rstats::Vector::new_na();
+        element = Rstats::Vector::shared_na();
       }
       if (element->exists_na_position(0)) {
         na_positions.push_back(i);
@@ -301,7 +404,7 @@ compose(...)
   }
   else if (strEQ(mode, "integer")) {
     compose_elements = Rstats::Vector::new_integer(len);
-    std::vector<IV>* values = compose_elements->get_integer_values();
+    IV* values = compose_elements->get_integer_values();
     for (IV i = 0; i < len; i++) {
       Rstats::Vector* element;
       SV* sv_element = my::avrv_fetch_simple(sv_elements, i);
@@ -309,7 +412,7 @@ compose(...)
         element = my::to_c_obj<Rstats::Vector*>(sv_element);
       }
       else {
-        element = Rstats::Vector::new_na();
+        element = Rstats::Vector::shared_na();
       }
       if (element->exists_na_position(0)) {
         na_positions.push_back(i);
@@ -321,7 +424,7 @@ compose(...)
   }
   else if (strEQ(mode, "logical")) {
     compose_elements = Rstats::Vector::new_logical(len);
-    std::vector<IV>* values = compose_elements->get_integer_values();
+    IV* values = compose_elements->get_integer_values();
     for (IV i = 0; i < len; i++) {
       Rstats::Vector* element;
       SV* sv_element = my::avrv_fetch_simple(sv_elements, i);
@@ -329,7 +432,7 @@ compose(...)
         element = my::to_c_obj<Rstats::Vector*>(sv_element);
       }
       else {
-        element = Rstats::Vector::new_na();
+        element = Rstats::Vector::shared_na();
       }
       if (element->exists_na_position(0)) {
         na_positions.push_back(i);
@@ -401,21 +504,26 @@ decompose(...)
     }
     else if (self->is_integer()) {
       for (IV i = 0; i < length; i++) {
-        Rstats::Vector* elements
-          = Rstats::Vector::new_integer(1, self->get_integer_value(i));
+        Rstats::Vector* elements;
         if (self->exists_na_position(i)) {
+          elements = Rstats::Vector::new_integer(1, self->get_integer_value(i));
           elements->add_na_position(0);
         }
+        else {
+          elements = Rstats::Vector::shared_integer(self->get_integer_value(i));
+        }
         SV* sv_elements = my::to_perl_obj(elements, "Rstats::Vector");
         my::avrv_push_inc(sv_decompose_elements, sv_elements);
       }
     }
     else if (self->is_logical()) {
       for (IV i = 0; i < length; i++) {
-        Rstats::Vector* elements
-          = Rstats::Vector::new_logical(1, self->get_integer_value(i));
+        Rstats::Vector* elements;
         if (self->exists_na_position(i)) {
-          elements->add_na_position(0);
+          elements = Rstats::Vector::shared_na();
+        }
+        else {
+          elements = Rstats::Vector::shared_logical(self->get_integer_value(i));
         }
         SV* sv_elements = my::to_perl_obj(elements, "Rstats::Vector");
         my::avrv_push_inc(sv_decompose_elements, sv_elements);
@@ -452,6 +560,28 @@ clone(...)
   return_sv(sv_e2);
 }
 
+SV*
+intern(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  
+  Rstats::Vector* e2 = self->intern();
+
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  
+  return_sv(sv_e2);
+}
+
+SV* is_interned(...)
+  PPCODE:
+{
+  Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
+  bool is = self->is_interned();
+  SV* sv_is = is ? my::new_mSViv(1) : my::new_mSViv(0);
+  return_sv(sv_is);
+}
+
 SV*
 is_infinite(...)
   PPCODE:
@@ -568,7 +698,7 @@ DESTROY(...)
 {
   Rstats::Vector* self = my::to_c_obj<Rstats::Vector*>(ST(0));
 
-  delete self;
+  self->dec_refcnt();
 }
 
 MODULE = Rstats::VectorFunc PACKAGE = Rstats::VectorFunc
@@ -709,6 +839,193 @@ equal(...)
   return_sv(sv_e3);
 }
 
+SV*
+match(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e2 = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* e3 = Rstats::VectorFunc::match(e1, e2);
+  SV* sv_e3 = my::to_perl_obj(e3, "Rstats::Vector");
+  return_sv(sv_e3);
+}
+
+SV*
+unique(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e2 = Rstats::VectorFunc::unique(e1);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+type_convert(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e2 = Rstats::VectorFunc::type_convert(e1);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+nchar(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  bool bytes = items > 1 && SvTRUE(ST(1));
+  Rstats::Vector* e2 = Rstats::VectorFunc::nchar(e1, bytes);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+toupper(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e2 = Rstats::VectorFunc::case_convert(e1, true);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+tolower(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e2 = Rstats::VectorFunc::case_convert(e1, false);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+chartr(...)
+  PPCODE:
+{
+  Rstats::Vector* e_old = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e_new = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(2));
+  Rstats::Vector* e2 = Rstats::VectorFunc::chartr(e_old, e_new, e1);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+grep(...)
+  PPCODE:
+{
+  Rstats::Vector* e_pattern = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(1));
+  bool ignore_case = items > 2 && SvTRUE(ST(2));
+  bool fixed = items > 3 && SvTRUE(ST(3));
+  Rstats::Vector* e2 = Rstats::VectorFunc::grep(e_pattern, e1, ignore_case, fixed);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+grepl(...)
+  PPCODE:
+{
+  Rstats::Vector* e_pattern = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(1));
+  bool ignore_case = items > 2 && SvTRUE(ST(2));
+  bool fixed = items > 3 && SvTRUE(ST(3));
+  Rstats::Vector* e2 = Rstats::VectorFunc::grepl(e_pattern, e1, ignore_case, fixed);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+regexpr(...)
+  PPCODE:
+{
+  Rstats::Vector* e_pattern = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(1));
+  bool ignore_case = items > 2 && SvTRUE(ST(2));
+  bool fixed = items > 3 && SvTRUE(ST(3));
+  Rstats::Vector* e_match_length;
+  Rstats::Vector* e2 = Rstats::VectorFunc::regexpr(e_pattern, e1, ignore_case, fixed, &e_match_length);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  SV* sv_match_length = my::to_perl_obj(e_match_length, "Rstats::Vector");
+  XPUSHs(sv_e2);
+  XPUSHs(sv_match_length);
+  XSRETURN(2);
+}
+
+SV*
+sub(...)
+  PPCODE:
+{
+  Rstats::Vector* e_pattern = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e_replacement = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(2));
+  bool ignore_case = items > 3 && SvTRUE(ST(3));
+  bool fixed = items > 4 && SvTRUE(ST(4));
+  Rstats::Vector* e2 = Rstats::VectorFunc::sub(e_pattern, e_replacement, e1, ignore_case, fixed, false);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+gsub(...)
+  PPCODE:
+{
+  Rstats::Vector* e_pattern = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e_replacement = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(2));
+  bool ignore_case = items > 3 && SvTRUE(ST(3));
+  bool fixed = items > 4 && SvTRUE(ST(4));
+  Rstats::Vector* e2 = Rstats::VectorFunc::sub(e_pattern, e_replacement, e1, ignore_case, fixed, true);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+substr(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  Rstats::Vector* e_start = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* e_stop = my::to_c_obj<Rstats::Vector*>(ST(2));
+  bool bytes = items > 3 && SvTRUE(ST(3));
+  Rstats::Vector* e2 = Rstats::VectorFunc::substr(e1, e_start, e_stop, bytes);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+paste(...)
+  PPCODE:
+{
+  SV* sv_sep = ST(0);
+  SV* sv_collapse = ST(1);
+  std::vector<Rstats::Vector*> elements_list;
+  for (IV i = 2; i < items; i++) {
+    elements_list.push_back(my::to_c_obj<Rstats::Vector*>(ST(i)));
+  }
+  Rstats::Vector* e2 = Rstats::VectorFunc::paste(elements_list, sv_sep, sv_collapse);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+sprintf(...)
+  PPCODE:
+{
+  Rstats::Vector* e_fmt = my::to_c_obj<Rstats::Vector*>(ST(0));
+  std::vector<Rstats::Vector*> elements_list;
+  for (IV i = 1; i < items; i++) {
+    elements_list.push_back(my::to_c_obj<Rstats::Vector*>(ST(i)));
+  }
+  Rstats::Vector* e2 = Rstats::VectorFunc::sprintf(e_fmt, elements_list);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
 SV*
 sum(...)
   PPCODE:
@@ -719,6 +1036,89 @@ sum(...)
   return_sv(sv_e2);
 }
 
+SV*
+sort(...)
+  PPCODE:
+{
+  Rstats::Vector* e1 = my::to_c_obj<Rstats::Vector*>(ST(0));
+  bool decreasing = items > 1 && SvTRUE(ST(1));
+  Rstats::Vector* e2 = Rstats::VectorFunc::sort(e1, decreasing);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
+SV*
+new_mapped_file(...)
+  PPCODE:
+{
+  const char* file = SvPV_nolen(ST(0));
+  const char* type_name = items > 1 ? SvPV_nolen(ST(1)) : "double";
+  bool read_only = items > 2 ? SvTRUE(ST(2)) : true;
+  Rstats::VectorType::Enum type;
+  if (strEQ(type_name, "double")) {
+    type = Rstats::VectorType::DOUBLE;
+  }
+  else if (strEQ(type_name, "integer")) {
+    type = Rstats::VectorType::INTEGER;
+  }
+  else {
+    croak("Invalid type '%s'(Rstats::VectorFunc::new_mapped_file())", type_name);
+  }
+  Rstats::Vector* e1 = Rstats::VectorFunc::new_mapped_file(file, type, read_only);
+  SV* sv_e1 = my::to_perl_obj(e1, "Rstats::Vector");
+  return_sv(sv_e1);
+}
+
+SV*
+row_positions(...)
+  PPCODE:
+{
+  Rstats::Vector* index = my::to_c_obj<Rstats::Vector*>(ST(0));
+  IV row_count = SvIV(ST(1));
+  Rstats::Vector* positions = Rstats::VectorFunc::row_positions(index, row_count);
+  SV* sv_positions = my::to_perl_obj(positions, "Rstats::Vector");
+  return_sv(sv_positions);
+}
+
+SV*
+gather_columns(...)
+  PPCODE:
+{
+  SV* sv_columns = ST(0);
+  Rstats::Vector* positions = my::to_c_obj<Rstats::Vector*>(ST(1));
+  
+  std::vector<Rstats::Vector*> columns;
+  IV length = my::avrv_len_fix(sv_columns);
+  for (IV i = 0; i < length; i++) {
+    columns.push_back(my::to_c_obj<Rstats::Vector*>(my::avrv_fetch_simple(sv_columns, i)));
+  }
+  std::vector<Rstats::Vector*> results;
+  Rstats::VectorFunc::gather_columns(columns, positions, results);
+  
+  SV* sv_results = my::new_mAVRV();
+  for (size_t i = 0; i < results.size(); i++) {
+    my::avrv_push_inc(sv_results, my::to_perl_obj(results[i], "Rstats::Vector"));
+  }
+  return_sv(sv_results);
+}
+
+SV*
+complete_rows(...)
+  PPCODE:
+{
+  SV* sv_columns = ST(0);
+  IV row_count = SvIV(ST(1));
+  
+  std::vector<Rstats::Vector*> columns;
+  IV length = my::avrv_len_fix(sv_columns);
+  for (IV i = 0; i < length; i++) {
+    columns.push_back(my::to_c_obj<Rstats::Vector*>(my::avrv_fetch_simple(sv_columns, i)));
+  }
+  Rstats::Vector* e2 = Rstats::VectorFunc::complete_rows(columns, row_count);
+  SV* sv_e2 = my::to_perl_obj(e2, "Rstats::Vector");
+  return_sv(sv_e2);
+}
+
 SV*
 add(...)
   PPCODE:
@@ -922,7 +1322,7 @@ SV*
 new_negative_inf(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_negative_inf();
+  Rstats::Vector* element = Rstats::Vector::shared_negative_inf();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -931,7 +1331,7 @@ SV*
 new_inf(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_inf();
+  Rstats::Vector* element = Rstats::Vector::shared_inf();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -940,7 +1340,7 @@ SV*
 new_nan(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_nan();
+  Rstats::Vector* element = Rstats::Vector::shared_nan();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -949,7 +1349,7 @@ SV*
 new_na(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_na();
+  Rstats::Vector* element = Rstats::Vector::shared_na();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -1049,6 +1449,15 @@ SV*
 new_logical(...)
   PPCODE:
 {
+  if (items == 1) {
+    SV* sv_value = ST(0);
+    Rstats::Vector* element = SvOK(sv_value)
+      ? Rstats::Vector::shared_logical(SvIV(sv_value))
+      : Rstats::Vector::shared_na();
+    SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
+    return_sv(sv_element);
+  }
+
   Rstats::Vector* element = Rstats::Vector::new_logical(items);
   for (int i = 0; i < items; i++) {
     SV* sv_value = ST(i);
@@ -1068,7 +1477,7 @@ SV*
 new_true(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_true();
+  Rstats::Vector* element = Rstats::Vector::shared_true();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -1077,7 +1486,7 @@ SV*
 new_false(...)
   PPCODE:
 {
-  Rstats::Vector* element = Rstats::Vector::new_false();
+  Rstats::Vector* element = Rstats::Vector::shared_false();
   SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
   return_sv(sv_element);
 }
@@ -1117,6 +1526,12 @@ SV*
 new_integer(...)
   PPCODE:
 {
+  if (items == 1 && SvOK(ST(0))) {
+    Rstats::Vector* element = Rstats::Vector::shared_integer(SvIV(ST(0)));
+    SV* sv_element = my::to_perl_obj(element, "Rstats::Vector");
+    return_sv(sv_element);
+  }
+
   Rstats::Vector* element = Rstats::Vector::new_integer(items);
   for (int i = 0; i < items; i++) {
     SV* sv_value = ST(i);
@@ -1179,6 +1594,68 @@ looks_like_complex(...)
   return_sv(sv_ret);
 }
 
+SV*
+pool_stats(...)
+  PPCODE:
+{
+  SV* sv_stats = Rstats::Memory::get_stats();
+  return_sv(sv_stats);
+}
+
+SV*
+get_thread_count(...)
+  PPCODE:
+{
+  SV* sv_count = my::new_mSViv(Rstats::ThreadPool::get_thread_count());
+  return_sv(sv_count);
+}
+
+SV*
+set_thread_count(...)
+  PPCODE:
+{
+  Rstats::ThreadPool::set_thread_count(SvIV(ST(0)));
+  XSRETURN(0);
+}
+
+SV*
+get_sort_memory(...)
+  PPCODE:
+{
+  SV* sv_memory = my::new_mSViv(Rstats::VectorFunc::get_sort_memory());
+  return_sv(sv_memory);
+}
+
+SV*
+set_sort_memory(...)
+  PPCODE:
+{
+  Rstats::VectorFunc::set_sort_memory(SvIV(ST(0)));
+  XSRETURN(0);
+}
+
+SV*
+interned_string_count(...)
+  PPCODE:
+{
+  SV* sv_count = my::new_mSViv(Rstats::StringPool::get_count());
+  return_sv(sv_count);
+}
+
+SV*
+compress_formats(...)
+  PPCODE:
+{
+  SV* sv_formats = my::new_mAVRV();
+#ifdef RSTATS_HAVE_ZLIB
+  my::avrv_push_inc(sv_formats, my::new_mSVpv_nolen("gzip"));
+#endif
+#ifdef RSTATS_HAVE_ZSTD
+  my::avrv_push_inc(sv_formats, my::new_mSVpv_nolen("zstd"));
+#endif
+  return_sv(sv_formats);
+}
+
 SV*
 cross_product(...)
   PPCODE:
@@ -1291,4 +1768,359 @@ index_to_pos(...)
   return_sv(sv_pos);
 }
 
+MODULE = Rstats::TableReader PACKAGE = Rstats::TableReader
+
+SV*
+new(...)
+  PPCODE:
+{
+  SV* sv_class = ST(0);
+  SV* sv_file = ST(1);
+  SV* sv_options = items > 2 ? ST(2) : &PL_sv_undef;
+  Rstats::TableReader* self = new Rstats::TableReader;
+  SV* sv_self = my::to_perl_obj(self, SvPV_nolen(sv_class));
+  self->open(sv_file, sv_options);
+  return_sv(sv_self);
+}
+
+SV*
+names(...)
+  PPCODE:
+{
+  Rstats::TableReader* self = my::to_c_obj<Rstats::TableReader*>(ST(0));
+  std::vector<std::string>& names = self->get_names();
+  SV* sv_names = my::new_mAVRV();
+  for (size_t i = 0; i < names.size(); i++) {
+    SV* sv_name = my::new_mSVpvn(names[i].data(), names[i].size());
+    if (self->is_utf8() && !Rstats::Util::is_ascii(names[i].data(), names[i].size())) {
+      SvUTF8_on(sv_name);
+    }
+    my::avrv_push_inc(sv_names, sv_name);
+  }
+  return_sv(sv_names);
+}
+
+SV*
+upgrades(...)
+  PPCODE:
+{
+  Rstats::TableReader* self = my::to_c_obj<Rstats::TableReader*>(ST(0));
+  std::vector<std::string>& upgrades = self->get_upgrades();
+  SV* sv_upgrades = my::new_mAVRV();
+  for (size_t i = 0; i < upgrades.size(); i++) {
+    SV* sv_upgrade = my::new_mSVpvn(upgrades[i].data(), upgrades[i].size());
+    if (self->is_utf8() && !Rstats::Util::is_ascii(upgrades[i].data(), upgrades[i].size())) {
+      SvUTF8_on(sv_upgrade);
+    }
+    my::avrv_push_inc(sv_upgrades, sv_upgrade);
+  }
+  return_sv(sv_upgrades);
+}
+
+SV*
+classes(...)
+  PPCODE:
+{
+  Rstats::TableReader* self = my::to_c_obj<Rstats::TableReader*>(ST(0));
+  std::vector<std::string>& classes = self->get_classes();
+  SV* sv_classes = my::new_mAVRV();
+  for (size_t i = 0; i < classes.size(); i++) {
+    if (classes[i].empty()) {
+      my::avrv_push_inc(sv_classes, my::new_mSVsv(&PL_sv_undef));
+    }
+    else {
+      my::avrv_push_inc(sv_classes, my::new_mSVpvn(classes[i].data(), classes[i].size()));
+    }
+  }
+  return_sv(sv_classes);
+}
+
+SV*
+read(...)
+  PPCODE:
+{
+  Rstats::TableReader* self = my::to_c_obj<Rstats::TableReader*>(ST(0));
+  IV max_rows = items > 1 && SvOK(ST(1)) ? SvIV(ST(1)) : -1;
+  std::vector<Rstats::Vector*> vectors;
+  if (!self->read(max_rows, vectors)) {
+    return_sv(&PL_sv_undef);
+  }
+  SV* sv_vectors = my::new_mAVRV();
+  for (size_t i = 0; i < vectors.size(); i++) {
+    my::avrv_push_inc(sv_vectors, my::to_perl_obj(vectors[i], "Rstats::Vector"));
+  }
+  return_sv(sv_vectors);
+}
+
+SV*
+DESTROY(...)
+  PPCODE:
+{
+  Rstats::TableReader* self = my::to_c_obj<Rstats::TableReader*>(ST(0));
+  delete self;
+}
+
+MODULE = Rstats::TableWriter PACKAGE = Rstats::TableWriter
+
+SV*
+write(...)
+  PPCODE:
+{
+  SV* sv_file = ST(1);
+  SV* sv_columns = ST(2);
+  SV* sv_ncol = ST(3);
+  SV* sv_row_names = ST(4);
+  SV* sv_col_names = ST(5);
+  SV* sv_options = items > 6 ? ST(6) : &PL_sv_undef;
+  
+  // The file is closed before croak
+  std::string error;
+  bool ok;
+  {
+    Rstats::TableWriter writer(sv_columns, sv_ncol, sv_row_names, sv_col_names, sv_options);
+    ok = writer.write(SvPV_nolen(sv_file), error);
+  }
+  if (!ok) {
+    croak("%s(Rstats::TableWriter::write())", error.c_str());
+  }
+  
+  XSRETURN(0);
+}
+
+MODULE = Rstats::BinaryFile PACKAGE = Rstats::BinaryFile
+
+SV*
+save(...)
+  PPCODE:
+{
+  SV* sv_file = ST(1);
+  SV* sv_vectors = ST(2);
+  SV* sv_meta = ST(3);
+  
+  std::vector<Rstats::Vector*> vectors;
+  IV length = my::avrv_len_fix(sv_vectors);
+  for (IV i = 0; i < length; i++) {
+    vectors.push_back(my::to_c_obj<Rstats::Vector*>(my::avrv_fetch_simple(sv_vectors, i)));
+  }
+  STRLEN meta_size;
+  const char* meta = SvPV(sv_meta, meta_size);
+  
+  std::string error;
+  if (!Rstats::BinaryFile::save(SvPV_nolen(sv_file), vectors, meta, meta_size, error)) {
+    croak("%s(Rstats::BinaryFile::save())", error.c_str());
+  }
+  
+  XSRETURN(0);
+}
+
+SV*
+load(...)
+  PPCODE:
+{
+  SV* sv_file = ST(1);
+  
+  std::vector<Rstats::Vector*> vectors;
+  std::string meta;
+  std::string error;
+  if (!Rstats::BinaryFile::load(SvPV_nolen(sv_file), vectors, meta, error)) {
+    croak("%s(Rstats::BinaryFile::load())", error.c_str());
+  }
+  
+  SV* sv_vectors = my::new_mAVRV();
+  for (size_t i = 0; i < vectors.size(); i++) {
+    my::avrv_push_inc(sv_vectors, my::to_perl_obj(vectors[i], "Rstats::Vector"));
+  }
+  SV* sv_result = my::new_mAVRV();
+  my::avrv_push_inc(sv_result, my::new_mSVpvn(meta.data(), meta.size()));
+  my::avrv_push_inc(sv_result, sv_vectors);
+  return_sv(sv_result);
+}
+
+MODULE = Rstats::ArrowFile PACKAGE = Rstats::ArrowFile
+
+SV*
+write(...)
+  PPCODE:
+{
+  SV* sv_file = ST(1);
+  SV* sv_columns = ST(2);
+  
+  // Columns are hashes of name, vector, levels and ordered
+  std::vector<Rstats::ArrowFile::Column> columns;
+  IV length = my::avrv_len_fix(sv_columns);
+  for (IV i = 0; i < length; i++) {
+    SV* sv_column = my::avrv_fetch_simple(sv_columns, i);
+    Rstats::ArrowFile::Column column;
+    column.name = SvPVutf8_nolen(my::hvrv_fetch_simple(sv_column, "name"));
+    column.vector = my::to_c_obj<Rstats::Vector*>(my::hvrv_fetch_simple(sv_column, "vector"));
+    SV* sv_levels = my::hvrv_fetch_simple(sv_column, "levels");
+    if (SvOK(sv_levels)) {
+      column.levels = my::to_c_obj<Rstats::Vector*>(sv_levels);
+    }
+    column.ordered = SvTRUE(my::hvrv_fetch_simple(sv_column, "ordered"));
+    columns.push_back(column);
+  }
+  
+  std::string error;
+  if (!Rstats::ArrowFile::write(SvPV_nolen(sv_file), columns, error)) {
+    croak("%s(Rstats::ArrowFile::write())", error.c_str());
+  }
+  
+  XSRETURN(0);
+}
+
+SV*
+read(...)
+  PPCODE:
+{
+  SV* sv_file = ST(1);
+  
+  std::vector<Rstats::ArrowFile::Column> columns;
+  std::string error;
+  if (!Rstats::ArrowFile::read(SvPV_nolen(sv_file), columns, error)) {
+    croak("%s(Rstats::ArrowFile::read())", error.c_str());
+  }
+  
+  SV* sv_columns = my::new_mAVRV();
+  for (size_t i = 0; i < columns.size(); i++) {
+    SV* sv_column = my::new_mHVRV();
+    SV* sv_name = my::new_mSVpvn(columns[i].name.data(), columns[i].name.size());
+    if (!Rstats::Util::is_ascii(columns[i].name.data(), columns[i].name.size())) {
+      SvUTF8_on(sv_name);
+    }
+    my::hvrv_store_nolen_inc(sv_column, "name", sv_name);
+    my::hvrv_store_nolen_inc(sv_column, "vector", my::to_perl_obj(columns[i].vector, "Rstats::Vector"));
+    if (columns[i].levels != NULL) {
+      my::hvrv_store_nolen_inc(sv_column, "levels", my::to_perl_obj(columns[i].levels, "Rstats::Vector"));
+      my::hvrv_store_nolen_inc(sv_column, "ordered", my::new_mSViv(columns[i].ordered));
+    }
+    my::avrv_push_inc(sv_columns, sv_column);
+  }
+  return_sv(sv_columns);
+}
+
+MODULE = Rstats::Join PACKAGE = Rstats::Join
+
+SV*
+hash_join(...)
+  PPCODE:
+{
+  Rstats::RowKeys x_keys;
+  Rstats::RowKeys y_keys;
+  to_row_keys(ST(1), x_keys);
+  to_row_keys(ST(2), y_keys);
+  bool all_x = SvTRUE(ST(3));
+  bool all_y = SvTRUE(ST(4));
+  bool sort = SvTRUE(ST(5));
+  
+  std::vector<IV> x_rows;
+  std::vector<IV> y_rows;
+  Rstats::Join::hash_join(x_keys, y_keys, all_x, all_y, sort, x_rows, y_rows);
+  
+  SV* sv_result = my::new_mAVRV();
+  my::avrv_push_inc(sv_result, to_positions(x_rows));
+  my::avrv_push_inc(sv_result, to_positions(y_rows));
+  return_sv(sv_result);
+}
+
+SV*
+merge_join(...)
+  PPCODE:
+{
+  Rstats::RowKeys x_keys;
+  Rstats::RowKeys y_keys;
+  to_row_keys(ST(1), x_keys);
+  to_row_keys(ST(2), y_keys);
+  bool all_x = SvTRUE(ST(3));
+  bool all_y = SvTRUE(ST(4));
+  
+  std::vector<IV> x_rows;
+  std::vector<IV> y_rows;
+  Rstats::Join::merge_join(x_keys, y_keys, all_x, all_y, x_rows, y_rows);
+  
+  SV* sv_result = my::new_mAVRV();
+  my::avrv_push_inc(sv_result, to_positions(x_rows));
+  my::avrv_push_inc(sv_result, to_positions(y_rows));
+  return_sv(sv_result);
+}
+
+SV*
+asof_join(...)
+  PPCODE:
+{
+  Rstats::RowKeys x_keys;
+  Rstats::RowKeys y_keys;
+  to_row_keys(ST(1), x_keys);
+  to_row_keys(ST(2), y_keys);
+  
+  std::vector<IV> x_rows;
+  std::vector<IV> y_rows;
+  Rstats::Join::asof_join(x_keys, y_keys, x_rows, y_rows);
+  
+  SV* sv_result = my::new_mAVRV();
+  my::avrv_push_inc(sv_result, to_positions(x_rows));
+  my::avrv_push_inc(sv_result, to_positions(y_rows));
+  return_sv(sv_result);
+}
+
+SV*
+is_sorted(...)
+  PPCODE:
+{
+  Rstats::RowKeys keys;
+  to_row_keys(ST(1), keys);
+  
+  SV* sv_sorted = my::new_mSViv(keys.is_sorted() ? 1 : 0);
+  return_sv(sv_sorted);
+}
+
+SV*
+gather_key(...)
+  PPCODE:
+{
+  Rstats::Vector* x_key = my::to_c_obj<Rstats::Vector*>(ST(1));
+  Rstats::Vector* x_rows = my::to_c_obj<Rstats::Vector*>(ST(2));
+  Rstats::Vector* y_key = my::to_c_obj<Rstats::Vector*>(ST(3));
+  Rstats::Vector* y_rows = my::to_c_obj<Rstats::Vector*>(ST(4));
+  Rstats::Vector* y_codes = items > 5 && SvOK(ST(5)) ? my::to_c_obj<Rstats::Vector*>(ST(5)) : NULL;
+  
+  Rstats::Vector* key = Rstats::Join::gather_key(x_key, x_rows, y_key, y_rows, y_codes);
+  SV* sv_key = my::to_perl_obj(key, "Rstats::Vector");
+  return_sv(sv_key);
+}
+
+MODULE = Rstats::Group PACKAGE = Rstats::Group
+
+SV*
+group_rows(...)
+  PPCODE:
+{
+  Rstats::RowKeys keys;
+  to_row_keys(ST(1), keys);
+  
+  std::vector<IV> groups;
+  std::vector<IV> first_rows;
+  Rstats::Group::group_rows(keys, groups, first_rows);
+  
+  SV* sv_result = my::new_mAVRV();
+  my::avrv_push_inc(sv_result, to_positions(groups));
+  my::avrv_push_inc(sv_result, to_positions(first_rows));
+  return_sv(sv_result);
+}
+
+SV*
+aggregate(...)
+  PPCODE:
+{
+  std::string func(SvPV_nolen(ST(1)));
+  Rstats::Vector* values = my::to_c_obj<Rstats::Vector*>(ST(2));
+  Rstats::Vector* groups = my::to_c_obj<Rstats::Vector*>(ST(3));
+  IV group_count = SvIV(ST(4));
+  bool na_rm = SvTRUE(ST(5));
+  
+  Rstats::Vector* result = Rstats::Group::aggregate(func, values, groups->get_integer_values(), group_count, na_rm);
+  SV* sv_result = my::to_perl_obj(result, "Rstats::Vector");
+  return_sv(sv_result);
+}
+
 MODULE = Rstats PACKAGE = Rstats
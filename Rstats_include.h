@@ -1,10 +1,42 @@
 /* C++ library */
 #include <vector>
+#include <algorithm>
+#include <queue>
 #include <iostream>
 #include <complex>
 #include <cmath>
 #include <map>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <limits>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <charconv>
+
+/* System(file mapping) */
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* Compressed file */
+#ifdef RSTATS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef RSTATS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* SIMD */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* Fix std::isnan problem in Windows */
 #ifndef _isnan
@@ -364,6 +364,14 @@ vec function is equal to C<m:n> of R.
 
 =head2 grep
 
+  # grep(pattern, x, ignore.case = FALSE, fixed = FALSE)
+  r->grep("^a", $x1)
+
+=head2 grepl
+
+  # grepl(pattern, x, ignore.case = FALSE, fixed = FALSE)
+  r->grepl("a.c", $x1)
+
 =head2 gsub
 
 =head2 head
@@ -390,6 +398,16 @@ vec function is equal to C<m:n> of R.
 
 =head2 list
 
+=head2 load_binary
+
+  # load_binary(file)
+  my $d1 = r->load_binary("data.bin");
+
+Load an object saved by C<save_binary>. The file is mapped into memory and
+vectors are views of the file, so loading doesn't depend on the data size.
+Attributes are read from plain text meta data, and only vectors, matrices,
+lists and data frames are created.
+
 =head2 log
 
   # log(x1)
@@ -418,6 +436,27 @@ vec function is equal to C<m:n> of R.
 
 =head2 merge
 
+  # merge(x, y, by = intersect(names(x), names(y)), by.x = by, by.y = by,
+  #   all = FALSE, all.x = all, all.y = all, sort = TRUE, suffixes = c(".x", ".y"),
+  #   method = "auto", roll = FALSE)
+  my $x3 = r->merge($x1, $x2, {by => "id", "all.x" => TRUE});
+
+Join two data frames on key columns. The hash table is built on the smaller
+data frame and the other one is probed in parallel. NA keys match NA keys.
+Without C<sort>, rows are in the order of the probed data frame.
+
+When keys of both data frames are already sorted, a sort-merge join is used
+instead, which needs no memory except the result. C<method> forces the way,
+C<"hash"> or C<"sort">(default is C<"auto">). Rows of a sort-merge join are
+always in order of keys.
+
+  # As-of join
+  my $x3 = r->merge($trades, $quotes, {by => ["symbol", "time"], roll => TRUE});
+
+With C<roll>, each row of x is joined with the row of y which has the same
+keys except the last one and the nearest previous value of the last key.
+Rows of x keep their order.
+
 =head2 Mod
 
 =head2 NA
@@ -426,6 +465,11 @@ vec function is equal to C<m:n> of R.
 
 =head2 na_omit
 
+  # na_omit(x1)
+  r->na_omit($x1)
+
+Rows of a data frame which have NA or NaN are removed.
+
 =head2 ncol
 
   # ncol(x1)
@@ -448,8 +492,23 @@ vec function is equal to C<m:n> of R.
 
 =head2 min
 
+=head2 mmap_vector
+
+  # mmap_vector(file, what = "double", readonly = TRUE)
+  my $x1 = r->mmap_vector("values.bin");
+  my $x2 = r->mmap_vector("values.bin", {what => "integer", readonly => FALSE});
+
+Vector of native doubles or 64 bit integers in a raw file. The file is mapped
+into memory and values are read when they are used, so the file can be larger
+than memory. C<sum>, C<mean> and C<sort> stream over the values in chunks.
+A read-only vector shares pages with the page cache and releases them after use.
+Otherwise pages are copy-on-write and the file is never changed.
+
 =head2 nchar
 
+  # nchar(x, type = "chars")
+  r->nchar($x1)
+
 =head2 order
 
 =head2 ordered
@@ -458,6 +517,14 @@ vec function is equal to C<m:n> of R.
 
 =head2 paste
 
+  # paste(..., sep = " ", collapse = NULL)
+  r->paste("x", 1:3, {sep => "-"})
+
+=head2 paste0
+
+  # paste0(..., collapse = NULL)
+  r->paste0("x", 1:3, {collapse => ","})
+
 =head2 pi
 
 =head2 pmax
@@ -468,6 +535,12 @@ vec function is equal to C<m:n> of R.
 
 =head2 range
 
+=head2 regexpr
+
+  # regexpr(pattern, text, ignore.case = FALSE, fixed = FALSE)
+  my $x2 = r->regexpr("b+", $x1);
+  my $x_match_length = $x2->match_length;
+
 =head2 rank
 
 =head2 rbind
@@ -479,8 +552,50 @@ vec function is equal to C<m:n> of R.
 
 =head2 quantile
 
+=head2 read_arrow
+
+  # read_arrow(file)
+  my $d1 = r->read_arrow("data.arrow");
+
+Read a data frame from an Apache Arrow IPC file. Integer, floating point, bool,
+utf8 and dictionary encoded utf8 columns are supported. Dictionaries become factors,
+strings stay character and nulls become NA. int64 and float64 values and strings of
+a file of a single record batch are views of the mapped file.
+
 =head2 read_table
 
+  # read_table(file, header = FALSE, sep = "", quote = "\"'", skip = 0,
+  #            nrows = -1, comment.char = "#", encoding = "UTF-8",
+  #            colClasses = NA, select = NULL, drop = NULL)
+  my $d1 = r->read_table("data.csv", {sep => ",", header => TRUE});
+  
+  # colClasses and select
+  my $d1 = r->read_table(
+    "data.csv",
+    {sep => ",", header => TRUE, colClasses => c("character", "numeric"), select => c(1, 2)}
+  );
+
+C<colClasses> is C<logical>, C<integer>, C<numeric>, C<complex>, C<character>,
+C<factor> or C<NULL>(the column is skipped). Columns which are not selected are not parsed.
+
+gzip and zstd compressed files are read directly if Rstats is built with
+zlib and zstd libraries.
+
+=head2 read_table_chunked
+
+  # read_table_chunked(file, chunk_size = 1000000, sample = 1000, header = FALSE, sep = "",
+  #                    quote = "\"'", skip = 0, comment.char = "#", encoding = "UTF-8",
+  #                    colClasses = NA, select = NULL, drop = NULL)
+  my $reader = r->read_table_chunked("data.csv", {sep => ",", header => TRUE, chunk_size => 100000});
+  while (my $d1 = $reader->next) {
+    # ...
+  }
+
+Read a file in data frames of C<chunk_size> rows.
+Column types are inferred from the first C<sample> rows or given by C<colClasses>.
+A column type which is widened by a later chunk is warned.
+See L<Rstats::ChunkedTableReader>.
+
 =head2 rep
 
 =head2 replace
@@ -517,6 +632,15 @@ vec function is equal to C<m:n> of R.
 
 =head2 sample
 
+=head2 save_binary
+
+  # save_binary(x, file)
+  r->save_binary($d1, "data.bin");
+
+Save a vector, a matrix, a list or a data frame into a binary file.
+Values, strings and NA bitmaps are stored in native layout and aligned to 64 bytes.
+The file is readable on machines of the same byte order and word size.
+
 =head2 seq
 
 =head2 sequence
@@ -537,6 +661,21 @@ vec function is equal to C<m:n> of R.
   # sinh(x1)
   r->sinh($x1)
 
+=head2 summarise
+
+  # summarise(x, name = func(column), ..., by, na.rm = FALSE)
+  my $x2 = r->summarise($x1, total => "sum(weight)", avg => "mean(weight)", count => "n()",
+    {by => ["sex", "age"]});
+
+Data frame of groups of rows by C<by> columns and named aggregations of the
+groups, which are C<sum>, C<mean>, C<min>, C<max>, C<n>, C<n_distinct>,
+C<median> and C<sd>. Groups are in order of keys. NA results NA unless C<na.rm>.
+
+Sorted keys are grouped by runs of same keys, and otherwise by hash tables
+of chunks of rows in parallel. Aggregations are evaluated natively, and
+C<sum>, C<mean>, C<min>, C<max> and C<sd> are partially aggregated for each
+chunk of rows in parallel.
+
 =head2 sum
 
 =head2 sqrt
@@ -546,10 +685,39 @@ vec function is equal to C<m:n> of R.
 
 =head2 sort
 
+  # sort(x1, decreasing = FALSE)
+  r->sort($x1, {decreasing => TRUE})
+
+NA and NaN are removed. Double and integer vectors are sorted natively.
+A mapped vector larger than the sort memory(C<Rstats::Util::set_sort_memory>)
+is sorted by external merge sort through temporary files in C<TMPDIR>.
+
+=head2 sprintf
+
+  # sprintf(fmt, ...)
+  r->sprintf("%s is %.2f", c("a", "b"), c(1.5, 2))
+
 =head2 sub
 
 =head2 subset
 
+  # subset(x1, condition, select)
+  r->subset($x1, $x1->getin('height') > 160, c('sex', 'weight'))
+
+Rows of all columns are gathered natively in one pass, and columns are
+processed in parallel. Row names are 1 to row count and are created when
+they are used.
+
+=head2 substr
+
+  # substr(x, start, stop, type = "chars")
+  r->substr($x1, 2, 4)
+
+=head2 substring
+
+  # substring(text, first, last = 1000000)
+  r->substring($x1, 2)
+
 =head2 sweep
 
 =head2 t
@@ -596,6 +764,35 @@ vec function is equal to C<m:n> of R.
 
 =head2 which
 
+=head2 write_arrow
+
+  # write_arrow(x, file)
+  r->write_arrow($d1, "data.arrow");
+
+Write a data frame into an Apache Arrow IPC file of a record batch, which is read by
+other Arrow tools. Double is float64, integer is int64, logical is bool,
+character is utf8 and factor is a dictionary of levels.
+
+=head2 write_csv
+
+  # write_csv(x, file, quote = TRUE, na = "NA", row.names = TRUE, col.names = NA,
+  #           eol = "\n", compress = FALSE)
+  r->write_csv($d1, "data.csv");
+
+Same as C<write_table> with C<sep> C<,> and C<qmethod> C<double>.
+The header has a blank for row names.
+
+=head2 write_table
+
+  # write_table(x, file, sep = " ", quote = TRUE, na = "NA", row.names = TRUE,
+  #             col.names = TRUE, eol = "\n", qmethod = "escape", compress = FALSE)
+  r->write_table($d1, "data.txt");
+  r->write_table($m1, "data.txt.gz", {sep => "\t", row.names => FALSE});
+
+Write a data frame, a matrix or a vector. Blocks of rows are formatted in threads.
+File is compressed by gzip if C<compress> is TRUE or the file name ends with C<.gz>.
+Compression needs Rstats built with zlib library.
+
 =head2 as_array
 
   # as.array(x1)
@@ -46,6 +46,12 @@ sub to_string {
   my $values = $self->values;
   my $type = $self->vector->type;
   
+  # Numbers are formatted natively
+  if ($type eq 'double' || $type eq 'integer' || $type eq 'complex') {
+    $values = $self->vector->as_character->values;
+    $type = 'numeric';
+  }
+  
   my $dim_values = $self->dim_as_array->values;
   
   my $dim_length = @$dim_values;
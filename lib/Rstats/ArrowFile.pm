@@ -0,0 +1,42 @@
+package Rstats::ArrowFile;
+
+use strict;
+use warnings;
+
+require Rstats;
+
+1;
+
+=head1 NAME
+
+Rstats::ArrowFile - Apache Arrow IPC file of data frame columns
+
+=head1 SYNOPSIS
+
+  Rstats::ArrowFile->write($file, [{name => 'x', vector => $vector}, ...]);
+  my $columns = Rstats::ArrowFile->read($file);
+
+=head1 METHODS
+
+=head2 write (xs)
+
+  Rstats::ArrowFile->write($file, $columns);
+
+Write columns as a record batch of Arrow IPC file format.
+Each column is a hash reference of C<name>, C<vector>(L<Rstats::Vector>),
+and C<levels> and C<ordered> for a factor.
+
+Double is written as float64, integer as int64, logical as bool and
+character as utf8. Factor codes are int32 indices of a dictionary of levels.
+NA is a null of the validity bitmap.
+
+=head2 read (xs)
+
+  my $columns = Rstats::ArrowFile->read($file);
+
+Read columns of Arrow IPC file. Columns are hash references of the same keys as C<write>.
+
+Integer and floating point columns of any width, bool, utf8, large_utf8 and
+dictionary encoded utf8 columns are supported. Unsigned 64 bit integer is read as double.
+If the file has a single record batch, int64 and float64 values and strings are
+views of the mapped file. Compressed record batches are not supported.
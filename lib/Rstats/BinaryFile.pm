@@ -0,0 +1,33 @@
+package Rstats::BinaryFile;
+
+use strict;
+use warnings;
+
+require Rstats;
+
+1;
+
+=head1 NAME
+
+Rstats::BinaryFile - Binary file of vectors
+
+=head1 SYNOPSIS
+
+  Rstats::BinaryFile->save($file, $vectors, $meta);
+  my ($meta, $vectors) = @{Rstats::BinaryFile->load($file)};
+
+=head1 METHODS
+
+=head2 save (xs)
+
+  Rstats::BinaryFile->save($file, $vectors, $meta);
+
+Save L<Rstats::Vector> objects and a meta data string. Values, string arenas and
+NA bitmaps are stored in native layout and aligned to 64 bytes.
+
+=head2 load (xs)
+
+  my ($meta, $vectors) = @{Rstats::BinaryFile->load($file)};
+
+Load vectors as views of the mapped file. Values are not parsed or copied.
+Pages are private, so changed values are not written to the file.
@@ -0,0 +1,49 @@
+package Rstats::ChunkedTableReader;
+
+use strict;
+use warnings;
+
+sub new {
+  my $class = shift;
+  
+  my $self = bless {@_}, $class;
+  
+  return $self;
+}
+
+sub names { shift->{reader}->names }
+
+sub next {
+  my $self = shift;
+  
+  # Factor levels are shared by all chunks
+  return $self->{reader}->read_data_frame($self->{chunk_size}, $self->{levels} ||= {});
+}
+
+1;
+
+=head1 NAME
+
+Rstats::ChunkedTableReader - Iterator of data frames read from a delimited text file
+
+=head1 SYNOPSIS
+
+  my $reader = r->read_table_chunked("data.csv", {sep => ",", header => TRUE, chunk_size => 100000});
+  while (my $d1 = $reader->next) {
+    # ...
+  }
+
+=head1 METHODS
+
+=head2 names
+
+Names of columns.
+
+=head2 next
+
+  my $d1 = $reader->next;
+
+Read the next C<chunk_size> rows into a data frame. Return undef if no rows are left.
+All data frames have the same columns. A column type widened by a later chunk is warned.
+Levels of a factor column are the levels of the previous chunks followed by new values,
+so a factor code means the same label in all chunks.
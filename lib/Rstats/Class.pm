@@ -11,8 +11,7 @@ use List::Util ();
 # lgamma
 # complete_cases
 # cor
-# pmatch regexpr
-# substr substring
+# pmatch
 # strsplit  strwrap
 # outer(x, y, f)
 # reorder()
@@ -22,7 +21,6 @@ use List::Util ();
 # read.delim()
 # read.delim2()
 # read.fwf()
-# merge
 # replicate
 # split
 # by
@@ -71,6 +69,7 @@ my @funcs = qw/
   floor
   gl
   grep
+  grepl
   gsub
   head
   i
@@ -84,6 +83,7 @@ my @funcs = qw/
   kronecker
   length
   list
+  load_binary
   log
   logb
   log2
@@ -104,21 +104,26 @@ my @funcs = qw/
   max
   mean
   min
+  mmap_vector
   nchar
   order
   ordered
   outer
   paste
+  paste0
   pi
   pmax
   pmin
   prod
   range
+  regexpr
   rank
   rbind
   Re
   quantile
+  read_arrow
   read_table
+  read_table_chunked
   rep
   replace
   rev
@@ -128,6 +133,7 @@ my @funcs = qw/
   rowMeans
   rowSums
   sample
+  save_binary
   seq
   sequence
   set_diag
@@ -138,8 +144,12 @@ my @funcs = qw/
   sum
   sqrt
   sort
+  sprintf
   sub
   subset
+  substr
+  substring
+  summarise
   sweep
   t
   tail
@@ -157,6 +167,9 @@ my @funcs = qw/
   upper_tri
   var
   which
+  write_arrow
+  write_csv
+  write_table
 /;
 
 my @object_methods = qw/
@@ -80,7 +80,11 @@ sub copy_attrs_to {
     my $length = @$dimnames;
     for (my $i = 0; $i < $length; $i++) {
       my $dimname = $dimnames->[$i];
-      if (defined $dimname && $dimname->length_value) {
+      if (!defined $dimname && $self->is_data_frame) {
+        # Row names of data frame are 1 to row count
+        push @$new_dimnames, undef;
+      }
+      elsif (defined $dimname && $dimname->length_value) {
         my $index = $new_indexes->[$i];
         my $dimname_values = $dimname->values;
         my $new_dimname_values = [];
@@ -237,6 +241,17 @@ sub levels {
   }
 }
 
+sub match_length {
+  my $self = shift;
+  
+  my $x_match_length = Rstats::Func::NULL();
+  if (exists $self->{'match.length'}) {
+    $x_match_length->vector($self->{'match.length'}->clone);
+  }
+  
+  return $x_match_length;
+}
+
 sub clone {
   my $self = shift;;
   
@@ -791,7 +806,7 @@ sub names {
     $self->{names} = $names->vector->clone;
     
     if ($self->is_data_frame) {
-      $self->{dimnames}[1] = $self->{names}->vector->clone;
+      $self->{dimnames}[1] = $self->{names}->clone;
     }
     
     return $self;
@@ -66,20 +66,63 @@ sub get {
     push @$new_elements, $elements->[$i - 1];
   }
   
-  # Extract rows
-  for my $new_element (@$new_elements) {
-    $new_element = $new_element->get($row_index) unless $row_index->is_null;
+  # Extract rows. Rows of all columns are gathered natively at once.
+  my $row_length = $self->{row_length};
+  $row_length = @$elements ? $elements->[0]->length_value : 0 unless defined $row_length;
+  if ($row_index->is_null) {
+    # All rows
+  }
+  elsif ($row_index->is_character) {
+    for my $new_element (@$new_elements) {
+      $new_element = $new_element->get($row_index);
+    }
+    $row_length = @$new_elements ? $new_elements->[0]->length_value : 0;
+  }
+  else {
+    my $positions = Rstats::VectorFunc::row_positions($row_index->vector, $row_length);
+    my $vectors = Rstats::VectorFunc::gather_columns([map { $_->vector } @$new_elements], $positions);
+    for (my $i = 0; $i < @$new_elements; $i++) {
+      my $new_element = Rstats::Func::NULL();
+      $new_element->vector($vectors->[$i]);
+      $new_elements->[$i]->copy_attrs_to($new_element, {exclude => [qw/dim names dimnames/]});
+      $new_elements->[$i] = $new_element;
+    }
+    $row_length = $positions->length_value;
   }
   
-  # Create new data frame
+  # Create new data frame. Row names are 1 to row count.
   my $data_frame = Rstats::DataFrame->new;
   $data_frame->list($new_elements);
-  $self->copy_attrs_to($data_frame, {new_indexes => [$row_index, Rstats::Func::c($col_index_values)]});
-  $data_frame->{dimnames}[0] = Rstats::VectorFunc::new_character(1 .. $data_frame->getin(1)->length_value);
+  $data_frame->{row_length} = $row_length;
+  $self->copy_attrs_to($data_frame, {new_indexes => [$row_index, Rstats::Func::c($col_index_values)], exclude => ['dimnames']});
+  $data_frame->{dimnames} = [undef, $data_frame->{names}->clone];
   
   return $data_frame;
 }
 
+# Row names are created when they are used
+sub rownames {
+  my $self = shift;
+  
+  return $self->SUPER::rownames(@_) if @_ || defined $self->{dimnames}[0];
+  
+  my $x_rownames = Rstats::Func::NULL();
+  $x_rownames->vector(Rstats::VectorFunc::new_character(1 .. $self->{row_length}));
+  
+  return $x_rownames;
+}
+
+sub dimnames {
+  my $self = shift;
+  
+  return $self->SUPER::dimnames(@_) if @_ || !exists $self->{dimnames} || defined $self->{dimnames}[0];
+  
+  my $x_dimnames = Rstats::Func::list();
+  $x_dimnames->list([$self->rownames->vector, $self->{dimnames}[1]->clone]);
+  
+  return $x_dimnames;
+}
+
 sub to_string {
   my $self = shift;
 
@@ -93,7 +136,7 @@ sub to_string {
   my $columns = [];
   for (my $i = 1; $i <= @$column_names; $i++) {
     my $x = $self->getin($i);
-    $x = $x->as_character if $x->is_factor;
+    $x = $x->as_character if $x->is_factor || $x->is_numeric || $x->is_complex;
     push @$columns, $x->values;
   }
   my $col_count = @{$columns};
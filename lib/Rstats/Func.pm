@@ -8,12 +8,18 @@ use Rstats::Array;
 use Rstats::List;
 use Rstats::DataFrame;
 use Rstats::VectorFunc;
+use Rstats::TableReader;
+use Rstats::ChunkedTableReader;
+use Rstats::TableWriter;
+use Rstats::BinaryFile;
+use Rstats::ArrowFile;
+use Rstats::Join;
+use Rstats::Group;
 
 use List::Util;
 use Math::Trig ();
 use POSIX ();
 use Math::Round ();
-use Encode ();
 
 sub NULL {
   
@@ -125,52 +131,249 @@ sub transform {
 sub na_omit {
   my $x1 = shift;
   
-  my @poss;
-  for my $v (@{$x1->list}) {
-    for (my $index = 1; $index <= $x1->{row_length}; $index++) {
-      push @poss, $index if $v->vector_part($index)->is_na->value;
-    }
-  }
-  
-  my $x2 = $x1->get(-(c(\@poss)), NULL);
+  my $x_complete = NULL;
+  $x_complete->vector(Rstats::VectorFunc::complete_rows([map { $_->vector } @{$x1->list}], $x1->{row_length}));
+  my $x2 = $x1->get($x_complete, NULL);
   
   return $x2;
 }
 
-# TODO: merge is not implemented yet
 sub merge {
-  die "merge is not implemented yet";
+  my ($x1, $x2, $x_by, $x_by_x, $x_by_y, $x_all, $x_all_x, $x_all_y, $x_sort, $x_suffixes, $x_method, $x_roll)
+    = args([qw/x y by by.x by.y all all.x all.y sort suffixes method roll/], @_);
   
-  my ($x1, $x2, $x_all, $x_all_x, $x_all_y, $x_by, $x_by_x, $x_by_y, $x_sort)
-    = args([qw/x1 x2 all all.x all.y by by.x by.y sort/], @_);
+  croak "Error in merge: x and y must be data frames"
+    unless $x1->is_data_frame && $x2->is_data_frame;
   
   # Join way
-  $x_all = FALSE unless defined $x_all;
-  $x_all_x = FALSE unless defined $x_all_x;
-  $x_all_y = FALSE unless defined $x_all_y;
-  my $all;
-  if ($x_all) {
-    $all = 'both';
+  my $all = defined $x_all ? $x_all->value : 0;
+  my $all_x = defined $x_all_x ? $x_all_x->value : $all;
+  my $all_y = defined $x_all_y ? $x_all_y->value : $all;
+  my $sort = defined $x_sort ? $x_sort->value : 1;
+  my ($suffix_x, $suffix_y) = defined $x_suffixes ? @{$x_suffixes->values} : ('.x', '.y');
+  my $method = defined $x_method ? $x_method->value : 'auto';
+  croak "Error in merge: method must be \"auto\", \"hash\" or \"sort\""
+    unless $method eq 'auto' || $method eq 'hash' || $method eq 'sort';
+  my $roll = defined $x_roll ? $x_roll->value : 0;
+  
+  # Key columns. Default is common columns.
+  my $x1_names = $x1->names->values;
+  my $x2_names = $x2->names->values;
+  my $by;
+  if (defined $x_by) {
+    $by = $x_by->values;
+  }
+  else {
+    my %x2_names_h = map { $_ => 1 } @$x2_names;
+    $by = [grep { $x2_names_h{$_} } @$x1_names];
   }
-  elsif ($x_all_x) {
-    $all = 'left';
+  my $by_x = defined $x_by_x ? $x_by_x->values : $by;
+  my $by_y = defined $x_by_y ? $x_by_y->values : $by;
+  croak "Error in merge: no columns to join by" unless @$by_x;
+  croak "Error in merge: 'by.x' and 'by.y' specify different numbers of columns"
+    unless @$by_x == @$by_y;
+  
+  my ($x_keys, $y_keys, $x_key_columns, $y_key_columns) = _join_keys($x1, $x2, $by_x, $by_y);
+  
+  # Sort-merge join is used when both keys are already sorted
+  if ($method eq 'auto') {
+    $method = Rstats::Join->is_sorted($x_keys) && Rstats::Join->is_sorted($y_keys) ? 'sort' : 'hash';
   }
-  elsif ($x_all_y) {
-    $all = 'rigth';
+  my ($x_rows, $y_rows);
+  if ($roll) {
+    ($x_rows, $y_rows) = @{Rstats::Join->asof_join($x_keys, $y_keys)};
+  }
+  elsif ($method eq 'sort') {
+    ($x_rows, $y_rows) = @{Rstats::Join->merge_join($x_keys, $y_keys, $all_x, $all_y)};
   }
   else {
-    $all = 'common';
+    ($x_rows, $y_rows) = @{Rstats::Join->hash_join($x_keys, $y_keys, $all_x, $all_y, $sort)};
+  }
+  
+  return _join_result($x1, $x2, $by_x, $by_y, $x_key_columns, $y_key_columns, $x_rows, $y_rows, $suffix_x, $suffix_y);
+}
+
+# Key columns of both sides. Factors are joined by their labels, and other types are upgraded
+# to the higher type.
+sub _join_keys {
+  my ($x1, $x2, $by_x, $by_y) = @_;
+  
+  my $x_keys = [];
+  my $y_keys = [];
+  my $x_key_columns = [];
+  my $y_key_columns = [];
+  for (my $i = 0; $i < @$by_x; $i++) {
+    my $x_key = $x1->getin($by_x->[$i]);
+    my $y_key = $x2->getin($by_y->[$i]);
+    if ($x_key->is_factor && $y_key->is_factor) {
+      push @$x_keys, {vector => $x_key->vector, levels => $x_key->{levels}};
+      push @$y_keys, {vector => $y_key->vector, levels => $y_key->{levels}};
+    }
+    else {
+      $x_key = $x_key->as_character if $x_key->is_factor;
+      $y_key = $y_key->as_character if $y_key->is_factor;
+      my $x_type = $x_key->vector->type;
+      my $y_type = $y_key->vector->type;
+      if ($x_type ne $y_type) {
+        my $type = Rstats::Util::higher_type($x_type, $y_type);
+        my $method = "as_$type";
+        $x_key = $x_key->$method;
+        $y_key = $y_key->$method;
+      }
+      push @$x_keys, {vector => $x_key->vector};
+      push @$y_keys, {vector => $y_key->vector};
+    }
+    push @$x_key_columns, $x_key;
+    push @$y_key_columns, $y_key;
+  }
+  
+  return ($x_keys, $y_keys, $x_key_columns, $y_key_columns);
+}
+
+# Data frame of joined rows. Key columns come first, and then other columns of x and y.
+# Names which are in both sides get suffixes.
+sub _join_result {
+  my ($x1, $x2, $by_x, $by_y, $x_key_columns, $y_key_columns, $x_rows, $y_rows, $suffix_x, $suffix_y) = @_;
+  
+  my $names = [];
+  my $columns = [];
+  for (my $i = 0; $i < @$by_x; $i++) {
+    my $x_key = $x_key_columns->[$i];
+    my $y_key = $y_key_columns->[$i];
+    my $x_column = NULL;
+    if ($x_key->is_factor) {
+      # Levels of y which are not in x are added
+      my $levels = $x_key->levels->values;
+      my %codes_h = map { $levels->[$_] => $_ + 1 } (0 .. @$levels - 1);
+      my $y_codes = [];
+      for my $level (@{$y_key->levels->values}) {
+        unless ($codes_h{$level}) {
+          push @$levels, $level;
+          $codes_h{$level} = @$levels;
+        }
+        push @$y_codes, $codes_h{$level};
+      }
+      $x_column->vector(Rstats::Join->gather_key($x_key->vector, $x_rows, $y_key->vector, $y_rows,
+        Rstats::VectorFunc::new_integer(@$y_codes)));
+      $x_key->copy_attrs_to($x_column, {exclude => [qw/dim names dimnames/]});
+      $x_column->{levels} = Rstats::VectorFunc::new_character(@$levels);
+    }
+    else {
+      $x_column->vector(Rstats::Join->gather_key($x_key->vector, $x_rows, $y_key->vector, $y_rows));
+      $x_key->copy_attrs_to($x_column, {exclude => [qw/dim names dimnames/]});
+    }
+    push @$names, $by_x->[$i];
+    push @$columns, $x_column;
+  }
+  
+  # Other columns
+  my %by_x_h = map { $_ => 1 } @$by_x;
+  my %by_y_h = map { $_ => 1 } @$by_y;
+  my @x_names = grep { !$by_x_h{$_} } @{$x1->names->values};
+  my @y_names = grep { !$by_y_h{$_} } @{$x2->names->values};
+  my %x_names_h = map { $_ => 1 } @x_names;
+  my %y_names_h = map { $_ => 1 } @y_names;
+  for my $side ([$x1, \@x_names, $x_rows, \%y_names_h, $suffix_x], [$x2, \@y_names, $y_rows, \%x_names_h, $suffix_y]) {
+    my ($x, $side_names, $rows, $other_names_h, $suffix) = @$side;
+    my $x_columns = [map { $x->getin($_) } @$side_names];
+    my $vectors = Rstats::VectorFunc::gather_columns([map { $_->vector } @$x_columns], $rows);
+    for (my $i = 0; $i < @$x_columns; $i++) {
+      my $x_column = NULL;
+      $x_column->vector($vectors->[$i]);
+      $x_columns->[$i]->copy_attrs_to($x_column, {exclude => [qw/dim names dimnames/]});
+      my $name = $side_names->[$i];
+      push @$names, $other_names_h->{$name} ? "$name$suffix" : $name;
+      push @$columns, $x_column;
+    }
+  }
+  
+  return _new_data_frame($names, $columns, $x_rows->length_value);
+}
+
+my %summarise_funcs_h = map { $_ => 1 } qw/sum mean min max n n_distinct median sd/;
+
+sub summarise {
+  my $x1 = shift;
+  my $opt = ref $_[-1] eq 'HASH' ? pop @_ : {};
+  my ($x_by, $x_na_rm) = args([qw/by na.rm/], $opt);
+  
+  croak "Error in summarise: x must be a data frame" unless $x1->is_data_frame;
+  
+  my $by = defined $x_by ? $x_by->values : [];
+  croak "Error in summarise: no columns to group by" unless @$by;
+  my $na_rm = defined $x_na_rm ? $x_na_rm->value : 0;
+  
+  # Aggregations like total => "sum(weight)"
+  my %names_h = map { $_ => 1 } @{$x1->names->values};
+  my @aggregations;
+  while (my ($name, $expr) = splice(@_, 0, 2)) {
+    my ($func, $column) = $expr =~ /^\s*(\w+)\s*\(\s*([^()]*?)\s*\)\s*$/
+      or croak "Error in summarise: invalid aggregation \"$expr\"";
+    croak "Error in summarise: unknown function \"$func\"" unless $summarise_funcs_h{$func};
+    if ($func eq 'n') {
+      croak "Error in n: unused argument ($column)" if length $column;
+    }
+    else {
+      croak "Error in summarise: object '$column' not found" unless $names_h{$column};
+    }
+    push @aggregations, [$name, $func, $column];
+  }
+  
+  # Groups
+  my $keys = [];
+  my $key_columns = [];
+  for my $name (@$by) {
+    croak "Error in summarise: object '$name' not found" unless $names_h{$name};
+    my $key = $x1->getin($name);
+    push @$keys, $key->is_factor ? {vector => $key->vector, levels => $key->{levels}} : {vector => $key->vector};
+    push @$key_columns, $key;
+  }
+  my ($groups, $first_rows) = @{Rstats::Group->group_rows($keys)};
+  my $group_count = $first_rows->length_value;
+  
+  # Key columns
+  my $names = [@$by];
+  my $columns = [];
+  my $vectors = Rstats::VectorFunc::gather_columns([map { $_->vector } @$key_columns], $first_rows);
+  for (my $i = 0; $i < @$key_columns; $i++) {
+    my $x_column = NULL;
+    $x_column->vector($vectors->[$i]);
+    $key_columns->[$i]->copy_attrs_to($x_column, {exclude => [qw/dim names dimnames/]});
+    push @$columns, $x_column;
   }
   
-  # ID
-  $x_by = $x1->names->get(1) unless defined $x_by;
-  $x_by_x = $x_by unless defined $x_by_x;
-  $x_by_y = $x_by unless defined $x_by_y;
-  my $by_x = $x_by_x->value;
-  my $by_y = $x_by_y->value;
+  # Aggregations
+  for my $aggregation (@aggregations) {
+    my ($name, $func, $column) = @$aggregation;
+    my $x_column = NULL;
+    if ($func eq 'n') {
+      $x_column->vector(Rstats::Group->aggregate('n', $groups, $groups, $group_count, 0));
+    }
+    else {
+      my $x_values = $x1->getin($column);
+      unless ($func eq 'n_distinct') {
+        croak "Error in $func: invalid 'type' (" . $x_values->typeof->value . ") of argument"
+          if $x_values->is_factor || !($x_values->is_double || $x_values->is_integer || $x_values->is_logical);
+      }
+      $x_column->vector(Rstats::Group->aggregate($func, $x_values->vector, $groups, $group_count, $na_rm));
+    }
+    push @$names, $name;
+    push @$columns, $x_column;
+  }
   
-  # Sort
-  my $sort = defined $x_sort ? $x_sort->value : 0;
+  return _new_data_frame($names, $columns, $group_count);
+}
+
+# Data frame of columns. Row names are 1 to row count.
+sub _new_data_frame {
+  my ($names, $columns, $row_length) = @_;
+  
+  my $data_frame = Rstats::DataFrame->new;
+  $data_frame->{row_length} = $row_length;
+  $data_frame->list($columns);
+  $data_frame->names(Rstats::Func::c($names));
+  
+  return $data_frame;
 }
 
 # TODO
@@ -185,107 +388,345 @@ sub merge {
 #           stringsAsFactors = default.stringsAsFactors(),
 #           encoding = "unknown")
 sub read_table {
-  my ($x_file, $x_sep, $x_skip, $x_nrows, $x_header, $x_comment_char, $x_row_names, $x_encoding)
-    = args([qw/file sep skip nrows header comment.char row.names encoding/], @_);
+  my ($x_file, $x_sep, $x_quote, $x_skip, $x_nrows, $x_header, $x_comment_char, $x_row_names, $x_encoding,
+    $x_col_classes, $x_select, $x_drop)
+    = args([qw/file sep quote skip nrows header comment.char row.names encoding colClasses select drop/], @_);
+  
+  my $options = {
+    sep => defined $x_sep ? $x_sep->value : undef,
+    quote => defined $x_quote ? $x_quote->value : undef,
+    skip => defined $x_skip ? $x_skip->value : 0,
+    header => defined $x_header ? $x_header->value : 0,
+    'comment.char' => defined $x_comment_char ? $x_comment_char->value : undef,
+    encoding => defined $x_encoding ? $x_encoding->value : 'UTF-8',
+    colClasses => _table_col_classes($x_col_classes),
+    select => defined $x_select ? $x_select->values : undef,
+    drop => defined $x_drop ? $x_drop->values : undef
+  };
+  my $nrows = defined $x_nrows ? $x_nrows->value : -1;
   
-  my $file = $x_file->value;
-  open(my $fh, '<', $file)
-    or croak "cannot open file '$file': $!";
+  # Records are parsed and typed natively
+  my $reader = Rstats::TableReader->new($x_file->value, $options);
+  my $d1 = $reader->read_data_frame($nrows < 0 ? undef : $nrows) || Rstats::Func::data_frame();
+  
+  return $d1;
+}
+
+sub read_table_chunked {
+  my ($x_file, $x_chunk_size, $x_sample, $x_sep, $x_quote, $x_skip, $x_header, $x_comment_char, $x_encoding,
+    $x_col_classes, $x_select, $x_drop)
+    = args([qw/file chunk_size sample sep quote skip header comment.char encoding colClasses select drop/], @_);
+  
+  my $options = {
+    sep => defined $x_sep ? $x_sep->value : undef,
+    quote => defined $x_quote ? $x_quote->value : undef,
+    skip => defined $x_skip ? $x_skip->value : 0,
+    header => defined $x_header ? $x_header->value : 0,
+    'comment.char' => defined $x_comment_char ? $x_comment_char->value : undef,
+    encoding => defined $x_encoding ? $x_encoding->value : 'UTF-8',
+    colClasses => _table_col_classes($x_col_classes),
+    select => defined $x_select ? $x_select->values : undef,
+    drop => defined $x_drop ? $x_drop->values : undef,
+    sample => defined $x_sample ? $x_sample->value : 1000
+  };
+  my $chunk_size = defined $x_chunk_size ? $x_chunk_size->value : 1000000;
+  croak "chunk_size must be positive" unless $chunk_size > 0;
   
-  # Separater
-  my $sep = defined $x_sep ? $x_sep->value : "\\s+";
-  my $encoding = defined $x_encoding ? $x_encoding->value : 'UTF-8';
-  my $skip = defined $x_skip ? $x_skip->value : 0;
-  my $header_opt = defined $x_header ? $x_header->value : 0;
+  my $reader = Rstats::TableReader->new($x_file->value, $options);
   
-  my $type_columns;
+  return Rstats::ChunkedTableReader->new(reader => $reader, chunk_size => $chunk_size);
+}
+
+sub write_table {
+  my ($x1, $x_file, $x_sep, $x_quote, $x_na, $x_row_names, $x_col_names, $x_eol, $x_qmethod, $x_compress)
+    = args([qw/x file sep quote na row.names col.names eol qmethod compress/], @_);
+  
+  my $file = $x_file->value;
+  my $options = {
+    sep => defined $x_sep ? $x_sep->value : ' ',
+    quote => defined $x_quote ? $x_quote->value : 1,
+    na => defined $x_na ? $x_na->value : 'NA',
+    eol => defined $x_eol ? $x_eol->value : "\n",
+    qmethod => defined $x_qmethod ? $x_qmethod->value : 'escape',
+    compress => defined $x_compress ? $x_compress->value : $file =~ /\.gz$/ ? 1 : 0
+  };
+  
+  # Columns. Factors are written as their labels.
   my $columns = [];
-  my $row_size;
-  my $header;
-  while (my $line = <$fh>) {
-    if ($skip > 0) {
-      $skip--;
-      next;
-    }
-    $line = Encode::decode($encoding, $line);
-    $line =~ s/\x0D?\x0A?$//;
-    
-    if ($header_opt && !$header) {
-      $header = [split(/$sep/, $line)];
-      next;
+  my $ncol;
+  my $x_names;
+  my $x_rownames;
+  my $row_count;
+  if ($x1->is_data_frame) {
+    for my $x_column (@{$x1->list}) {
+      my $x_column_fix = $x_column->is_factor ? $x_column->as_character : $x_column;
+      push @$columns, $x_column_fix->vector;
     }
+    $row_count = @$columns ? $columns->[0]->length_value : 0;
+    $x_names = $x1->names;
     
-    my @row = split(/$sep/, $line);
-    my $current_row_size = @row;
-    $row_size ||= $current_row_size;
-    
-    # Row size different
-    croak "line $. did not have $row_size elements"
-      if $current_row_size != $row_size;
-    
-    $type_columns ||= [('logical') x $row_size];
-    
-    for (my $i = 0; $i < @row; $i++) {
-      
-      $columns->[$i] ||= [];
-      push @{$columns->[$i]}, $row[$i];
-      my $type;
-      if (defined Rstats::Util::looks_like_na($row[$i])) {
-        $type = 'logical';
-      }
-      elsif (defined Rstats::Util::looks_like_logical($row[$i])) {
-        $type = 'logical';
-      }
-      elsif (defined Rstats::Util::looks_like_integer($row[$i])) {
-        $type = 'integer';
-      }
-      elsif (defined Rstats::Util::looks_like_double($row[$i])) {
-        $type = 'double';
-      }
-      elsif (defined Rstats::Util::looks_like_complex($row[$i])) {
-        $type = 'complex';
+    # Row names which are 1 to row count are written as row numbers
+    $x_rownames = $x1->rownames if defined $x1->{dimnames}[0];
+  }
+  elsif ($x1->is_matrix) {
+    my $x_matrix = $x1->is_factor ? $x1->as_character : $x1;
+    $columns = [$x_matrix->vector];
+    ($row_count, $ncol) = @{$x1->dim->values};
+    $x_names = $x1->colnames;
+    $x_names = paste0('V', se("1:$ncol")) if $x_names->is_null;
+    $x_rownames = $x1->rownames;
+  }
+  else {
+    my $x_column = $x1->is_factor ? $x1->as_character : $x1;
+    $columns = [$x_column->vector];
+    $row_count = $x_column->length_value;
+    $x_names = c('x');
+  }
+  
+  # row.names is TRUE, FALSE or names
+  my $row_names;
+  if (!defined $x_row_names || !$x_row_names->is_character) {
+    if (!defined $x_row_names || $x_row_names->value) {
+      # Row names which don't match rows are replaced with row numbers
+      if (!defined $x_rownames || $x_rownames->is_null || $x_rownames->length_value != $row_count) {
+        $options->{row_numbers} = 1;
       }
       else {
-        $type = 'character';
+        $row_names = $x_rownames->as_character->vector;
       }
-      $type_columns->[$i] = Rstats::Util::higher_type($type_columns->[$i], $type);
     }
   }
+  else {
+    $row_names = $x_row_names->vector;
+  }
   
-  my $data_frame_args = [];
-  for (my $i = 0; $i < $row_size; $i++) {
-    if (defined $header->[$i]) {
-      push @$data_frame_args, $header->[$i];
+  # col.names is TRUE, FALSE, NA(a blank is put for row names) or names
+  my $col_names;
+  if (!defined $x_col_names || !$x_col_names->is_character) {
+    my $col_names_value = defined $x_col_names ? $x_col_names->value : 1;
+    if (!defined $col_names_value || $col_names_value) {
+      $col_names = $x_names->as_character->vector;
+      $options->{col_names_blank} = 1 unless defined $col_names_value;
     }
-    else {
-      push @$data_frame_args, "V" . ($i + 1);
+  }
+  else {
+    $col_names = $x_col_names->vector;
+  }
+  
+  Rstats::TableWriter->write($file, $columns, $ncol, $row_names, $col_names, $options);
+  
+  return;
+}
+
+sub write_csv {
+  my ($x1, $x_file, $x_quote, $x_na, $x_row_names, $x_col_names, $x_eol, $x_compress)
+    = args([qw/x file quote na row.names col.names eol compress/], @_);
+  
+  # Header has a blank for row names like write.csv
+  my $x_row_names_fix = defined $x_row_names ? $x_row_names : Rstats::Func::TRUE();
+  unless (defined $x_col_names) {
+    $x_col_names = $x_row_names_fix->is_character || $x_row_names_fix->value ? NA() : Rstats::Func::TRUE();
+  }
+  
+  my $opt = {
+    sep => c(','),
+    qmethod => c('double'),
+    'row.names' => $x_row_names_fix,
+    'col.names' => $x_col_names
+  };
+  $opt->{quote} = $x_quote if defined $x_quote;
+  $opt->{na} = $x_na if defined $x_na;
+  $opt->{eol} = $x_eol if defined $x_eol;
+  $opt->{compress} = $x_compress if defined $x_compress;
+  
+  return write_table($x1, $x_file, $opt);
+}
+
+sub save_binary {
+  my ($x1, $x_file) = args([qw/x file/], @_);
+  
+  # Vectors are stored as buffers and the other attributes are written as plain meta data
+  my $vectors = [];
+  my $meta = _binary_encode($x1, $vectors);
+  Rstats::BinaryFile->save($x_file->value, $vectors, $meta);
+  
+  return;
+}
+
+sub load_binary {
+  my ($x_file) = args([qw/file/], @_);
+  
+  my ($meta, $vectors) = @{Rstats::BinaryFile->load($x_file->value)};
+  
+  pos($meta) = 0;
+  my $x1 = _binary_decode(\$meta, $vectors);
+  croak "Error in load_binary: broken binary file" unless pos($meta) == length $meta;
+  
+  return $x1;
+}
+
+sub mmap_vector {
+  my ($x_file, $x_what, $x_readonly) = args([qw/file what readonly/], @_);
+  
+  my $what = defined $x_what ? $x_what->value : 'double';
+  croak "Error in mmap_vector: what must be \"double\" or \"integer\""
+    unless $what eq 'double' || $what eq 'integer';
+  my $readonly = defined $x_readonly ? $x_readonly->value : 1;
+  
+  my $x1 = NULL;
+  $x1->vector(Rstats::VectorFunc::new_mapped_file($x_file->value, $what, $readonly ? 1 : 0));
+  
+  return $x1;
+}
+
+# Classes of objects which are saved by save_binary
+my %binary_classes = map { $_ => 1 } qw/Rstats::Array Rstats::List Rstats::DataFrame/;
+
+# Meta data has a node in a line. Nodes of an array or attributes of an object follow its line.
+#   undef
+#   scalar LENGTH:BYTES (utf8 LENGTH:BYTES for UTF-8 string)
+#   vector INDEX
+#   array COUNT
+#   object CLASS COUNT (COUNT pairs of name and value nodes)
+sub _binary_encode {
+  my ($value, $vectors) = @_;
+  
+  my $ref = ref $value;
+  if (!defined $value) {
+    return "undef\n";
+  }
+  elsif (!$ref) {
+    my $type = 'scalar';
+    if (utf8::is_utf8($value)) {
+      utf8::encode($value);
+      $type = 'utf8';
     }
-    my $type = $type_columns->[$i];
-    if ($type eq 'character') {
-      my $x1 = Rstats::Func::c($columns->[$i]);
-      push @$data_frame_args, $x1->as_factor;
+    return "$type " . length($value) . ":$value\n";
+  }
+  elsif ($ref eq 'Rstats::Vector') {
+    push @$vectors, $value;
+    return "vector $#$vectors\n";
+  }
+  elsif ($ref eq 'ARRAY') {
+    return 'array ' . @$value . "\n" . join('', map { _binary_encode($_, $vectors) } @$value);
+  }
+  elsif ($binary_classes{$ref}) {
+    my @names = sort keys %$value;
+    return "object $ref " . @names . "\n"
+      . join('', map { _binary_encode($_, $vectors) . _binary_encode($value->{$_}, $vectors) } @names);
+  }
+  else {
+    croak "Can't save $ref object";
+  }
+}
+
+# Node is parsed from pos of meta data. Objects are created only for the classes of save_binary.
+sub _binary_decode {
+  my ($meta, $vectors) = @_;
+  
+  my $broken = "Error in load_binary: broken binary file";
+  if ($$meta =~ /\Gundef\n/gc) {
+    return undef;
+  }
+  elsif ($$meta =~ /\G(scalar|utf8) (\d+):/gc) {
+    my ($type, $length) = ($1, $2);
+    my $start = pos $$meta;
+    croak $broken unless $start + $length < length $$meta && substr($$meta, $start + $length, 1) eq "\n";
+    my $value = substr($$meta, $start, $length);
+    if ($type eq 'utf8') {
+      utf8::decode($value) or croak $broken;
     }
-    elsif ($type eq 'complex') {
-      my $x1 = Rstats::Func::c($columns->[$i]);
-      push @$data_frame_args, $x1->as_complex;
+    pos($$meta) = $start + $length + 1;
+    return $value;
+  }
+  elsif ($$meta =~ /\Gvector (\d+)\n/gc) {
+    croak $broken unless $1 < @$vectors;
+    return $vectors->[$1];
+  }
+  elsif ($$meta =~ /\Garray (\d+)\n/gc) {
+    my $count = $1;
+    my $values = [];
+    for (my $i = 0; $i < $count; $i++) {
+      push @$values, _binary_decode($meta, $vectors);
     }
-    elsif ($type eq 'double') {
-      my $x1 = Rstats::Func::c($columns->[$i]);
-      push @$data_frame_args, $x1->as_double;
+    return $values;
+  }
+  elsif ($$meta =~ /\Gobject (\S+) (\d+)\n/gc) {
+    my ($class, $count) = ($1, $2);
+    croak "Error in load_binary: $class object can't be loaded" unless $binary_classes{$class};
+    my %attrs;
+    for (my $i = 0; $i < $count; $i++) {
+      my $name = _binary_decode($meta, $vectors);
+      croak $broken unless defined $name && !ref $name;
+      $attrs{$name} = _binary_decode($meta, $vectors);
     }
-    elsif ($type eq 'integer') {
-      my $x1 = Rstats::Func::c($columns->[$i]);
-      push @$data_frame_args, $x1->as_integer;
+    return $class->new(%attrs);
+  }
+  else {
+    croak $broken;
+  }
+}
+
+sub write_arrow {
+  my ($x1, $x_file) = args([qw/x file/], @_);
+  
+  croak "Error in write_arrow: x must be a data frame" unless $x1->is_data_frame;
+  
+  # Factors are written as dictionaries of levels
+  my $names = $x1->names->values;
+  my $columns = [];
+  my $x_columns = $x1->list;
+  for (my $i = 0; $i < @$x_columns; $i++) {
+    my $x_column = $x_columns->[$i];
+    my $column = {name => $names->[$i], vector => $x_column->vector};
+    if ($x_column->is_factor) {
+      $column->{levels} = $x_column->{levels};
+      $column->{ordered} = $x_column->is_ordered->value;
     }
-    else {
-      my $x1 = Rstats::Func::c($columns->[$i]);
-      push @$data_frame_args, $x1->as_logical;
+    push @$columns, $column;
+  }
+  Rstats::ArrowFile->write($x_file->value, $columns);
+  
+  return;
+}
+
+sub read_arrow {
+  my ($x_file) = args([qw/file/], @_);
+  
+  my $columns = Rstats::ArrowFile->read($x_file->value);
+  
+  my $data_frame_args = [];
+  for my $column (@$columns) {
+    my $x_column = NULL;
+    $x_column->vector($column->{vector});
+    if (defined $column->{levels}) {
+      $x_column->{class} = Rstats::VectorFunc::new_character($column->{ordered} ? ('factor', 'ordered') : 'factor');
+      $x_column->{levels} = $column->{levels};
+    }
+    elsif ($x_column->is_character) {
+      # Strings stay character
+      $x_column->class('AsIs');
     }
+    push @$data_frame_args, $column->{name}, $x_column;
   }
   
-  my $d1 = Rstats::Func::data_frame(@$data_frame_args);
+  return data_frame(@$data_frame_args);
+}
+
+# Named colClasses is specified by column names
+sub _table_col_classes {
+  my $x_col_classes = shift;
   
-  return $d1;
+  return undef unless defined $x_col_classes;
+  
+  my $classes = $x_col_classes->values;
+  if (exists $x_col_classes->{names}) {
+    my $names = $x_col_classes->names->values;
+    return {map { $names->[$_] => $classes->[$_] } 0 .. @$names - 1};
+  }
+  else {
+    return $classes;
+  }
 }
 
 sub interaction {
@@ -431,8 +872,6 @@ sub factor {
   # default - ordered
   $x_ordered = $x1->is_ordered unless defined $x_ordered;
   
-  my $x1_elements = $x1->decompose_elements;
-  
   my $labels_length = $x_labels->length->value;
   my $levels_length = $x_levels->length->value;
   if ($labels_length == 1 && $x1->length_value != 1) {
@@ -443,30 +882,37 @@ sub factor {
     croak("Error in factor 'labels'; length $labels_length should be 1 or $levels_length");
   }
   
-  # Levels hash
-  my $levels;
-  my $x_levels_elements = $x_levels->decompose_elements;
-  for (my $i = 1; $i <= $levels_length; $i++) {
-    my $x_levels_element = $x_levels_elements->[$i - 1];
-    my $value = $x_levels_element->value;
-    $levels->{$value} = $i;
+  my $f1;
+  if ($x_levels->vector->type eq 'character') {
+    $f1 = NULL;
+    $f1->vector(Rstats::VectorFunc::match($x1->vector, $x_levels->vector)->as_integer);
   }
-  
-  my $f1_elements = [];
-  for my $x1_element (@$x1_elements) {
-    if ($x1_element->is_na->value) {
-      push @$f1_elements, Rstats::VectorFunc::NA();
+  else {
+    # Levels hash
+    my $levels;
+    my $x_levels_elements = $x_levels->decompose_elements;
+    for (my $i = 1; $i <= $levels_length; $i++) {
+      my $x_levels_element = $x_levels_elements->[$i - 1];
+      my $value = $x_levels_element->value;
+      $levels->{$value} = $i;
     }
-    else {
-      my $value = $x1_element->value;
-      my $f1_element = exists $levels->{$value}
-        ? Rstats::VectorFunc::new_integer($levels->{$value})
-        : Rstats::VectorFunc::NA();
-      push @$f1_elements, $f1_element;
+    
+    my $f1_elements = [];
+    for my $x1_element (@{$x1->decompose_elements}) {
+      if ($x1_element->is_na->value) {
+        push @$f1_elements, Rstats::VectorFunc::NA();
+      }
+      else {
+        my $value = $x1_element->value;
+        my $f1_element = exists $levels->{$value}
+          ? Rstats::VectorFunc::new_integer($levels->{$value})
+          : Rstats::VectorFunc::NA();
+        push @$f1_elements, $f1_element;
+      }
     }
+    
+    $f1 = c($f1_elements)->as_integer;
   }
-  
-  my $f1 = c($f1_elements)->as_integer;
   if ($x_ordered) {
     $f1->{class} = Rstats::VectorFunc::new_character('factor', 'ordered');
   }
@@ -508,8 +954,6 @@ sub data_frame {
   # count
   my $counts = [];
   my $column_names = [];
-  my $row_names = [];
-  my $row_count = 1;
   while (my ($name, $v) = splice(@data, 0, 2)) {
     if ($v->is_character && !grep {$_ eq 'AsIs'} @{$v->class->values}) {
       $v = $v->as_factor;
@@ -547,8 +991,6 @@ sub data_frame {
       push @$column_names, $fix_name;
       push @$elements, $v;
     }
-    push @$row_names, "$row_count";
-    $row_count++;
     $name_count->{$name}++;
   }
   
@@ -574,16 +1016,11 @@ sub data_frame {
     }
   }
   
-  # Create data frame
+  # Create data frame. Row names are 1 to row count.
   my $data_frame = Rstats::DataFrame->new;
   $data_frame->{row_length} = $max_count;
   $data_frame->list($elements);
-  $data_frame->dimnames(
-    Rstats::Func::list(
-      Rstats::Func::c($row_names),
-      Rstats::Func::c($column_names)
-    )
-  );
+  $data_frame->names(Rstats::Func::c($column_names));
   
   return $data_frame;
 }
@@ -792,94 +1229,105 @@ sub Arg {
 }
 
 sub sub {
-  my ($x1_pattern, $x1_replacement, $x1_x, $x1_ignore_case)
-    = args(['pattern', 'replacement', 'x', 'ignore.case'], @_);
-  
-  my $pattern = $x1_pattern->value;
-  my $replacement = $x1_replacement->value;
-  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->vector_part : FALSE;
+  my ($x1_pattern, $x1_replacement, $x1_x, $x1_ignore_case, $x1_fixed)
+    = args(['pattern', 'replacement', 'x', 'ignore.case', 'fixed'], @_);
   
-  my $x2_elements = [];
-  for my $x_e (@{$x1_x->decompose_elements}) {
-    if ($x_e->is_na->value) {
-      push @$x2_elements, $x_e;
-    }
-    else {
-      my $x = $x_e->value;
-      if ($ignore_case) {
-        $x =~ s/$pattern/$replacement/i;
-      }
-      else {
-        $x =~ s/$pattern/$replacement/;
-      }
-      push @$x2_elements, Rstats::VectorFunc::new_character($x);
-    }
-  }
+  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->value : 0;
+  my $fixed = defined $x1_fixed ? $x1_fixed->value : 0;
+  $x1_x = $x1_x->as_character unless $x1_x->is_character;
   
-  my $x2 = c($x2_elements);
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::sub(
+    $x1_pattern->as_character->vector,
+    $x1_replacement->as_character->vector,
+    $x1_x->vector,
+    $ignore_case ? 1 : 0,
+    $fixed ? 1 : 0
+  ));
   $x1_x->copy_attrs_to($x2);
   
   return $x2;
 }
 
 sub gsub {
-  my ($x1_pattern, $x1_replacement, $x1_x, $x1_ignore_case)
-    = args(['pattern', 'replacement', 'x', 'ignore.case'], @_);
+  my ($x1_pattern, $x1_replacement, $x1_x, $x1_ignore_case, $x1_fixed)
+    = args(['pattern', 'replacement', 'x', 'ignore.case', 'fixed'], @_);
   
-  my $pattern = $x1_pattern->value;
-  my $replacement = $x1_replacement->value;
-  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->vector_part : FALSE;
-  
-  my $x2_elements = [];
-  for my $x_e (@{$x1_x->decompose_elements}) {
-    if ($x_e->is_na->value) {
-      push @$x2_elements, $x_e;
-    }
-    else {
-      my $x = $x_e->value;
-      if ($ignore_case) {
-        $x =~ s/$pattern/$replacement/gi;
-      }
-      else {
-        $x =~ s/$pattern/$replacement/g;
-      }
-      push @$x2_elements, Rstats::VectorFunc::new_character($x);
-    }
-  }
+  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->value : 0;
+  my $fixed = defined $x1_fixed ? $x1_fixed->value : 0;
+  $x1_x = $x1_x->as_character unless $x1_x->is_character;
   
-  my $x2 = c($x2_elements);
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::gsub(
+    $x1_pattern->as_character->vector,
+    $x1_replacement->as_character->vector,
+    $x1_x->vector,
+    $ignore_case ? 1 : 0,
+    $fixed ? 1 : 0
+  ));
   $x1_x->copy_attrs_to($x2);
   
   return $x2;
 }
 
 sub grep {
-  my ($x1_pattern, $x1_x, $x1_ignore_case) = args(['pattern', 'x', 'ignore.case'], @_);
+  my ($x1_pattern, $x1_x, $x1_ignore_case, $x1_fixed)
+    = args(['pattern', 'x', 'ignore.case', 'fixed'], @_);
   
-  my $pattern = $x1_pattern->value;
-  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->vector_part : FALSE;
+  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->value : 0;
+  my $fixed = defined $x1_fixed ? $x1_fixed->value : 0;
+  $x1_x = $x1_x->as_character unless $x1_x->is_character;
   
-  my $x2_elements = [];
-  my $x1_x_elements = $x1_x->decompose_elements;
-  for (my $i = 0; $i < @$x1_x_elements; $i++) {
-    my $x_e = $x1_x_elements->[$i];
-    
-    unless ($x_e->is_na->value) {
-      my $x = $x_e->value;
-      if ($ignore_case) {
-        if ($x =~ /$pattern/i) {
-          push @$x2_elements, Rstats::VectorFunc::new_double($i + 1);
-        }
-      }
-      else {
-        if ($x =~ /$pattern/) {
-          push @$x2_elements, Rstats::VectorFunc::new_double($i + 1);
-        }
-      }
-    }
-  }
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::grep(
+    $x1_pattern->as_character->vector,
+    $x1_x->vector,
+    $ignore_case ? 1 : 0,
+    $fixed ? 1 : 0
+  ));
   
-  return c($x2_elements);
+  return $x2;
+}
+
+sub grepl {
+  my ($x1_pattern, $x1_x, $x1_ignore_case, $x1_fixed)
+    = args(['pattern', 'x', 'ignore.case', 'fixed'], @_);
+  
+  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->value : 0;
+  my $fixed = defined $x1_fixed ? $x1_fixed->value : 0;
+  $x1_x = $x1_x->as_character unless $x1_x->is_character;
+  
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::grepl(
+    $x1_pattern->as_character->vector,
+    $x1_x->vector,
+    $ignore_case ? 1 : 0,
+    $fixed ? 1 : 0
+  ));
+  $x1_x->copy_attrs_to($x2);
+  
+  return $x2;
+}
+
+sub regexpr {
+  my ($x1_pattern, $x1_text, $x1_ignore_case, $x1_fixed)
+    = args(['pattern', 'text', 'ignore.case', 'fixed'], @_);
+  
+  my $ignore_case = defined $x1_ignore_case ? $x1_ignore_case->value : 0;
+  my $fixed = defined $x1_fixed ? $x1_fixed->value : 0;
+  $x1_text = $x1_text->as_character unless $x1_text->is_character;
+  
+  my ($x2_vector, $x2_match_length) = Rstats::VectorFunc::regexpr(
+    $x1_pattern->as_character->vector,
+    $x1_text->vector,
+    $ignore_case ? 1 : 0,
+    $fixed ? 1 : 0
+  );
+  my $x2 = NULL;
+  $x2->vector($x2_vector);
+  $x2->{'match.length'} = $x2_match_length;
+  
+  return $x2;
 }
 
 sub c {
@@ -1027,25 +1475,14 @@ sub col {
 sub chartr {
   my ($x1_old, $x1_new, $x1_x) = args(['old', 'new', 'x'], @_);
   
-  my $old = $x1_old->value;
-  my $new = $x1_new->value;
-  
-  my $x2_elements = [];
-  for my $x_e (@{$x1_x->decompose_elements}) {
-    if ($x_e->is_na->value) {
-      push @$x2_elements, $x_e;
-    }
-    else {
-      my $x = $x_e->value;
-      $old =~ s#/#\/#;
-      $new =~ s#/#\/#;
-      eval "\$x =~ tr/$old/$new/";
-      croak $@ if $@;
-      push @$x2_elements, Rstats::VectorFunc::new_character($x);
-    }
-  }
+  $x1_x = $x1_x->as_character unless $x1_x->is_character;
   
-  my $x2 = c($x2_elements);
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::chartr(
+    $x1_old->as_character->vector,
+    $x1_new->as_character->vector,
+    $x1_x->vector
+  ));
   $x1_x->copy_attrs_to($x2);
   
   return $x2;
@@ -1255,20 +1692,12 @@ sub diff {
 }
 
 sub nchar {
-  my $x1 = to_c(shift);
+  my ($x1, $x_type) = args([qw/x type/], @_);
   
   if ($x1->vector->type eq 'character') {
-    my $x2_elements = [];
-    for my $x1_element (@{$x1->decompose_elements}) {
-      if ($x1_element->is_na->value) {
-        push @$x2_elements, $x1_element;
-      }
-      else {
-        my $x2_element = Rstats::VectorFunc::new_double(CORE::length $x1_element->value);
-        push @$x2_elements, $x2_element;
-      }
-    }
-    my $x2 = c($x2_elements);
+    my $type = defined $x_type ? $x_type->value : 'chars';
+    my $x2 = NULL;
+    $x2->vector(Rstats::VectorFunc::nchar($x1->vector, $type eq 'bytes' ? 1 : 0));
     $x1->copy_attrs_to($x2);
     
     return $x2;
@@ -1282,17 +1711,8 @@ sub tolower {
   my $x1 = to_c(shift);
   
   if ($x1->vector->type eq 'character') {
-    my $x2_elements = [];
-    for my $x1_element (@{$x1->decompose_elements}) {
-      if ($x1_element->is_na->value) {
-        push @$x2_elements, $x1_element;
-      }
-      else {
-        my $x2_element = Rstats::VectorFunc::new_character(lc $x1_element->value);
-        push @$x2_elements, $x2_element;
-      }
-    }
-    my $x2 = c($x2_elements);
+    my $x2 = NULL;
+    $x2->vector(Rstats::VectorFunc::tolower($x1->vector));
     $x1->copy_attrs_to($x2);
     
     return $x2;
@@ -1306,17 +1726,8 @@ sub toupper {
   my $x1 = to_c(shift);
   
   if ($x1->vector->type eq 'character') {
-    my $x2_elements = [];
-    for my $x1_element (@{$x1->decompose_elements}) {
-      if ($x1_element->is_na->value) {
-        push @$x2_elements, $x1_element;
-      }
-      else {
-        my $x2_element = Rstats::VectorFunc::new_character(uc $x1_element->value);
-        push @$x2_elements, $x2_element;
-      }
-    }
-    my $x2 = c($x2_elements);
+    my $x2 = NULL;
+    $x2->vector(Rstats::VectorFunc::toupper($x1->vector));
     $x1->copy_attrs_to($x2);
     
     return $x2;
@@ -1326,9 +1737,62 @@ sub toupper {
   }
 }
 
+sub sprintf {
+  my $x_fmt = to_c(shift);
+  $x_fmt = $x_fmt->as_character unless $x_fmt->is_character;
+  
+  my @vectors;
+  for my $x (@_) {
+    my $x1 = to_c($x);
+    $x1 = $x1->as_character if $x1->is_factor;
+    push @vectors, $x1->vector;
+  }
+  
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::sprintf($x_fmt->vector, @vectors));
+  
+  return $x2;
+}
+
+sub substr {
+  my ($x1, $x_start, $x_stop, $x_type) = args([qw/x start stop type/], @_);
+  
+  croak "argument \"start\" is missing" unless defined $x_start;
+  croak "argument \"stop\" is missing" unless defined $x_stop;
+  
+  $x1 = $x1->as_character unless $x1->is_character;
+  my $type = defined $x_type ? $x_type->value : 'chars';
+  
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::substr(
+    $x1->vector,
+    $x_start->vector->as_integer,
+    $x_stop->vector->as_integer,
+    $type eq 'bytes' ? 1 : 0
+  ));
+  $x1->copy_attrs_to($x2);
+  
+  return $x2;
+}
+
+sub substring {
+  my ($x1, $x_first, $x_last) = args([qw/text first last/], @_);
+  
+  $x_last = c(1000000) unless defined $x_last;
+  
+  return Rstats::Func::substr($x1, $x_first, $x_last);
+}
+
 sub match {
   my ($x1, $x2) = (to_c(shift), to_c(shift));
   
+  if ($x1->vector->type eq 'character' && $x2->vector->type eq 'character') {
+    my $x3 = NULL;
+    $x3->vector(Rstats::VectorFunc::match($x1->vector, $x2->vector));
+    
+    return $x3;
+  }
+  
   my $x1_elements = $x1->decompose_elements;
   my $x2_elements = $x2->decompose_elements;
   my @matches;
@@ -2040,17 +2504,26 @@ sub rank {
 
 sub paste {
   my $opt = ref $_[-1] eq 'HASH' ? pop @_ : {};
-  my $sep = $opt->{sep};
-  $sep = ' ' unless defined $sep;
+  my $sep = defined $opt->{sep} ? to_c($opt->{sep})->value : ' ';
+  my $collapse = defined $opt->{collapse} ? to_c($opt->{collapse})->value : undef;
   
-  my $str = shift;
-  my $x1 = shift;
+  my @vectors;
+  for my $x (@_) {
+    my $x1 = to_c($x);
+    $x1 = $x1->as_character unless $x1->is_character;
+    push @vectors, $x1->vector;
+  }
   
-  my $x1_values = $x1->values;
-  my $x2_values = [];
-  push @$x2_values, "$str$sep$_" for @$x1_values;
+  my $x2 = NULL;
+  $x2->vector(Rstats::VectorFunc::paste($sep, $collapse, @vectors));
   
-  return c($x2_values);
+  return $x2;
+}
+
+sub paste0 {
+  my $opt = ref $_[-1] eq 'HASH' ? pop @_ : {};
+  
+  return paste(@_, {%$opt, sep => ''});
 }
 
 sub pmax {
@@ -2379,6 +2852,14 @@ sub sort {
   my $x1 = to_c(shift);
   my $decreasing = $opt->{decreasing};
   
+  # Numeric vectors are sorted natively
+  my $type = $x1->vector->type;
+  if (!$x1->is_factor && ($type eq 'double' || $type eq 'integer')) {
+    my $x2 = NULL;
+    $x2->vector(Rstats::VectorFunc::sort($x1->vector, $decreasing ? 1 : 0));
+    return $x2;
+  }
+  
   my @a2_elements = grep { !$_->is_na->value && !$_->is_nan->value } @{$x1->decompose_elements};
   
   my $x3_elements = $decreasing
@@ -2457,7 +2938,13 @@ sub trunc {
 sub unique {
   my $x1 = to_c(shift);
   
-  if ($x1->is_vector) {
+  if ($x1->is_vector && $x1->vector->type eq 'character') {
+    my $x2 = NULL;
+    $x2->vector(Rstats::VectorFunc::unique($x1->vector));
+    
+    return $x2;
+  }
+  elsif ($x1->is_vector) {
     my $x2_elements = [];
     my $elements_count = {};
     my $na_count;
@@ -0,0 +1,38 @@
+package Rstats::Group;
+
+use strict;
+use warnings;
+
+require Rstats;
+
+1;
+
+=head1 NAME
+
+Rstats::Group - Groups of data frame rows and aggregations of the groups
+
+=head1 SYNOPSIS
+
+  my $keys = [{vector => $key->vector}];
+  my ($groups, $first_rows) = @{Rstats::Group->group_rows($keys)};
+  my $sums = Rstats::Group->aggregate('sum', $values->vector, $groups, $first_rows->length_value, 0);
+
+=head1 METHODS
+
+=head2 group_rows (xs)
+
+  my ($groups, $first_rows) = @{Rstats::Group->group_rows($keys)};
+
+Group rows by key columns. Keys are hashes of C<vector> and C<levels> of
+a factor column. The result is integer vectors of the 0-based group of each
+row and the first row of each group. Groups are in order of keys.
+Sorted keys are grouped by runs of same keys. Otherwise each chunk of rows is
+grouped by its own hash table in parallel, and then groups of the chunks are merged.
+
+=head2 aggregate (xs)
+
+  my $x1 = Rstats::Group->aggregate($func, $values, $groups, $group_count, $na_rm);
+
+Aggregation of values by groups. C<$func> is C<n>, C<sum>, C<mean>, C<min>,
+C<max>, C<sd>, C<median> or C<n_distinct>. C<sum>, C<mean>, C<min>, C<max> and
+C<sd> are partially aggregated for each chunk of rows in parallel.
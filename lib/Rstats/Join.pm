@@ -0,0 +1,59 @@
+package Rstats::Join;
+
+use strict;
+use warnings;
+
+require Rstats;
+
+1;
+
+=head1 NAME
+
+Rstats::Join - Joins of data frames on key columns
+
+=head1 SYNOPSIS
+
+  my $keys_x = [{vector => $x_key->vector}];
+  my $keys_y = [{vector => $y_key->vector}];
+  my ($x_rows, $y_rows) = @{Rstats::Join->hash_join($keys_x, $keys_y, $all_x, $all_y, $sort)};
+
+=head1 METHODS
+
+=head2 hash_join (xs)
+
+  my ($x_rows, $y_rows) = @{Rstats::Join->hash_join($keys_x, $keys_y, $all_x, $all_y, $sort)};
+
+Join rows of two sides by key columns. Keys are hashes of C<vector> and
+C<levels> of a factor column. Factors are joined by their labels.
+The result is integer vectors of 0-based rows of x and y for each joined row,
+and -1 is a row which has no match. The hash table is built on the smaller side
+and the other side is probed in parallel.
+
+=head2 merge_join (xs)
+
+  my ($x_rows, $y_rows) = @{Rstats::Join->merge_join($keys_x, $keys_y, $all_x, $all_y)};
+
+Sort-merge join. Both sides are scanned once in order of keys, so sorted
+keys need no extra memory except the result. A side which is not sorted is
+ordered first. Joined rows are in order of keys.
+
+=head2 asof_join (xs)
+
+  my ($x_rows, $y_rows) = @{Rstats::Join->asof_join($keys_x, $keys_y)};
+
+As-of join. Each x row is joined with the y row which has the same keys
+except the last one and the nearest previous value of the last key.
+x rows keep their order.
+
+=head2 is_sorted (xs)
+
+  my $sorted = Rstats::Join->is_sorted($keys);
+
+Whether rows are in ascending order of keys. NA is last.
+
+=head2 gather_key (xs)
+
+  my $key = Rstats::Join->gather_key($x_key, $x_rows, $y_key, $y_rows, $y_codes);
+
+Key column of joined rows. A row which has no x row takes the key of the y row.
+C<$y_codes> converts codes of a y factor to codes of the result.
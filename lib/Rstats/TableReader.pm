@@ -0,0 +1,114 @@
+package Rstats::TableReader;
+
+use strict;
+use warnings;
+
+use Carp 'carp';
+
+require Rstats;
+
+sub read_data_frame {
+  my ($self, $nrows, $levels) = @_;
+  
+  my $vectors = $self->read($nrows);
+  carp $_ for @{$self->upgrades};
+  return unless $vectors;
+  
+  my $names = $self->names;
+  my $classes = $self->classes;
+  
+  my $data_frame_args = [];
+  for (my $i = 0; $i < @$vectors; $i++) {
+    push @$data_frame_args, $names->[$i];
+    
+    my $x1 = Rstats::Func::NULL();
+    $x1->vector($vectors->[$i]);
+    if ($x1->is_character) {
+      # Character column is converted to factor unless colClasses is "character"
+      my $class = $classes->[$i];
+      if (defined $class && $class eq 'character') {
+        push @$data_frame_args, Rstats::Func::I($x1);
+      }
+      elsif ($levels) {
+        # Levels of the previous calls come first and new values are added after them,
+        # so a code means the same label in all data frames
+        my $prev_levels = $levels->{$i} || [];
+        my %prev = map { $_ => 1 } @$prev_levels;
+        my $values = Rstats::Func::sort(Rstats::Func::unique($x1), {'na.last' => Rstats::Func::TRUE()})->values;
+        my $x_levels = Rstats::Func::NULL();
+        $x_levels->vector(
+          Rstats::VectorFunc::new_character(@$prev_levels, grep { defined $_ && !$prev{$_} } @$values)
+        );
+        $levels->{$i} = $x_levels->values;
+        push @$data_frame_args, Rstats::Func::factor($x1, {levels => $x_levels});
+      }
+      else {
+        push @$data_frame_args, $x1->as_factor;
+      }
+    }
+    else {
+      push @$data_frame_args, $x1;
+    }
+  }
+  
+  return Rstats::Func::data_frame(@$data_frame_args);
+}
+
+1;
+
+=head1 NAME
+
+Rstats::TableReader - Reader of delimited text files
+
+=head1 SYNOPSIS
+
+  my $reader = Rstats::TableReader->new($file, {sep => ',', header => 1});
+  my $names = $reader->names;
+  my $vectors = $reader->read;
+
+=head1 METHODS
+
+=head2 new (xs)
+
+  my $reader = Rstats::TableReader->new($file, $options);
+
+Options are C<sep>, C<quote>, C<comment.char>, C<skip>, C<header>, C<encoding>,
+C<colClasses>, C<select>, C<drop> and C<sample>. The file is mapped into memory.
+Column types are inferred from the first C<sample> rows, which are not consumed.
+
+gzip(if Rstats is built with zlib library) and zstd(if Rstats is built with zstd library) compressed file is detected by the magic number,
+and decompressed in a background thread while records are parsed.
+
+C<colClasses> is an array reference recycled over the columns, or a hash reference
+of column names. C<select> and C<drop> are array references of column numbers or names.
+
+=head2 names (xs)
+
+Names of selected columns. Names are C<V1>, C<V2>, ... if the file has no header.
+
+=head2 classes (xs)
+
+C<colClasses> of selected columns. The value is undef if the type is inferred.
+
+=head2 read (xs)
+
+  my $vectors = $reader->read;
+  my $vectors = $reader->read($nrows);
+
+Read rows into L<Rstats::Vector> columns. Return undef if no rows are left.
+
+=head2 upgrades (xs)
+
+Messages of column types which are changed by the last C<read>,
+after the types are decided by C<sample> rows or by the first C<read>.
+
+=head2 read_data_frame
+
+  my $d1 = $reader->read_data_frame;
+  my $d1 = $reader->read_data_frame($nrows);
+  my $d1 = $reader->read_data_frame($nrows, $levels);
+
+Read rows into a data frame. Character columns are factors unless C<colClasses> is C<character>.
+If a hash reference C<$levels> is passed, factor levels are kept in it by column number.
+Levels of the previous calls with the same C<$levels> come first and new values are added after them.
+Changes of column types are warned. Return undef if no rows are left.
@@ -0,0 +1,32 @@
+package Rstats::TableWriter;
+
+use strict;
+use warnings;
+
+require Rstats;
+
+1;
+
+=head1 NAME
+
+Rstats::TableWriter - Writer of delimited text files
+
+=head1 SYNOPSIS
+
+  Rstats::TableWriter->write($file, $vectors, undef, $row_names, $col_names, {sep => ','});
+
+=head1 METHODS
+
+=head2 write (xs)
+
+  Rstats::TableWriter->write($file, $vectors, $ncol, $row_names, $col_names, $options);
+
+Write L<Rstats::Vector> columns into the file. If C<$ncol> is defined,
+C<$vectors> has one vector of a matrix which has C<$ncol> columns.
+C<$row_names> and C<$col_names> are character vectors or undef.
+
+Options are C<sep>, C<eol>, C<na>, C<quote>, C<qmethod>(C<escape> or C<double>),
+C<compress>(gzip), C<row_numbers>(row names are 1, 2, ...) and C<col_names_blank>
+(the header has a blank for row names).
+
+Blocks of rows are formatted and compressed in threads.
@@ -161,4 +161,30 @@ Rstats::Util - Utility class
 
 =head2 cross_product (xs)
 
+=head2 pool_stats (xs)
+
+Usage of the pool allocator, which is shared by all threads of the process.
+
+=head2 get_thread_count (xs)
+
+=head2 set_thread_count (xs)
+
+Count of threads used by parallel functions. Default is RSTATS_NUM_THREADS
+environment variable or count of CPU cores.
+
+=head2 get_sort_memory (xs)
+
+=head2 set_sort_memory (xs)
+
+Bytes of values which C<sort> sorts in memory. Larger mapped vectors are
+sorted by external merge sort. Default is 256MB.
+
+=head2 interned_string_count (xs)
+
+Count of strings in the string pool, which is shared by all threads of the process.
+
+=head2 compress_formats (xs)
+
+Compressed file formats which Rstats is built with, C<gzip>(zlib) and C<zstd>.
+
 1;
@@ -11,40 +11,8 @@ use overload
 sub to_string {
   my $self = shift;
   
-  my @strs;
-  my $values = $self->values;
-  for my $value (@$values) {
-    my $str;
-    if (defined $value) {
-      if ($self->is_character) {
-        $str = $value . "";
-      }
-      elsif ($self->is_complex) {
-        my $re = $value->{re};
-        my $im = $value->{im};
-        
-        $str = "$re";
-        $str .= '+' if $im >= 0;
-        $str .= $im . 'i';
-      }
-      elsif ($self->is_double) {
-        $str = $value . "";
-      }
-      elsif ($self->is_integer) {
-        $str = $value . "";
-      }
-      elsif ($self->is_logical) {
-        $str = $value ? 'TRUE' : 'FALSE'
-      }
-      else {
-        croak "Invalid type";
-      }
-    }
-    else {
-      $str = 'NA';
-    }
-    push @strs, $str;
-  }
+  my $values = $self->is_character ? $self->values : $self->as_character->values;
+  my @strs = map { defined $_ ? $_ : 'NA' } @$values;
   
   my $str_all = join ' ', @strs;
   
@@ -71,6 +39,26 @@ Rstats::Vector - Vector
 
 =head2 values (xs)
 
+=head2 raw_values (xs)
+
+=head2 packed_values (xs)
+
+=head2 re_values (xs)
+
+=head2 im_values (xs)
+
+=head2 buffer (xs)
+
+=head2 new_double_from_buffer (xs)
+
+=head2 new_integer_from_buffer (xs)
+
+=head2 is_inline_values (xs)
+
+=head2 intern (xs)
+
+=head2 is_interned (xs)
+
 =head2 is_character (xs)
 
 =head2 is_complex (xs)
@@ -83,6 +71,8 @@ Rstats::Vector - Vector
 
 =head2 is_logical (xs)
 
+=head2 as_character (xs)
+
 =head2 as_double (xs)
 
 =head2 as_integer (xs)
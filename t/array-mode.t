@@ -245,6 +245,14 @@ use Rstats::VectorFunc;
     ok(r->is_integer($x2));
     is($x2->values->[0], undef);
   }
+
+  # as_integer - character, out of range
+  {
+    my $x1 = array(c("1e300", "-1e300", "Inf"));
+    my $x2 = r->as_integer($x1);
+    ok(r->is_integer($x2));
+    is_deeply($x2->values, [undef, undef, undef]);
+  }
   
   # as_integer - complex
   {
@@ -290,6 +298,14 @@ use Rstats::VectorFunc;
     is_deeply($x2->values, ['Inf']);
   }
 
+  # as_numeric - character, overflow and underflow
+  {
+    my $x1 = array(c("1e400", "-1e400", "1e-400", "+1e400"));
+    my $x2 = r->as_numeric($x1);
+    ok(r->is_numeric($x2));
+    is_deeply($x2->values, ['Inf', '-Inf', 0, 'Inf']);
+  }
+
   # as_numeric - NA
   {
     my $x1 = array(Rstats::VectorFunc::NA);
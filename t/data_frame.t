@@ -188,6 +188,57 @@ use Rstats;
     is_deeply($x2->class->values, ['data.frame']);
     is_deeply($x2->names->values, ['weight']);
   }
+  
+  # get - logical row index with NA, all column types
+  {
+    my $x1 = data_frame(
+      sex => c('F', 'M', NA, 'F'),
+      name => r->I(c('a', "caf\x{e9}", 'c', NA)),
+      height => c(172, NA, 155, 160),
+      count => c(1, 2, 3, 4)->as_integer,
+      flag => c(T, F, NA, T),
+      z => c(r->complex(1, 2), r->complex(3, 4), r->complex(5, 6), r->complex(7, 8))
+    );
+    my $x2 = $x1->get(c(T, NA, T, T), NULL);
+    ok($x2->is_data_frame);
+    is_deeply($x2->getin(1)->levels->values, [qw/F M/]);
+    is_deeply($x2->getin(1)->as_character->values, ['F', undef, 'F']);
+    ok($x2->getin(2)->is_character);
+    is_deeply($x2->getin(2)->values, ['a', 'c', undef]);
+    is_deeply($x2->getin(3)->values, [172, 155, 160]);
+    ok($x2->getin(4)->is_integer);
+    is_deeply($x2->getin(4)->values, [1, 3, 4]);
+    is_deeply($x2->getin(5)->values, [1, undef, 1]);
+    is_deeply($x2->getin(6)->values, [{re => 1, im => 2}, {re => 5, im => 6}, {re => 7, im => 8}]);
+    is_deeply(r->nrow($x2)->values, [3]);
+    is_deeply($x2->rownames->values, [qw/1 2 3/]);
+    is_deeply($x2->dimnames->getin(1)->values, [qw/1 2 3/]);
+  }
+  
+  # get - out of range row index
+  {
+    my $x1 = data_frame(height => c(172, 168), weight => c(5, 6));
+    my $x2 = $x1->get(c(2, 3), NULL);
+    is_deeply($x2->getin(1)->values, [168, undef]);
+    is_deeply($x2->getin(2)->values, [6, undef]);
+  }
+  
+  # get - long data frame is filtered in parallel
+  {
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    my $x1 = data_frame(
+      a => r->seq(1, 100000),
+      b => r->seq(1, 100000)->as_integer,
+      c => r->seq(100000, 1)
+    );
+    my $x2 = r->subset($x1, $x1->getin('a') > 99997);
+    Rstats::Util::set_thread_count($thread_count);
+    is_deeply(r->nrow($x2)->values, [3]);
+    is_deeply($x2->getin(1)->values, [99998, 99999, 100000]);
+    is_deeply($x2->getin(2)->values, [99998, 99999, 100000]);
+    is_deeply($x2->getin(3)->values, [3, 2, 1]);
+  }
 }
 
 # transform
@@ -339,6 +390,15 @@ use Rstats;
     is_deeply($x2->getin(2)->values, [qw/155/]);
     is_deeply($x2->getin(3)->values, [qw/7/]);
   }
+  
+  # na_omit - NaN
+  {
+    my $x1 = data_frame(height => c(172, NaN, 155), weight => c(5, 6, NA));
+    my $x2 = r->na_omit($x1);
+    is_deeply(r->nrow($x2)->values, [1]);
+    is_deeply($x2->getin(1)->values, [172]);
+    is_deeply($x2->getin(2)->values, [5]);
+  }
 }
 
 # head
@@ -452,6 +512,233 @@ use Rstats;
   }
 }
 
+# merge
+{
+  my $x = data_frame(id => c(1, 2, 3, 4), g => c('a', 'b', 'a', 'c'), v => c(10, 20, 30, 40));
+  my $y = data_frame(id => c(4, 2, 2, 5), g => c('c', 'b', 'b', 'd'), v => c(1, 2, 3, 4));
+  
+  # merge - inner join, common names are suffixed
+  {
+    my $x1 = r->merge($x, $y, {by => 'id'});
+    is_deeply($x1->names->values, ['id', 'g.x', 'v.x', 'g.y', 'v.y']);
+    is_deeply($x1->getin('id')->values, [2, 2, 4]);
+    is_deeply($x1->getin('v.x')->values, [20, 20, 40]);
+    is_deeply($x1->getin('v.y')->values, [2, 3, 1]);
+    is_deeply($x1->getin('g.y')->as_character->values, ['b', 'b', 'c']);
+  }
+  
+  # merge - all, composite key
+  {
+    my $x1 = r->merge($x, $y, {by => ['id', 'g'], all => TRUE});
+    is_deeply($x1->names->values, ['id', 'g', 'v.x', 'v.y']);
+    is_deeply($x1->getin('id')->values, [1, 2, 2, 3, 4, 5]);
+    is_deeply($x1->getin('g')->as_character->values, ['a', 'b', 'b', 'a', 'c', 'd']);
+    is_deeply($x1->getin('v.x')->values, [10, 20, 20, 30, 40, undef]);
+    is_deeply($x1->getin('v.y')->values, [undef, 2, 3, undef, 1, 4]);
+  }
+  
+  # merge - all.x, factor key, sort FALSE
+  {
+    my $x1 = r->merge($x, $y, {by => 'g', 'all.x' => TRUE, sort => FALSE});
+    is_deeply($x1->getin('g')->as_character->values, ['a', 'b', 'b', 'a', 'c']);
+    is_deeply($x1->getin('g')->levels->values, ['a', 'b', 'c', 'd']);
+    is_deeply($x1->getin('id.y')->values, [undef, 2, 2, undef, 4]);
+  }
+  
+  # merge - by.x, by.y, all.y, suffixes
+  {
+    my $y1 = data_frame(key => c(4, 2, 5), w => c(1, 2, 3));
+    my $x1 = r->merge($x, $y1, {'by.x' => 'id', 'by.y' => 'key', 'all.y' => TRUE});
+    is_deeply($x1->names->values, ['id', 'g', 'v', 'w']);
+    is_deeply($x1->getin('id')->values, [2, 4, 5]);
+    is_deeply($x1->getin('v')->values, [20, 40, undef]);
+    
+    my $x2 = r->merge($x, $y, {by => 'id', suffixes => c('_l', '_r')});
+    is_deeply($x2->names->values, ['id', 'g_l', 'v_l', 'g_r', 'v_r']);
+  }
+  
+  # merge - NA key matches NA, integer and double keys
+  {
+    my $x1 = data_frame(k => c(1, NA, 3), v => c(1, 2, 3));
+    my $y1 = data_frame(k => r->as_integer(c(3, NA)), w => c(30, 20));
+    my $x2 = r->merge($x1, $y1);
+    is_deeply($x2->getin('k')->values, [3, undef]);
+    is_deeply($x2->getin('w')->values, [30, 20]);
+  }
+  
+  # merge - long data frames
+  {
+    my $x1 = data_frame(k => c(1 .. 100000), v => c(1 .. 100000));
+    my $y1 = data_frame(k => c(map { $_ * 2 } 1 .. 50000), w => c(1 .. 50000));
+    my $x2 = r->merge($x1, $y1);
+    is(r->nrow($x2)->value, 50000);
+    is_deeply([@{$x2->getin('v')->values}[0 .. 2]], [2, 4, 6]);
+    is($x2->getin('w')->values->[-1], 50000);
+  }
+  
+  # merge - interned character keys are hashed in threads
+  {
+    my $x1 = data_frame(k => r->I(c(map { sprintf('k%06d', $_) } 1 .. 100000)), v => se('1:100000'));
+    my $y1 = data_frame(k => r->I(c(map { sprintf('k%06d', $_ * 2) } 1 .. 50000)), w => se('1:50000'));
+    for my $x_key ($x1->getin('k'), $y1->getin('k')) {
+      $x_key->vector($x_key->vector->intern);
+    }
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    my $x2 = r->merge($x1, $y1, {method => 'hash'});
+    Rstats::Util::set_thread_count($thread_count);
+    is(r->nrow($x2)->value, 50000);
+    is_deeply([@{$x2->getin('k')->values}[0, -1]], ['k000002', 'k100000']);
+    is_deeply([@{$x2->getin('v')->values}[0, -1]], [2, 100000]);
+  }
+  
+  # merge - sort-merge join gives same rows as hash join
+  {
+    for my $all (FALSE, TRUE) {
+      my $x1 = r->merge($x, $y, {by => ['id', 'g'], all => $all, method => 'hash'});
+      my $x2 = r->merge($x, $y, {by => ['id', 'g'], all => $all, method => 'sort'});
+      is_deeply($x2->getin('id')->values, $x1->getin('id')->values);
+      is_deeply($x2->getin('v.x')->values, $x1->getin('v.x')->values);
+      is_deeply($x2->getin('v.y')->values, $x1->getin('v.y')->values);
+    }
+  }
+  
+  # merge - sorted keys are detected
+  {
+    my $x1 = data_frame(k => c(1, 1, 2, 3, NA), v => c(1, 2, 3, 4, 5));
+    my $y1 = data_frame(k => c(1, 3, 3, NA), w => c(10, 30, 31, 50));
+    ok(Rstats::Join->is_sorted([{vector => $x1->getin('k')->vector}]));
+    ok(!Rstats::Join->is_sorted([{vector => $x->getin('g')->vector, levels => $x->getin('g')->{levels}}]));
+    my $x2 = r->merge($x1, $y1, {'all.x' => TRUE});
+    is_deeply($x2->getin('k')->values, [1, 1, 2, 3, 3, undef]);
+    is_deeply($x2->getin('v')->values, [1, 2, 3, 4, 4, 5]);
+    is_deeply($x2->getin('w')->values, [10, 10, undef, 30, 31, 50]);
+  }
+  
+  # merge - sortedness of interned character keys is checked in threads
+  {
+    my $x1 = data_frame(k => r->I(c(map { sprintf('k%06d', $_) } 1 .. 100000)));
+    my $x_key = $x1->getin('k');
+    $x_key->vector($x_key->vector->intern);
+    my $y1 = data_frame(k => r->I(c('k000001', 'k099999')), w => c(1, 2));
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    ok(Rstats::Join->is_sorted([{vector => $x_key->vector}]));
+    my $x2 = r->merge($x1, $y1, {method => 'sort'});
+    Rstats::Util::set_thread_count($thread_count);
+    is_deeply($x2->getin('k')->values, ['k000001', 'k099999']);
+    is_deeply($x2->getin('w')->values, [1, 2]);
+  }
+  
+  # merge - as-of join with roll
+  {
+    my $x1 = data_frame(s => c('a', 'a', 'a', 'b', 'a'), t => c(1, 5, 10, 3, NA));
+    my $y1 = data_frame(s => c('a', 'a', 'a', 'a', 'b', 'b'), t => c(0, 2, 5, 5, 4, 1), p => c(100, 102, 105, 106, 204, 201));
+    my $x2 = r->merge($x1, $y1, {by => ['s', 't'], roll => TRUE});
+    is_deeply($x2->getin('t')->values, [1, 5, 10, 3, undef]);
+    is_deeply($x2->getin('p')->values, [100, 106, 106, 201, undef]);
+    
+    my $x3 = r->merge(data_frame(t => c(-1, 0.5)), data_frame(t => c(0, 1), p => c(1, 2)), {roll => TRUE});
+    is_deeply($x3->getin('p')->values, [undef, 1]);
+  }
+  
+  # merge - errors
+  {
+    eval { r->merge(c(1), $y) };
+    like($@, qr/x and y must be data frames/);
+    eval { r->merge($x, data_frame(z => c(1))) };
+    like($@, qr/no columns to join by/);
+    eval { r->merge($x, $y, {method => 'nested'}) };
+    like($@, qr/method must be/);
+  }
+}
+
+# summarise
+{
+  my $x = data_frame(
+    g => c('b', 'a', 'b', 'a', 'c'),
+    h => c(1, 1, 2, 1, 1),
+    v => c(1, 2, 3, NA, 5),
+    w => r->as_integer(c(5, 4, 3, 2, 1))
+  );
+  
+  # summarise - one key, all functions
+  {
+    my $x1 = r->summarise($x,
+      total => 'sum(w)', avg => 'mean(v)', lo => 'min(w)', hi => 'max(v)',
+      n => 'n()', nd => 'n_distinct(h)', med => 'median(w)', s => 'sd(w)',
+      {by => 'g'}
+    );
+    is_deeply($x1->names->values, [qw/g total avg lo hi n nd med s/]);
+    is_deeply($x1->getin('g')->as_character->values, ['a', 'b', 'c']);
+    ok($x1->getin('g')->is_factor);
+    is_deeply($x1->getin('total')->values, [6, 8, 1]);
+    ok($x1->getin('total')->is_integer);
+    is_deeply($x1->getin('avg')->values, [undef, 2, 5]);
+    is_deeply($x1->getin('lo')->values, [2, 3, 1]);
+    is_deeply($x1->getin('hi')->values, [undef, 3, 5]);
+    is_deeply($x1->getin('n')->values, [2, 2, 1]);
+    is_deeply($x1->getin('nd')->values, [1, 2, 1]);
+    is_deeply($x1->getin('med')->values, [3, 4, 1]);
+    is(sprintf('%.6f', $x1->getin('s')->values->[0]), '1.414214');
+    is($x1->getin('s')->values->[2], undef);
+  }
+  
+  # summarise - composite key, na.rm
+  {
+    my $x1 = r->summarise($x, avg => 'mean(v)', hi => 'max(v)', {by => ['g', 'h'], 'na.rm' => TRUE});
+    is_deeply($x1->getin('g')->as_character->values, ['a', 'b', 'b', 'c']);
+    is_deeply($x1->getin('h')->values, [1, 1, 2, 1]);
+    is_deeply($x1->getin('avg')->values, [2, 1, 3, 5]);
+    is_deeply($x1->getin('hi')->values, [2, 1, 3, 5]);
+  }
+  
+  # summarise - sorted keys and hashed keys give same groups
+  {
+    my @keys = map { int($_ / 1000) } 0 .. 99999;
+    my $x1 = data_frame(k => c(@keys), v => c(0 .. 99999));
+    my $x2 = data_frame(k => c(reverse @keys), v => c(reverse 0 .. 99999));
+    my $x3 = r->summarise($x1, s => 'sum(v)', m => 'median(v)', {by => 'k'});
+    my $x4 = r->summarise($x2, s => 'sum(v)', m => 'median(v)', {by => 'k'});
+    is(r->nrow($x3)->value, 100);
+    is_deeply($x4->getin('k')->values, $x3->getin('k')->values);
+    is_deeply($x4->getin('s')->values, $x3->getin('s')->values);
+    is_deeply($x4->getin('m')->values, $x3->getin('m')->values);
+    is($x3->getin('s')->values->[1], 1499500);
+    is($x3->getin('m')->values->[1], 1499.5);
+  }
+  
+  # summarise - interned character keys and values are grouped in threads
+  {
+    my $x1 = data_frame(
+      k => r->I(c(map { sprintf('g%02d', $_ % 100) } 0 .. 99999)),
+      h => r->I(c(map { 'h' . $_ % 7 } 0 .. 99999))
+    );
+    for my $x_column ($x1->getin('k'), $x1->getin('h')) {
+      $x_column->vector($x_column->vector->intern);
+    }
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    my $x2 = r->summarise($x1, n => 'n()', nd => 'n_distinct(h)', {by => 'k'});
+    Rstats::Util::set_thread_count($thread_count);
+    is_deeply($x2->getin('k')->as_character->values, [map { sprintf('g%02d', $_) } 0 .. 99]);
+    is_deeply($x2->getin('n')->values, [(1000) x 100]);
+    is_deeply($x2->getin('nd')->values, [(7) x 100]);
+  }
+  
+  # summarise - errors
+  {
+    eval { r->summarise($x, s => 'sum(v)') };
+    like($@, qr/no columns to group by/);
+    eval { r->summarise($x, s => 'var(v)', {by => 'g'}) };
+    like($@, qr/unknown function "var"/);
+    eval { r->summarise($x, s => 'sum(z)', {by => 'g'}) };
+    like($@, qr/object 'z' not found/);
+    eval { r->summarise($x, s => 'sum(g)', {by => 'h'}) };
+    like($@, qr/invalid 'type'/);
+  }
+}
+
 # data_frame - to_string
 {
   # data_frame - to_string
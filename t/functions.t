@@ -481,6 +481,59 @@ use Math::Trig ();
   }
 }
 
+# sub and gsub
+{
+  # sub - capture group
+  {
+    my $x1 = r->sub("(\\w+)@(\\w+)", "\\2 at \\1", c("user\@example", "none"));
+    is_deeply($x1->values, ["example at user", "none"]);
+  }
+  
+  # sub - whole match and backslash in replacement
+  {
+    my $x1 = r->sub("an", "<\\0>", c("banana"));
+    is_deeply($x1->values, ["b<an>ana"]);
+    my $x2 = r->sub("a", "\\\\", c("banana"));
+    is_deeply($x2->values, ["b\\nana"]);
+    my $x3 = r->gsub("a", "\\\\1", c("banana"));
+    is_deeply($x3->values, ["b\\1n\\1n\\1"]);
+  }
+  
+  # gsub - fixed
+  {
+    my $x1 = r->gsub(".", "-", c("a.b.c", "abc"), {fixed => TRUE});
+    is_deeply($x1->values, ["a-b-c", "abc"]);
+  }
+  
+  # gsub - empty match
+  {
+    my $x1 = r->gsub("x*", "-", c("abc"));
+    is_deeply($x1->values, ["-a-b-c-"]);
+  }
+  
+  # gsub - utf8
+  {
+    my $x1 = r->gsub("\x{3044}", "i", c("\x{3042}\x{3044}\x{3044}", "caf\x{e9}"));
+    is_deeply($x1->values, ["\x{3042}ii", "caf\x{e9}"]);
+  }
+}
+
+# grepl
+{
+  my $x1 = r->grepl("b", c("abc", NA, "xyz"));
+  is_deeply($x1->values, [1, 0, 0]);
+  
+  my $x2 = r->grepl("a.c", c("abc", "a.c"), {fixed => TRUE});
+  is_deeply($x2->values, [0, 1]);
+}
+
+# regexpr
+{
+  my $x1 = r->regexpr("b+", c("abbc", "xyz", NA, "\x{3042}bb"));
+  is_deeply($x1->values, [2, -1, undef, 2]);
+  is_deeply($x1->match_length->values, [2, -1, undef, 2]);
+}
+
 # grep
 {
   # grep - case not ignore
@@ -507,6 +560,12 @@ use Math::Trig ();
   my $x3 = c("abc", "def", NA);
   my $x4 = r->chartr($x1, $x2, $x3);
   is_deeply($x4->values, ["ABC", "DEF", undef]);
+  
+  # chartr - utf8
+  {
+    my $x1 = r->chartr("a\x{3042}", "b\x{3044}", c("a\x{3042}c", "aa"));
+    is_deeply($x1->values, ["b\x{3044}c", "bb"]);
+  }
 }
 
 # charmatch
@@ -868,13 +927,143 @@ use Math::Trig ();
     my $v1 = r->paste('x', se('1:3'), {sep => ''});
     is_deeply($v1->values, ['x1', 'x2', 'x3']);
   }
+  # paste - recycle
+  {
+    my $v1 = r->paste(c('a', 'b'), se('1:4'), 'z', {sep => '-'});
+    is_deeply($v1->values, ['a-1-z', 'b-2-z', 'a-3-z', 'b-4-z']);
+  }
+  # paste - NA
+  {
+    my $v1 = r->paste(c('a', NA), 'b');
+    is_deeply($v1->values, ['a b', 'NA b']);
+  }
+  # paste - collapse
+  {
+    my $v1 = r->paste('x', se('1:3'), {sep => '', collapse => '+'});
+    is_deeply($v1->values, ['x1+x2+x3']);
+  }
+  # paste - zero length
+  {
+    my $v1 = r->paste(r->as_character(NULL), 'a');
+    is_deeply($v1->values, [' a']);
+    my $v2 = r->paste(r->as_character(NULL));
+    is_deeply($v2->values, []);
+    my $v3 = r->paste(r->as_character(NULL), {collapse => ''});
+    is_deeply($v3->values, ['']);
+  }
+  # paste - UTF-8
+  {
+    my $v1 = r->paste("\x{3042}", "\x{e9}", {sep => "\x{e9}"});
+    is_deeply($v1->values, ["\x{3042}\x{e9}\x{e9}"]);
+  }
+}
+
+# paste0
+{
+  # paste0 - basic
+  {
+    my $v1 = r->paste0('x', se('1:3'));
+    is_deeply($v1->values, ['x1', 'x2', 'x3']);
+  }
+  # paste0 - collapse
+  {
+    my $v1 = r->paste0('x', se('1:3'), {collapse => ','});
+    is_deeply($v1->values, ['x1,x2,x3']);
+  }
+}
+
+# sprintf
+{
+  # sprintf - basic
+  {
+    my $v1 = r->sprintf('%s is %.2f', c('a', 'b'), c(1.5, 2));
+    is_deeply($v1->values, ['a is 1.50', 'b is 2.00']);
+  }
+  # sprintf - integer
+  {
+    my $v1 = r->sprintf('%03d|%x|%5s|%%', se('1:2'), 255, 'ab');
+    is_deeply($v1->values, ['001|ff|   ab|%', '002|ff|   ab|%']);
+  }
+  # sprintf - NA, NaN and Inf
+  {
+    my $v1 = r->sprintf('%d', c(1, NA));
+    is_deeply($v1->values, ['1', 'NA']);
+    my $v2 = r->sprintf('%f', c(NaN, Inf, -Inf));
+    is_deeply($v2->values, ['NaN', 'Inf', '-Inf']);
+  }
+  # sprintf - vectorized format
+  {
+    my $v1 = r->sprintf(c('%d', '[%d]'), 5);
+    is_deeply($v1->values, ['5', '[5]']);
+  }
+  # sprintf - %s with number
+  {
+    my $v1 = r->sprintf('x%s', 1.5);
+    is_deeply($v1->values, ['x1.5']);
+  }
+  # sprintf - %d with not integer
+  {
+    eval { r->sprintf('%d', 1.5) };
+    like($@, qr/invalid format/);
+  }
 }
 
 # nchar
 {
-  my $v1 = c("AAA", "BB", NA);
-  my $v2 = r->nchar($v1);
-  is_deeply($v2->values, [3, 2, undef])
+  # nchar - basic
+  {
+    my $v1 = c("AAA", "BB", NA);
+    my $v2 = r->nchar($v1);
+    is_deeply($v2->values, [3, 2, undef])
+  }
+  
+  # nchar - utf8
+  {
+    my $v1 = c("\x{3042}\x{3044}", "caf\x{e9}");
+    is_deeply(r->nchar($v1)->values, [2, 4]);
+    is_deeply(r->nchar($v1, {type => "bytes"})->values, [6, 5]);
+  }
+}
+
+# substr
+{
+  # substr - basic
+  {
+    my $v1 = c("abcdef", "xy", NA);
+    my $v2 = r->substr($v1, 2, 4);
+    is_deeply($v2->values, ["bcd", "y", undef]);
+  }
+  
+  # substr - recycled start and stop
+  {
+    my $v1 = c("abcdef", "abcdef", "abcdef");
+    my $v2 = r->substr($v1, c(1, 2, 3), c(1, 3, 10));
+    is_deeply($v2->values, ["a", "bc", "cdef"]);
+  }
+  
+  # substr - start is larger than stop
+  {
+    my $v1 = c("abc");
+    is_deeply(r->substr($v1, 3, 2)->values, [""]);
+  }
+  
+  # substr - utf8
+  {
+    my $v1 = c("\x{3042}\x{3044}\x{3046}");
+    is_deeply(r->substr($v1, 2, 3)->values, ["\x{3044}\x{3046}"]);
+    is_deeply(r->substr(c("abc"), 2, 3, {type => "bytes"})->values, ["bc"]);
+    is_deeply(r->substr($v1, 4, 6, {type => "bytes"})->values, ["\x{3044}"]);
+    my $v2 = r->substr($v1, 1, 4, {type => "bytes"});
+    is_deeply($v2->values, ["\xe3\x81\x82\xe3"]);
+    ok(!utf8::is_utf8($v2->values->[0]));
+  }
+}
+
+# substring
+{
+  my $v1 = c("abcdef");
+  is_deeply(r->substring($v1, 3)->values, ["cdef"]);
+  is_deeply(r->substring($v1, 1, 2)->values, ["ab"]);
 }
 
 # tolower
@@ -886,9 +1075,20 @@ use Math::Trig ();
 
 # toupper
 {
-  my $v1 = c("aa", "bb", NA);
-  my $v2 = r->toupper($v1);
-  is_deeply($v2->values, ["AA", "BB", undef])
+  # toupper - basic
+  {
+    my $v1 = c("aa", "bb", NA);
+    my $v2 = r->toupper($v1);
+    is_deeply($v2->values, ["AA", "BB", undef])
+  }
+  
+  # toupper - long string and utf8
+  {
+    my $v1 = c("abcdefghijklmnopqrstuvwxyz0123456789[]{}", "caf\x{e9} \x{3b1}");
+    my $v2 = r->toupper($v1);
+    is_deeply($v2->values, ["ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789[]{}", "CAF\x{c9} \x{391}"]);
+    is_deeply(r->tolower($v2)->values, ["abcdefghijklmnopqrstuvwxyz0123456789[]{}", "caf\x{e9} \x{3b1}"]);
+  }
 }
 
 # match
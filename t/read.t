@@ -4,6 +4,10 @@ use warnings;
 
 use Rstats;
 use FindBin;
+use File::Temp ();
+use IO::Compress::Gzip ();
+
+my $has_gzip = grep { $_ eq 'gzip' } @{Rstats::Util::compress_formats()};
 
 # read_table
 {
@@ -45,5 +49,603 @@ use FindBin;
     is_deeply($d1->getin(1)->values, [qw/2 3/]);
     is_deeply($d1->getin(2)->values, [qw/1.1 1.2/]);
   }
+
+  # read_table - quote, comment, empty field and UTF-8
+  {
+    my $d1 = r->read_table("$FindBin::Bin/data/read.t/quote.csv", {sep => ',', header => T});
+    is_deeply($d1->names->values, [qw/name value note/]);
+    is_deeply($d1->getin(1)->levels->values, ["a, b", "caf\x{e9}", 'say "hi"']);
+    ok($d1->getin(2)->is_double);
+    is_deeply($d1->getin(2)->values, [1, undef, 3.5]);
+    is_deeply($d1->getin(3)->levels->values, ["two\nlines", "x ", "z"]);
+  }
+  
+  # read_table - overflow and underflow of double
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "1e400 1\n-1e400 2\n1e-400 3\n";
+    close $tmp;
+    my $d1 = r->read_table($tmp->filename);
+    ok($d1->getin(1)->is_double);
+    is_deeply($d1->getin(1)->values, ['Inf', '-Inf', 0]);
+  }
+
+  # read_table - nrows
+  {
+    my $d1 = r->read_table("$FindBin::Bin/data/read.t/quote.csv", {sep => ',', header => T, nrows => 2});
+    is_deeply($d1->getin(2)->values, [1, undef]);
+  }
+  
+  # read_table - different count of fields
+  {
+    eval { r->read_table("$FindBin::Bin/data/read.t/quote.csv", {sep => ','}) };
+    ok(!$@);
+    eval { r->read_table("$FindBin::Bin/data/read.t/ragged.txt") };
+    like($@, qr/line 2 did not have 2 elements/);
+  }
+
+  # read_table - chunks parsed in threads
+  {
+    my $tmp = File::Temp->new;
+    for my $i (1 .. 60000) {
+      my $value = $i == 50000 ? 'x' : $i % 100;
+      print $tmp qq/$i,"text $i\nnext ""line""",$value,${\($i * 0.5)}\n/;
+    }
+    close $tmp;
+    
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    my $d1 = r->read_table($tmp->filename, {sep => ','});
+    Rstats::Util::set_thread_count(1);
+    my $d2 = r->read_table($tmp->filename, {sep => ','});
+    Rstats::Util::set_thread_count($thread_count);
+    
+    is($d1->getin(1)->length_value, 60000);
+    ok($d1->getin(1)->is_integer);
+    is_deeply($d1->getin(1)->values, $d2->getin(1)->values);
+    is_deeply($d1->getin(2)->as_character->values, $d2->getin(2)->as_character->values);
+    is($d1->getin(2)->as_character->values->[9], qq/text 10\nnext "line"/);
+    ok($d1->getin(3)->is_factor);
+    is_deeply($d1->getin(3)->as_character->values, $d2->getin(3)->as_character->values);
+    ok($d1->getin(4)->is_double);
+    is_deeply($d1->getin(4)->values, $d2->getin(4)->values);
+  }
+  
+  # read_table - colClasses
+  {
+    my $file = "$FindBin::Bin/data/read.t/quote.csv";
+    my $d1 = r->read_table($file, {sep => ',', header => T, colClasses => c('character', 'complex', 'factor')});
+    ok($d1->getin(1)->is_character);
+    is_deeply($d1->getin(1)->values, ["a, b", 'say "hi"', "caf\x{e9}"]);
+    ok($d1->getin(2)->is_complex);
+    is_deeply($d1->getin(2)->values->[0], {re => 1, im => 0});
+    ok($d1->getin(3)->is_factor);
+    
+    my $x_col_classes = c('integer', 'NULL');
+    $x_col_classes->names(c('value', 'note'));
+    eval { r->read_table($file, {sep => ',', header => T, colClasses => $x_col_classes}) };
+    like($@, qr/line 7 expected 'integer', got '3\.5'/);
+    
+    $x_col_classes = c('numeric', 'NULL');
+    $x_col_classes->names(c('value', 'note'));
+    my $d2 = r->read_table($file, {sep => ',', header => T, colClasses => $x_col_classes});
+    is_deeply($d2->names->values, [qw/name value/]);
+    ok($d2->getin(1)->is_factor);
+    ok($d2->getin(2)->is_double);
+    
+    eval { r->read_table($file, {sep => ',', header => T, colClasses => c(NA, 'integer')}) };
+    like($@, qr/line 7 expected 'integer', got '3\.5'/);
+    
+    eval { r->read_table($file, {sep => ',', colClasses => c('date')}) };
+    like($@, qr/invalid colClasses 'date'/);
+  }
+  
+  # read_table - select and drop
+  {
+    my $file = "$FindBin::Bin/data/read.t/quote.csv";
+    my $d1 = r->read_table($file, {sep => ',', header => T, select => c('note', 'value')});
+    is_deeply($d1->names->values, [qw/value note/]);
+    is_deeply($d1->getin(1)->values, [1, undef, 3.5]);
+    
+    my $d2 = r->read_table($file, {sep => ',', header => T, select => c(1, 3)});
+    is_deeply($d2->names->values, [qw/name note/]);
+    
+    my $d3 = r->read_table($file, {sep => ',', header => T, drop => c('name')});
+    is_deeply($d3->names->values, [qw/value note/]);
+    
+    eval { r->read_table($file, {sep => ',', header => T, select => c('foo')}) };
+    like($@, qr/column 'foo' is not found/);
+    
+    eval { r->read_table($file, {sep => ',', header => T, select => c(1), drop => c(2)}) };
+    like($@, qr/select and drop/);
+    
+    # The mapping of the file is released when the reader croaks
+    SKIP: {
+      skip 'no /proc/self/maps', 1 unless -r '/proc/self/maps';
+      eval { r->read_table($file, {sep => ',', header => T, select => c(9)}) };
+      open my $maps, '<', '/proc/self/maps' or die $!;
+      ok(!grep { index($_, 'quote.csv') >= 0 } <$maps>);
+    }
+  }
+  
+  # read_table_chunked
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "id,value,name\n";
+    for my $i (1 .. 250) {
+      my $value = $i == 160 ? 1.5 : $i;
+      print $tmp "$i,$value,n$i\n";
+    }
+    close $tmp;
+    
+    # Types from sample
+    {
+      my $reader = r->read_table_chunked($tmp->filename, {sep => ',', header => T, chunk_size => 100, sample => 200});
+      is_deeply($reader->names, [qw/id value name/]);
+      my @warnings;
+      local $SIG{__WARN__} = sub { push @warnings, @_ };
+      my $lengths = [];
+      while (my $d1 = $reader->next) {
+        push @$lengths, $d1->getin(1)->length_value;
+        ok($d1->getin(1)->is_integer);
+        ok($d1->getin(2)->is_double);
+        ok($d1->getin(3)->is_factor);
+      }
+      is_deeply($lengths, [100, 100, 50]);
+      is(scalar @warnings, 0);
+    }
+    
+    # Upgrade found after sample
+    {
+      my $reader = r->read_table_chunked($tmp->filename, {sep => ',', header => T, chunk_size => 100, sample => 10});
+      my @warnings;
+      local $SIG{__WARN__} = sub { push @warnings, @_ };
+      my $d1 = $reader->next;
+      ok($d1->getin(2)->is_integer);
+      my $d2 = $reader->next;
+      ok($d2->getin(2)->is_double);
+      is($d2->getin(2)->values->[59], 1.5);
+      is(scalar @warnings, 1);
+      like($warnings[0], qr/type of column 'value' is changed from integer to double in the rows from line 102/);
+      my $d3 = $reader->next;
+      ok($d3->getin(2)->is_double);
+      ok(!defined $reader->next);
+    }
+    
+    # colClasses
+    {
+      my $reader = r->read_table_chunked(
+        $tmp->filename,
+        {sep => ',', header => T, chunk_size => 100, sample => 10, colClasses => c('numeric', 'numeric', 'character')}
+      );
+      my $d1 = $reader->next;
+      ok($d1->getin(1)->is_double);
+      ok($d1->getin(3)->is_character);
+    }
+  }
+  
+  # read_table_chunked - factor levels are shared by chunks
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "k\nb\na\nc\na\nb\nb\n";
+    close $tmp;
+    
+    my $reader = r->read_table_chunked($tmp->filename, {header => T, chunk_size => 2, sample => 2});
+    my $d1 = $reader->next;
+    is_deeply($d1->getin(1)->levels->values, ['a', 'b']);
+    is_deeply($d1->getin(1)->values, [2, 1]);
+    my $d2 = $reader->next;
+    is_deeply($d2->getin(1)->levels->values, ['a', 'b', 'c']);
+    is_deeply($d2->getin(1)->values, [3, 1]);
+    my $d3 = $reader->next;
+    is_deeply($d3->getin(1)->levels->values, ['a', 'b', 'c']);
+    is_deeply($d3->getin(1)->values, [2, 2]);
+    ok(!defined $reader->next);
+  }
+  
+  # read_table - gzip compressed file
+  SKIP: {
+    skip 'Rstats is built without zlib', 1 unless $has_gzip;
+    
+    # Data is larger than a segment and has quoted line breaks
+    my $plain = File::Temp->new;
+    for my $i (1 .. 400000) {
+      my $value = $i == 390000 ? 'x' : $i % 7;
+      print $plain qq/$i,"text $i\nnext",$value,${\($i * 0.25)}\n/;
+    }
+    close $plain;
+    
+    my $gz = File::Temp->new(SUFFIX => '.gz');
+    close $gz;
+    IO::Compress::Gzip::gzip($plain->filename => $gz->filename) or die $IO::Compress::Gzip::GzipError;
+    
+    my $vectors1 = Rstats::TableReader->new($gz->filename, {sep => ','})->read;
+    my $vectors2 = Rstats::TableReader->new($plain->filename, {sep => ','})->read;
+    is($vectors1->[0]->length_value, 400000);
+    for my $k (0 .. 3) {
+      is($vectors1->[$k]->type, $vectors2->[$k]->type);
+      is_deeply($vectors1->[$k]->values, $vectors2->[$k]->values);
+    }
+    is($vectors1->[1]->values->[9], "text 10\nnext");
+    
+    # Chunks
+    my $reader = Rstats::TableReader->new($gz->filename, {sep => ','});
+    my $lengths = [];
+    my $ids = [];
+    while (my $vectors = $reader->read(150000)) {
+      push @$lengths, $vectors->[0]->length_value;
+      push @$ids, $vectors->[0]->values->[-1];
+    }
+    is_deeply($lengths, [150000, 150000, 100000]);
+    is_deeply($ids, [150000, 300000, 400000]);
+  }
+  
+  # read_table - concatenated and broken gzip files
+  SKIP: {
+    skip 'Rstats is built without zlib', 1 unless $has_gzip;
+    
+    my $gz = File::Temp->new(SUFFIX => '.gz');
+    close $gz;
+    IO::Compress::Gzip::gzip(\"a b\n1 x\n" => $gz->filename) or die $IO::Compress::Gzip::GzipError;
+    IO::Compress::Gzip::gzip(\"2 y\n" => $gz->filename, Append => 1) or die $IO::Compress::Gzip::GzipError;
+    my $d1 = r->read_table($gz->filename, {header => T});
+    is_deeply($d1->names->values, [qw/a b/]);
+    is_deeply($d1->getin(1)->values, [1, 2]);
+    my $reader = r->read_table_chunked($gz->filename, {header => T, chunk_size => 1});
+    is_deeply($reader->next->getin(2)->as_character->values, ['x']);
+    is_deeply($reader->next->getin(2)->as_character->values, ['y']);
+    ok(!defined $reader->next);
+    
+    my $compressed;
+    IO::Compress::Gzip::gzip(\("1 2\n" x 1000) => \$compressed) or die $IO::Compress::Gzip::GzipError;
+    my $broken = File::Temp->new(SUFFIX => '.gz');
+    print $broken substr($compressed, 0, length($compressed) - 12);
+    close $broken;
+    eval { r->read_table($broken->filename) };
+    like($@, qr/unexpected end of compressed file/);
+    
+    # The decompressor thread is stopped when the reader croaks while it is running ahead
+    SKIP: {
+      skip 'no /proc/self/task', 1 unless -d '/proc/self/task';
+      my $thread_count = sub { opendir my $dh, '/proc/self/task' or die $!; scalar grep { /^\d+$/ } readdir $dh };
+      my $large = File::Temp->new(SUFFIX => '.gz');
+      close $large;
+      IO::Compress::Gzip::gzip(\("a b\n" . ("1 2\n" x 10000000)) => $large->filename) or die $IO::Compress::Gzip::GzipError;
+      my $count1 = $thread_count->();
+      eval { r->read_table($large->filename, {header => T, select => c('c')}) };
+      like($@, qr/column 'c' is not found/);
+      is($thread_count->(), $count1);
+    }
+  }
+  
+  # read_table and write_table - gzip without zlib
+  SKIP: {
+    skip 'Rstats is built with zlib', 2 if $has_gzip;
+    
+    my $gz = File::Temp->new(SUFFIX => '.gz');
+    close $gz;
+    IO::Compress::Gzip::gzip(\"a b\n1 2\n" => $gz->filename) or die $IO::Compress::Gzip::GzipError;
+    eval { r->read_table($gz->filename) };
+    like($@, qr/gzip compressed file is not supported/);
+    eval { r->write_table(data_frame(a => c(1)), $gz->filename) };
+    like($@, qr/gzip compression is not supported/);
+  }
+}
+
+# write_table
+{
+  # write_table - data frame
+  {
+    my $d1 = data_frame(
+      name => c('a', 'say "hi"', NA),
+      value => c(1.5, NA, 1/3),
+      count => c(1, 2, 3)->as_integer,
+      flag => c(T, F, T),
+      z => c(r->complex(1, 2), r->complex(-1, -1), r->complex(0, 0))
+    );
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->write_table($d1, $tmp->filename);
+    my $text = do { open my $fh, '<', $tmp->filename or die $!; local $/; <$fh> };
+    is($text, <<'EOS');
+"name" "value" "count" "flag" "z"
+"1" "a" 1.5 1 TRUE 1+2i
+"2" "say \"hi\"" NA 2 FALSE -1-1i
+"3" NA 0.333333333333333 3 TRUE 0+0i
+EOS
+    
+    r->write_table($d1, $tmp->filename, {'row.names' => F});
+    my $d2 = r->read_table($tmp->filename, {header => T});
+    is_deeply($d2->names->values, [qw/name value count flag z/]);
+    is_deeply($d2->getin(2)->values, [1.5, undef, 0.333333333333333]);
+  }
+  
+  # write_table - options
+  {
+    my $d1 = data_frame(a => c(1, 2), b => c('x', 'y'));
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->write_table($d1, $tmp->filename, {sep => "\t", quote => F, 'row.names' => F, na => ''});
+    my $text = do { open my $fh, '<', $tmp->filename or die $!; local $/; <$fh> };
+    is($text, "a\tb\n1\tx\n2\ty\n");
+    
+    r->write_table($d1, $tmp->filename, {'row.names' => c('r1', 'r2'), 'col.names' => F});
+    $text = do { open my $fh, '<', $tmp->filename or die $!; local $/; <$fh> };
+    is($text, qq/"r1" 1 "x"\n"r2" 2 "y"\n/);
+  }
+  
+  # write_table - matrix
+  {
+    my $m1 = matrix(se('1:6'), 2, 3);
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->write_table($m1, $tmp->filename, {quote => F});
+    my $text = do { open my $fh, '<', $tmp->filename or die $!; local $/; <$fh> };
+    is($text, "V1 V2 V3\n1 1 3 5\n2 2 4 6\n");
+  }
+  
+  # write_csv
+  {
+    my $d1 = data_frame(a => c(1, 2), b => c('x"', 'y'));
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->write_csv($d1, $tmp->filename);
+    my $text = do { open my $fh, '<', $tmp->filename or die $!; local $/; <$fh> };
+    is($text, qq/"","a","b"\n"1",1,"x"""\n"2",2,"y"\n/);
+  }
+  
+  # write_table - gzip and blocks formatted in threads
+  SKIP: {
+    skip 'Rstats is built without zlib', 1 unless $has_gzip;
+    
+    my $d1 = data_frame(id => se('1:20000'), value => se('1:20000') / 4);
+    my $tmp = File::Temp->new(SUFFIX => '.gz');
+    close $tmp;
+    
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    r->write_table($d1, $tmp->filename, {sep => ','});
+    Rstats::Util::set_thread_count($thread_count);
+    
+    my $d2 = r->read_table($tmp->filename, {sep => ',', header => T});
+    is($d2->getin(1)->length_value, 20000);
+    is_deeply($d2->getin(2)->values, $d1->getin(1)->values);
+    is_deeply($d2->getin(3)->values, $d1->getin(2)->values);
+  }
+  
+  # write_table - interned character matrix formatted in threads
+  {
+    my $values = [map { "s" . ($_ % 1000) } 1 .. 200000];
+    my $m1 = matrix(c($values), 100000, 2);
+    $m1->vector($m1->vector->intern);
+    my $tmp = File::Temp->new;
+    close $tmp;
+    
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    r->write_table($m1, $tmp->filename, {'row.names' => F});
+    Rstats::Util::set_thread_count($thread_count);
+    
+    my $d2 = r->read_table($tmp->filename, {header => T, colClasses => 'character'});
+    is_deeply($d2->getin(1)->values, [@$values[0 .. 99999]]);
+    is_deeply($d2->getin(2)->values, [@$values[100000 .. 199999]]);
+  }
+}
+
+# save_binary
+{
+  # save_binary - data frame
+  {
+    my $d1 = data_frame(
+      name => c('a', "caf\x{e9}", NA),
+      value => c(1.5, NA, 1/3),
+      count => c(1, 2, 3)->as_integer,
+      flag => c(T, F, NA),
+      z => c(r->complex(1, 2), r->complex(-1, -1), r->complex(0, 0))
+    );
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->save_binary($d1, $tmp->filename);
+    my $d2 = r->load_binary($tmp->filename);
+    ok($d2->is_data_frame);
+    is_deeply($d2->names->values, [qw/name value count flag z/]);
+    ok($d2->getin(1)->is_factor);
+    is_deeply($d2->getin(1)->levels->values, ['a', "caf\x{e9}"]);
+    is_deeply($d2->getin(1)->as_character->values, ['a', "caf\x{e9}", undef]);
+    is_deeply($d2->getin(2)->values, [1.5, undef, 1/3]);
+    ok($d2->getin(3)->is_integer);
+    is_deeply($d2->getin(3)->values, [1, 2, 3]);
+    is_deeply($d2->getin(4)->values, [1, 0, undef]);
+    is_deeply($d2->getin(5)->values, $d1->getin(5)->values);
+    
+    # Loaded values can be changed without changing the file
+    my $x1 = $d2->getin(2);
+    $x1->at(1);
+    $x1->set(5);
+    is_deeply($x1->values, [5, undef, 1/3]);
+    is_deeply(r->load_binary($tmp->filename)->getin(2)->values, [1.5, undef, 1/3]);
+  }
+  
+  # save_binary - matrix, list and long vectors
+  {
+    my $m1 = matrix(se('1:6'), 2, 3);
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->save_binary($m1, $tmp->filename);
+    my $m2 = r->load_binary($tmp->filename);
+    ok($m2->is_matrix);
+    is_deeply($m2->dim->values, [2, 3]);
+    is_deeply($m2->values, [1 .. 6]);
+    
+    my $l1 = list(c('x' x 100, 'y'), se('1:10000'));
+    r->save_binary($l1, $tmp->filename);
+    my $l2 = r->load_binary($tmp->filename);
+    is_deeply($l2->getin(1)->values, ['x' x 100, 'y']);
+    is_deeply($l2->getin(2)->values, [1 .. 10000]);
+  }
+  
+  # load_binary - broken file
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "RSTATSB\0" . "\0" x 100;
+    close $tmp;
+    eval { r->load_binary($tmp->filename) };
+    like($@, qr/broken binary file/);
+  }
+  
+  # load_binary - meta data is parsed without creating other objects
+  {
+    my $tmp = File::Temp->new;
+    close $tmp;
+    Rstats::BinaryFile->save($tmp->filename, [], "object File::Temp 0\n");
+    eval { r->load_binary($tmp->filename) };
+    like($@, qr/File::Temp object can't be loaded/);
+    
+    Rstats::BinaryFile->save($tmp->filename, [], "object Rstats::Array 1\nscalar 6:vector\nvector 0\n");
+    eval { r->load_binary($tmp->filename) };
+    like($@, qr/broken binary file/);
+    
+    Rstats::BinaryFile->save($tmp->filename, [], "array 1\nscalar 10:abc\n");
+    eval { r->load_binary($tmp->filename) };
+    like($@, qr/broken binary file/);
+    
+    eval { r->save_binary(bless({}, 'Rstats::Container'), $tmp->filename) };
+    like($@, qr/Can't save Rstats::Container object/);
+  }
+}
+
+# read_arrow
+{
+  # read_arrow - file of pyarrow(two record batches)
+  {
+    my $d1 = r->read_arrow("$FindBin::Bin/data/read.t/pyarrow.arrow");
+    ok($d1->is_data_frame);
+    is_deeply($d1->names->values, [qw/i8 i32 u64 f32 f64 b s ls f/]);
+    ok($d1->getin('i8')->is_integer);
+    is_deeply($d1->getin('i8')->values, [-1, undef, 3]);
+    is_deeply($d1->getin('i32')->values, [100000, 2, undef]);
+    ok($d1->getin('u64')->is_double);
+    is_deeply($d1->getin('u64')->values, [1, 2 ** 63, 3]);
+    is_deeply($d1->getin('f32')->values, [0.5, undef, 1.5]);
+    is_deeply($d1->getin('f64')->values, [1.25, 2.5, undef]);
+    ok($d1->getin('b')->is_logical);
+    is_deeply($d1->getin('b')->values, [1, undef, 0]);
+    ok($d1->getin('s')->is_character);
+    is_deeply($d1->getin('s')->values, ['a', undef, "\x{3042}"]);
+    is_deeply($d1->getin('ls')->values, ['x', 'yy', '']);
+    ok($d1->getin('f')->is_factor);
+    is_deeply($d1->getin('f')->levels->values, [qw/lo hi/]);
+    is_deeply($d1->getin('f')->as_character->values, ['hi', 'lo', undef]);
+  }
+  
+  # write_arrow - round trip
+  {
+    my $d1 = data_frame(
+      value => c(1.5, NA, 1/3),
+      count => c(1, 2, NA)->as_integer,
+      flag => c(T, F, NA),
+      name => r->I(c('a', "caf\x{e9}", NA)),
+      level => r->factor(c('lo', 'hi', 'lo'), {levels => c('lo', 'hi'), ordered => T})
+    );
+    my $tmp = File::Temp->new;
+    close $tmp;
+    r->write_arrow($d1, $tmp->filename);
+    my $d2 = r->read_arrow($tmp->filename);
+    is_deeply($d2->names->values, [qw/value count flag name level/]);
+    is_deeply($d2->getin(1)->values, [1.5, undef, 1/3]);
+    ok($d2->getin(2)->is_integer);
+    is_deeply($d2->getin(2)->values, [1, 2, undef]);
+    is_deeply($d2->getin(3)->values, [1, 0, undef]);
+    is_deeply($d2->getin(4)->values, ['a', "caf\x{e9}", undef]);
+    ok($d2->getin(5)->is_ordered);
+    is_deeply($d2->getin(5)->levels->values, [qw/lo hi/]);
+    is_deeply($d2->getin(5)->values, [1, 2, 1]);
+    
+    # Loaded values can be changed without changing the file
+    my $x1 = $d2->getin(1);
+    $x1->at(1);
+    $x1->set(5);
+    is_deeply($x1->values, [5, undef, 1/3]);
+    is_deeply(r->read_arrow($tmp->filename)->getin(1)->values, [1.5, undef, 1/3]);
+  }
+  
+  # write_arrow - complex column
+  {
+    my $tmp = File::Temp->new;
+    close $tmp;
+    eval { r->write_arrow(data_frame(z => c(r->complex(1, 2))), $tmp->filename) };
+    like($@, qr/complex column 'z' can't be written/);
+  }
+  
+  # read_arrow - broken file
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "ARROW1\0\0" . "\0" x 100 . "ARROW1";
+    close $tmp;
+    eval { r->read_arrow($tmp->filename) };
+    like($@, qr/broken arrow file/);
+  }
 }
 
+# mmap_vector
+{
+  # mmap_vector - double, streamed over chunks
+  {
+    my @values = map { ($_ * 7919) % 600000 } (1 .. 600000);
+    my $tmp = File::Temp->new;
+    binmode $tmp;
+    print $tmp pack('d*', @values);
+    close $tmp;
+    my $x1 = r->mmap_vector($tmp->filename);
+    ok($x1->is_double);
+    is($x1->length_value, 600000);
+    is(r->sum($x1)->value, 599999 * 600000 / 2);
+    is(r->mean($x1)->value, 599999 / 2);
+    is_deeply(r->sort($x1)->values, [0 .. 599999]);
+  }
+  
+  # mmap_vector - external sort
+  {
+    my @values = ((map { ($_ * 37) % 1000 - 500 } (1 .. 5000)), 'nan');
+    my $tmp = File::Temp->new;
+    binmode $tmp;
+    print $tmp pack('d*', @values);
+    close $tmp;
+    my $x1 = r->mmap_vector($tmp->filename);
+    my $sort_memory = Rstats::Util::get_sort_memory();
+    Rstats::Util::set_sort_memory(1024);
+    my $x2 = r->sort($x1);
+    my $x3 = r->sort($x1, {decreasing => TRUE});
+    Rstats::Util::set_sort_memory($sort_memory);
+    my @sorted = sort { $a <=> $b } grep { $_ eq $_ + 0 } @values;
+    is($x2->length_value, 5000);
+    is_deeply($x2->values, \@sorted);
+    is_deeply($x3->values, [reverse @sorted]);
+  }
+  
+  # mmap_vector - integer, copy-on-write
+  {
+    my $tmp = File::Temp->new;
+    binmode $tmp;
+    print $tmp pack('q*', 3, -1, 2);
+    close $tmp;
+    my $x1 = r->mmap_vector($tmp->filename, {what => 'integer', readonly => FALSE});
+    ok($x1->is_integer);
+    is_deeply(r->sort($x1)->values, [-1, 2, 3]);
+    ok(r->sort($x1)->is_integer);
+    is(r->sum($x1)->value, 4);
+    $x1->at(2);
+    $x1->set(5);
+    is_deeply($x1->values, [3, 5, 2]);
+    is_deeply(r->mmap_vector($tmp->filename, {what => 'integer'})->values, [3, -1, 2]);
+  }
+  
+  # mmap_vector - size is not a multiple of 8
+  {
+    my $tmp = File::Temp->new;
+    print $tmp "abc";
+    close $tmp;
+    eval { r->mmap_vector($tmp->filename) };
+    like($@, qr/not a multiple of 8/);
+  }
+}
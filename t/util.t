@@ -133,6 +133,22 @@ use Rstats::Util;
     my $ret = Rstats::Util::looks_like_double($num_str);
     cmp_ok($ret, "==", 5.23);
   }
+  
+  # looks_like_double - exponent, Inf and integer
+  {
+    cmp_ok(Rstats::Util::looks_like_double(" -1.5e3 "), "==", -1500);
+    cmp_ok(Rstats::Util::looks_like_double(".5"), "==", 0.5);
+    cmp_ok(Rstats::Util::looks_like_double("-Inf"), "==", -9**9**9);
+    cmp_ok(Rstats::Util::looks_like_double("+7"), "==", 7);
+  }
+  
+  # looks_like_double - not double
+  {
+    ok(!defined Rstats::Util::looks_like_double("1.2.3"));
+    ok(!defined Rstats::Util::looks_like_double("e5"));
+    ok(!defined Rstats::Util::looks_like_double("2i"));
+    ok(!defined Rstats::Util::looks_like_double(""));
+  }
 }
 
 # looks_like_integer
@@ -143,6 +159,13 @@ use Rstats::Util;
     my $ret = Rstats::Util::looks_like_integer($num_str);
     cmp_ok($ret, "==", 5);
   }
+  
+  # looks_like_integer - not integer
+  {
+    ok(!defined Rstats::Util::looks_like_integer("5.5"));
+    ok(!defined Rstats::Util::looks_like_integer("1e3"));
+    ok(!defined Rstats::Util::looks_like_integer("TRUE"));
+  }
 }
 
 # cross_product
@@ -206,4 +229,36 @@ use Rstats::Util;
     my $value = Rstats::Util::index_to_pos([3, 3, 2], $dim);
     is($value, 22);
   }
-}
\ No newline at end of file
+}
+
+# pool_stats
+{
+  # pool_stats - blocks are reused
+  {
+    # Blocks of the sizes are put in free lists first
+    Rstats::VectorFunc::new_double(1 .. 10);
+    my $stats1 = Rstats::Util::pool_stats();
+    is(scalar @{$stats1->{classes}}, 6);
+    is($stats1->{classes}[0]{size}, 16);
+    {
+      my $x1 = Rstats::VectorFunc::new_double(1 .. 10);
+      my $stats2 = Rstats::Util::pool_stats();
+      my $in_use1 = 0;
+      $in_use1 += $_->{in_use} for @{$stats1->{classes}};
+      my $in_use2 = 0;
+      $in_use2 += $_->{in_use} for @{$stats2->{classes}};
+      is($in_use2 - $in_use1, 2);
+    }
+    my $stats3 = Rstats::Util::pool_stats();
+    is_deeply($stats3, $stats1);
+  }
+
+  # pool_stats - large buffer
+  {
+    my $stats1 = Rstats::Util::pool_stats();
+    my $x1 = Rstats::VectorFunc::new_double(1 .. 100);
+    my $stats2 = Rstats::Util::pool_stats();
+    is($stats2->{large_in_use} - $stats1->{large_in_use}, 1);
+    is($stats2->{large_bytes} - $stats1->{large_bytes}, 800);
+  }
+}
@@ -107,3 +107,299 @@ use Rstats;
     is($e1->value->{im}, 2.5);
   }
 }
+
+# bulk export
+{
+  # bulk export - raw_values double
+  {
+    my $e1 = Rstats::VectorFunc::new_double(1.5, undef, 'Inf', 'NaN');
+    my $values = $e1->raw_values;
+    is($values->[0], 1.5);
+    ok(!defined $values->[1]);
+    ok($values->[2] > 0 && $values->[2] == $values->[2] * 2);
+    ok($values->[3] != $values->[3]);
+  }
+
+  # bulk export - raw_values integer
+  {
+    my $e1 = Rstats::VectorFunc::new_integer(1, 2, undef);
+    is_deeply($e1->raw_values, [1, 2, undef]);
+  }
+
+  # bulk export - packed_values double
+  {
+    my $e1 = Rstats::VectorFunc::new_double(1.5, 2.5, undef);
+    my @values = unpack('d*', $e1->packed_values);
+    is_deeply([@values[0, 1]], [1.5, 2.5]);
+    ok($values[2] != $values[2]);
+  }
+
+  # bulk export - packed_values integer
+  {
+    my $e1 = Rstats::VectorFunc::new_integer(3, 4, 5);
+    is_deeply([unpack('j*', $e1->packed_values)], [3, 4, 5]);
+  }
+
+  # bulk export - packed_values complex
+  {
+    my $e1 = Rstats::VectorFunc::new_complex({re => 1, im => 2}, {re => 3, im => 4});
+    is_deeply([unpack('d*', $e1->packed_values)], [1, 2, 3, 4]);
+  }
+
+  # bulk export - re_values and im_values
+  {
+    my $e1 = Rstats::VectorFunc::new_complex({re => 1, im => 2}, undef, {re => 3, im => 4});
+    is_deeply($e1->re_values, [1, undef, 3]);
+    is_deeply($e1->im_values, [2, undef, 4]);
+  }
+}
+
+# buffer
+{
+  # buffer - new_double_from_buffer
+  {
+    my $e1 = Rstats::Vector::new_double_from_buffer(pack('d*', 1.5, 2.5, 3.5));
+    is($e1->type, 'double');
+    is_deeply($e1->values, [1.5, 2.5, 3.5]);
+  }
+
+  # buffer - new_double_from_buffer, invalid size
+  {
+    eval { Rstats::Vector::new_double_from_buffer("abc") };
+    like($@, qr/multiple/);
+  }
+
+  # buffer - new_integer_from_buffer
+  {
+    my $e1 = Rstats::Vector::new_integer_from_buffer(pack('j*', 1, -2, 3));
+    is($e1->type, 'integer');
+    is_deeply($e1->values, [1, -2, 3]);
+  }
+
+  # buffer - new_integer_from_buffer, 32bit elements
+  {
+    my $e1 = Rstats::Vector::new_integer_from_buffer(pack('l*', 4, -5), 4);
+    is_deeply($e1->values, [4, -5]);
+  }
+
+  # buffer - buffer
+  {
+    my $e1 = Rstats::VectorFunc::new_double(1.5, 2.5);
+    my $buffer_ref = \$e1->buffer;
+    undef $e1;
+    is_deeply([unpack('d*', $$buffer_ref)], [1.5, 2.5]);
+    eval { $$buffer_ref = 'x' };
+    like($@, qr/read-only/);
+  }
+}
+
+# shared constants
+{
+  # shared constants - same object
+  {
+    is(${Rstats::VectorFunc::NA()}, ${Rstats::VectorFunc::NA()});
+    is(${Rstats::VectorFunc::TRUE()}, ${Rstats::VectorFunc::TRUE()});
+    is(${Rstats::VectorFunc::new_integer(5)}, ${Rstats::VectorFunc::new_integer(5)});
+  }
+
+  # shared constants - survive DESTROY
+  {
+    { my $e1 = Rstats::VectorFunc::NA(); }
+    { my $e1 = Rstats::VectorFunc::new_integer(3); }
+    { my $e1 = Rstats::VectorFunc::FALSE(); }
+    my $e1 = Rstats::VectorFunc::NA();
+    ok($e1->is_na->value);
+    is(Rstats::VectorFunc::new_integer(3)->value, 3);
+    is(Rstats::VectorFunc::FALSE()->value, 0);
+  }
+
+  # shared constants - large integer is not shared
+  {
+    isnt(${Rstats::VectorFunc::new_integer(100000)}, ${Rstats::VectorFunc::new_integer(100000)});
+  }
+}
+
+# inline values
+{
+  # inline values - short vectors
+  {
+    ok(Rstats::VectorFunc::new_double(1.5)->is_inline_values);
+    ok(Rstats::VectorFunc::new_double(1.5, 2.5)->is_inline_values);
+    ok(Rstats::VectorFunc::new_complex({re => 1, im => 2})->is_inline_values);
+    ok(Rstats::VectorFunc::new_character("a")->is_inline_values);
+  }
+
+  # inline values - long vectors
+  {
+    my $e1 = Rstats::VectorFunc::new_double(1.5, 2.5, 3.5);
+    ok(!$e1->is_inline_values);
+    is_deeply($e1->values, [1.5, 2.5, 3.5]);
+    my $e2 = Rstats::VectorFunc::new_complex({re => 1, im => 2}, {re => 3, im => 4});
+    ok(!$e2->is_inline_values);
+    is_deeply($e2->re_values, [1, 3]);
+  }
+
+  # inline values - character
+  {
+    my $e1 = Rstats::VectorFunc::new_character("a", "b");
+    is_deeply($e1->values, ["a", "b"]);
+  }
+
+  # inline values - null
+  {
+    my $e1 = Rstats::VectorFunc::new_null();
+    ok(!$e1->is_inline_values);
+    is_deeply($e1->values, []);
+  }
+}
+
+# character storage
+{
+  # character storage - utf8
+  {
+    my $e1 = Rstats::VectorFunc::new_character("caf\x{e9}", "\x{3042}", "abc");
+    is_deeply($e1->values, ["caf\x{e9}", "\x{3042}", "abc"]);
+    ok(utf8::is_utf8($e1->values->[1]));
+  }
+
+  # character storage - latin-1 string is upgraded
+  {
+    my $e1 = Rstats::VectorFunc::new_character("caf\x{e9}");
+    my $e2 = Rstats::VectorFunc::new_character("\x{3042}");
+    my $e3 = Rstats::Vector->compose("character", [$e1, $e2]);
+    is_deeply($e3->values, ["caf\x{e9}", "\x{3042}"]);
+  }
+
+  # character storage - compare
+  {
+    my $e1 = Rstats::VectorFunc::new_character("ab", "b", "abc", "\x{3042}");
+    my $e2 = Rstats::VectorFunc::new_character("abc", "a", "abc", "caf\x{e9}");
+    is_deeply(Rstats::VectorFunc::less_than($e1, $e2)->values, [1, 0, 0, 0]);
+    is_deeply(Rstats::VectorFunc::equal($e1, $e2)->values, [0, 0, 1, 0]);
+  }
+
+  # character storage - repeated
+  {
+    my $e1 = Rstats::VectorFunc::new_character("x", "y", "z");
+    my $e2 = $e1->clone;
+    is_deeply($e2->values, ["x", "y", "z"]);
+  }
+}
+
+# number formatting
+{
+  # number formatting - double
+  {
+    my $e1 = Rstats::VectorFunc::new_double(0.1 + 0.2, 1/3, 1e20, 123456, 1e-5, 0.0001, -2.5, 1e15, 100000, 0, -0.0);
+    is_deeply(
+      $e1->as_character->values,
+      ["0.3", "0.333333333333333", "1e+20", "123456", "1e-05", "0.0001", "-2.5", "1e+15", "100000", "0", "0"]
+    );
+  }
+
+  # number formatting - digits
+  {
+    my $e1 = Rstats::VectorFunc::new_double(3.14159, 0.1 + 0.2, 123456, 1e-5);
+    is_deeply($e1->as_character(3)->values, ["3.14", "0.3", "1.23e+05", "1e-05"]);
+    is_deeply($e1->as_character(17)->values, ["3.14159", "0.30000000000000004", "123456", "1e-05"]);
+  }
+
+  # number formatting - not finite, integer and complex
+  {
+    my $e1 = Rstats::Vector->compose(
+      "double",
+      [Rstats::VectorFunc::new_inf(), Rstats::VectorFunc::new_negative_inf(), Rstats::VectorFunc::new_nan()]
+    );
+    is_deeply($e1->as_character->values, ["Inf", "-Inf", "NaN"]);
+    my $e2 = Rstats::VectorFunc::new_integer(-12, 0, 2147483647);
+    is_deeply($e2->as_character->values, ["-12", "0", "2147483647"]);
+    my $e3 = Rstats::VectorFunc::new_complex({re => 1.5, im => -2}, {re => 0, im => 1/3});
+    is_deeply($e3->as_character->values, ["1.5-2i", "0+0.333333333333333i"]);
+  }
+}
+
+# type_convert
+{
+  # type_convert - each type
+  {
+    my $e1 = Rstats::VectorFunc::type_convert(Rstats::VectorFunc::new_character("T", "NA", "FALSE"));
+    is($e1->type, "logical");
+    is_deeply($e1->values, [1, undef, 0]);
+    my $e2 = Rstats::VectorFunc::type_convert(Rstats::VectorFunc::new_character("1", "NA", " -20 ", "TRUE"));
+    is($e2->type, "integer");
+    is_deeply($e2->values, [1, undef, -20, 1]);
+    my $e3 = Rstats::VectorFunc::type_convert(Rstats::VectorFunc::new_character("1", "2.5", "1e2"));
+    is($e3->type, "double");
+    is_deeply($e3->values, [1, 2.5, 100]);
+    my $e4 = Rstats::VectorFunc::type_convert(Rstats::VectorFunc::new_character("1", "2.5", "1-2i"));
+    is($e4->type, "complex");
+    is_deeply($e4->values, [{re => 1, im => 0}, {re => 2.5, im => 0}, {re => 1, im => -2}]);
+    my $e5 = Rstats::VectorFunc::type_convert(Rstats::VectorFunc::new_character("1", "a", "NA"));
+    is($e5->type, "character");
+    is_deeply($e5->values, ["1", "a", "NA"]);
+  }
+}
+
+# interned character
+{
+  # interned character - values
+  {
+    my $e1 = Rstats::VectorFunc::new_character("a", "b", "a", "caf\x{e9}", undef)->intern;
+    ok($e1->is_interned);
+    is_deeply($e1->values, ["a", "b", "a", "caf\x{e9}", undef]);
+    ok($e1->clone->is_interned);
+  }
+
+  # interned character - strings are shared and freed
+  {
+    my $count1 = Rstats::Util::interned_string_count();
+    {
+      my $e1 = Rstats::VectorFunc::new_character("x1", "x2", "x1")->intern;
+      my $e2 = Rstats::VectorFunc::new_character("x2", "x3")->intern;
+      is(Rstats::Util::interned_string_count() - $count1, 3);
+    }
+    is(Rstats::Util::interned_string_count(), $count1);
+  }
+
+  # interned character - equal
+  {
+    my $e1 = Rstats::VectorFunc::new_character("a", "b", "caf\x{e9}")->intern;
+    my $e2 = Rstats::VectorFunc::new_character("a", "c", "caf\x{e9}")->intern;
+    my $e3 = Rstats::VectorFunc::new_character("a", "b", "caf\x{e9}");
+    is_deeply(Rstats::VectorFunc::equal($e1, $e2)->values, [1, 0, 1]);
+    is_deeply(Rstats::VectorFunc::equal($e1, $e3)->values, [1, 1, 1]);
+    is_deeply(Rstats::VectorFunc::less_than($e1, $e2)->values, [0, 1, 0]);
+  }
+
+  # interned character - match
+  {
+    my $e1 = Rstats::VectorFunc::new_character("b", "z", undef, "a");
+    my $e2 = Rstats::VectorFunc::new_character("a", "b", "b");
+    is_deeply(Rstats::VectorFunc::match($e1, $e2)->values, [2, undef, undef, 1]);
+    is_deeply(Rstats::VectorFunc::match($e1->intern, $e2->intern)->values, [2, undef, undef, 1]);
+  }
+
+  # interned character - unique
+  {
+    my $e1 = Rstats::VectorFunc::new_character("b", "a", undef, "b", undef, "c");
+    is_deeply(Rstats::VectorFunc::unique($e1)->values, ["b", "a", undef, "c"]);
+    is_deeply(Rstats::VectorFunc::unique($e1->intern)->values, ["b", "a", undef, "c"]);
+  }
+}
+
+# thread pool
+{
+  # thread pool - fixed search is split into threads
+  {
+    my $thread_count = Rstats::Util::get_thread_count();
+    Rstats::Util::set_thread_count(4);
+    my @strs = map { $_ % 3 == 0 ? "row$_ ERROR" : "row$_ ok" } (0 .. 99999);
+    my $e1 = Rstats::VectorFunc::new_character(@strs);
+    my $e2 = Rstats::VectorFunc::new_character("ERROR");
+    my $e3 = Rstats::VectorFunc::grepl($e2, $e1, 0, 1);
+    is_deeply($e3->values, [map { $_ =~ /ERROR/ ? 1 : 0 } @strs]);
+    my $e4 = Rstats::VectorFunc::grep($e2, $e1, 0, 1);
+    is($e4->length_value, 33334);
+    Rstats::Util::set_thread_count($thread_count);
+  }
+}